@@ -0,0 +1,109 @@
+#include <benchmark/benchmark.h>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "baldr/graphreader.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+constexpr uint32_t kTileCount = 4096;
+constexpr size_t kTileSize = 1024;
+
+class BenchGraphMemory final : public GraphMemory {
+public:
+  BenchGraphMemory() : memory_(sizeof(GraphTileHeader)) {
+    data = const_cast<char*>(memory_.data());
+    size = memory_.size();
+  }
+
+private:
+  const std::vector<char> memory_;
+};
+
+struct BenchGraphTile : public GraphTile {
+  BenchGraphTile(GraphId id, size_t size) {
+    memory_ = std::make_unique<const BenchGraphMemory>();
+    header_ = reinterpret_cast<GraphTileHeader*>(memory_->data);
+    header_->set_graphid(id);
+    header_->set_end_offset(size);
+  }
+};
+
+std::vector<GraphId> make_tile_ids() {
+  std::vector<GraphId> ids;
+  ids.reserve(kTileCount);
+  for (uint32_t i = 0; i < kTileCount; ++i) {
+    ids.emplace_back(i, 2, 0);
+  }
+  return ids;
+}
+
+const std::vector<GraphId> tile_ids = make_tile_ids();
+
+// Returns the cache shared by all benchmark threads. A shard count of 0 means the
+// single mutex SynchronizedTileCache, anything else a ShardedTileCache of LRU shards
+TileCache& get_cache(size_t shard_count) {
+  static std::mutex caches_mutex;
+  static std::unordered_map<size_t, std::unique_ptr<TileCache>> caches;
+  static TileCacheLRU synchronized_lru(kTileCount * kTileSize,
+                                       TileCacheLRU::MemoryLimitControl::HARD);
+  static std::mutex synchronized_mutex;
+
+  std::lock_guard<std::mutex> lock(caches_mutex);
+  auto found = caches.find(shard_count);
+  if (found != caches.end()) {
+    return *found->second;
+  }
+
+  std::unique_ptr<TileCache> cache;
+  if (shard_count == 0) {
+    cache.reset(new SynchronizedTileCache(synchronized_lru, synchronized_mutex));
+  } else {
+    std::vector<std::unique_ptr<TileCache>> shards;
+    for (size_t i = 0; i < shard_count; ++i) {
+      shards.emplace_back(new TileCacheLRU(kTileCount * kTileSize,
+                                           TileCacheLRU::MemoryLimitControl::HARD));
+    }
+    cache.reset(new ShardedTileCache(std::move(shards)));
+  }
+
+  // fill it up before anyone starts reading
+  for (const auto& id : tile_ids) {
+    cache->Put(id, new BenchGraphTile(id, kTileSize), kTileSize);
+  }
+  return *caches.emplace(shard_count, std::move(cache)).first->second;
+}
+
+// Hammers the cache with lookups from many threads at once. We only check for
+// existence so that the tiles' reference counters are not touched concurrently
+// (they are only thread safe with ENABLE_THREAD_SAFE_TILE_REF_COUNT)
+void BM_TileCacheLookup(benchmark::State& state) {
+  TileCache& cache = get_cache(state.range(0));
+  std::mt19937 gen(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  std::uniform_int_distribution<uint32_t> dist(0, kTileCount - 1);
+
+  size_t hits = 0;
+  for (auto _ : state) {
+    hits += cache.Contains(tile_ids[dist(gen)]);
+  }
+  benchmark::DoNotOptimize(hits);
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_TileCacheLookup)
+    ->ArgName("shards")
+    ->Arg(0)
+    ->Arg(8)
+    ->Arg(32)
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
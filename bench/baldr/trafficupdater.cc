@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "baldr/graphtile.h"
+#include "baldr/trafficupdater.h"
+
+#include "microtar.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+constexpr uint32_t kTileCount = 256;
+constexpr uint32_t kEdgeCount = 16384;
+constexpr size_t kUpdateCount = 1 << 20;
+
+// one extract per kind of tile so that both can be benchmarked in the same run
+const std::string& get_extract(bool double_buffered) {
+  static const std::string extracts[] = {"test/data/traffic_updater_bench_single.tar",
+                                         "test/data/traffic_updater_bench_double.tar"};
+  static bool written[] = {false, false};
+  const auto& extract = extracts[double_buffered];
+  if (!written[double_buffered]) {
+    mtar_t tar;
+    if (mtar_open(&tar, extract.c_str(), "w") != MTAR_ESUCCESS) {
+      throw std::runtime_error("Could not open " + extract + " for writing");
+    }
+    for (uint32_t i = 0; i < kTileCount; ++i) {
+      const GraphId tile_id(i, 2, 0);
+      auto bytes = TrafficUpdater::CreateTile(tile_id, kEdgeCount, double_buffered);
+      auto name = GraphTile::FileSuffix(tile_id);
+      mtar_write_file_header(&tar, name.c_str(), bytes.size());
+      mtar_write_data(&tar, bytes.data(), bytes.size());
+    }
+    mtar_finalize(&tar);
+    mtar_close(&tar);
+    written[double_buffered] = true;
+  }
+  return extract;
+}
+
+std::vector<TrafficUpdate> make_updates() {
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<uint32_t> tile(0, kTileCount - 1);
+  std::uniform_int_distribution<uint32_t> edge(0, kEdgeCount - 1);
+  std::uniform_int_distribution<uint32_t> speed(1, 127);
+  std::vector<TrafficUpdate> updates;
+  updates.reserve(kUpdateCount);
+  for (size_t i = 0; i < kUpdateCount; ++i) {
+    const auto s = speed(generator);
+    updates.push_back({GraphId(tile(generator), 2, edge(generator)),
+                       TrafficSpeed(s, s, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW, 255,
+                                    0, 0, 0, 0, false)});
+  }
+  return updates;
+}
+
+const std::vector<TrafficUpdate> updates = make_updates();
+
+// Stages a batch of updates spread over the whole extract and publishes them
+void BM_StageAndPublish(benchmark::State& state, bool double_buffered) {
+  TrafficUpdater updater(get_extract(double_buffered));
+  const std::vector<TrafficUpdate> batch(updates.begin(), updates.begin() + state.range(0));
+  for (auto _ : state) {
+    updater.Stage(batch);
+    benchmark::DoNotOptimize(updater.Publish(0));
+  }
+  state.SetItemsProcessed(state.iterations() * batch.size());
+}
+
+BENCHMARK_CAPTURE(BM_StageAndPublish, single_buffered, false)
+    ->Unit(benchmark::kMillisecond)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, kUpdateCount);
+BENCHMARK_CAPTURE(BM_StageAndPublish, double_buffered, true)
+    ->Unit(benchmark::kMillisecond)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, kUpdateCount);
+
+// Same as above but parsing the updates from a csv stream
+void BM_StageStreamAndPublish(benchmark::State& state) {
+  TrafficUpdater updater(get_extract(true));
+  std::string csv;
+  for (auto i = 0; i < state.range(0); ++i) {
+    const auto& update = updates[i];
+    csv += std::to_string(update.edge_id.level()) + '/' + std::to_string(update.edge_id.tileid()) +
+           '/' + std::to_string(update.edge_id.id()) + ',' +
+           std::to_string(update.speed.get_overall_speed()) + ",10\n";
+  }
+  for (auto _ : state) {
+    std::istringstream stream(csv);
+    updater.Stage(stream);
+    benchmark::DoNotOptimize(updater.Publish(0));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * csv.size());
+}
+
+BENCHMARK(BM_StageStreamAndPublish)
+    ->Unit(benchmark::kMillisecond)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, kUpdateCount);
+
+} // namespace
+
+BENCHMARK_MAIN();
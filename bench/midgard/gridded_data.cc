@@ -0,0 +1,150 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <string>
+
+#include "baldr/graphreader.h"
+#include "loki/worker.h"
+#include "midgard/gridded_data.h"
+#include "sif/costfactory.h"
+#include "test.h"
+#include "thor/isochrone.h"
+#include "worker.h"
+
+using namespace valhalla;
+using namespace valhalla::midgard;
+
+namespace {
+
+const auto config = test::json_to_pt(R"({
+    "mjolnir":{"tile_dir":"test/data/utrecht_tiles", "concurrency": 1},
+    "loki":{
+      "actions":["isochrone"],
+      "logging":{"long_request": 100},
+      "service_defaults":{"minimum_reachability": 50,"radius": 0,"search_cutoff": 35000, "node_snap_tolerance": 5, "street_side_tolerance": 5, "street_side_max_distance": 1000, "heading_tolerance": 60}
+    },
+    "thor":{
+      "logging":{"long_request": 100}
+    },
+    "meili":{
+      "grid": {"cache_size": 100240,"size": 500},
+      "default": {"breakage_distance": 2000}
+    },
+    "service_limits": {
+      "auto": {"max_distance": 5000000.0, "max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+      "auto_shorter": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+      "bicycle": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50},
+      "bus": {"max_distance": 5000000.0,"max_locations": 50,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+      "hov": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+      "taxi": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+      "isochrone": {"max_contours": 4,"max_distance": 25000.0,"max_locations": 1,"max_time_contour": 120, "max_distance_contour":200},
+      "max_avoid_locations": 50,"max_radius": 200,"max_reachability": 100,"max_alternates":2,
+      "multimodal": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 0.0,"max_matrix_locations": 0},
+      "pedestrian": {"max_distance": 250000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50,"max_transit_walking_distance": 10000,"min_transit_walking_distance": 1},
+      "skadi": {"max_shape": 750000,"min_resample": 10.0},
+      "trace": {"max_distance": 200000.0,"max_gps_accuracy": 100.0,"max_search_radius": 100,"max_shape": 16000,"max_best_paths":4,"max_best_paths_shape":100},
+      "transit": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50},
+      "truck": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50}
+    }
+  })");
+
+// Five time contours and, when there are two of them, five distance contours as well
+template <size_t dimensions_t>
+std::vector<typename GriddedData<dimensions_t>::contour_interval_t> intervals(const float seconds,
+                                                                             const float meters) {
+  std::vector<typename GriddedData<dimensions_t>::contour_interval_t> intervals;
+  for (int i = 1; i <= 5; ++i) {
+    intervals.emplace_back(0, seconds * i / 5, "time", "");
+    if (dimensions_t > 1) {
+      intervals.emplace_back(1, meters * i / 5, "distance", "");
+    }
+  }
+  return intervals;
+}
+
+// A square grid of the given number of tiles a side with the values growing away from a few
+// centers and some noise on top, so that it has more than one ring per contour
+std::shared_ptr<GriddedData<2>> synthetic_grid(const int size) {
+  constexpr float kTileSize = 0.001f;
+  const float max = std::numeric_limits<float>::max();
+  const GriddedData<2>::value_type unreached{max, max};
+  AABB2<PointLL> bounds({5.0, 52.0, 5.0 + size * kTileSize, 52.0 + size * kTileSize});
+  auto grid = std::make_shared<GriddedData<2>>(bounds, kTileSize, unreached);
+  std::mt19937 gen(0); // Seed with the same value for consistent benchmarking
+  std::uniform_real_distribution<float> noise(0, 120);
+  const std::vector<PointLL> centers{grid->Center(grid->TileId(size / 2, size / 2)),
+                                     grid->Center(grid->TileId(size / 5, size / 4)),
+                                     grid->Center(grid->TileId(size * 4 / 5, size * 2 / 3))};
+  for (int tile_id = 0; tile_id < grid->nrows() * grid->ncolumns(); ++tile_id) {
+    auto ll = grid->Base(tile_id);
+    float meters = max;
+    for (const auto& center : centers) {
+      meters = std::min(meters, static_cast<float>(center.Distance(ll)));
+    }
+    grid->SetIfLessThan(tile_id, {meters / 15 + noise(gen), meters + noise(gen) * 10});
+  }
+  return grid;
+}
+
+// The isotile of an hour's drive across Utrecht
+std::shared_ptr<const GriddedData<2>> utrecht_grid() {
+  Api request;
+  ParseApi(R"({"locations":[{"lat":52.078937,"lon":5.115321}],"costing":"auto",
+    "contours":[{"time":60}],"polygons":true})",
+           Options::isochrone, request);
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+  loki::loki_worker_t loki_worker(config);
+  loki_worker.isochrones(request);
+  sif::TravelMode mode;
+  auto mode_costing = sif::CostFactory().CreateModeCosting(request.options(), mode);
+  thor::Isochrone isochrone;
+  return isochrone.Compute(request, reader, mode_costing, mode);
+}
+
+static void BM_SyntheticContours(benchmark::State& state) {
+  const auto grid = synthetic_grid(state.range(0));
+  const uint32_t threads = state.range(1);
+  size_t rings = 0;
+  for (auto _ : state) {
+    auto contours = intervals<2>(3600, 50000);
+    auto result = grid->GenerateContours(contours, true, 0.f, kOptimalGeneralization, threads);
+    for (const auto& collection : result) {
+      rings += collection.front().size();
+    }
+  }
+  state.counters["Rings"] = benchmark::Counter(rings, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_SyntheticContours)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime()
+    ->ArgNames({"size", "threads"})
+    ->Args({250, 1})
+    ->Args({1000, 1})
+    ->Args({2000, 1})
+    ->Args({2000, 2})
+    ->Args({2000, 4})
+    ->Args({2000, 10});
+
+static void BM_UtrechtContours(benchmark::State& state) {
+  const auto grid = utrecht_grid();
+  const bool polygons = state.range(0);
+  const uint32_t threads = state.range(1);
+  for (auto _ : state) {
+    auto contours = intervals<2>(3600, 50000);
+    auto result =
+        grid->GenerateContours(contours, polygons, 1.f, kOptimalGeneralization, threads);
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+BENCHMARK(BM_UtrechtContours)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime()
+    ->ArgNames({"polygons", "threads"})
+    ->Args({0, 1})
+    ->Args({1, 1})
+    ->Args({1, 4});
+
+} // namespace
+
+BENCHMARK_MAIN();
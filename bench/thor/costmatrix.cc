@@ -4,12 +4,16 @@
 #include <random>
 #include <string>
 
+#include "baldr/contractionhierarchy.h"
 #include "baldr/graphreader.h"
 #include "loki/search.h"
 #include "midgard/pointll.h"
+#include "mjolnir/contractionhierarchybuilder.h"
 #include "sif/autocost.h"
 #include "sif/costfactory.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
+#include "thor/timedistancematrix.h"
 #include <valhalla/proto/options.pb.h>
 
 using namespace valhalla;
@@ -25,7 +29,8 @@ boost::property_tree::ptree json_to_pt(const std::string& json) {
 }
 
 const auto config = json_to_pt(R"({
-    "mjolnir":{"tile_dir":"test/data/utrecht_tiles", "concurrency": 1},
+    "mjolnir":{"tile_dir":"test/data/utrecht_tiles", "concurrency": 1,
+               "contraction_hierarchy":"test/data/utrecht_contraction_hierarchy.bin"},
     "loki":{
       "actions":["sources_to_targets"],
       "logging":{"long_request": 100},
@@ -60,11 +65,9 @@ const auto config = json_to_pt(R"({
 
 constexpr float kMaxRange = 256;
 
-static void BM_UtrechtCostMatrix(benchmark::State& state) {
-  const int size = state.range(0);
-  baldr::GraphReader reader(config.get_child("mjolnir"));
-
-  // Generate N random locations within the Utrect bounding box;
+// N random locations within the Utrecht bounding box, correlated to the graph
+google::protobuf::RepeatedPtrField<valhalla::Location>
+RandomLocations(const int size, baldr::GraphReader& reader, const sif::cost_ptr_t& cost) {
   std::vector<valhalla::baldr::Location> locations;
   const double min_lon = 5.0163;
   const double max_lon = 5.1622;
@@ -80,30 +83,53 @@ static void BM_UtrechtCostMatrix(benchmark::State& state) {
     locations.emplace_back(midgard::PointLL{lng_distribution(gen), lat_distribution(gen)});
   }
 
-  Options options;
-  options.set_costing(Costing::auto_);
-  rapidjson::Document doc;
-  sif::ParseCostingOptions(doc, "/costing_options", options);
-  sif::TravelMode mode;
-  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
-  auto cost = costs[static_cast<size_t>(mode)];
-
   const auto projections = loki::Search(locations, reader, cost);
   if (projections.size() == 0) {
     throw std::runtime_error("Found no matching locations");
   }
 
   google::protobuf::RepeatedPtrField<valhalla::Location> sources;
-
   for (const auto& projection : projections) {
     auto* p = sources.Add();
     baldr::PathLocation::toPBF(projection.second, p, reader);
   }
+  return sources;
+}
+
+// The default auto options, their mode and costing
+struct costing_t {
+  Options options;
+  sif::TravelMode mode;
+  sif::mode_costing_t costs;
+
+  costing_t() {
+    options.set_costing(Costing::auto_);
+    rapidjson::Document doc;
+    sif::ParseCostingOptions(doc, "/costing_options", options);
+    costs = sif::CostFactory().CreateModeCosting(options, mode);
+  }
+};
+
+static void BM_UtrechtCostMatrix(benchmark::State& state) {
+  const int size = state.range(0);
+  const uint32_t threads = state.range(1);
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+
+  Options options;
+  options.set_costing(Costing::auto_);
+  rapidjson::Document doc;
+  sif::ParseCostingOptions(doc, "/costing_options", options);
+  sif::TravelMode mode;
+  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
+  auto cost = costs[static_cast<size_t>(mode)];
+
+  const auto sources = RandomLocations(size, reader, cost);
 
   std::size_t result_size = 0;
 
+  const auto matrix_threads = thor::CostMatrix::MakeThreads(config.get_child("mjolnir"), threads);
   for (auto _ : state) {
-    thor::CostMatrix matrix;
+    thor::CostMatrix matrix(matrix_threads);
     auto result = matrix.SourceToTarget(sources, sources, reader, costs, mode, 100000.);
     result_size += result.size();
   }
@@ -111,10 +137,103 @@ static void BM_UtrechtCostMatrix(benchmark::State& state) {
 }
 
 BENCHMARK(BM_UtrechtCostMatrix)
+    ->Unit(benchmark::kMillisecond)
+    ->ArgNames({"size", "threads"})
+    ->RangeMultiplier(2)
+    ->Ranges({{1, kMaxRange}, {1, 1}});
+
+static void BM_UtrechtTimeDistanceMatrix(benchmark::State& state) {
+  const int size = state.range(0);
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+  costing_t costing;
+  const auto sources =
+      RandomLocations(size, reader, costing.costs[static_cast<size_t>(costing.mode)]);
+
+  for (auto _ : state) {
+    thor::TimeDistanceMatrix matrix;
+    auto result = matrix.SourceToTarget(sources, sources, reader, costing.costs, costing.mode,
+                                        100000.);
+    benchmark::DoNotOptimize(result);
+  }
+  state.counters["Routes"] = benchmark::Counter(size, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_UtrechtTimeDistanceMatrix)
+    ->Unit(benchmark::kMillisecond)
+    ->RangeMultiplier(2)
+    ->Range(1, kMaxRange);
+
+// The time invariant matrices above are what this is to be compared with, it expands forward
+// from every source like the time distance matrix does when there are as many targets
+static void BM_UtrechtTimeDependentMatrix(benchmark::State& state) {
+  const int size = state.range(0);
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+  costing_t costing;
+  auto sources = RandomLocations(size, reader, costing.costs[static_cast<size_t>(costing.mode)]);
+  const auto targets = sources;
+  for (auto& source : sources) {
+    source.set_date_time("2021-06-08T08:00");
+  }
+
+  for (auto _ : state) {
+    thor::TimeDistanceMatrix matrix;
+    auto result = matrix.TimeDependentSourceToTarget(sources, targets, reader, costing.costs,
+                                                     costing.mode, 100000.);
+    benchmark::DoNotOptimize(result);
+  }
+  state.counters["Routes"] = benchmark::Counter(size, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_UtrechtTimeDependentMatrix)
     ->Unit(benchmark::kMillisecond)
     ->RangeMultiplier(2)
     ->Range(1, kMaxRange);
 
+static void BM_UtrechtBucketMatrix(benchmark::State& state) {
+  const int size = state.range(0);
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+  costing_t costing;
+  const auto sources =
+      RandomLocations(size, reader, costing.costs[static_cast<size_t>(costing.mode)]);
+
+  // Contract the tiles the first time round
+  const auto file = config.get<std::string>("mjolnir.contraction_hierarchy");
+  baldr::ContractionHierarchy hierarchy;
+  if (!hierarchy.Load(file, reader)) {
+    mjolnir::ContractionHierarchyBuilder::Build(config);
+    if (!hierarchy.Load(file, reader)) {
+      state.SkipWithError("Could not build the contraction hierarchy");
+      return;
+    }
+  }
+
+  for (auto _ : state) {
+    thor::BucketMatrix matrix(hierarchy);
+    auto result = matrix.SourceToTarget(sources, sources, reader, costing.costs, costing.mode,
+                                        100000.);
+    benchmark::DoNotOptimize(result);
+  }
+  state.counters["Routes"] = benchmark::Counter(size, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// The same sizes as the others and then the sizes only it can do
+BENCHMARK(BM_UtrechtBucketMatrix)
+    ->Unit(benchmark::kMillisecond)
+    ->RangeMultiplier(2)
+    ->Range(1, kMaxRange)
+    ->Arg(1024)
+    ->Arg(2048);
+
+// How the matrix scales with the threads expanding its locations
+BENCHMARK(BM_UtrechtCostMatrix)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime()
+    ->ArgNames({"size", "threads"})
+    ->Args({200, 1})
+    ->Args({200, 2})
+    ->Args({200, 4})
+    ->Args({200, 8});
+
 } // namespace
 
 BENCHMARK_MAIN();
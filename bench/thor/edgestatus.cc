@@ -0,0 +1,142 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "baldr/graphtile.h"
+#include "thor/edgestatus.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::thor;
+
+namespace {
+
+// roughly the number of tiles and edges per tile a long level 2 route touches, in an 8x8 grid
+constexpr uint32_t kTileColumns = 8;
+constexpr uint32_t kTileCount = kTileColumns * kTileColumns;
+constexpr uint32_t kEdgesPerTile = 30000;
+constexpr size_t kExpansions = 200000;
+
+class BenchGraphMemory final : public GraphMemory {
+public:
+  BenchGraphMemory() : memory_(sizeof(GraphTileHeader)) {
+    data = const_cast<char*>(memory_.data());
+    size = memory_.size();
+  }
+
+private:
+  const std::vector<char> memory_;
+};
+
+struct BenchGraphTile : public GraphTile {
+  BenchGraphTile(GraphId id) {
+    memory_ = std::make_unique<const BenchGraphMemory>();
+    header_ = reinterpret_cast<GraphTileHeader*>(memory_->data);
+    header_->set_graphid(id);
+    header_->set_directededgecount(kEdgesPerTile);
+  }
+};
+
+// The way edge status used to be stored, kept here to compare against
+class UnorderedMapEdgeStatus {
+public:
+  ~UnorderedMapEdgeStatus() {
+    clear();
+  }
+  void clear() {
+    for (auto& iter : edgestatus_) {
+      delete[] iter.second;
+    }
+    edgestatus_.clear();
+  }
+  EdgeStatusInfo Get(const GraphId& edgeid) const {
+    const auto p = edgestatus_.find(edgeid.tile_value());
+    return (p == edgestatus_.end()) ? EdgeStatusInfo() : p->second[edgeid.id()];
+  }
+  void Set(const GraphId& edgeid, const EdgeSet set, const uint32_t index, graph_tile_ptr tile) {
+    auto p = edgestatus_.find(edgeid.tile_value());
+    if (p != edgestatus_.end()) {
+      p->second[edgeid.id()] = {set, index};
+    } else {
+      auto inserted = edgestatus_.emplace(edgeid.tile_value(),
+                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
+      inserted.first->second[edgeid.id()] = {set, index};
+    }
+  }
+  void Update(const GraphId& edgeid, const EdgeSet set) {
+    edgestatus_.find(edgeid.tile_value())->second[edgeid.id()].set_ = static_cast<uint32_t>(set);
+  }
+
+private:
+  std::unordered_map<uint32_t, EdgeStatusInfo*> edgestatus_;
+};
+
+struct expansion_t {
+  GraphId edgeid;
+  uint32_t tile_index;
+};
+
+// A made up search which, like the real ones, mostly stays within a tile for a while and
+// expands edges near the ones it just expanded before wandering off to a neighboring tile
+std::vector<expansion_t> make_expansions() {
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> leave(0.f, 1.f);
+  std::uniform_int_distribution<int> step(-64, 64);
+  std::uniform_int_distribution<int> neighbor(-1, 1);
+
+  std::vector<expansion_t> expansions;
+  expansions.reserve(kExpansions);
+  int tile = kTileCount / 2;
+  int edge = kEdgesPerTile / 2;
+  for (size_t i = 0; i < kExpansions; ++i) {
+    if (leave(gen) < 0.01f) {
+      tile = std::max(0, std::min<int>(kTileCount - 1,
+                                       tile + neighbor(gen) * kTileColumns + neighbor(gen)));
+    }
+    edge = std::max(0, std::min<int>(kEdgesPerTile - 1, edge + step(gen)));
+    expansions.push_back({GraphId(tile, 2, edge), static_cast<uint32_t>(tile)});
+  }
+  return expansions;
+}
+
+const std::vector<expansion_t> expansions = make_expansions();
+
+std::vector<graph_tile_ptr> make_tiles() {
+  std::vector<graph_tile_ptr> tiles;
+  for (uint32_t i = 0; i < kTileCount; ++i) {
+    tiles.emplace_back(new BenchGraphTile(GraphId(i, 2, 0)));
+  }
+  return tiles;
+}
+
+// Runs the same expansions against the edge status over and over, clearing it in between like
+// a path algorithm does between requests. Each expansion looks the edge up, labels it temporary
+// if it hasnt been seen and otherwise makes it permanent
+template <typename edge_status_t> void BM_EdgeStatusExpansion(benchmark::State& state) {
+  const auto tiles = make_tiles();
+  edge_status_t edgestatus;
+
+  uint32_t index = 0;
+  for (auto _ : state) {
+    edgestatus.clear();
+    for (const auto& expansion : expansions) {
+      auto status = edgestatus.Get(expansion.edgeid);
+      if (status.set() == EdgeSet::kUnreachedOrReset) {
+        edgestatus.Set(expansion.edgeid, EdgeSet::kTemporary, index++, tiles[expansion.tile_index]);
+      } else if (status.set() == EdgeSet::kTemporary) {
+        edgestatus.Update(expansion.edgeid, EdgeSet::kPermanent);
+      }
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * expansions.size());
+}
+
+BENCHMARK_TEMPLATE(BM_EdgeStatusExpansion, UnorderedMapEdgeStatus)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_EdgeStatusExpansion, EdgeStatus)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
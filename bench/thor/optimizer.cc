@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "thor/local_search_optimizer.h"
+#include "thor/optimizer.h"
+
+using namespace valhalla::thor;
+
+// Compares the tours the optimizers of optimized_route find, and how long they take to find them,
+// on synthetic cost matrices. The TourCost counter is what to compare the quality by, lower is
+// better
+
+namespace {
+
+// Asymmetric costs between random points in a square, the way from one to another some way off
+// the straight line, like the times of a cost matrix in a city
+std::vector<float> synthetic_costs(const uint32_t count) {
+  std::mt19937 random(count);
+  std::uniform_real_distribution<float> coordinate(0.f, 10000.f), detour(1.f, 1.5f);
+  std::vector<std::pair<float, float>> points(count);
+  for (auto& point : points) {
+    point = {coordinate(random), coordinate(random)};
+  }
+  std::vector<float> costs(count * count, 0.f);
+  for (uint32_t i = 0; i < count; ++i) {
+    for (uint32_t j = 0; j < count; ++j) {
+      if (i != j) {
+        costs[i * count + j] = std::hypot(points[i].first - points[j].first,
+                                          points[i].second - points[j].second) *
+                               detour(random);
+      }
+    }
+  }
+  return costs;
+}
+
+static void BM_Annealing(benchmark::State& state) {
+  const uint32_t count = state.range(0);
+  const auto costs = synthetic_costs(count);
+  double cost = 0;
+  for (auto _ : state) {
+    Optimizer optimizer;
+    optimizer.Seed(111111);
+    auto tour = optimizer.Solve(count, costs);
+    cost += LocalSearchOptimizer::TourCost(costs, tour);
+  }
+  state.counters["TourCost"] = benchmark::Counter(cost, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_Annealing)
+    ->Unit(benchmark::kMillisecond)
+    ->ArgName("locations")
+    ->Arg(25)
+    ->Arg(50)
+    ->Arg(100)
+    ->Arg(150)
+    ->Arg(300);
+
+static void BM_LocalSearch(benchmark::State& state) {
+  const uint32_t count = state.range(0);
+  const uint32_t threads = state.range(1);
+  const uint32_t starts = state.range(2);
+  const auto costs = synthetic_costs(count);
+  double cost = 0;
+  for (auto _ : state) {
+    auto tour = LocalSearchOptimizer(threads, starts).Solve(count, costs);
+    cost += LocalSearchOptimizer::TourCost(costs, tour);
+  }
+  state.counters["TourCost"] = benchmark::Counter(cost, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_LocalSearch)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime()
+    ->ArgNames({"locations", "threads", "starts"})
+    ->Args({25, 1, 8})
+    ->Args({50, 1, 8})
+    ->Args({100, 1, 8})
+    ->Args({150, 1, 1})
+    ->Args({150, 1, 8})
+    ->Args({150, 4, 8})
+    ->Args({150, 4, 32})
+    ->Args({300, 1, 8})
+    ->Args({300, 4, 8});
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,251 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "baldr/graphreader.h"
+#include "baldr/label_queue.h"
+#include "loki/search.h"
+#include "midgard/pointll.h"
+#include "sif/autocost.h"
+#include "sif/costfactory.h"
+#include "thor/bidirectional_astar.h"
+#include "thor/isochrone.h"
+#include "thor/searcharena.h"
+#include <valhalla/proto/options.pb.h>
+
+using namespace valhalla;
+
+// Compares the priority queues the path algorithms can sort their labels with (see
+// thor.priority_queue in the config) on searches of different lengths
+
+namespace {
+
+boost::property_tree::ptree json_to_pt(const std::string& json) {
+  std::stringstream ss;
+  ss << json;
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(ss, pt);
+  return pt;
+}
+
+const auto config = json_to_pt(R"({
+    "mjolnir":{"tile_dir":"test/data/utrecht_tiles", "concurrency": 1},
+    "thor":{"logging":{"long_request": 100}}
+  })");
+
+// The default auto options, their mode and costing
+struct costing_t {
+  Options options;
+  sif::TravelMode mode;
+  sif::mode_costing_t costs;
+
+  costing_t() {
+    options.set_costing(Costing::auto_);
+    rapidjson::Document doc;
+    sif::ParseCostingOptions(doc, "/costing_options", options);
+    costs = sif::CostFactory().CreateModeCosting(options, mode);
+  }
+};
+
+// Correlates the points to the graph
+std::vector<valhalla::Location> Correlate(const std::vector<midgard::PointLL>& points,
+                                          baldr::GraphReader& reader,
+                                          const sif::cost_ptr_t& cost) {
+  std::vector<baldr::Location> locations(points.begin(), points.end());
+  const auto projections = loki::Search(locations, reader, cost);
+  std::vector<valhalla::Location> correlated;
+  for (const auto& location : locations) {
+    auto found = projections.find(location);
+    if (found == projections.cend()) {
+      throw std::runtime_error("Found no matching location");
+    }
+    correlated.emplace_back();
+    baldr::PathLocation::toPBF(found->second, &correlated.back(), reader);
+  }
+  return correlated;
+}
+
+/**
+ * Dijkstra over a grid of labels with random edge costs, without any graph around it, so all
+ * thats timed is the queue. The cost of an edge is between 1 and the scale so the costs of a
+ * large grid with a large scale go well past the range of the double bucket queue.
+ */
+static void BM_QueueGrid(benchmark::State& state, baldr::QueueType queue_type) {
+  struct label_t {
+    float cost;
+    float sortcost() const {
+      return cost;
+    }
+  };
+  const uint32_t side = state.range(0);
+  const float scale = state.range(1);
+
+  std::mt19937 gen(0); // Seed with the same value for consistent benchmarking
+  std::uniform_real_distribution<float> cost_distribution(1.f, scale);
+  std::vector<float> edge_costs(side * side * 4);
+  for (auto& cost : edge_costs) {
+    cost = cost_distribution(gen);
+  }
+
+  thor::SearchArena arena(thor::SearchArena::kDefaultWindow,
+                          thor::SearchArena::kDefaultMaxRetainedBytes, queue_type);
+  std::vector<label_t> labels;
+  std::vector<uint8_t> status;
+  for (auto _ : state) {
+    labels.assign(side * side, {std::numeric_limits<float>::max()});
+    status.assign(side * side, 0);
+    auto queue = arena.MakeQueue(0.f, thor::kBucketCount, 1, labels);
+    labels[0].cost = 0.f;
+    queue->add(0);
+    status[0] = 1;
+    uint32_t settled = 0;
+    for (auto idx = queue->pop(); idx != baldr::kInvalidLabel; idx = queue->pop()) {
+      status[idx] = 2;
+      ++settled;
+      const uint32_t x = idx % side, y = idx / side;
+      const uint32_t neighbours[] = {x > 0 ? idx - 1 : idx, x + 1 < side ? idx + 1 : idx,
+                                     y > 0 ? idx - side : idx, y + 1 < side ? idx + side : idx};
+      for (uint32_t i = 0; i < 4; ++i) {
+        const auto next = neighbours[i];
+        const auto cost = labels[idx].cost + edge_costs[idx * 4 + i];
+        if (status[next] == 2 || cost >= labels[next].cost) {
+          continue;
+        }
+        if (status[next] == 1) {
+          queue->decrease(next, cost);
+          labels[next].cost = cost;
+        } else {
+          labels[next].cost = cost;
+          queue->add(next);
+          status[next] = 1;
+        }
+      }
+    }
+    benchmark::DoNotOptimize(settled);
+    arena.ReleaseQueue(queue);
+  }
+  state.counters["Labels"] =
+      benchmark::Counter(side * side, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK_CAPTURE(BM_QueueGrid, double_bucket, baldr::QueueType::kDoubleBucket)
+    ->Unit(benchmark::kMillisecond)
+    ->ArgNames({"side", "scale"})
+    ->Args({200, 10})
+    ->Args({1000, 10})
+    ->Args({1000, 1000});
+BENCHMARK_CAPTURE(BM_QueueGrid, radix_heap, baldr::QueueType::kRadixHeap)
+    ->Unit(benchmark::kMillisecond)
+    ->ArgNames({"side", "scale"})
+    ->Args({200, 10})
+    ->Args({1000, 10})
+    ->Args({1000, 1000});
+
+/**
+ * Bidirectional A* between pairs of locations around Utrecht. Short routes stay within a few
+ * blocks, long ones go from one side of the tiles to the other.
+ */
+static void BM_UtrechtRoutes(benchmark::State& state, baldr::QueueType queue_type, bool long_haul) {
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+  costing_t costing;
+  const auto& cost = costing.costs[static_cast<size_t>(costing.mode)];
+
+  const double min_lon = 5.0163;
+  const double max_lon = 5.1622;
+  const double min_lat = 52.0469999;
+  const double max_lat = 52.1411;
+  std::mt19937 gen(0); // Seed with the same value for consistent benchmarking
+  std::uniform_real_distribution<> lng_distribution(min_lon, max_lon);
+  std::uniform_real_distribution<> lat_distribution(min_lat, max_lat);
+  std::uniform_real_distribution<> offset_distribution(-0.005, 0.005);
+
+  std::vector<midgard::PointLL> points;
+  for (int i = 0; i < 8; ++i) {
+    if (long_haul) {
+      // from one edge of the box to the opposite one
+      const auto lat = lat_distribution(gen);
+      points.emplace_back(min_lon + 0.01, lat);
+      points.emplace_back(max_lon - 0.01, max_lat + min_lat - lat);
+    } else {
+      const midgard::PointLL origin(lng_distribution(gen), lat_distribution(gen));
+      points.push_back(origin);
+      points.emplace_back(origin.lng() + offset_distribution(gen),
+                          origin.lat() + offset_distribution(gen));
+    }
+  }
+  const auto locations = Correlate(points, reader, cost);
+
+  auto arena = std::make_shared<thor::SearchArena>(thor::SearchArena::kDefaultWindow,
+                                                   thor::SearchArena::kDefaultMaxRetainedBytes,
+                                                   queue_type);
+  thor::BidirectionalAStar astar;
+  astar.set_search_arena(arena);
+  std::size_t route_size = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i + 1 < locations.size(); i += 2) {
+      auto origin = locations[i];
+      auto destination = locations[i + 1];
+      auto result = astar.GetBestPath(origin, destination, reader, costing.costs, costing.mode);
+      route_size += !result.empty();
+      astar.Clear();
+    }
+  }
+  if (route_size == 0) {
+    throw std::runtime_error("Failed all routes");
+  }
+  state.counters["Routes"] =
+      benchmark::Counter(locations.size() / 2, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK_CAPTURE(BM_UtrechtRoutes, short_double_bucket, baldr::QueueType::kDoubleBucket, false)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtRoutes, short_radix_heap, baldr::QueueType::kRadixHeap, false)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtRoutes, long_double_bucket, baldr::QueueType::kDoubleBucket, true)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtRoutes, long_radix_heap, baldr::QueueType::kRadixHeap, true)
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * Isochrones out of the center of Utrecht, the number of minutes is the argument.
+ */
+static void BM_UtrechtIsochrone(benchmark::State& state, baldr::QueueType queue_type) {
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+  costing_t costing;
+  const auto& cost = costing.costs[static_cast<size_t>(costing.mode)];
+
+  Api api;
+  *api.mutable_options() = costing.options;
+  *api.mutable_options()->add_locations() =
+      Correlate({midgard::PointLL{5.114598, 52.103607}}, reader, cost).front();
+  api.mutable_options()->add_contours()->set_time(state.range(0));
+
+  auto arena = std::make_shared<thor::SearchArena>(thor::SearchArena::kDefaultWindow,
+                                                   thor::SearchArena::kDefaultMaxRetainedBytes,
+                                                   queue_type);
+  thor::Isochrone isochrone;
+  isochrone.set_search_arena(arena);
+  for (auto _ : state) {
+    auto request = api;
+    auto grid = isochrone.Compute(request, reader, costing.costs, costing.mode);
+    benchmark::DoNotOptimize(grid);
+    isochrone.Clear();
+  }
+}
+
+BENCHMARK_CAPTURE(BM_UtrechtIsochrone, double_bucket, baldr::QueueType::kDoubleBucket)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(5)
+    ->Arg(15);
+BENCHMARK_CAPTURE(BM_UtrechtIsochrone, radix_heap, baldr::QueueType::kRadixHeap)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(5)
+    ->Arg(15);
+
+} // namespace
+
+BENCHMARK_MAIN();
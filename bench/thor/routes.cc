@@ -5,8 +5,11 @@
 #include <string>
 
 #include "baldr/graphreader.h"
+#include "baldr/landmarks.h"
 #include "loki/search.h"
 #include "midgard/pointll.h"
+#include "mjolnir/graphtilebuilder.h"
+#include "mjolnir/landmarkbuilder.h"
 #include "sif/autocost.h"
 #include "sif/costfactory.h"
 #include "test.h"
@@ -79,10 +82,20 @@ boost::property_tree::ptree build_config(const char* live_traffic_tar) {
   })");
 }
 
+// Writes a copy of the tiles with routing edges added to them and points the config at the copy
+void add_routing_edges(boost::property_tree::ptree& config) {
+  const std::string routing_edges_dir = "test/data/utrecht_tiles_routing_edges";
+  auto reader = test::make_clean_graphreader(config.get_child("mjolnir"));
+  for (const auto& tile_id : reader->GetTileSet()) {
+    mjolnir::GraphTileBuilder::AddRoutingEdges(routing_edges_dir, reader->GetGraphTile(tile_id));
+  }
+  config.put("mjolnir.tile_dir", routing_edges_dir);
+}
+
 constexpr float kMaxRange = 256;
 
-static void BM_UtrechtBidirectionalAstar(benchmark::State& state) {
-  const auto config = build_config("generated-live-data.tar");
+static void BM_UtrechtBidirectionalAstar(benchmark::State& state, bool routing_edges) {
+  auto config = build_config("generated-live-data.tar");
   test::build_live_traffic_data(config);
 
   std::mt19937 gen(0); // Seed with the same value for consistent benchmarking
@@ -107,6 +120,9 @@ static void BM_UtrechtBidirectionalAstar(benchmark::State& state) {
     };
     test::customize_live_traffic_data(config, generate_traffic);
   }
+  if (routing_edges) {
+    add_routing_edges(config);
+  }
 
   auto clean_reader = test::make_clean_graphreader(config.get_child("mjolnir"));
 
@@ -188,6 +204,144 @@ static void BM_UtrechtBidirectionalAstar(benchmark::State& state) {
       benchmark::Counter(route_size, benchmark::Counter::kIsIterationInvariantRate);
 }
 
+/**
+ * Bidirectional A* with and without the landmarks bounding its heuristic, between locations
+ * across Utrecht. Besides the time it reports how many edges the searches settle per route.
+ */
+static void BM_UtrechtLandmarks(benchmark::State& state, bool use_landmarks) {
+  // The landmark costs are those of a route without live traffic
+  auto config = build_config("landmarks.tar");
+  config.get_child("mjolnir").erase("traffic_extract");
+  config.put("mjolnir.landmarks", "test/data/utrecht_landmarks.bin");
+  auto clean_reader = test::make_clean_graphreader(config.get_child("mjolnir"));
+
+  Options options;
+  create_costing_options(options);
+  sif::TravelMode mode;
+  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
+  auto cost = costs[static_cast<size_t>(mode)];
+
+  // Select the landmarks the first time round
+  thor::BidirectionalAStar astar;
+  if (use_landmarks) {
+    const auto file = config.get<std::string>("mjolnir.landmarks");
+    if (!astar.LoadLandmarks(file, *clean_reader)) {
+      mjolnir::LandmarkBuilder::Build(config);
+      if (!astar.LoadLandmarks(file, *clean_reader)) {
+        state.SkipWithError("Could not build the landmarks");
+        return;
+      }
+    }
+  }
+
+  // Each location is routed to the next one
+  std::vector<valhalla::baldr::Location> locations;
+  locations.emplace_back(midgard::PointLL{5.025595, 52.067372});
+  locations.emplace_back(midgard::PointLL{5.135983, 52.110116});
+  locations.emplace_back(midgard::PointLL{5.110077, 52.062043});
+  locations.emplace_back(midgard::PointLL{5.095273, 52.108956});
+  locations.emplace_back(midgard::PointLL{5.117328, 52.099464});
+  locations.emplace_back(midgard::PointLL{5.035283, 52.081237});
+  locations.emplace_back(midgard::PointLL{5.152104, 52.056829});
+  locations.emplace_back(midgard::PointLL{5.112481, 52.074073});
+  const auto projections = loki::Search(locations, *clean_reader, cost);
+  std::vector<valhalla::Location> correlated;
+  for (const auto& location : locations) {
+    auto found = projections.find(location);
+    if (found == projections.cend()) {
+      throw std::runtime_error("Found no matching locations");
+    }
+    correlated.emplace_back();
+    baldr::PathLocation::toPBF(found->second, &correlated.back(), *clean_reader);
+  }
+
+  std::size_t settled = 0;
+  astar.set_track_expansion([&settled](baldr::GraphReader&, const char*, baldr::GraphId,
+                                       const char* status, bool) { settled += *status == 's'; });
+  std::size_t route_size = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i + 1 < correlated.size(); ++i) {
+      auto origin = correlated[i];
+      auto destination = correlated[i + 1];
+      auto result = astar.GetBestPath(origin, destination, *clean_reader, costs, mode, options);
+      route_size += !result.empty();
+      astar.Clear();
+    }
+  }
+  if (route_size == 0) {
+    throw std::runtime_error("Failed all routes");
+  }
+  state.counters["Routes"] =
+      benchmark::Counter(correlated.size() - 1, benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["Settled"] = static_cast<double>(settled) / route_size;
+}
+
+BENCHMARK_CAPTURE(BM_UtrechtLandmarks, distance, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtLandmarks, landmarks, true)->Unit(benchmark::kMillisecond);
+
+/**
+ * Latency of bidirectional A* on the longest routes across Utrecht, with the forward and reverse
+ * searches taking turns on one thread or running on two.
+ */
+static void BM_UtrechtParallelBidirectional(benchmark::State& state, bool parallel) {
+  auto config = build_config("parallel.tar");
+  config.get_child("mjolnir").erase("traffic_extract");
+  auto clean_reader = test::make_clean_graphreader(config.get_child("mjolnir"));
+
+  Options options;
+  create_costing_options(options);
+  sif::TravelMode mode;
+  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
+  auto cost = costs[static_cast<size_t>(mode)];
+
+  // The extract is small so every route counts as long
+  thor::BidirectionalAStar astar;
+  if (parallel) {
+    astar.set_parallel(test::make_clean_graphreader(config.get_child("mjolnir")), 0.f);
+  }
+
+  // Locations on either side of the city are routed to the other side and back
+  std::vector<valhalla::baldr::Location> locations;
+  locations.emplace_back(midgard::PointLL{5.025595, 52.067372});
+  locations.emplace_back(midgard::PointLL{5.135983, 52.110116});
+  locations.emplace_back(midgard::PointLL{5.035283, 52.081237});
+  locations.emplace_back(midgard::PointLL{5.152104, 52.056829});
+  const auto projections = loki::Search(locations, *clean_reader, cost);
+  std::vector<valhalla::Location> correlated;
+  for (const auto& location : locations) {
+    auto found = projections.find(location);
+    if (found == projections.cend()) {
+      throw std::runtime_error("Found no matching locations");
+    }
+    correlated.emplace_back();
+    baldr::PathLocation::toPBF(found->second, &correlated.back(), *clean_reader);
+  }
+  const std::vector<std::pair<size_t, size_t>> routes = {{0, 1}, {1, 0}, {2, 3}, {3, 2}};
+
+  std::size_t route_size = 0;
+  for (auto _ : state) {
+    for (const auto& route : routes) {
+      auto origin = correlated[route.first];
+      auto destination = correlated[route.second];
+      auto result = astar.GetBestPath(origin, destination, *clean_reader, costs, mode, options);
+      route_size += !result.empty();
+      astar.Clear();
+    }
+  }
+  if (route_size == 0) {
+    throw std::runtime_error("Failed all routes");
+  }
+  state.counters["Routes"] =
+      benchmark::Counter(routes.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK_CAPTURE(BM_UtrechtParallelBidirectional, one_thread, false)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_UtrechtParallelBidirectional, two_threads, true)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
 void customize_traffic(const boost::property_tree::ptree& config,
                        baldr::GraphId& target_edge_id,
                        const int target_speed) {
@@ -209,7 +363,9 @@ void customize_traffic(const boost::property_tree::ptree& config,
   test::customize_live_traffic_data(config, generate_traffic);
 }
 
-BENCHMARK(BM_UtrechtBidirectionalAstar)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtBidirectionalAstar, directed_edges, false)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtBidirectionalAstar, routing_edges, true)->Unit(benchmark::kMillisecond);
 
 /** Benchmarks the GetSpeed function */
 static void BM_GetSpeed(benchmark::State& state) {
@@ -285,6 +441,53 @@ static void BM_Sif_Allowed(benchmark::State& state) {
 
 BENCHMARK(BM_Sif_Allowed)->Unit(benchmark::kNanosecond);
 
+/** Benchmarks the access check expansion makes on every edge it looks at, over all the tiles */
+static void BM_Sif_IsAccessible(benchmark::State& state, bool routing_edges) {
+  auto config = build_config("sif-accessible.tar");
+  test::build_live_traffic_data(config);
+  if (routing_edges) {
+    add_routing_edges(config);
+  }
+
+  auto clean_reader = test::make_clean_graphreader(config.get_child("mjolnir"));
+  std::vector<baldr::graph_tile_ptr> tiles;
+  size_t edge_count = 0;
+  for (const auto& tile_id : clean_reader->GetTileSet()) {
+    tiles.push_back(clean_reader->GetGraphTile(tile_id));
+    edge_count += tiles.back()->header()->directededgecount();
+    if (routing_edges && !tiles.back()->routing_edges()) {
+      throw std::runtime_error("Tile is missing its routing edges");
+    }
+  }
+
+  Options options;
+  create_costing_options(options);
+  sif::TravelMode mode;
+  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
+  auto cost = costs[static_cast<size_t>(mode)];
+
+  size_t accessible = 0;
+  for (auto _ : state) {
+    for (const auto& tile : tiles) {
+      if (routing_edges) {
+        const auto& edges = tile->routing_edges();
+        for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+          accessible += cost->IsAccessible(edges, i);
+        }
+      } else {
+        for (const auto& edge : tile->GetDirectedEdges()) {
+          accessible += cost->IsAccessible(&edge);
+        }
+      }
+    }
+    benchmark::DoNotOptimize(accessible);
+  }
+  state.SetItemsProcessed(state.iterations() * edge_count);
+}
+
+BENCHMARK_CAPTURE(BM_Sif_IsAccessible, directed_edges, false)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_Sif_IsAccessible, routing_edges, true)->Unit(benchmark::kMicrosecond);
+
 } // namespace
 
 BENCHMARK_MAIN();
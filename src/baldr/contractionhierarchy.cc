@@ -0,0 +1,226 @@
+#include "baldr/contractionhierarchy.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace {
+
+using namespace valhalla::baldr;
+
+struct file_header_t {
+  char magic[8];
+  uint64_t dataset_id;   // of the tileset the hierarchy was contracted from
+  uint32_t costing;      // of the profile
+  uint32_t profile_size; // bytes of serialized costing options, padded to 8 bytes in the file
+  uint32_t tile_count;
+  uint32_t vertex_count;
+  uint32_t up_count;   // of arcs going up
+  uint32_t down_count; // of arcs coming down
+};
+constexpr char kFileMagic[8] = {'V', 'C', 'H', 'C', 'S', 'R', '0', '2'};
+
+size_t padded(size_t size) {
+  return (size + 7) & ~size_t(7);
+}
+
+// the size the file should be given its header
+size_t file_size(const file_header_t& header) {
+  return sizeof(file_header_t) + padded(header.profile_size) +
+         header.tile_count * sizeof(ContractionHierarchy::tile_t) +
+         2 * (header.vertex_count + 1) * sizeof(uint32_t) +
+         (static_cast<size_t>(header.up_count) + header.down_count) *
+             sizeof(ContractionHierarchy::arc_t);
+}
+
+// whether the offsets start at 0, never go backwards and end at the number of arcs and whether the
+// arcs only lead to vertices we have
+bool sound(const uint32_t* offsets,
+           const ContractionHierarchy::arc_t* arcs,
+           uint32_t vertex_count,
+           uint32_t arc_count) {
+  if (offsets[0] != 0 || offsets[vertex_count] != arc_count) {
+    return false;
+  }
+  for (uint32_t i = 0; i < vertex_count; ++i) {
+    if (offsets[i] > offsets[i + 1]) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < arc_count; ++i) {
+    if (arcs[i].vertex >= vertex_count ||
+        (arcs[i].middle != ContractionHierarchy::kInvalidVertex && arcs[i].middle >= vertex_count)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// the id of the dataset we can use to tell if the file goes with the tileset
+uint64_t dataset_id(GraphReader& reader) {
+  for (const auto& level : TileHierarchy::levels()) {
+    for (const auto& tile_id : reader.GetTileSet(level.level)) {
+      if (auto tile = reader.GetGraphTile(tile_id)) {
+        return tile->header()->dataset_id();
+      }
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+constexpr uint32_t ContractionHierarchy::kInvalidVertex;
+
+ContractionHierarchy::ContractionHierarchy()
+    : costing_(0), vertex_count_(0), tiles_(nullptr), tile_count_(0), up_offsets_(nullptr),
+      up_arcs_(nullptr), down_offsets_(nullptr), down_arcs_(nullptr) {
+}
+
+bool ContractionHierarchy::Load(const std::string& file, GraphReader& reader) {
+  struct stat s;
+  if (stat(file.c_str(), &s) || static_cast<uint64_t>(s.st_size) < sizeof(file_header_t)) {
+    LOG_WARN("Contraction hierarchy " + file + " not found");
+    return false;
+  }
+
+  try {
+    mapped_.map(file, s.st_size);
+    file_header_t header;
+    memcpy(&header, mapped_.get(), sizeof(header));
+    // it has to be the right size and belong to the tileset
+    if (memcmp(header.magic, kFileMagic, sizeof(header.magic)) ||
+        file_size(header) != static_cast<uint64_t>(s.st_size) ||
+        header.dataset_id != dataset_id(reader)) {
+      LOG_WARN("Ignoring stale contraction hierarchy " + file);
+      mapped_.unmap();
+      return false;
+    }
+
+    const char* pos = mapped_.get() + sizeof(header);
+    profile_.assign(pos, header.profile_size);
+    pos += padded(header.profile_size);
+    tiles_ = reinterpret_cast<const tile_t*>(pos);
+    up_offsets_ = reinterpret_cast<const uint32_t*>(tiles_ + header.tile_count);
+    up_arcs_ = reinterpret_cast<const arc_t*>(up_offsets_ + header.vertex_count + 1);
+    down_offsets_ = reinterpret_cast<const uint32_t*>(up_arcs_ + header.up_count);
+    down_arcs_ = reinterpret_cast<const arc_t*>(down_offsets_ + header.vertex_count + 1);
+    costing_ = header.costing;
+    vertex_count_ = header.vertex_count;
+    tile_count_ = header.tile_count;
+
+    // everything has to stay in bounds and the tiles have to be sorted for finding their edges
+    bool tiles_sound = true;
+    uint64_t tiles_end = 0;
+    for (uint32_t i = 0; tiles_sound && i < tile_count_; ++i) {
+      tiles_sound = tiles_[i].first_vertex >= tiles_end;
+      tiles_end = static_cast<uint64_t>(tiles_[i].first_vertex) + tiles_[i].edge_count;
+      tiles_sound = tiles_sound && tiles_end <= vertex_count_;
+    }
+    if (!tiles_sound || !sound(up_offsets_, up_arcs_, vertex_count_, header.up_count) ||
+        !sound(down_offsets_, down_arcs_, vertex_count_, header.down_count)) {
+      LOG_WARN("Ignoring corrupt contraction hierarchy " + file);
+      up_offsets_ = down_offsets_ = nullptr;
+      mapped_.unmap();
+      return false;
+    }
+  } catch (const std::exception& e) {
+    LOG_WARN("Could not map contraction hierarchy " + file + ": " + e.what());
+    up_offsets_ = down_offsets_ = nullptr;
+    return false;
+  }
+
+  tile_index_.clear();
+  tile_index_.reserve(tile_count_);
+  for (uint32_t i = 0; i < tile_count_; ++i) {
+    tile_index_.emplace(tiles_[i].tile_id, i);
+  }
+  return true;
+}
+
+void ContractionHierarchy::Save(const std::string& file,
+                                GraphReader& reader,
+                                uint32_t costing,
+                                const std::string& profile,
+                                const std::vector<tile_t>& tiles,
+                                const std::vector<uint32_t>& up_offsets,
+                                const std::vector<arc_t>& up_arcs,
+                                const std::vector<uint32_t>& down_offsets,
+                                const std::vector<arc_t>& down_arcs) {
+  file_header_t header{};
+  memcpy(header.magic, kFileMagic, sizeof(header.magic));
+  header.dataset_id = dataset_id(reader);
+  header.costing = costing;
+  header.profile_size = profile.size();
+  header.tile_count = tiles.size();
+  header.vertex_count = up_offsets.size() - 1;
+  header.up_count = up_arcs.size();
+  header.down_count = down_arcs.size();
+
+  // write it to the side and move it into place so no one ever maps half a file
+  const auto tmp_file = file + ".tmp";
+  {
+    const char padding[8] = {};
+    std::ofstream out(tmp_file, std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(profile.data(), profile.size());
+    out.write(padding, padded(profile.size()) - profile.size());
+    out.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(tile_t));
+    out.write(reinterpret_cast<const char*>(up_offsets.data()),
+              up_offsets.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(up_arcs.data()), up_arcs.size() * sizeof(arc_t));
+    out.write(reinterpret_cast<const char*>(down_offsets.data()),
+              down_offsets.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(down_arcs.data()), down_arcs.size() * sizeof(arc_t));
+    if (!out) {
+      std::remove(tmp_file.c_str());
+      throw std::runtime_error("Could not write contraction hierarchy " + file);
+    }
+  }
+  if (std::rename(tmp_file.c_str(), file.c_str())) {
+    std::remove(tmp_file.c_str());
+    throw std::runtime_error("Could not write contraction hierarchy " + file);
+  }
+  LOG_INFO("Wrote contraction hierarchy of " + std::to_string(header.vertex_count) +
+           " edges with " + std::to_string(header.up_count) + " arcs up and " +
+           std::to_string(header.down_count) + " arcs down to " + file);
+}
+
+GraphId ContractionHierarchy::edge(uint32_t vertex) const {
+  // the last tile starting at or before the vertex
+  const auto* tile =
+      std::upper_bound(tiles_, tiles_ + tile_count_, vertex,
+                       [](uint32_t v, const tile_t& t) { return v < t.first_vertex; }) -
+      1;
+  GraphId edge_id(tile->tile_id);
+  edge_id.set_id(vertex - tile->first_vertex);
+  return edge_id;
+}
+
+const ContractionHierarchy::arc_t* ContractionHierarchy::find_arc(uint32_t from,
+                                                                  uint32_t to) const {
+  // its either an arc going up out of from or an arc coming down into to
+  const arc_t* best = nullptr;
+  for (const auto& arc : up(from)) {
+    if (arc.vertex == to && (!best || arc.cost < best->cost)) {
+      best = &arc;
+    }
+  }
+  for (const auto& arc : down(to)) {
+    if (arc.vertex == from && (!best || arc.cost < best->cost)) {
+      best = &arc;
+    }
+  }
+  return best;
+}
+
+} // namespace baldr
+} // namespace valhalla
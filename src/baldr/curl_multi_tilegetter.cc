@@ -0,0 +1,350 @@
+#include "baldr/curl_multi_tilegetter.h"
+#include "midgard/logging.h"
+
+#include <stdexcept>
+#include <string>
+
+#ifdef CURL_STATICLIB
+
+#if defined(_MSC_VER) && !defined(NOGDI)
+#define NOGDI // prevents winsock2.h drag in wingdi.h
+#endif
+
+#include <curl/curl.h>
+
+#if defined(_MSC_VER) && defined(GetNameInfo)
+#undef GetNameInfo // winsock2.h imports #define GetNameInfo which clashes with
+                   // EdgeInfo::GetNameInfo
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+using valhalla::baldr::tile_getter_t;
+
+// how often we check the interrupt while waiting on a download
+constexpr std::chrono::milliseconds INTERRUPT_CHECK_INTERVAL(10);
+// how long the transfer thread sleeps in curl before it looks for new work, if curl cant wake it
+constexpr int MULTI_WAIT_TIMEOUT_MS = 10;
+
+struct curl_singleton_t {
+  curl_singleton_t() {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+  }
+  ~curl_singleton_t() {
+    curl_global_cleanup();
+  }
+};
+
+size_t write_callback(char* in, size_t block_size, size_t blocks, std::vector<char>* out) {
+  if (!out) {
+    return static_cast<size_t>(0);
+  }
+  out->insert(out->end(), in, in + (block_size * blocks));
+  return block_size * blocks;
+}
+
+// a download and everyone waiting on it
+struct transfer_t {
+  explicit transfer_t(const std::string& url) : url(url), future(promise.get_future().share()) {
+  }
+  std::string url;
+  std::vector<char> bytes;
+  std::promise<tile_getter_t::response_t> promise;
+  std::shared_future<tile_getter_t::response_t> future;
+  CURL* easy = nullptr;
+};
+
+// someone waiting on a download and whether they joined it rather than started it
+struct waiter_t {
+  std::shared_future<tile_getter_t::response_t> future;
+  bool coalesced;
+};
+
+tile_getter_t::response_t wait(const waiter_t& waiter, const tile_getter_t::interrupt_t* interrupt) {
+  if (interrupt) {
+    (*interrupt)();
+    while (waiter.future.wait_for(INTERRUPT_CHECK_INTERVAL) != std::future_status::ready) {
+      (*interrupt)();
+    }
+  }
+  auto response = waiter.future.get();
+  response.coalesced_ = waiter.coalesced;
+  return response;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+struct curl_multi_tile_getter_t::pimpl_t {
+  pimpl_t(size_t max_concurrent, const std::string& user_agent, bool gzipped)
+      : max_concurrent(std::max<size_t>(max_concurrent, 1)), user_agent(user_agent),
+        gzipped(gzipped), stop(false), active(0), transfers(0), coalesced(0) {
+    static curl_singleton_t s;
+    multi = curl_multi_init();
+    if (!multi) {
+      LOG_ERROR("Failed to created CURL multi handle");
+      throw std::runtime_error("Failed to created CURL multi handle");
+    }
+    thread = std::thread(&pimpl_t::run, this);
+  }
+
+  ~pimpl_t() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    wake();
+    thread.join();
+
+    // fail whatever is left so no one waits forever
+    for (auto& t : in_flight) {
+      if (t.second->easy) {
+        curl_multi_remove_handle(multi, t.second->easy);
+        curl_easy_cleanup(t.second->easy);
+      }
+      t.second->promise.set_value({});
+    }
+    curl_multi_cleanup(multi);
+  }
+
+  // queue the urls (or join their downloads) under a single lock so duplicates always coalesce
+  std::vector<waiter_t> submit(const std::vector<std::string>& urls) {
+    std::vector<waiter_t> waiters;
+    waiters.reserve(urls.size());
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (const auto& url : urls) {
+        auto found = in_flight.find(url);
+        if (found != in_flight.end()) {
+          ++coalesced;
+          waiters.push_back({found->second->future, true});
+          continue;
+        }
+        auto transfer = std::make_shared<transfer_t>(url);
+        in_flight.emplace(url, transfer);
+        pending.push_back(transfer);
+        waiters.push_back({transfer->future, false});
+      }
+    }
+    wake();
+    return waiters;
+  }
+
+  // get the transfer thread out of waiting on either curl or the condition
+  void wake() {
+    cond.notify_one();
+#if LIBCURL_VERSION_NUM >= 0x074400
+    curl_multi_wakeup(multi);
+#endif
+  }
+
+  // set up the easy handle for a download and hand it to the multi handle
+  bool start(transfer_t& t) {
+    t.easy = curl_easy_init();
+    if (!t.easy) {
+      return false;
+    }
+    curl_easy_setopt(t.easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(t.easy, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(t.easy, CURLOPT_WRITEDATA, &t.bytes);
+    // this is less secure but we'll worry about that later
+    curl_easy_setopt(t.easy, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(t.easy, CURLOPT_SSL_VERIFYHOST, 0L);
+    // use gzip compression in any case but leave it compressed if thats what the user wants
+    curl_easy_setopt(t.easy, CURLOPT_ACCEPT_ENCODING, "gzip");
+    if (gzipped) {
+      curl_easy_setopt(t.easy, CURLOPT_HTTP_CONTENT_DECODING, 0L);
+    }
+    if (!user_agent.empty()) {
+      curl_easy_setopt(t.easy, CURLOPT_USERAGENT, user_agent.c_str());
+    }
+    curl_easy_setopt(t.easy, CURLOPT_URL, t.url.c_str());
+    curl_easy_setopt(t.easy, CURLOPT_PRIVATE, &t);
+    if (curl_multi_add_handle(multi, t.easy) != CURLM_OK) {
+      curl_easy_cleanup(t.easy);
+      t.easy = nullptr;
+      return false;
+    }
+    ++transfers;
+    return true;
+  }
+
+  // hand the result to everyone waiting and forget about the transfer
+  void finish(transfer_t& t, response_t&& response) {
+    if (t.easy) {
+      curl_multi_remove_handle(multi, t.easy);
+      curl_easy_cleanup(t.easy);
+      t.easy = nullptr;
+    }
+    std::shared_ptr<transfer_t> transfer;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto found = in_flight.find(t.url);
+      transfer = std::move(found->second);
+      in_flight.erase(found);
+      --active;
+    }
+    transfer->promise.set_value(std::move(response));
+  }
+
+  // the transfer thread
+  void run() {
+    while (true) {
+      // wait for work and start as many transfers as we are allowed to
+      std::vector<std::shared_ptr<transfer_t>> starting;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this]() { return stop || !pending.empty() || active > 0; });
+        if (stop) {
+          return;
+        }
+        while (active < max_concurrent && !pending.empty()) {
+          starting.push_back(std::move(pending.front()));
+          pending.pop_front();
+          ++active;
+        }
+      }
+      for (auto& t : starting) {
+        if (!start(*t)) {
+          LOG_ERROR("Failed to start download of " + t->url);
+          finish(*t, {});
+        }
+      }
+
+      // move the transfers along
+      int running = 0;
+      curl_multi_perform(multi, &running);
+
+      // collect the ones that are done
+      int left = 0;
+      while (CURLMsg* msg = curl_multi_info_read(multi, &left)) {
+        if (msg->msg != CURLMSG_DONE) {
+          continue;
+        }
+        transfer_t* t = nullptr;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &t);
+        long http_code = 0;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &http_code);
+        response_t response;
+        if (msg->data.result != CURLE_OK) {
+          LOG_ERROR("Failed to get URL " + t->url + ": " + curl_easy_strerror(msg->data.result));
+        } else if (http_code == 200) {
+          response.bytes_ = std::move(t->bytes);
+          response.status_ = tile_getter_t::status_code_t::SUCCESS;
+        } else if (http_code != 404) {
+          // not found just means the tileset has no such tile, anything else is worth a mention
+          LOG_WARN("Failed to get URL " + t->url + ": HTTP " + std::to_string(http_code));
+        }
+        finish(*t, std::move(response));
+      }
+
+      // wait for something to happen on the sockets, or for someone to wake us up
+      if (running > 0) {
+#if LIBCURL_VERSION_NUM >= 0x074400
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+#else
+        curl_multi_wait(multi, nullptr, 0, MULTI_WAIT_TIMEOUT_MS, nullptr);
+#endif
+      }
+    }
+  }
+
+  const size_t max_concurrent;
+  const std::string user_agent;
+  const bool gzipped;
+
+  CURLM* multi;
+  std::thread thread;
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool stop;
+  // number of transfers handed to curl
+  size_t active;
+  // transfers not yet handed to curl, in the order they were asked for
+  std::deque<std::shared_ptr<transfer_t>> pending;
+  // every transfer that isnt finished yet, whether pending or active
+  std::unordered_map<std::string, std::shared_ptr<transfer_t>> in_flight;
+
+  std::atomic<size_t> transfers;
+  std::atomic<size_t> coalesced;
+};
+
+curl_multi_tile_getter_t::curl_multi_tile_getter_t(size_t max_concurrent,
+                                                   const std::string& user_agent,
+                                                   bool gzipped)
+    : pimpl_(new pimpl_t(max_concurrent, user_agent, gzipped)), gzipped_(gzipped) {
+}
+
+curl_multi_tile_getter_t::response_t curl_multi_tile_getter_t::get(const std::string& url) {
+  return wait(pimpl_->submit({url}).front(), interrupt_);
+}
+
+std::vector<curl_multi_tile_getter_t::response_t>
+curl_multi_tile_getter_t::get_batch(const std::vector<std::string>& urls) {
+  std::vector<response_t> responses;
+  responses.reserve(urls.size());
+  for (const auto& waiter : pimpl_->submit(urls)) {
+    responses.emplace_back(wait(waiter, interrupt_));
+  }
+  return responses;
+}
+
+size_t curl_multi_tile_getter_t::transfer_count() const {
+  return pimpl_->transfers;
+}
+
+size_t curl_multi_tile_getter_t::coalesced_count() const {
+  return pimpl_->coalesced;
+}
+
+} // namespace baldr
+} // namespace valhalla
+
+#else
+
+// if you dont build with CURL support we always error when you try to use it
+namespace valhalla {
+namespace baldr {
+
+struct curl_multi_tile_getter_t::pimpl_t {};
+
+curl_multi_tile_getter_t::curl_multi_tile_getter_t(size_t, const std::string&, bool gzipped)
+    : gzipped_(gzipped) {
+}
+
+curl_multi_tile_getter_t::response_t curl_multi_tile_getter_t::get(const std::string&) {
+  LOG_ERROR("This version of libvalhalla was not built with CURL support");
+  throw std::runtime_error("This version of libvalhalla was not built with CURL support");
+}
+
+std::vector<curl_multi_tile_getter_t::response_t>
+curl_multi_tile_getter_t::get_batch(const std::vector<std::string>&) {
+  LOG_ERROR("This version of libvalhalla was not built with CURL support");
+  throw std::runtime_error("This version of libvalhalla was not built with CURL support");
+}
+
+size_t curl_multi_tile_getter_t::transfer_count() const {
+  return 0;
+}
+
+size_t curl_multi_tile_getter_t::coalesced_count() const {
+  return 0;
+}
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif
@@ -0,0 +1,256 @@
+#include "extract_index.h"
+#include "baldr/graphtile.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+// The sidecar index is a header followed by one entry per tile. The header remembers the size and
+// modification time of the tar it was made from so that we can tell when it has gone stale and a
+// checksum over the entries so that we can tell when the index itself is garbled
+constexpr char EXTRACT_INDEX_MAGIC[8] = {'V', 'T', 'A', 'R', 'I', 'D', 'X', '1'};
+
+struct extract_index_header_t {
+  char magic[8];
+  uint64_t tar_size;
+  int64_t tar_mtime_sec;
+  int64_t tar_mtime_nsec;
+  uint64_t count;
+  uint64_t checksum;
+};
+
+struct extract_index_entry_t {
+  uint64_t tile_id;
+  uint64_t offset; // of the tile data from the start of the tar
+  uint64_t size;
+};
+
+std::string extract_index_file(const std::string& tar_file) {
+  return tar_file + ".index";
+}
+
+// several processes can start on the same tar at once so each writes its own temporary file
+std::string extract_index_tmp_file(const std::string& index_file) {
+  std::string tmp_file;
+  while (tmp_file.empty() || filesystem::exists(tmp_file)) {
+    std::stringstream ss;
+    ss << index_file << ".tmp_" << std::this_thread::get_id() << "_"
+       << std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    tmp_file = ss.str();
+  }
+  return tmp_file;
+}
+
+// fnv-1a over the raw bytes of the entries
+uint64_t extract_index_checksum(const extract_index_entry_t* entries, uint64_t count) {
+  uint64_t hash = 14695981039346656037ull;
+  const auto* bytes = reinterpret_cast<const unsigned char*>(entries);
+  for (uint64_t i = 0; i < count * sizeof(extract_index_entry_t); ++i) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// fills out the parts of the header which identify the tar
+bool stat_extract(const std::string& tar_file, extract_index_header_t& header) {
+  struct stat s;
+  if (stat(tar_file.c_str(), &s)) {
+    return false;
+  }
+  header.tar_size = s.st_size;
+  header.tar_mtime_sec = s.st_mtime;
+#if defined(_WIN32)
+  header.tar_mtime_nsec = 0;
+#elif defined(__APPLE__)
+  header.tar_mtime_nsec = s.st_mtimespec.tv_nsec;
+#else
+  header.tar_mtime_nsec = s.st_mtim.tv_nsec;
+#endif
+  return true;
+}
+
+// checks that right before the entry there is a valid tar header for a file of the right size
+// whose name is the tile the entry says it is
+bool verify_extract_entry(const tar& archive, const extract_index_entry_t& entry) {
+  if (entry.offset < sizeof(tar::header_t) || entry.offset + entry.size > archive.mm.size()) {
+    return false;
+  }
+  const auto* h = reinterpret_cast<const tar::header_t*>(archive.mm.get() + entry.offset -
+                                                         sizeof(tar::header_t));
+  if (!h->verify() || h->get_file_size() != entry.size) {
+    return false;
+  }
+  const char opp_sep = filesystem::path::preferred_separator == '/' ? '\\' : '/';
+  std::string name(h->name, strnlen(h->name, sizeof(h->name)));
+  std::replace(name.begin(), name.end(), opp_sep, filesystem::path::preferred_separator);
+  try {
+    return valhalla::baldr::GraphTile::GetTileId(name) == entry.tile_id;
+  } catch (...) {
+    return false;
+  }
+}
+
+// map files to graph ids by walking over all the headers in the tar
+valhalla::baldr::extract_tiles_t scan_extract(const tar& archive) {
+  valhalla::baldr::extract_tiles_t tiles;
+  for (auto& c : archive.contents) {
+    try {
+      auto id = valhalla::baldr::GraphTile::GetTileId(c.first);
+      tiles[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
+    } catch (...) {
+      // It's possible to put non-tile files inside the tarfile.  As we're only
+      // parsing the file *name* as a GraphId here, we will just silently skip
+      // any file paths that can't be parsed by GraphId::GetTileId()
+      // If we end up with *no* recognizable tile files in the tarball at all,
+      // checks lower down will warn on that.
+    }
+  }
+  return tiles;
+}
+
+// map files to graph ids using the sidecar index, returns false if its missing or not usable
+bool load_extract_index(const tar& archive,
+                        bool updated_in_place,
+                        valhalla::baldr::extract_tiles_t& tiles) {
+  const auto index_file = extract_index_file(archive.tar_file);
+  struct stat s;
+  if (stat(index_file.c_str(), &s) ||
+      static_cast<uint64_t>(s.st_size) < sizeof(extract_index_header_t)) {
+    return false;
+  }
+
+  try {
+    mem_map<char> index(index_file, s.st_size);
+    extract_index_header_t header;
+    memcpy(&header, index.get(), sizeof(header));
+
+    // the index has to belong to exactly this version of the tar, a tar that is updated in place
+    // gets a new modification time each time so for those we rely on the checks below instead
+    extract_index_header_t expected{};
+    if (memcmp(header.magic, EXTRACT_INDEX_MAGIC, sizeof(header.magic)) ||
+        !stat_extract(archive.tar_file, expected) || header.tar_size != expected.tar_size ||
+        (!updated_in_place && (header.tar_mtime_sec != expected.tar_mtime_sec ||
+                               header.tar_mtime_nsec != expected.tar_mtime_nsec)) ||
+        header.count * sizeof(extract_index_entry_t) + sizeof(header) !=
+            static_cast<uint64_t>(s.st_size)) {
+      LOG_WARN("Ignoring stale extract index " + index_file);
+      return false;
+    }
+
+    // and must not be garbled or describe some other layout of the tar
+    const auto* entries =
+        reinterpret_cast<const extract_index_entry_t*>(index.get() + sizeof(header));
+    if (extract_index_checksum(entries, header.count) != header.checksum ||
+        (header.count && (!verify_extract_entry(archive, entries[0]) ||
+                          !verify_extract_entry(archive, entries[header.count - 1])))) {
+      LOG_WARN("Ignoring corrupt extract index " + index_file);
+      return false;
+    }
+
+    // the checksum covers the content so we only need to keep the pointers in bounds
+    tiles.reserve(header.count);
+    for (uint64_t i = 0; i < header.count; ++i) {
+      const auto& entry = entries[i];
+      if (entry.offset + entry.size > archive.mm.size()) {
+        tiles.clear();
+        return false;
+      }
+      tiles[entry.tile_id] = std::make_pair(archive.mm.get() + entry.offset, entry.size);
+    }
+  } catch (const std::exception& e) {
+    LOG_WARN("Could not load extract index " + index_file + ": " + e.what());
+    tiles.clear();
+    return false;
+  }
+  return true;
+}
+
+// writes the sidecar index for the tar, failing to do so only costs us the next startup time
+void save_extract_index(const tar& archive, const valhalla::baldr::extract_tiles_t& tiles) {
+  extract_index_header_t header{};
+  if (!stat_extract(archive.tar_file, header)) {
+    return;
+  }
+  memcpy(header.magic, EXTRACT_INDEX_MAGIC, sizeof(header.magic));
+
+  // sorted by position in the tar so the index is deterministic
+  std::vector<extract_index_entry_t> entries;
+  entries.reserve(tiles.size());
+  for (const auto& tile : tiles) {
+    entries.push_back({tile.first, static_cast<uint64_t>(tile.second.first - archive.mm.get()),
+                       tile.second.second});
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const extract_index_entry_t& a, const extract_index_entry_t& b) {
+              return a.offset < b.offset;
+            });
+  header.count = entries.size();
+  header.checksum = extract_index_checksum(entries.data(), entries.size());
+
+  // write it to the side and move it into place so no one ever sees half an index
+  const auto index_file = extract_index_file(archive.tar_file);
+  const auto tmp_file = extract_index_tmp_file(index_file);
+  {
+    std::ofstream file(tmp_file, std::ios::out | std::ios::binary | std::ios::trunc);
+    // the tar is allowed to live somewhere read only, then we just do without
+    if (!file.is_open()) {
+      LOG_INFO("Not writing extract index " + index_file + ", its directory is not writable");
+      return;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()),
+               entries.size() * sizeof(extract_index_entry_t));
+    if (!file) {
+      LOG_WARN("Could not write extract index " + index_file);
+      std::remove(tmp_file.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp_file.c_str(), index_file.c_str())) {
+    LOG_WARN("Could not write extract index " + index_file);
+    std::remove(tmp_file.c_str());
+    return;
+  }
+  LOG_INFO("Wrote extract index " + index_file);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+extract_tiles_t load_extract(std::shared_ptr<tar>& archive,
+                             const std::string& tar_file,
+                             bool use_index,
+                             bool updated_in_place) {
+  if (use_index) {
+    extract_tiles_t tiles;
+    archive.reset(new tar(tar_file, true, false));
+    if (load_extract_index(*archive, updated_in_place, tiles)) {
+      return tiles;
+    }
+  }
+
+  // fall back to walking the whole thing
+  archive.reset(new tar(tar_file));
+  auto tiles = scan_extract(*archive);
+  if (use_index && !tiles.empty()) {
+    save_extract_index(*archive, tiles);
+  }
+  return tiles;
+}
+
+} // namespace baldr
+} // namespace valhalla
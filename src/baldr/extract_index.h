@@ -0,0 +1,39 @@
+#pragma once
+
+#include "midgard/sequence.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace valhalla {
+namespace baldr {
+
+// where each tile lives inside of a tar extract, keyed by graphid
+using extract_tiles_t = std::unordered_map<uint64_t, std::pair<char*, size_t>>;
+
+/**
+ * Maps the tar and finds the tiles inside of it, using and maintaining the sidecar index of the
+ * tar if asked to. Loading the index is still linear in the number of tiles, it is checksummed
+ * and copied into the map, but it only touches the pages of the index and the first and last
+ * tile headers rather than every header in the tar, which for a planet sized extract means most
+ * of its pages
+ *
+ * @param archive           the archive to (re)load
+ * @param tar_file          where the archive lives
+ * @param use_index         whether to use a sidecar index and to write it when its missing or
+ *                          stale, writing is skipped when the directory of the tar is read only
+ * @param updated_in_place  whether the tar has its tiles rewritten in place, like a traffic
+ *                          extract, in which case its modification time cant tell us anything
+ *                          about whether the index is stale
+ * @return the tile locations within the archive
+ */
+extract_tiles_t load_extract(std::shared_ptr<midgard::tar>& archive,
+                             const std::string& tar_file,
+                             bool use_index,
+                             bool updated_in_place = false);
+
+} // namespace baldr
+} // namespace valhalla
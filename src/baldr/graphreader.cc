@@ -1,12 +1,27 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <sys/stat.h>
+#include <tuple>
 #include <utility>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
+#include "baldr/compression_utils.h"
 #include "baldr/connectivity_map.h"
+#include "baldr/curl_multi_tilegetter.h"
 #include "baldr/curl_tilegetter.h"
 #include "baldr/graphreader.h"
+#include "extract_index.h"
 #include "filesystem.h"
 #include "incident_singleton.h"
 #include "midgard/encoded.h"
@@ -20,6 +35,29 @@ namespace {
 constexpr size_t DEFAULT_MAX_CACHE_SIZE = 1073741824; // 1 gig
 constexpr size_t AVERAGE_TILE_SIZE = 2097152;         // 2 megs
 constexpr size_t AVERAGE_MM_TILE_SIZE = 1024;         // 1k
+constexpr size_t DEFAULT_PREFETCH_MAX_TILES = 64;
+
+// Readers with the same settings share the transfers so that concurrent misses on a tile only
+// download it once. The tile_dir is one of the settings since only the reader whose miss started
+// a download saves the tile, so readers saving to different places cant share
+valhalla::baldr::curl_multi_tile_getter_t shared_tile_getter(size_t max_concurrent,
+                                                             const std::string& user_agent,
+                                                             bool gzipped,
+                                                             const std::string& tile_dir) {
+  using settings_t = std::tuple<size_t, std::string, bool, std::string>;
+  static std::mutex mutex;
+  static std::map<settings_t, valhalla::baldr::curl_multi_tile_getter_t> getters;
+  std::lock_guard<std::mutex> lock(mutex);
+  settings_t settings{max_concurrent, user_agent, gzipped, tile_dir};
+  auto found = getters.find(settings);
+  if (found == getters.end()) {
+    found = getters
+                .emplace(settings, valhalla::baldr::curl_multi_tile_getter_t(max_concurrent,
+                                                                             user_agent, gzipped))
+                .first;
+  }
+  return found->second;
+}
 
 } // namespace
 
@@ -27,24 +65,14 @@ namespace valhalla {
 namespace baldr {
 
 GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& pt) {
+  // whether to use (and maintain) sidecar indices of the tars to avoid scanning them on startup
+  bool use_index = pt.get<bool>("extract_index", false);
+
   // if you really meant to load it
   if (pt.get_optional<std::string>("tile_extract")) {
     try {
-      // load the tar
-      archive.reset(new midgard::tar(pt.get<std::string>("tile_extract")));
-      // map files to graph ids
-      for (auto& c : archive->contents) {
-        try {
-          auto id = GraphTile::GetTileId(c.first);
-          tiles[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
-        } catch (...) {
-          // It's possible to put non-tile files inside the tarfile.  As we're only
-          // parsing the file *name* as a GraphId here, we will just silently skip
-          // any file paths that can't be parsed by GraphId::GetTileId()
-          // If we end up with *no* recognizable tile files in the tarball at all,
-          // checks lower down will warn on that.
-        }
-      }
+      // load the tar and map files to graph ids
+      tiles = load_extract(archive, pt.get<std::string>("tile_extract"), use_index);
       // couldn't load it
       if (tiles.empty()) {
         LOG_WARN("Tile extract contained no usuable tiles");
@@ -63,21 +91,10 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
 
   if (pt.get_optional<std::string>("traffic_extract")) {
     try {
-      // load the tar
-      traffic_archive.reset(new midgard::tar(pt.get<std::string>("traffic_extract")));
-      // map files to graph ids
-      for (auto& c : traffic_archive->contents) {
-        try {
-          auto id = GraphTile::GetTileId(c.first);
-          traffic_tiles[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
-        } catch (...) {
-          // It's possible to put non-tile files inside the tarfile.  As we're only
-          // parsing the file *name* as a GraphId here, we will just silently skip
-          // any file paths that can't be parsed by GraphId::GetTileId()
-          // If we end up with *no* recognizable tile files in the tarball at all,
-          // checks lower down will warn on that.
-        }
-      }
+      // load the tar and map files to graph ids
+      // the traffic extract has its speeds rewritten in place while we have it mapped
+      traffic_tiles =
+          load_extract(traffic_archive, pt.get<std::string>("traffic_extract"), use_index, true);
       // couldn't load it
       if (traffic_tiles.empty()) {
         LOG_WARN("Traffic tile extract contained no usuable tiles");
@@ -97,6 +114,90 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
   }
 }
 
+void GraphReader::tile_extract_t::warmup(const boost::property_tree::ptree& pt) const {
+  std::call_once(warmed_up, [this, &pt]() {
+    const auto start = std::chrono::steady_clock::now();
+
+    // level 2 is usually too big to warm up completely so we only do it within a bbox
+    boost::optional<AABB2<PointLL>> bbox;
+    if (auto bbox_str = pt.get_optional<std::string>("bbox")) {
+      std::vector<double> coords;
+      std::stringstream ss(*bbox_str);
+      std::string coord;
+      while (std::getline(ss, coord, ',')) {
+        coords.push_back(std::stod(coord));
+      }
+      if (coords.size() != 4) {
+        throw std::runtime_error("warmup.bbox must be min_lon,min_lat,max_lon,max_lat");
+      }
+      bbox = AABB2<PointLL>(coords[0], coords[1], coords[2], coords[3]);
+    }
+    bool lock = pt.get<bool>("mlock", false);
+
+    // figure out what parts of the extracts we want
+    std::vector<std::pair<char*, size_t>> regions;
+    size_t total_bytes = 0;
+    const auto& local_tiles = TileHierarchy::levels()[2].tiles;
+    for (const auto* extract : {&tiles, &traffic_tiles}) {
+      for (const auto& tile : *extract) {
+        GraphId id(tile.first);
+        if (id.level() < 2 ||
+            (id.level() == 2 && bbox && bbox->Intersects(local_tiles.TileBounds(id.tileid())))) {
+          regions.push_back(tile.second);
+          total_bytes += tile.second.second;
+        }
+      }
+    }
+    // in file order so that we read the extracts front to back
+    std::sort(regions.begin(), regions.end());
+    LOG_INFO("Warming up " + std::to_string(regions.size()) + " tiles (" +
+             std::to_string(total_bytes >> 20) + " MB)");
+
+#ifdef _WIN32
+    const size_t page_size = 4096;
+    if (lock) {
+      LOG_WARN("Locking the warmed up tiles in memory is not supported on this platform");
+      lock = false;
+    }
+#else
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+#endif
+
+    // touch every page, and lock it if asked
+    size_t done_bytes = 0;
+    size_t next_report = 10;
+    volatile char sink = 0;
+    for (const auto& region : regions) {
+      auto* begin = reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(region.first) &
+                                            ~static_cast<uintptr_t>(page_size - 1));
+      auto* end = region.first + region.second;
+#ifndef _WIN32
+      posix_madvise(begin, end - begin, POSIX_MADV_WILLNEED);
+#endif
+      for (const char* page = begin; page < end; page += page_size) {
+        sink = sink + *page;
+      }
+#ifndef _WIN32
+      if (lock && mlock(begin, end - begin)) {
+        LOG_WARN("Could not lock the warmed up tiles in memory: " + std::string(strerror(errno)));
+        lock = false;
+      }
+#endif
+
+      // let them know how far along we are
+      done_bytes += region.second;
+      while (total_bytes && done_bytes * 100 / total_bytes >= next_report) {
+        LOG_INFO("Warmup " + std::to_string(next_report) + "% done");
+        next_report += 10;
+      }
+    }
+
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    LOG_INFO("Warmup finished in " + std::to_string(elapsed.count()) + " seconds" +
+             (lock ? ", tiles are locked in memory" : ""));
+  });
+}
+
 std::shared_ptr<const GraphReader::tile_extract_t>
 GraphReader::get_extract_instance(const boost::property_tree::ptree& pt) {
   static std::shared_ptr<const GraphReader::tile_extract_t> tile_extract(
@@ -218,8 +319,11 @@ void SimpleTileCache::Trim() {
 // ----------------------------------------------------------------------------
 
 // Constructor.
-TileCacheLRU::TileCacheLRU(size_t max_size, MemoryLimitControl mem_control)
-    : mem_control_(mem_control), cache_size_(0), max_cache_size_(max_size) {
+TileCacheLRU::TileCacheLRU(size_t max_size,
+                           MemoryLimitControl mem_control,
+                           size_t max_compressed_size)
+    : mem_control_(mem_control), cache_size_(0), max_cache_size_(max_size), compressed_size_(0),
+      max_compressed_size_(max_compressed_size) {
 }
 
 void TileCacheLRU::Reserve(size_t tile_size) {
@@ -233,6 +337,10 @@ bool TileCacheLRU::Contains(const GraphId& graphid) const {
   return cache_.find(graphid) != cache_.cend();
 }
 
+bool TileCacheLRU::ContainsCompressed(const GraphId& graphid) const {
+  return compressed_.find(graphid) != compressed_.cend();
+}
+
 bool TileCacheLRU::OverCommitted() const {
   return cache_size_ > max_cache_size_;
 }
@@ -241,6 +349,9 @@ void TileCacheLRU::Clear() {
   cache_size_ = 0;
   cache_.clear();
   key_val_lru_list_.clear();
+  compressed_size_ = 0;
+  compressed_.clear();
+  compressed_lru_list_.clear();
 }
 
 void TileCacheLRU::Trim() {
@@ -249,21 +360,132 @@ void TileCacheLRU::Trim() {
 
 graph_tile_ptr TileCacheLRU::Get(const GraphId& graphid) const {
   auto cached = cache_.find(graphid);
-  if (cached == cache_.cend()) {
+  if (cached != cache_.cend()) {
+    const KeyValueIter& entry_iter = cached->second;
+    MoveToLruHead(entry_iter);
+    return entry_iter->tile;
+  }
+
+  // maybe we still have it compressed
+  if (max_compressed_size_ == 0) {
+    return nullptr;
+  }
+  auto compressed = compressed_.find(graphid);
+  if (compressed == compressed_.cend()) {
+    ++stats_.misses;
     return nullptr;
   }
 
-  const KeyValueIter& entry_iter = cached->second;
-  MoveToLruHead(entry_iter);
+  // inflate it, we know exactly how big it will be
+  const auto start = std::chrono::steady_clock::now();
+  const CompressedKeyValue& entry = *compressed->second;
+  std::vector<char> data;
+  auto src_func = [&entry](z_stream& s) -> void {
+    s.next_in = const_cast<Byte*>(reinterpret_cast<const Byte*>(entry.data.data()));
+    s.avail_in = static_cast<unsigned int>(entry.data.size());
+  };
+  auto dst_func = [&data, &entry](z_stream& s) -> int {
+    // if the whole buffer wasn't used we are done
+    auto size = data.size();
+    if (s.total_out < size) {
+      data.resize(s.total_out);
+    } // one extra byte so the first buffer is never exactly used up
+    else {
+      data.resize(size + entry.tile_size + 1);
+      s.next_out = reinterpret_cast<Byte*>(data.data() + size);
+      s.avail_out = static_cast<unsigned int>(entry.tile_size + 1);
+    }
+    return Z_NO_FLUSH;
+  };
+  const bool inflated = baldr::inflate(src_func, dst_func) && data.size() == entry.tile_size;
+  const GraphId id = entry.id;
+  EraseCompressed(compressed->second);
+  if (!inflated) {
+    LOG_ERROR("Failed to inflate cached tile " + std::to_string(id));
+    ++stats_.misses;
+    return nullptr;
+  }
+  graph_tile_ptr tile = GraphTile::Create(id, std::move(data));
+  stats_.decompress_ms +=
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  ++stats_.hits;
+
+  // move it back to the main tier
+  const auto tile_size = tile->header()->end_offset();
+  if (mem_control_ == MemoryLimitControl::HARD) {
+    TrimToFit(tile_size);
+  }
+  key_val_lru_list_.emplace_front(KeyValue{id, std::move(tile)});
+  cache_.emplace(id, key_val_lru_list_.begin());
+  cache_size_ += tile_size;
+  return key_val_lru_list_.front().tile;
+}
+
+void TileCacheLRU::Compress(const KeyValue& entry) const {
+  // the traffic memory of a tile lives outside of the tile so we cant bring it back
+  if (entry.tile->get_traffic_tile()()) {
+    return;
+  }
+
+  // deflate the raw tile bytes, speed matters more than ratio here
+  const auto start = std::chrono::steady_clock::now();
+  const size_t tile_size = entry.tile->header()->end_offset();
+  const char* tile_data = reinterpret_cast<const char*>(entry.tile->header());
+  std::vector<char> data;
+  auto src_func = [tile_data, tile_size](z_stream& s) -> int {
+    s.next_in = const_cast<Byte*>(reinterpret_cast<const Byte*>(tile_data));
+    s.avail_in = static_cast<unsigned int>(tile_size);
+    return Z_FINISH;
+  };
+  auto dst_func = [&data, tile_size](z_stream& s) -> void {
+    // if the whole buffer wasn't used we are done
+    auto size = data.size();
+    if (s.total_out < size) {
+      data.resize(s.total_out);
+    } // we need more space
+    else {
+      const size_t chunk = tile_size / 4 + 64;
+      data.resize(size + chunk);
+      s.next_out = reinterpret_cast<Byte*>(data.data() + size);
+      s.avail_out = static_cast<unsigned int>(chunk);
+    }
+  };
+  if (!baldr::deflate(src_func, dst_func, Z_BEST_SPEED, false)) {
+    return;
+  }
+  data.shrink_to_fit();
+  stats_.compress_ms +=
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  // make room for it
+  if (data.size() > max_compressed_size_) {
+    return;
+  }
+  while (max_compressed_size_ - compressed_size_ < data.size()) {
+    EraseCompressed(std::prev(compressed_lru_list_.end()));
+    ++stats_.evictions;
+  }
 
-  return entry_iter->tile;
+  compressed_size_ += data.size();
+  compressed_lru_list_.emplace_front(entry.id, std::move(data), tile_size);
+  compressed_.emplace(entry.id, compressed_lru_list_.begin());
+  ++stats_.compressions;
 }
 
-size_t TileCacheLRU::TrimToFit(const size_t required_size) {
+void TileCacheLRU::EraseCompressed(const CompressedKeyValueIter& entry_iter) const {
+  compressed_size_ -= entry_iter->data.size();
+  compressed_.erase(entry_iter->id);
+  compressed_lru_list_.erase(entry_iter);
+}
+
+size_t TileCacheLRU::TrimToFit(const size_t required_size) const {
   size_t freed_space = 0;
   while ((OverCommitted() || (max_cache_size_ - cache_size_) < required_size) &&
          !key_val_lru_list_.empty()) {
     const KeyValue& entry_to_evict = key_val_lru_list_.back();
+    if (max_compressed_size_ > 0) {
+      Compress(entry_to_evict);
+    }
     const auto tile_size = entry_to_evict.tile->header()->end_offset();
     cache_size_ -= tile_size;
     freed_space += tile_size;
@@ -282,6 +504,12 @@ graph_tile_ptr TileCacheLRU::Put(const GraphId& graphid, graph_tile_ptr tile, si
     throw std::runtime_error("TileCacheLRU: tile size is bigger than max cache size");
   }
 
+  // the tile is about to be in the main tier, no need to keep it compressed as well
+  auto compressed = compressed_.find(graphid);
+  if (compressed != compressed_.end()) {
+    EraseCompressed(compressed->second);
+  }
+
   auto cached = cache_.find(graphid);
   if (cached == cache_.end()) {
     if (mem_control_ == MemoryLimitControl::HARD) {
@@ -368,6 +596,76 @@ graph_tile_ptr SynchronizedTileCache::Put(const GraphId& graphid, graph_tile_ptr
   return cache_.Put(graphid, std::move(tile), size);
 }
 
+// ----------------------------------------------------------------------------
+// ShardedTileCache implementation
+// ----------------------------------------------------------------------------
+
+// Constructor.
+ShardedTileCache::ShardedTileCache(std::vector<std::unique_ptr<TileCache>>&& shards)
+    : shards_(std::make_shared<std::vector<Shard>>(shards.size())) {
+  if (shards.empty()) {
+    throw std::runtime_error("ShardedTileCache: at least one shard is required");
+  }
+  for (size_t i = 0; i < shards.size(); ++i) {
+    (*shards_)[i].cache = std::move(shards[i]);
+  }
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void ShardedTileCache::Reserve(size_t tile_size) {
+  for (auto& shard : *shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.cache->Reserve(tile_size);
+  }
+}
+
+// Checks if tile exists in the cache.
+bool ShardedTileCache::Contains(const GraphId& graphid) const {
+  auto& s = shard(graphid);
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.cache->Contains(graphid);
+}
+
+// Lets you know if the cache is too large.
+bool ShardedTileCache::OverCommitted() const {
+  for (const auto& shard : *shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.cache->OverCommitted()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Clears the cache.
+void ShardedTileCache::Clear() {
+  for (auto& shard : *shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.cache->Clear();
+  }
+}
+
+void ShardedTileCache::Trim() {
+  for (auto& shard : *shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.cache->Trim();
+  }
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+graph_tile_ptr ShardedTileCache::Get(const GraphId& graphid) const {
+  auto& s = shard(graphid);
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.cache->Get(graphid);
+}
+
+// Puts a copy of a tile of into the cache.
+graph_tile_ptr ShardedTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) {
+  auto& s = shard(graphid);
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.cache->Put(graphid, std::move(tile), size);
+}
+
 // Constructs tile cache.
 TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree& pt) {
   size_t max_cache_size = pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE);
@@ -377,10 +675,35 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
                              ? TileCacheLRU::MemoryLimitControl::HARD
                              : TileCacheLRU::MemoryLimitControl::SOFT;
 
+  size_t lru_compressed_size = pt.get<size_t>("lru_compressed_cache_size", 0);
+
   bool use_simple_cache = pt.get<bool>("use_simple_mem_cache", false);
 
   // wrap tile cache with thread-safe version
   if (pt.get<bool>("global_synchronized_cache", false)) {
+    // split the global cache into independently locked shards to reduce lock contention
+    size_t shard_count = pt.get<size_t>("global_cache_shards", 1);
+    if (shard_count > 1) {
+      static std::unique_ptr<ShardedTileCache> shardedTileCache_;
+      static std::mutex shardedFactoryMutex;
+      std::lock_guard<std::mutex> lock(shardedFactoryMutex);
+      if (!shardedTileCache_) {
+        // each shard gets its share of the memory budget. we dont use the flat cache for the
+        // shards since each one would allocate an index over the entire tile hierarchy
+        std::vector<std::unique_ptr<TileCache>> shards;
+        for (size_t i = 0; i < shard_count; ++i) {
+          if (use_lru_cache) {
+            shards.emplace_back(new TileCacheLRU(max_cache_size / shard_count, lru_mem_control,
+                                                 lru_compressed_size / shard_count));
+          } else {
+            shards.emplace_back(new SimpleTileCache(max_cache_size / shard_count));
+          }
+        }
+        shardedTileCache_.reset(new ShardedTileCache(std::move(shards)));
+      }
+      return new ShardedTileCache(*shardedTileCache_);
+    }
+
     // Handle synchronization of cache
     static std::mutex globalCacheMutex_;
     static std::shared_ptr<TileCache> globalTileCache_;
@@ -389,7 +712,8 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
     std::lock_guard<std::mutex> lock(factoryMutex);
     if (!globalTileCache_) {
       if (use_lru_cache) {
-        globalTileCache_.reset(new TileCacheLRU(max_cache_size, lru_mem_control));
+        globalTileCache_.reset(
+            new TileCacheLRU(max_cache_size, lru_mem_control, lru_compressed_size));
       } else {
         // globalTileCache_.reset(new SimpleTileCache(max_cache_size));
         globalTileCache_.reset(new FlatTileCache(max_cache_size));
@@ -400,7 +724,7 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
 
   // or do you want to use an LRU cache
   if (use_lru_cache) {
-    return new TileCacheLRU(max_cache_size, lru_mem_control);
+    return new TileCacheLRU(max_cache_size, lru_mem_control, lru_compressed_size);
   }
 
   // maybe you want a basic hashmap of tiles
@@ -422,9 +746,15 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
 
   // Make a tile fetcher if we havent passed one in from somewhere else
   if (!tile_getter_ && !tile_url_.empty()) {
-    tile_getter_ = std::make_unique<curl_tile_getter_t>(max_concurrent_users_,
-                                                        pt.get<std::string>("user_agent", ""),
-                                                        pt.get<bool>("tile_url_gz", false));
+    if (pt.get<bool>("tile_url_coalesced", false)) {
+      tile_getter_ = std::make_unique<curl_multi_tile_getter_t>(
+          shared_tile_getter(max_concurrent_users_, pt.get<std::string>("user_agent", ""),
+                             pt.get<bool>("tile_url_gz", false), tile_dir_));
+    } else {
+      tile_getter_ = std::make_unique<curl_tile_getter_t>(max_concurrent_users_,
+                                                          pt.get<std::string>("user_agent", ""),
+                                                          pt.get<bool>("tile_url_gz", false));
+    }
   }
 
   // validate tile url
@@ -435,6 +765,11 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
   // mmap'd file
   cache_->Reserve(tile_extract_->tiles.empty() ? AVERAGE_TILE_SIZE : AVERAGE_MM_TILE_SIZE);
 
+  // Get the most used parts of the extract into memory before we serve any requests
+  if (!tile_extract_->tiles.empty() && pt.get<bool>("warmup.enabled", false)) {
+    tile_extract_->warmup(pt.get_child("warmup"));
+  }
+
   // Initialize the incident cache singleton if we have any kind of configuration to do so. if the
   // configuration is wrong or any kind of problem occurs this throws. the call below will spawn a
   // single background thread which is responsible for loading incidents continually
@@ -448,7 +783,16 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
 
   // Fill shortcut recovery cache if requested or by default in memmap mode
   if (pt.get<bool>("shortcut_caching", false)) {
-    shortcut_recovery_t::get_instance(this);
+    shortcut_recovery_t::get_instance(this, pt.get<std::string>("shortcut_recovery_file", ""));
+  }
+
+  // Load tiles in the background if requested, pointless if we have them mmapped already
+  size_t prefetch_threads = pt.get<size_t>("prefetch_threads", 0);
+  if (prefetch_threads > 0 && tile_extract_->tiles.empty()) {
+    prefetcher_.reset(
+        new tile_prefetcher_t(prefetch_threads,
+                              pt.get<size_t>("prefetch_max_tiles", DEFAULT_PREFETCH_MAX_TILES),
+                              [this](const GraphId& base) { return LoadGraphTile(base); }));
   }
 }
 
@@ -532,43 +876,105 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
     return cache_->Put(base, std::move(tile), size);
   } // Try getting it from flat file
   else {
-    auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
-    auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
-                              ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
-                                                                     traffic_ptr->second)
-                              : nullptr;
-
-    // Try to get it from disk and if we cant..
-    graph_tile_ptr tile = GraphTile::Create(tile_dir_, base, std::move(traffic_memory));
-    if (!tile || !tile->header()) {
-      if (!tile_getter_) {
+    // It may have been loaded in the background already, otherwise we load it now
+    graph_tile_ptr tile = prefetcher_ ? prefetcher_->take(base) : nullptr;
+    if (!tile) {
+      tile = LoadGraphTile(base);
+      if (!tile) {
         return nullptr;
       }
+    }
 
-      {
-        std::lock_guard<std::mutex> lock(_404s_lock);
-        if (_404s.find(base) != _404s.end()) {
-          // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
-          return nullptr;
-        }
-      }
+    // Keep a copy in the cache and return it
+    const size_t size = tile->header()->end_offset();
+    return cache_->Put(base, std::move(tile), size);
+  }
+}
 
-      // Get it from the url and cache it to disk if you can
-      tile = GraphTile::CacheTileURL(tile_url_, base, tile_getter_.get(), tile_dir_);
-      if (!tile) {
-        std::lock_guard<std::mutex> lock(_404s_lock);
-        _404s.insert(base);
+// Load a tile from disk or url without going through the cache
+graph_tile_ptr GraphReader::LoadGraphTile(const GraphId& base) {
+  auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
+  auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
+                            ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
+                                                                   traffic_ptr->second)
+                            : nullptr;
+
+  // Try to get it from disk and if we cant..
+  graph_tile_ptr tile = GraphTile::Create(tile_dir_, base, std::move(traffic_memory));
+  if (!tile || !tile->header()) {
+    if (!tile_getter_) {
+      return nullptr;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(_404s_lock);
+      if (_404s.find(base) != _404s.end()) {
         // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
         return nullptr;
       }
-      // LOG_DEBUG("Url cache hit " + GraphTile::FileSuffix(base));
-    } else {
-      // LOG_DEBUG("Disk cache hit " + GraphTile::FileSuffix(base));
     }
 
-    // Keep a copy in the cache and return it
-    const size_t size = tile->header()->end_offset();
-    return cache_->Put(base, std::move(tile), size);
+    // Get it from the url and cache it to disk if you can
+    tile = GraphTile::CacheTileURL(tile_url_, base, tile_getter_.get(), tile_dir_);
+    if (!tile) {
+      std::lock_guard<std::mutex> lock(_404s_lock);
+      _404s.insert(base);
+      // LOG_DEBUG("Url cache miss " + GraphTile::FileSuffix(base));
+      return nullptr;
+    }
+    // LOG_DEBUG("Url cache hit " + GraphTile::FileSuffix(base));
+  } else {
+    // LOG_DEBUG("Disk cache hit " + GraphTile::FileSuffix(base));
+  }
+  return tile;
+}
+
+// Move whatever the prefetcher has loaded so far into the cache
+void GraphReader::AdoptPrefetched() {
+  for (auto& loaded : prefetcher_->take_loaded()) {
+    if (!cache_->Contains(loaded.first)) {
+      const size_t size = loaded.second->header()->end_offset();
+      cache_->Put(loaded.first, std::move(loaded.second), size);
+    }
+  }
+}
+
+// Prefetch a single tile
+void GraphReader::Prefetch(const GraphId& graphid) {
+  if (!prefetcher_ || !graphid.Is_Valid()) {
+    return;
+  }
+  AdoptPrefetched();
+  RequestPrefetch(graphid.Tile_Base());
+}
+
+// Prefetch a tile and its neighbors on the same level
+void GraphReader::PrefetchNeighbors(const GraphId& graphid) {
+  if (!prefetcher_ || !graphid.Is_Valid() || graphid.level() >= TileHierarchy::levels().size()) {
+    return;
+  }
+  AdoptPrefetched();
+  const auto& tiles = TileHierarchy::levels()[graphid.level()].tiles;
+  const int32_t tile_id = graphid.tileid();
+  const int32_t row_ids[] = {tiles.BottomNeighbor(tile_id), tile_id, tiles.TopNeighbor(tile_id)};
+  for (int32_t id : row_ids) {
+    RequestPrefetch({static_cast<uint32_t>(tiles.LeftNeighbor(id)), graphid.level(), 0});
+    RequestPrefetch({static_cast<uint32_t>(id), graphid.level(), 0});
+    RequestPrefetch({static_cast<uint32_t>(tiles.RightNeighbor(id)), graphid.level(), 0});
+  }
+}
+
+// Prefetch the tiles along a line on all levels
+void GraphReader::PrefetchAlong(const midgard::PointLL& a, const midgard::PointLL& b) {
+  if (!prefetcher_) {
+    return;
+  }
+  AdoptPrefetched();
+  const std::vector<midgard::PointLL> line{a, b};
+  for (const auto& level : TileHierarchy::levels()) {
+    for (const auto& tile : level.tiles.Intersect(line)) {
+      RequestPrefetch({static_cast<uint32_t>(tile.first), level.level, 0});
+    }
   }
 }
 
@@ -758,6 +1164,10 @@ std::vector<GraphId> GraphReader::RecoverShortcut(const GraphId& shortcut_id) {
   return shortcut_recovery_t::get_instance().get(shortcut_id, *this);
 }
 
+void GraphReader::SaveShortcutRecovery(const std::string& file) {
+  shortcut_recovery_t::save(*this, file);
+}
+
 // Convenience method to get the relative edge density (from the
 // begin node of an edge).
 uint32_t GraphReader::GetEdgeDensity(const GraphId& edgeid) {
@@ -861,6 +1271,17 @@ std::unordered_set<GraphId> GraphReader::GetTileSet(const uint8_t level) const {
   return tiles;
 }
 
+// Sums up the epochs of the live traffic tiles, each of them is bumped when speeds are published
+uint64_t GraphReader::GetTrafficEpoch() const {
+  uint64_t epoch = 0;
+  for (const auto& t : tile_extract_->traffic_tiles) {
+    if (t.second.second >= sizeof(TrafficTileHeader)) {
+      epoch += TrafficTile::load_epoch(reinterpret_cast<TrafficTileHeader*>(t.second.first));
+    }
+  }
+  return epoch;
+}
+
 AABB2<PointLL> GraphReader::GetMinimumBoundingBox(const AABB2<PointLL>& bb) {
   // Iterate through all the tiles that intersect this bounding box
   const auto& ids = TileHierarchy::GetGraphIds(bb);
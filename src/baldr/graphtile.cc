@@ -216,21 +216,56 @@ graph_tile_ptr GraphTile::CacheTileURL(const std::string& tile_url,
   if (result.status_ != tile_getter_t::status_code_t::SUCCESS) {
     return nullptr;
   }
+  // only whoever started the download saves the tile
+  return CacheTileBytes(graphid, std::move(result.bytes_), tile_getter->gzipped(),
+                        result.coalesced_ ? "" : cache_location);
+}
+
+std::vector<graph_tile_ptr> GraphTile::CacheTileURLs(const std::string& tile_url,
+                                                     const std::vector<GraphId>& graphids,
+                                                     tile_getter_t* tile_getter,
+                                                     const std::string& cache_location) {
+  // Don't bother with invalid ids
+  std::vector<graph_tile_ptr> tiles(graphids.size());
+  std::vector<size_t> indices;
+  std::vector<std::string> uris;
+  for (size_t i = 0; i < graphids.size(); ++i) {
+    if (graphids[i].Is_Valid() && graphids[i].level() <= TileHierarchy::get_max_level()) {
+      indices.push_back(i);
+      uris.push_back(MakeSingleTileUrl(tile_url, graphids[i]));
+    }
+  }
+
+  // fetch them all at once and make tiles out of the ones we got
+  auto results = tile_getter->get_batch(uris);
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (results[i].status_ == tile_getter_t::status_code_t::SUCCESS) {
+      tiles[indices[i]] =
+          CacheTileBytes(graphids[indices[i]], std::move(results[i].bytes_), tile_getter->gzipped(),
+                         results[i].coalesced_ ? "" : cache_location);
+    }
+  }
+  return tiles;
+}
+
+graph_tile_ptr GraphTile::CacheTileBytes(const GraphId& graphid,
+                                         std::vector<char>&& bytes,
+                                         bool gzipped,
+                                         const std::string& cache_location) {
   // try to cache it on disk so we dont have to keep fetching it from url
   if (!cache_location.empty()) {
-    auto suffix = FileSuffix(graphid.Tile_Base(),
-                             (tile_getter->gzipped() ? valhalla::baldr::SUFFIX_COMPRESSED
-                                                     : valhalla::baldr::SUFFIX_NON_COMPRESSED));
+    auto suffix = FileSuffix(graphid.Tile_Base(), (gzipped ? valhalla::baldr::SUFFIX_COMPRESSED
+                                                           : valhalla::baldr::SUFFIX_NON_COMPRESSED));
     auto disk_location = cache_location + filesystem::path::preferred_separator + suffix;
-    SaveTileToFile(result.bytes_, disk_location);
+    SaveTileToFile(bytes, disk_location);
   }
 
   // turn the memory into a tile
-  if (tile_getter->gzipped()) {
-    return DecompressTile(graphid, result.bytes_);
+  if (gzipped) {
+    return DecompressTile(graphid, bytes);
   }
 
-  return new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(result.bytes_)));
+  return new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(bytes)));
 }
 
 GraphTile::~GraphTile() = default;
@@ -347,6 +382,8 @@ void GraphTile::Initialize(const GraphId& graphid) {
     predictedspeeds_.set_profiles(reinterpret_cast<int16_t*>(ptr2));
 
     lane_connectivity_size_ = header_->predictedspeeds_offset() - header_->lane_connectivity_offset();
+  } else if (header_->routing_edges_offset() > 0) {
+    lane_connectivity_size_ = header_->routing_edges_offset() - header_->lane_connectivity_offset();
   } else {
     lane_connectivity_size_ = header_->end_offset() - header_->lane_connectivity_offset();
   }
@@ -355,6 +392,19 @@ void GraphTile::Initialize(const GraphId& graphid) {
   // is not fixed size and count).
   // example_size_ = header_->end_offset() - header_->example_offset();
 
+  // Start of the routing edges (always the last section of the tile when present)
+  if (header_->routing_edges_offset() > 0) {
+    if (header_->routing_edges_offset() +
+            RoutingEdges::size(header_->directededgecount()) ==
+        header_->end_offset()) {
+      routing_edges_.set(tile_ptr + header_->routing_edges_offset(),
+                         header_->directededgecount());
+    } else {
+      LOG_WARN("Ignoring routing edges of wrong size in tile " + std::to_string(graphid.tileid()) +
+               " at level " + std::to_string(graphid.level()));
+    }
+  }
+
   // ANY NEW EXPANSION DATA GOES HERE
 
   // Associate one stop Ids for transit tiles
@@ -0,0 +1,155 @@
+#include "baldr/landmarks.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace {
+
+using namespace valhalla::baldr;
+
+struct file_header_t {
+  char magic[8];
+  uint64_t dataset_id;   // of the tileset the landmarks were built from
+  uint32_t costing;      // of the profile
+  uint32_t profile_size; // bytes of serialized costing options, padded to 8 bytes in the file
+  uint32_t tile_count;
+  uint32_t node_count;
+  uint32_t landmark_count;
+  uint32_t padding;
+};
+constexpr char kFileMagic[8] = {'V', 'A', 'L', 'T', 'L', 'M', '0', '1'};
+
+size_t padded(size_t size) {
+  return (size + 7) & ~size_t(7);
+}
+
+// the size the file should be given its header
+size_t file_size(const file_header_t& header) {
+  return sizeof(file_header_t) + padded(header.profile_size) +
+         header.tile_count * sizeof(Landmarks::tile_t) +
+         static_cast<size_t>(header.node_count) * 2 * header.landmark_count * sizeof(float);
+}
+
+// the id of the dataset we can use to tell if the file goes with the tileset
+uint64_t dataset_id(GraphReader& reader) {
+  for (const auto& level : TileHierarchy::levels()) {
+    for (const auto& tile_id : reader.GetTileSet(level.level)) {
+      if (auto tile = reader.GetGraphTile(tile_id)) {
+        return tile->header()->dataset_id();
+      }
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+constexpr uint32_t Landmarks::kInvalidNode;
+
+Landmarks::Landmarks()
+    : costing_(0), landmark_count_(0), node_count_(0), tiles_(nullptr), tile_count_(0),
+      costs_(nullptr) {
+}
+
+bool Landmarks::Load(const std::string& file, GraphReader& reader) {
+  struct stat s;
+  if (stat(file.c_str(), &s) || static_cast<uint64_t>(s.st_size) < sizeof(file_header_t)) {
+    LOG_WARN("Landmarks " + file + " not found");
+    return false;
+  }
+
+  try {
+    mapped_.map(file, s.st_size);
+    file_header_t header;
+    memcpy(&header, mapped_.get(), sizeof(header));
+    // it has to be the right size and belong to the tileset
+    if (memcmp(header.magic, kFileMagic, sizeof(header.magic)) || header.landmark_count == 0 ||
+        file_size(header) != static_cast<uint64_t>(s.st_size) ||
+        header.dataset_id != dataset_id(reader)) {
+      LOG_WARN("Ignoring stale landmarks " + file);
+      mapped_.unmap();
+      return false;
+    }
+
+    const char* pos = mapped_.get() + sizeof(header);
+    profile_.assign(pos, header.profile_size);
+    pos += padded(header.profile_size);
+    tiles_ = reinterpret_cast<const tile_t*>(pos);
+    costs_ = reinterpret_cast<const float*>(tiles_ + header.tile_count);
+    costing_ = header.costing;
+    landmark_count_ = header.landmark_count;
+    node_count_ = header.node_count;
+    tile_count_ = header.tile_count;
+
+    // the nodes of the tiles have to stay in bounds
+    for (uint32_t i = 0; i < tile_count_; ++i) {
+      if (static_cast<uint64_t>(tiles_[i].first_node) + tiles_[i].node_count > node_count_) {
+        LOG_WARN("Ignoring corrupt landmarks " + file);
+        costs_ = nullptr;
+        mapped_.unmap();
+        return false;
+      }
+    }
+  } catch (const std::exception& e) {
+    LOG_WARN("Could not map landmarks " + file + ": " + e.what());
+    costs_ = nullptr;
+    return false;
+  }
+
+  tile_index_.clear();
+  tile_index_.reserve(tile_count_);
+  for (uint32_t i = 0; i < tile_count_; ++i) {
+    tile_index_.emplace(tiles_[i].tile_id, i);
+  }
+  return true;
+}
+
+void Landmarks::Save(const std::string& file,
+                     GraphReader& reader,
+                     uint32_t costing,
+                     const std::string& profile,
+                     uint32_t landmark_count,
+                     const std::vector<tile_t>& tiles,
+                     const std::vector<float>& costs) {
+  file_header_t header{};
+  memcpy(header.magic, kFileMagic, sizeof(header.magic));
+  header.dataset_id = dataset_id(reader);
+  header.costing = costing;
+  header.profile_size = profile.size();
+  header.tile_count = tiles.size();
+  header.node_count = landmark_count ? costs.size() / (2 * landmark_count) : 0;
+  header.landmark_count = landmark_count;
+
+  // write it to the side and move it into place so no one ever maps half a file
+  const auto tmp_file = file + ".tmp";
+  {
+    const char padding[8] = {};
+    std::ofstream out(tmp_file, std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(profile.data(), profile.size());
+    out.write(padding, padded(profile.size()) - profile.size());
+    out.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(tile_t));
+    out.write(reinterpret_cast<const char*>(costs.data()), costs.size() * sizeof(float));
+    if (!out) {
+      std::remove(tmp_file.c_str());
+      throw std::runtime_error("Could not write landmarks " + file);
+    }
+  }
+  if (std::rename(tmp_file.c_str(), file.c_str())) {
+    std::remove(tmp_file.c_str());
+    throw std::runtime_error("Could not write landmarks " + file);
+  }
+  LOG_INFO("Wrote the costs of " + std::to_string(header.node_count) + " nodes to and from " +
+           std::to_string(landmark_count) + " landmarks to " + file);
+}
+
+} // namespace baldr
+} // namespace valhalla
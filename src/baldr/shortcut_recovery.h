@@ -3,9 +3,15 @@
 #include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
 #include "midgard/logging.h"
+#include "midgard/sequence.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <string>
+#include <sys/stat.h>
 #include <unordered_map>
 #include <vector>
 
@@ -16,10 +22,13 @@ struct shortcut_recovery_t {
 protected:
   /**
    * Constructs a shortcut cache from a graphreaders tileset by recovering all shortcuts. If the
-   * graphreader passed in is null nothing is cached and revoery will happen on the fly
+   * graphreader passed in is null nothing is cached and revoery will happen on the fly. If a file
+   * is passed in and it holds the recovered shortcuts for this tileset it is mapped instead
    * @param reader
+   * @param file    a file written by save, if any
    */
-  shortcut_recovery_t(valhalla::baldr::GraphReader* reader) {
+  shortcut_recovery_t(valhalla::baldr::GraphReader* reader, const std::string& file = "")
+      : keys(nullptr), offsets(nullptr), edges(nullptr), count(0), unrecovered(0), superseded(0) {
     // do nothing if the reader is no good
     if (!reader) {
       LOG_INFO("Shortcut recovery cache disabled");
@@ -27,18 +36,41 @@ protected:
     }
     LOG_INFO("Shortcut recovery cache enabled");
 
+    // use the prerecovered shortcuts if we have them
+    if (!file.empty() && load(file, *reader)) {
+      LOG_INFO(std::to_string(count) + " recovered shortcuts mapped from " + file);
+      return;
+    }
+
+    shortcuts = recover_all(*reader, unrecovered, superseded);
+    LOG_INFO(std::to_string(shortcuts.size()) + " shortcuts recovered as " +
+             std::to_string(superseded) + " superseded edges. " + std::to_string(unrecovered) +
+             " shortcuts could not be recovered.");
+  }
+
+  /**
+   * Recovers all of the shortcuts in the tileset, along with their opposing shortcuts
+   * @param reader       the reader for the tileset
+   * @param unrecovered  incremented for each shortcut which couldnt be recovered
+   * @param superseded   incremented for each edge superseded by a recovered shortcut
+   * @return the superseded edges keyed by shortcut
+   */
+  static std::unordered_map<uint64_t, std::vector<valhalla::baldr::GraphId>>
+  recover_all(valhalla::baldr::GraphReader& reader, size_t& unrecovered, size_t& superseded) {
+    std::unordered_map<uint64_t, std::vector<valhalla::baldr::GraphId>> shortcuts;
+
     // completely skip the levels that dont have shortcuts
     for (const auto& level : valhalla::baldr::TileHierarchy::levels()) {
       // we dont get shortcuts on level 2 and up
       if (level.level > 1)
         continue;
       // for each tile
-      for (auto tile_id : reader->GetTileSet(level.level)) {
+      for (auto tile_id : reader.GetTileSet(level.level)) {
         // cull cache if we are over allocated
-        if (reader->OverCommitted())
-          reader->Trim();
+        if (reader.OverCommitted())
+          reader.Trim();
         // this shouldnt fail but garbled files could cause it
-        auto tile = reader->GetGraphTile(tile_id);
+        auto tile = reader.GetGraphTile(tile_id);
         assert(tile);
         // for each edge in the tile
         for (const auto& edge : tile->GetDirectedEdges()) {
@@ -51,7 +83,7 @@ protected:
           if (shortcuts.find(shortcut_id) != shortcuts.end())
             continue;
           // recover the shortcut and make a copy for opposing direction
-          auto recovered = recover_shortcut(*reader, shortcut_id);
+          auto recovered = recover_shortcut(reader, shortcut_id);
           decltype(recovered) opp_recovered = recovered;
           std::reverse_copy(recovered.cbegin(), recovered.cend(), opp_recovered.begin());
           // save some stats
@@ -63,12 +95,12 @@ protected:
 
           // its cheaper to get the opposing without crawling the graph
           auto opp_tile = tile;
-          auto opp_id = reader->GetOpposingEdgeId(shortcut_id, opp_tile);
+          auto opp_id = reader.GetOpposingEdgeId(shortcut_id, opp_tile);
           if (!opp_id.Is_Valid())
             continue; // dont store edges which arent in our tileset
 
           for (auto& id : opp_recovered) {
-            id = reader->GetOpposingEdgeId(id, opp_tile);
+            id = reader.GetOpposingEdgeId(id, opp_tile);
             if (!id.Is_Valid()) {
               opp_recovered = {opp_id};
               break;
@@ -83,10 +115,7 @@ protected:
         }
       }
     }
-
-    LOG_INFO(std::to_string(shortcuts.size()) + " shortcuts recovered as " +
-             std::to_string(superseded) + " superseded edges. " + std::to_string(unrecovered) +
-             " shortcuts could not be recovered.");
+    return shortcuts;
   }
 
   /**
@@ -95,9 +124,9 @@ protected:
    * @param  shortcutid  Graph Id of the shortcut edge.
    * @return Returns the edgeids of the directed edges this shortcut represents.
    */
-  std::vector<valhalla::baldr::GraphId>
+  static std::vector<valhalla::baldr::GraphId>
   recover_shortcut(valhalla::baldr::GraphReader& reader,
-                   const valhalla::baldr::GraphId& shortcut_id) const {
+                   const valhalla::baldr::GraphId& shortcut_id) {
     using namespace valhalla::baldr;
     // grab the shortcut edge
     auto tile = reader.GetGraphTile(shortcut_id);
@@ -194,8 +223,85 @@ protected:
     return edges;
   }
 
+  /**
+   * The recovered shortcuts can be persisted in a compressed sparse row layout: a header, the
+   * sorted shortcut ids, one offset per shortcut (plus one at the end) into the superseded edges
+   * and finally the superseded edges themselves. Its mapped read only so every process using the
+   * same file shares the same pages and there is nothing to parse at startup
+   */
+  struct file_header_t {
+    char magic[8];
+    uint64_t dataset_id; // of the tileset the shortcuts were recovered from
+    uint64_t count;      // of shortcuts
+    uint64_t edge_count; // of superseded edges
+  };
+  static constexpr char kFileMagic[8] = {'V', 'S', 'C', 'R', 'C', 'S', 'R', '1'};
+
+  // the id of the dataset we can use to tell if the file goes with the tileset
+  static uint64_t dataset_id(valhalla::baldr::GraphReader& reader) {
+    for (const auto& level : valhalla::baldr::TileHierarchy::levels()) {
+      for (const auto& tile_id : reader.GetTileSet(level.level)) {
+        if (auto tile = reader.GetGraphTile(tile_id)) {
+          return tile->header()->dataset_id();
+        }
+      }
+    }
+    return 0;
+  }
+
+  // maps the file if it is sound and goes with the tileset of the reader
+  bool load(const std::string& file, valhalla::baldr::GraphReader& reader) {
+    struct stat s;
+    if (stat(file.c_str(), &s) || static_cast<uint64_t>(s.st_size) < sizeof(file_header_t)) {
+      LOG_WARN("Shortcut recovery file " + file + " not found");
+      return false;
+    }
+
+    try {
+      mapped.map(file, s.st_size);
+      file_header_t header;
+      memcpy(&header, mapped.get(), sizeof(header));
+      // it has to be the right size and belong to the tileset
+      if (memcmp(header.magic, kFileMagic, sizeof(header.magic)) ||
+          sizeof(header) + (2 * header.count + 1 + header.edge_count) * sizeof(uint64_t) !=
+              static_cast<uint64_t>(s.st_size) ||
+          header.dataset_id != dataset_id(reader)) {
+        LOG_WARN("Ignoring stale shortcut recovery file " + file);
+        mapped.unmap();
+        return false;
+      }
+      keys = reinterpret_cast<const uint64_t*>(mapped.get() + sizeof(header));
+      offsets = keys + header.count;
+      edges = offsets + header.count + 1;
+      count = header.count;
+      // the offsets have to start at 0, never go backwards and end exactly at the edges we have
+      // and the keys have to be sorted for the lookups to find them
+      bool sound = offsets[0] == 0 && offsets[count] == header.edge_count;
+      for (uint64_t i = 0; sound && i < count; ++i) {
+        sound = offsets[i] <= offsets[i + 1] && (i == 0 || keys[i - 1] < keys[i]);
+      }
+      if (!sound) {
+        LOG_WARN("Ignoring corrupt shortcut recovery file " + file);
+        keys = offsets = edges = nullptr;
+        count = 0;
+        mapped.unmap();
+        return false;
+      }
+    } catch (const std::exception& e) {
+      LOG_WARN("Could not map shortcut recovery file " + file + ": " + e.what());
+      return false;
+    }
+    return true;
+  }
+
   // a place to cache the recovered shortcuts
   std::unordered_map<uint64_t, std::vector<valhalla::baldr::GraphId>> shortcuts;
+  // or the same thing mapped from a file
+  valhalla::midgard::mem_map<char> mapped;
+  const uint64_t* keys;
+  const uint64_t* offsets;
+  const uint64_t* edges;
+  uint64_t count;
   // a place to keep some stats about the recovery
   size_t unrecovered;
   size_t superseded;
@@ -208,11 +314,70 @@ public:
    * @param reader       the reader used to initialize the cache the first time
    * @return a filled cache mapping shortcuts to superceeded edges
    */
-  static shortcut_recovery_t& get_instance(valhalla::baldr::GraphReader* reader = nullptr) {
-    static shortcut_recovery_t cache{reader};
+  static shortcut_recovery_t& get_instance(valhalla::baldr::GraphReader* reader = nullptr,
+                                           const std::string& file = "") {
+    static shortcut_recovery_t cache{reader, file};
     return cache;
   }
 
+  /**
+   * Recovers all of the shortcuts in the readers tileset and writes them to a file which can be
+   * mapped by get_instance rather than recovering them all again in every process
+   *
+   * @param reader       the reader for the tileset
+   * @param file         where to write the recovered shortcuts
+   */
+  static void save(valhalla::baldr::GraphReader& reader, const std::string& file) {
+    size_t unrecovered = 0, superseded = 0;
+    auto shortcuts = recover_all(reader, unrecovered, superseded);
+
+    // sort the shortcuts so they can be binary searched
+    std::vector<uint64_t> keys;
+    keys.reserve(shortcuts.size());
+    for (const auto& shortcut : shortcuts) {
+      keys.push_back(shortcut.first);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    // lay out the superseded edges in the same order
+    std::vector<uint64_t> offsets, edges;
+    offsets.reserve(keys.size() + 1);
+    for (auto key : keys) {
+      offsets.push_back(edges.size());
+      for (const auto& edge : shortcuts[key]) {
+        edges.push_back(edge);
+      }
+    }
+    offsets.push_back(edges.size());
+
+    file_header_t header{};
+    memcpy(header.magic, kFileMagic, sizeof(header.magic));
+    header.dataset_id = dataset_id(reader);
+    header.count = keys.size();
+    header.edge_count = edges.size();
+
+    // write it to the side and move it into place so no one ever maps half a file
+    const auto tmp_file = file + ".tmp";
+    {
+      std::ofstream out(tmp_file, std::ios::out | std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      out.write(reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(uint64_t));
+      out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+      out.write(reinterpret_cast<const char*>(edges.data()), edges.size() * sizeof(uint64_t));
+      if (!out) {
+        std::remove(tmp_file.c_str());
+        throw std::runtime_error("Could not write shortcut recovery file " + file);
+      }
+    }
+    if (std::rename(tmp_file.c_str(), file.c_str())) {
+      std::remove(tmp_file.c_str());
+      throw std::runtime_error("Could not write shortcut recovery file " + file);
+    }
+    LOG_INFO("Wrote " + std::to_string(keys.size()) + " shortcuts recovered as " +
+             std::to_string(superseded) + " superseded edges to " + file + ". " +
+             std::to_string(unrecovered) + " shortcuts could not be recovered.");
+  }
+
   /**
    * returns the list of graphids of the edges superceded by the provided shortcut. saddly because we
    * may have to recover the shortcut on the fly we cannot return const reference here
@@ -222,6 +387,15 @@ public:
    */
   std::vector<valhalla::baldr::GraphId> get(const valhalla::baldr::GraphId& shortcut_id,
                                             valhalla::baldr::GraphReader& reader) const {
+    // look it up in the mapped file
+    if (keys) {
+      const auto* key = std::lower_bound(keys, keys + count, static_cast<uint64_t>(shortcut_id));
+      if (key == keys + count || *key != shortcut_id)
+        return recover_shortcut(reader, shortcut_id);
+      auto i = key - keys;
+      return std::vector<valhalla::baldr::GraphId>(edges + offsets[i], edges + offsets[i + 1]);
+    }
+
     // in the case that we didnt fill the cache we fallback to recovering on the fly
     auto itr = shortcuts.find(shortcut_id);
     if (itr == shortcuts.cend())
@@ -231,4 +405,6 @@ public:
   }
 };
 
+constexpr char shortcut_recovery_t::kFileMagic[8];
+
 } // namespace
@@ -0,0 +1,112 @@
+#include "baldr/tile_prefetcher.h"
+#include "baldr/graphtile.h"
+#include "midgard/logging.h"
+
+namespace valhalla {
+namespace baldr {
+
+tile_prefetcher_t::tile_prefetcher_t(size_t thread_count, size_t max_tiles, loader_t loader)
+    : max_tiles_(max_tiles), loader_(std::move(loader)), stop_(false) {
+  threads_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back(&tile_prefetcher_t::work, this);
+  }
+}
+
+tile_prefetcher_t::~tile_prefetcher_t() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cond_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void tile_prefetcher_t::request(const GraphId& tile_id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // already on its way or too much outstanding work
+    if (queued_.count(tile_id) || loading_.count(tile_id) || loaded_.count(tile_id) ||
+        queued_.size() + loading_.size() + loaded_.size() >= max_tiles_) {
+      return;
+    }
+    queued_.insert(tile_id);
+    queue_.push_back(tile_id);
+  }
+  work_cond_.notify_one();
+}
+
+graph_tile_ptr tile_prefetcher_t::take(const GraphId& tile_id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  // not picked up yet, its faster for the caller to load it than to wait in line
+  if (queued_.erase(tile_id)) {
+    return nullptr;
+  }
+
+  // someone is loading it right now so we wait for them to finish
+  done_cond_.wait(lock, [this, &tile_id]() { return loading_.find(tile_id) == loading_.end(); });
+
+  // hand it over if we got it
+  auto found = loaded_.find(tile_id);
+  if (found == loaded_.end()) {
+    return nullptr;
+  }
+  graph_tile_ptr tile = std::move(found->second);
+  loaded_.erase(found);
+  return tile;
+}
+
+std::unordered_map<GraphId, graph_tile_ptr> tile_prefetcher_t::take_loaded() {
+  std::unordered_map<GraphId, graph_tile_ptr> tiles;
+  std::lock_guard<std::mutex> lock(mutex_);
+  tiles.swap(loaded_);
+  return tiles;
+}
+
+void tile_prefetcher_t::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_.clear();
+  queued_.clear();
+  loaded_.clear();
+}
+
+void tile_prefetcher_t::work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cond_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+    if (stop_) {
+      return;
+    }
+
+    // skip requests that were cancelled or taken in the meantime
+    GraphId tile_id = queue_.front();
+    queue_.pop_front();
+    if (!queued_.erase(tile_id)) {
+      continue;
+    }
+    loading_.insert(tile_id);
+
+    // load it without holding the lock
+    lock.unlock();
+    graph_tile_ptr tile;
+    try {
+      tile = loader_(tile_id);
+    } catch (const std::exception& e) {
+      LOG_WARN("Failed to prefetch tile " + std::to_string(tile_id) + ": " + e.what());
+    }
+    lock.lock();
+
+    // hand it over, we release our reference under the lock as the owner may take it right away
+    loading_.erase(tile_id);
+    if (tile) {
+      loaded_.emplace(tile_id, std::move(tile));
+    }
+    done_cond_.notify_all();
+  }
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -0,0 +1,199 @@
+#include "baldr/trafficupdater.h"
+#include "extract_index.h"
+#include "midgard/logging.h"
+#include "midgard/sequence.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+using namespace valhalla::baldr;
+
+// the most values there are on a line of updates, the edge id and the full speed record
+constexpr size_t kMaxUpdateFields = 10;
+
+// kph to the 2kph resolution of the traffic speeds, anything too fast is unknown
+uint32_t encode_speed(const unsigned long kph) {
+  return std::min<unsigned long>(kph, UNKNOWN_TRAFFIC_SPEED_KPH) >> 1;
+}
+
+uint32_t encode_congestion(const unsigned long congestion) {
+  return std::min<unsigned long>(congestion, MAX_CONGESTION_VAL);
+}
+
+// parses one line of updates, returns false if its malformed
+bool parse_update(const std::string& line, TrafficUpdate& update) {
+  // the edge id
+  const auto comma = line.find(',');
+  if (comma == std::string::npos) {
+    return false;
+  }
+  try {
+    update.edge_id = GraphId(line.substr(0, comma));
+  } catch (...) {
+    return false;
+  }
+
+  // the numbers after it
+  unsigned long values[kMaxUpdateFields - 1];
+  size_t count = 0;
+  const char* pos = line.c_str() + comma;
+  while (*pos == ',' && count < kMaxUpdateFields - 1) {
+    char* end = nullptr;
+    values[count++] = std::strtoul(pos + 1, &end, 10);
+    if (end == pos + 1) {
+      return false;
+    }
+    pos = end;
+  }
+  if (*pos != '\0' && *pos != '\r') {
+    return false;
+  }
+
+  // the same speed and congestion across the whole edge
+  if (count == 1 || count == 2) {
+    const auto speed = encode_speed(values[0]);
+    update.speed = TrafficSpeed(speed, speed, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW,
+                                255, 0, count == 2 ? encode_congestion(values[1]) : 0, 0, 0,
+                                false);
+    return true;
+  }
+
+  // or each of the sub segments
+  if (count == kMaxUpdateFields - 1) {
+    update.speed = TrafficSpeed(encode_speed(values[0]), encode_speed(values[1]),
+                                encode_speed(values[2]), encode_speed(values[3]),
+                                std::min<unsigned long>(values[4], 255),
+                                std::min<unsigned long>(values[5], 255),
+                                encode_congestion(values[6]), encode_congestion(values[7]),
+                                encode_congestion(values[8]), false);
+    return true;
+  }
+  return false;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+TrafficUpdater::TrafficUpdater(const std::string& traffic_extract, bool use_index)
+    : staged_count_(0) {
+  auto tiles = load_extract(archive_, traffic_extract, use_index);
+  if (tiles.empty()) {
+    throw std::runtime_error("No traffic tiles found in " + traffic_extract);
+  }
+  tiles_.reserve(tiles.size());
+  for (const auto& tile : tiles) {
+    if (tile.second.second < sizeof(TrafficTileHeader)) {
+      LOG_WARN("Skipping traffic tile " + std::to_string(GraphId(tile.first)) +
+               " which is too small to be one");
+      continue;
+    }
+    tiles_.emplace(tile.first, tile_t{tile.second.first, tile.second.second, {}});
+  }
+}
+
+bool TrafficUpdater::Stage(const GraphId& edge_id, const TrafficSpeed& speed) {
+  auto found = tiles_.find(edge_id.Tile_Base());
+  if (found == tiles_.end()) {
+    return false;
+  }
+  auto& tile = found->second;
+  const auto* header = reinterpret_cast<const TrafficTileHeader*>(tile.data);
+  if (edge_id.id() >= header->directed_edge_count) {
+    return false;
+  }
+  if (tile.staged.empty()) {
+    dirty_.push_back(&tile);
+  }
+  tile.staged.emplace_back(edge_id.id(), speed);
+  ++staged_count_;
+  return true;
+}
+
+size_t TrafficUpdater::Stage(const std::vector<TrafficUpdate>& updates) {
+  size_t staged = 0;
+  for (const auto& update : updates) {
+    staged += Stage(update.edge_id, update.speed);
+  }
+  return staged;
+}
+
+size_t TrafficUpdater::Stage(std::istream& updates) {
+  size_t staged = 0, line_number = 0;
+  std::string line;
+  TrafficUpdate update;
+  while (std::getline(updates, line)) {
+    ++line_number;
+    if (line.empty() || line.front() == '#' || line == "\r") {
+      continue;
+    }
+    if (!parse_update(line, update)) {
+      LOG_WARN("Skipping malformed traffic update on line " + std::to_string(line_number));
+      continue;
+    }
+    staged += Stage(update.edge_id, update.speed);
+  }
+  return staged;
+}
+
+size_t TrafficUpdater::Publish(uint64_t last_update) {
+  for (auto* tile : dirty_) {
+    auto* header = reinterpret_cast<volatile TrafficTileHeader*>(tile->data);
+    auto* speeds = reinterpret_cast<TrafficSpeed*>(tile->data + sizeof(TrafficTileHeader));
+    const uint32_t count = header->directed_edge_count;
+    const uint32_t epoch = TrafficTile::load_epoch(header);
+
+    // readers only ever look at the other buffer so we can take our time with this one
+    if (TrafficTile::is_double_buffered(tile->size, count)) {
+      const auto* current = speeds + (epoch & 1) * count;
+      auto* next = speeds + ((epoch + 1) & 1) * count;
+      std::memcpy(next, current, count * sizeof(TrafficSpeed));
+      speeds = next;
+    }
+
+    // later updates of the same edge win since they are applied last
+    for (const auto& update : tile->staged) {
+      speeds[update.first] = update.second;
+    }
+
+    // make sure the speeds are all there before the epoch tells readers about them
+    header->last_update = last_update;
+    TrafficTile::store_epoch(header, epoch + 1);
+
+    tile->staged.clear();
+  }
+
+  const auto published = dirty_.size();
+  dirty_.clear();
+  staged_count_ = 0;
+  return published;
+}
+
+size_t TrafficUpdater::Publish() {
+  return Publish(std::chrono::duration_cast<std::chrono::seconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count());
+}
+
+std::string TrafficUpdater::CreateTile(const GraphId& tile_id,
+                                       uint32_t edge_count,
+                                       bool double_buffered) {
+  TrafficTileHeader header{};
+  header.tile_id = tile_id.Tile_Base().value;
+  header.directed_edge_count = edge_count;
+  header.traffic_tile_version = TRAFFIC_TILE_VERSION;
+  std::string tile(sizeof(TrafficTileHeader) +
+                       (double_buffered ? 2 : 1) * size_t(edge_count) * sizeof(TrafficSpeed),
+                   '\0');
+  std::memcpy(&tile[0], &header, sizeof(header));
+  return tile;
+}
+
+} // namespace baldr
+} // namespace valhalla
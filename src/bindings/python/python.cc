@@ -90,6 +90,12 @@ struct simplified_actor_t : public valhalla::tyr::actor_t {
   std::string expansion(const std::string& request_str) {
     return valhalla::tyr::actor_t::expansion(request_str, nullptr, nullptr);
   };
+  std::string one_to_many(const std::string& request_str) {
+    return valhalla::tyr::actor_t::one_to_many(request_str, nullptr, nullptr);
+  };
+  std::string batch_isochrone(const std::string& request_str) {
+    return valhalla::tyr::actor_t::batch_isochrone(request_str, nullptr, nullptr);
+  };
 };
 
 PYBIND11_MODULE(python_valhalla, m) {
@@ -105,6 +111,8 @@ PYBIND11_MODULE(python_valhalla, m) {
           "Matrix", &simplified_actor_t::matrix,
           "Computes the time and distance between a set of locations and returns them as a matrix table.")
       .def("Isochrone", &simplified_actor_t::isochrone, "Calculates isochrones and isodistances.")
+      .def("BatchIsochrone", &simplified_actor_t::batch_isochrone,
+           "Calculates an isochrone for each of the locations on its own.")
       .def("TraceRoute", &simplified_actor_t::trace_route,
            "Map-matching for a set of input locations, e.g. from a GPS.")
       .def(
@@ -115,6 +123,8 @@ PYBIND11_MODULE(python_valhalla, m) {
       .def(
           "TransitAvailable", &simplified_actor_t::transit_available,
           "Lookup if transit stops are available in a defined radius around a set of input locations.")
+      .def("OneToMany", &simplified_actor_t::one_to_many,
+           "Calculates routes from the first location to each of the others.")
       .def(
           "Expansion", &simplified_actor_t::expansion,
           "Returns all road segments which were touched by the routing algorithm during the graph traversal.");
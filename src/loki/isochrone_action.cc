@@ -81,6 +81,23 @@ void loki_worker_t::isochrones(Api& request) {
   auto max_location_distance = std::numeric_limits<float>::min();
   check_distance(options.locations(), max_distance.find("isochrone")->second, max_location_distance);
 
+  correlate_isochrones(request);
+}
+
+void loki_worker_t::batch_isochrones(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request, "loki_worker_t::batch_isochrones");
+
+  // every location is the origin of an isochrone of its own so they can be as far apart as they like
+  init_isochrones(request);
+  if (static_cast<size_t>(request.options().locations_size()) > max_batch_isochrones) {
+    throw valhalla_exception_t{150, std::to_string(max_batch_isochrones)};
+  }
+  correlate_isochrones(request);
+}
+
+void loki_worker_t::correlate_isochrones(Api& request) {
+  auto& options = *request.mutable_options();
   try {
     // correlate the various locations to the underlying graph
     auto locations = PathLocation::fromPBF(options.locations());
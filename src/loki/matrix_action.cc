@@ -51,16 +51,22 @@ void loki_worker_t::init_matrix(Api& request) {
   if (options.action() == Options::sources_to_targets) {
     parse_locations(options.mutable_sources(), valhalla_exception_t{112});
     parse_locations(options.mutable_targets(), valhalla_exception_t{112});
-  } // optimized route uses locations but needs to do a matrix
+  } // optimized route and one to many use locations but need to do a matrix
   else {
     parse_locations(options.mutable_locations(), valhalla_exception_t{112});
     if (options.locations_size() < 2) {
       throw valhalla_exception_t{120};
     };
 
-    // create new sources and targets from locations
-    options.mutable_targets()->CopyFrom(options.locations());
-    options.mutable_sources()->CopyFrom(options.locations());
+    // create new sources and targets from locations, one to many routes from the first to the rest
+    if (options.action() == Options::one_to_many) {
+      options.mutable_sources()->Add()->CopyFrom(options.locations(0));
+      options.mutable_targets()->CopyFrom(options.locations());
+      options.mutable_targets()->DeleteSubrange(0, 1);
+    } else {
+      options.mutable_targets()->CopyFrom(options.locations());
+      options.mutable_sources()->CopyFrom(options.locations());
+    }
   }
 
   // sanitize
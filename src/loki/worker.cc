@@ -144,6 +144,7 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
       max_contours(config.get<size_t>("service_limits.isochrone.max_contours")),
       max_contour_min(config.get<size_t>("service_limits.isochrone.max_time_contour")),
       max_contour_km(config.get<size_t>("service_limits.isochrone.max_distance_contour")),
+      max_batch_isochrones(config.get<size_t>("service_limits.isochrone.max_batch_locations", 1000)),
       max_trace_shape(config.get<size_t>("service_limits.trace.max_shape")),
       sample(config.get<std::string>("additional_data.elevation", "")),
       max_elevation_shape(config.get<size_t>("service_limits.skadi.max_shape")),
@@ -281,6 +282,7 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
         break;
       case Options::sources_to_targets:
       case Options::optimized_route:
+      case Options::one_to_many:
         matrix(request);
         result.messages.emplace_back(request.SerializeAsString());
         break;
@@ -288,6 +290,10 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
         isochrones(request);
         result.messages.emplace_back(request.SerializeAsString());
         break;
+      case Options::batch_isochrone:
+        batch_isochrones(request);
+        result.messages.emplace_back(request.SerializeAsString());
+        break;
       case Options::trace_attributes:
       case Options::trace_route:
         trace(request);
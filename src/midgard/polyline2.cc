@@ -2,7 +2,9 @@
 #include "midgard/point2.h"
 #include "midgard/pointll.h"
 
+#include <algorithm>
 #include <list>
+#include <vector>
 
 namespace valhalla {
 namespace midgard {
@@ -57,12 +59,13 @@ void Polyline2<coord_t>::Generalize(container_t& polyline,
   if (epsilon <= 0 || polyline.size() < 3)
     return;
 
-  // the recursive bit
+  // the recursive bit, it only marks the points to drop so that they can all be removed in one go
   epsilon *= epsilon;
+  std::vector<bool> keep(polyline.size(), true);
   std::function<void(typename container_t::iterator, size_t, typename container_t::iterator, size_t)>
       peucker;
-  peucker = [&peucker, &polyline, epsilon, &indices](typename container_t::iterator start, size_t s,
-                                                     typename container_t::iterator end, size_t e) {
+  peucker = [&peucker, &keep, epsilon, &indices](typename container_t::iterator start, size_t s,
+                                                 typename container_t::iterator end, size_t e) {
     // find the point furthest from the line
     typename coord_t::value_type dmax = std::numeric_limits<typename coord_t::value_type>::lowest();
     typename container_t::iterator itr;
@@ -90,20 +93,30 @@ void Polyline2<coord_t>::Generalize(container_t& polyline,
     // there are some high frequency details between start and end
     // so we need to look for flatter sections between them
     if (dmax >= epsilon) {
-      // we recurse from right to left for two reasons:
-      // 1. we want to preserve iterator validity in the vector version
-      // 2. its the only way to preserve the indices in the keep set
       if (e - k > 1)
         peucker(itr, k, end, e);
       if (k - s > 1)
         peucker(start, s, itr, k);
     } // nothing sticks out between start and end so simplify everything between away
     else
-      polyline.erase(std::next(start), end);
+      std::fill(keep.begin() + s + 1, keep.begin() + e, false);
   };
 
   // recurse!
   peucker(polyline.begin(), 0, std::prev(polyline.end()), polyline.size() - 1);
+
+  // move the points we keep to the front and drop the rest, erasing them one range at a time would
+  // shift the rest of a vector over and over again
+  auto kept = polyline.begin();
+  auto k = keep.cbegin();
+  for (auto p = polyline.begin(); p != polyline.end(); ++p, ++k) {
+    if (*k) {
+      if (kept != p)
+        *kept = std::move(*p);
+      ++kept;
+    }
+  }
+  polyline.erase(kept, polyline.end());
 }
 
 // Explicit instantiation
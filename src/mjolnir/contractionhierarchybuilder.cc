@@ -0,0 +1,380 @@
+#include "mjolnir/contractionhierarchybuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "baldr/contractionhierarchy.h"
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "proto_conversions.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+using arc_t = ContractionHierarchy::arc_t;
+constexpr uint32_t kInvalidVertex = ContractionHierarchy::kInvalidVertex;
+
+// How many vertices a witness search settles before giving up and keeping the shortcut. Giving up
+// early only costs a superfluous shortcut, so estimating the priority of a vertex gives up sooner
+constexpr uint32_t kMaxWitnessSettled = 500;
+constexpr uint32_t kMaxSimulatedWitnessSettled = 50;
+
+using queue_t =
+    std::priority_queue<std::pair<float, uint32_t>, std::vector<std::pair<float, uint32_t>>,
+                        std::greater<std::pair<float, uint32_t>>>;
+
+struct shortcut_t {
+  uint32_t from;
+  uint32_t to;
+  float cost;
+  float secs;
+  uint32_t length;
+};
+
+/**
+ * Contracts a graph given as its arcs, one vertex at a time in order of the number of shortcuts
+ * contracting it would add (less the arcs it removes) and how many of its neighbours are already
+ * contracted, which keeps the hierarchy flat. When a vertex is contracted a shortcut is added
+ * between each pair of its remaining neighbours, unless a witness search finds a path between them
+ * which is no more expensive without going through the vertex.
+ */
+class contractor_t {
+public:
+  explicit contractor_t(uint32_t vertex_count)
+      : out_(vertex_count), in_(vertex_count), contracted_neighbours_(vertex_count, 0),
+        up_(vertex_count), down_(vertex_count),
+        distance_(vertex_count, std::numeric_limits<float>::infinity()) {
+  }
+
+  // adds an arc unless there is already a cheaper one
+  void add_arc(uint32_t from, const arc_t& arc) {
+    const auto to = arc.vertex;
+    arc_t reverse = arc;
+    reverse.vertex = from;
+    auto found = std::find_if(out_[from].begin(), out_[from].end(),
+                              [to](const arc_t& a) { return a.vertex == to; });
+    if (found != out_[from].end()) {
+      if (found->cost <= arc.cost) {
+        return;
+      }
+      *found = arc;
+      *std::find_if(in_[to].begin(), in_[to].end(),
+                    [from](const arc_t& a) { return a.vertex == from; }) = reverse;
+      return;
+    }
+    out_[from].push_back(arc);
+    in_[to].push_back(reverse);
+  }
+
+  // contracts every vertex with arcs, in order of priority
+  void contract() {
+    queue_t queue;
+    for (uint32_t v = 0; v < out_.size(); ++v) {
+      if (!out_[v].empty() || !in_[v].empty()) {
+        queue.emplace(priority(v), v);
+      }
+    }
+
+    size_t contracted = 0, shortcuts = 0;
+    const size_t total = queue.size();
+    while (!queue.empty()) {
+      auto v = queue.top().second;
+      queue.pop();
+      // the priority only goes up as neighbours are contracted so check it before contracting
+      auto p = priority(v);
+      if (!queue.empty() && p > queue.top().first) {
+        queue.emplace(p, v);
+        continue;
+      }
+      shortcuts += contract(v);
+      if (++contracted % 100000 == 0) {
+        LOG_INFO("Contracted " + std::to_string(contracted) + " of " + std::to_string(total) +
+                 " edges, " + std::to_string(shortcuts) + " shortcuts so far");
+      }
+    }
+    LOG_INFO("Contracted " + std::to_string(contracted) + " edges with " +
+             std::to_string(shortcuts) + " shortcuts");
+  }
+
+  // the arcs going up out of each vertex and those coming down into each vertex
+  const std::vector<std::vector<arc_t>>& up() const {
+    return up_;
+  }
+  const std::vector<std::vector<arc_t>>& down() const {
+    return down_;
+  }
+
+protected:
+  float priority(uint32_t v) {
+    int64_t edge_difference = static_cast<int64_t>(find_shortcuts(v, true).size()) -
+                              static_cast<int64_t>(in_[v].size() + out_[v].size());
+    return static_cast<float>(2 * edge_difference + contracted_neighbours_[v]);
+  }
+
+  // contracts the vertex and returns the number of shortcuts that took
+  size_t contract(uint32_t v) {
+    const auto shortcuts = find_shortcuts(v, false);
+
+    // whatever arcs it still has go up the hierarchy since their other end is contracted later
+    up_[v] = std::move(out_[v]);
+    down_[v] = std::move(in_[v]);
+
+    // take the vertex out of the remaining graph
+    for (const auto& arc : up_[v]) {
+      auto& in = in_[arc.vertex];
+      in.erase(std::remove_if(in.begin(), in.end(),
+                              [v](const arc_t& a) { return a.vertex == v; }),
+               in.end());
+      ++contracted_neighbours_[arc.vertex];
+    }
+    for (const auto& arc : down_[v]) {
+      auto& out = out_[arc.vertex];
+      out.erase(std::remove_if(out.begin(), out.end(),
+                               [v](const arc_t& a) { return a.vertex == v; }),
+                out.end());
+      ++contracted_neighbours_[arc.vertex];
+    }
+
+    // and bridge the gap it leaves
+    for (const auto& shortcut : shortcuts) {
+      add_arc(shortcut.from,
+              {shortcut.to, v, shortcut.cost, shortcut.secs, shortcut.length});
+    }
+    return shortcuts.size();
+  }
+
+  // the shortcuts needed to contract the vertex
+  std::vector<shortcut_t> find_shortcuts(uint32_t v, bool simulate) {
+    std::vector<shortcut_t> shortcuts;
+    for (const auto& in : in_[v]) {
+      // the most expensive path through v we have to find a witness for
+      float max_cost = -1.f;
+      for (const auto& out : out_[v]) {
+        if (out.vertex != in.vertex) {
+          max_cost = std::max(max_cost, in.cost + out.cost);
+        }
+      }
+      if (max_cost < 0.f) {
+        continue;
+      }
+
+      // see which of them we can do without
+      witness_search(in.vertex, v, max_cost,
+                     simulate ? kMaxSimulatedWitnessSettled : kMaxWitnessSettled);
+      for (const auto& out : out_[v]) {
+        if (out.vertex != in.vertex && distance_[out.vertex] > in.cost + out.cost) {
+          shortcuts.push_back({in.vertex, out.vertex, in.cost + out.cost, in.secs + out.secs,
+                               in.length + out.length});
+        }
+      }
+    }
+    return shortcuts;
+  }
+
+  // finds the cheapest paths from the source that do not go through the ignored vertex
+  void witness_search(uint32_t source, uint32_t ignore, float max_cost, uint32_t max_settled) {
+    for (auto vertex : touched_) {
+      distance_[vertex] = std::numeric_limits<float>::infinity();
+    }
+    touched_.clear();
+
+    queue_t queue;
+    distance_[source] = 0.f;
+    touched_.push_back(source);
+    queue.emplace(0.f, source);
+    uint32_t settled = 0;
+    while (!queue.empty() && settled < max_settled) {
+      auto cost = queue.top().first;
+      auto vertex = queue.top().second;
+      queue.pop();
+      if (cost > distance_[vertex]) {
+        continue;
+      }
+      if (cost > max_cost) {
+        break;
+      }
+      ++settled;
+      for (const auto& arc : out_[vertex]) {
+        if (arc.vertex == ignore) {
+          continue;
+        }
+        auto next = cost + arc.cost;
+        if (next < distance_[arc.vertex]) {
+          if (std::isinf(distance_[arc.vertex])) {
+            touched_.push_back(arc.vertex);
+          }
+          distance_[arc.vertex] = next;
+          queue.emplace(next, arc.vertex);
+        }
+      }
+    }
+  }
+
+  // the graph that is left to contract
+  std::vector<std::vector<arc_t>> out_;
+  std::vector<std::vector<arc_t>> in_;
+  std::vector<uint32_t> contracted_neighbours_;
+  // the hierarchy
+  std::vector<std::vector<arc_t>> up_;
+  std::vector<std::vector<arc_t>> down_;
+  // for the witness searches
+  std::vector<float> distance_;
+  std::vector<uint32_t> touched_;
+};
+
+// lays out the arcs of each vertex back to back
+void flatten(const std::vector<std::vector<arc_t>>& arcs,
+             std::vector<uint32_t>& offsets,
+             std::vector<arc_t>& flat) {
+  offsets.reserve(arcs.size() + 1);
+  for (const auto& vertex_arcs : arcs) {
+    offsets.push_back(flat.size());
+    flat.insert(flat.end(), vertex_arcs.begin(), vertex_arcs.end());
+  }
+  offsets.push_back(flat.size());
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void ContractionHierarchyBuilder::Build(const boost::property_tree::ptree& pt) {
+  const auto file = pt.get<std::string>("mjolnir.contraction_hierarchy", "");
+  if (file.empty()) {
+    LOG_INFO("Skipping contraction hierarchy");
+    return;
+  }
+
+  // the default options of the costing are the profile we contract for
+  const auto costing_str = pt.get<std::string>("mjolnir.contraction_hierarchy_costing", "auto");
+  Costing costing;
+  if (!Costing_Enum_Parse(costing_str, &costing)) {
+    throw std::runtime_error("Unknown contraction hierarchy costing " + costing_str);
+  }
+  rapidjson::Document doc;
+  doc.SetObject();
+  CostingOptions options;
+  ParseCostingOptions(doc, "/costing_options/" + costing_str, &options, costing);
+  auto cost = CostFactory().Create(options);
+  const auto mode = cost->travel_mode();
+  // like the first pass of A*, destination only edges are left to the fallback
+  cost->set_allow_destination_only(false);
+
+  // the hierarchy is time invariant so it shouldnt see any live traffic, and it has to see the
+  // tiles we just built rather than some old extract of them
+  auto reader_config = pt.get_child("mjolnir");
+  reader_config.erase("traffic_extract");
+  reader_config.erase("tile_extract");
+  GraphReader reader(reader_config);
+
+  // every directed edge gets a vertex, numbered in order of tile
+  std::vector<GraphId> tile_ids;
+  for (const auto& level : TileHierarchy::levels()) {
+    for (const auto& tile_id : reader.GetTileSet(level.level)) {
+      tile_ids.push_back(tile_id);
+    }
+  }
+  std::sort(tile_ids.begin(), tile_ids.end());
+  std::vector<ContractionHierarchy::tile_t> tiles;
+  std::unordered_map<uint64_t, uint32_t> first_vertex;
+  uint32_t vertex_count = 0;
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    if (!tile) {
+      continue;
+    }
+    const uint32_t edge_count = tile->header()->directededgecount();
+    if (static_cast<uint64_t>(vertex_count) + edge_count >= kInvalidVertex) {
+      throw std::runtime_error("Too many directed edges for a contraction hierarchy");
+    }
+    tiles.push_back({tile_id, vertex_count, edge_count});
+    first_vertex.emplace(tile_id, vertex_count);
+    vertex_count += edge_count;
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  LOG_INFO("Contracting " + std::to_string(vertex_count) + " edges in " +
+           std::to_string(tiles.size()) + " tiles for " + costing_str);
+
+  // an arc from each edge to each edge the costing allows to follow it
+  contractor_t contractor(vertex_count);
+  size_t arc_count = 0;
+  for (const auto& t : tiles) {
+    auto tile = reader.GetGraphTile(GraphId(t.tile_id));
+    GraphId edge_id(t.tile_id);
+    for (uint32_t i = 0; i < t.edge_count; ++i, ++edge_id) {
+      const auto* edge = tile->directededge(i);
+      if (edge->is_shortcut() || edge->IsTransitLine() || !cost->Allowed(edge, tile)) {
+        continue;
+      }
+      auto end_tile = reader.GetGraphTile(edge->endnode());
+      if (!end_tile) {
+        continue;
+      }
+
+      // the edges leaving a node the edge ends at, on any level
+      EdgeLabel pred(kInvalidLabel, edge_id, edge, {}, 0.f, 0.f, mode, 0, {});
+      auto expand = [&](const GraphId& node_id, const graph_tile_ptr& node_tile) {
+        const auto* node = node_tile->node(node_id);
+        auto first = first_vertex.find(node_tile->header()->graphid());
+        if (first == first_vertex.end() || !cost->Allowed(node)) {
+          return;
+        }
+        GraphId next_id(node_id.tileid(), node_id.level(), node->edge_index());
+        for (const auto& next : node_tile->GetDirectedEdges(node)) {
+          int restriction_idx = -1;
+          if (!next.is_shortcut() && !next.IsTransitLine() &&
+              cost->Allowed(&next, pred, node_tile, next_id, 0, 0, restriction_idx)) {
+            auto arc_cost =
+                cost->TransitionCost(&next, node, pred) + cost->EdgeCost(&next, node_tile);
+            contractor.add_arc(t.first_vertex + i, {first->second + next_id.id(), kInvalidVertex,
+                                                    arc_cost.cost, arc_cost.secs, next.length()});
+            ++arc_count;
+          }
+          ++next_id;
+        }
+      };
+      expand(edge->endnode(), end_tile);
+      for (const auto& transition : end_tile->GetNodeTransitions(edge->endnode())) {
+        auto transition_tile = reader.GetGraphTile(transition.endnode());
+        if (transition_tile) {
+          expand(transition.endnode(), transition_tile);
+        }
+      }
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  LOG_INFO("Found " + std::to_string(arc_count) + " turns between the edges");
+
+  // contract it and write it out
+  contractor.contract();
+  std::vector<uint32_t> up_offsets, down_offsets;
+  std::vector<arc_t> up_arcs, down_arcs;
+  flatten(contractor.up(), up_offsets, up_arcs);
+  flatten(contractor.down(), down_offsets, down_arcs);
+  ContractionHierarchy::Save(file, reader, static_cast<uint32_t>(costing),
+                             options.SerializeAsString(), tiles, up_offsets, up_arcs, down_offsets,
+                             down_arcs);
+}
+
+} // namespace mjolnir
+} // namespace valhalla
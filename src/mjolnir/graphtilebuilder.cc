@@ -13,6 +13,47 @@
 
 using namespace valhalla::baldr;
 
+namespace {
+
+// Writes one field of every directed edge as an array
+template <typename T, typename field_t>
+void write_column(std::ostream& out,
+                  const DirectedEdge* edges,
+                  const uint32_t count,
+                  const field_t& field) {
+  std::vector<T> column(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    column[i] = static_cast<T>(field(edges[i]));
+  }
+  out.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+}
+
+// Writes the routing edges for the directed edges, see RoutingEdges for the layout
+void write_routing_edges(std::ostream& out, const DirectedEdge* edges, const uint32_t count) {
+  write_column<uint64_t>(out, edges, count, [](const DirectedEdge& e) { return e.endnode().value; });
+  write_column<uint32_t>(out, edges, count, [](const DirectedEdge& e) { return e.length(); });
+  write_column<uint16_t>(out, edges, count, [](const DirectedEdge& e) { return e.forwardaccess(); });
+  write_column<uint16_t>(out, edges, count, [](const DirectedEdge& e) { return e.reverseaccess(); });
+  write_column<uint8_t>(out, edges, count, [](const DirectedEdge& e) { return e.speed(); });
+  write_column<uint8_t>(out, edges, count,
+                        [](const DirectedEdge& e) { return e.classification(); });
+  write_column<uint8_t>(out, edges, count, [](const DirectedEdge& e) { return e.use(); });
+  write_column<uint8_t>(out, edges, count, [](const DirectedEdge& e) { return e.restrictions(); });
+  write_column<uint8_t>(out, edges, count, [](const DirectedEdge& e) { return e.opp_index(); });
+  write_column<uint8_t>(out, edges, count, [](const DirectedEdge& e) { return e.localedgeidx(); });
+  write_column<uint8_t>(out, edges, count, [](const DirectedEdge& e) {
+    return e.shortcut() | (e.is_shortcut() ? RoutingEdges::kIsShortcut : 0);
+  });
+  write_column<uint8_t>(out, edges, count, [](const DirectedEdge& e) { return e.superseded(); });
+}
+
+// Where the tile data ends if we leave out the routing edges
+uint32_t data_end_offset(const GraphTileHeader& header) {
+  return header.routing_edges_offset() > 0 ? header.routing_edges_offset() : header.end_offset();
+}
+
+} // namespace
+
 namespace valhalla {
 namespace mjolnir {
 
@@ -338,6 +379,14 @@ void GraphTileBuilder::StoreTileData() {
     header_builder_.set_end_offset(header_builder_.lane_connectivity_offset() +
                                    (lane_connectivity_builder_.size() * sizeof(LaneConnectivity)));
 
+    // Write the routing edges last if the tile had them
+    if (header_builder_.routing_edges_offset() > 0) {
+      header_builder_.set_routing_edges_offset(header_builder_.end_offset());
+      write_routing_edges(in_mem, directededges_builder_.data(), directededges_builder_.size());
+      header_builder_.set_end_offset(header_builder_.end_offset() +
+                                     RoutingEdges::size(directededges_builder_.size()));
+    }
+
     // Sanity check for the end offset
     uint32_t curr =
         static_cast<uint32_t>(in_mem.tellp()) + static_cast<uint32_t>(sizeof(GraphTileHeader));
@@ -408,8 +457,13 @@ void GraphTileBuilder::Update(const std::vector<NodeInfo>& nodes,
 
     // Write the rest of the tiles
     auto begin = reinterpret_cast<const char*>(&access_restrictions_[0]);
-    auto end = reinterpret_cast<const char*>(header()) + header()->end_offset();
+    auto end = reinterpret_cast<const char*>(header()) + data_end_offset(*header());
     file.write(begin, end - begin);
+
+    // The routing edges have to match the updated directed edges
+    if (header()->routing_edges_offset() > 0) {
+      write_routing_edges(file, directededges.data(), directededges.size());
+    }
     file.close();
   } else {
     throw std::runtime_error("GraphTileBuilder::Update - Failed to open file " + filename.string());
@@ -989,6 +1043,9 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
   header.set_edgeinfo_offset(header.edgeinfo_offset() + shift);
   header.set_textlist_offset(header.textlist_offset() + shift);
   header.set_lane_connectivity_offset(header.lane_connectivity_offset() + shift);
+  if (header.routing_edges_offset() > 0) {
+    header.set_routing_edges_offset(header.routing_edges_offset() + shift);
+  }
   header.set_end_offset(header.end_offset() + shift);
   // rewrite the tile
   filesystem::path filename =
@@ -1019,6 +1076,36 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
   }
 }
 
+// Adds the routing edges to the tile (or rewrites them if it already has them)
+void GraphTileBuilder::AddRoutingEdges(const std::string& tile_dir, const graph_tile_ptr& tile) {
+  assert(tile);
+  GraphTileHeader header = *tile->header();
+  const uint32_t offset = data_end_offset(header);
+  header.set_routing_edges_offset(offset);
+  header.set_end_offset(offset + RoutingEdges::size(header.directededgecount()));
+
+  // rewrite the tile
+  filesystem::path filename =
+      tile_dir + filesystem::path::preferred_separator + GraphTile::FileSuffix(header.graphid());
+  if (!filesystem::exists(filename.parent_path())) {
+    filesystem::create_directories(filename.parent_path());
+  }
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (file.is_open()) {
+    // new header
+    file.write(reinterpret_cast<const char*>(&header), sizeof(GraphTileHeader));
+    // everything else but the old routing edges
+    const auto* begin = reinterpret_cast<const char*>(tile->header()) + sizeof(GraphTileHeader);
+    const auto* end = reinterpret_cast<const char*>(tile->header()) + offset;
+    file.write(begin, end - begin);
+    // the routing edges
+    write_routing_edges(file, tile->GetDirectedEdges().begin(), header.directededgecount());
+  } // failed
+  else {
+    throw std::runtime_error("Failed to open file " + filename.string());
+  }
+}
+
 // Add a predicted speed profile for a directed edge.
 void GraphTileBuilder::AddPredictedSpeed(const uint32_t idx,
                                          const std::vector<int16_t>& profile,
@@ -1063,12 +1150,18 @@ void GraphTileBuilder::UpdatePredictedSpeeds(const std::vector<DirectedEdge>& di
   std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
   if (file.is_open()) {
     // Write a new header - add the offset to predicted speed data and the profile count.
-    // Update the end offset (shift by the amount of predicted speed data added).
-    size_t offset = header_->end_offset();
-    header_builder_.set_end_offset(header_->end_offset() +
+    // Update the end offset (shift by the amount of predicted speed data added). The
+    // routing edges, if any, stay the last thing in the tile.
+    size_t offset = data_end_offset(*header_);
+    header_builder_.set_end_offset(offset +
                                    (speed_profile_offset_builder_.size() * sizeof(uint32_t)) +
                                    (speed_profile_builder_.size() * sizeof(int16_t)));
     header_builder_.set_predictedspeeds_offset(offset);
+    if (header_->routing_edges_offset() > 0) {
+      header_builder_.set_routing_edges_offset(header_builder_.end_offset());
+      header_builder_.set_end_offset(header_builder_.end_offset() +
+                                     RoutingEdges::size(directededges.size()));
+    }
     header_builder_.set_predictedspeeds_count(speed_profile_builder_.size() / kCoefficientCount);
     file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
 
@@ -1097,8 +1190,10 @@ void GraphTileBuilder::UpdatePredictedSpeeds(const std::vector<DirectedEdge>& di
     file.write(reinterpret_cast<const char*>(speed_profile_builder_.data()),
                speed_profile_builder_.size() * sizeof(int16_t));
 
-    // Write the rest of the tiles. TBD (if anything is added after the speed profiles
-    // then this will need to be updated)
+    // Write the routing edges from the updated directed edges
+    if (header_->routing_edges_offset() > 0) {
+      write_routing_edges(file, directededges.data(), directededges.size());
+    }
 
     // Close the file
     file.close();
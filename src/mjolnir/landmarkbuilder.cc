@@ -0,0 +1,341 @@
+#include "mjolnir/landmarkbuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "baldr/graphreader.h"
+#include "baldr/landmarks.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "proto_conversions.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+constexpr float kInfinity = std::numeric_limits<float>::infinity();
+
+using queue_t =
+    std::priority_queue<std::pair<float, uint32_t>, std::vector<std::pair<float, uint32_t>>,
+                        std::greater<std::pair<float, uint32_t>>>;
+
+struct arc_t {
+  uint32_t from;
+  uint32_t to;
+  float cost;
+};
+
+/**
+ * The nodes of every level and the arcs between them in a compressed sparse row layout, once in
+ * the direction of the edges and once against it.
+ */
+class node_graph_t {
+public:
+  node_graph_t(uint32_t node_count, const std::vector<arc_t>& arcs) {
+    layout(node_count, arcs, false, forward_offsets_, forward_arcs_);
+    layout(node_count, arcs, true, reverse_offsets_, reverse_arcs_);
+  }
+
+  uint32_t node_count() const {
+    return forward_offsets_.size() - 1;
+  }
+
+  // the cheapest cost from the source to every node, or from every node to the source
+  void dijkstra(uint32_t source, bool forward, std::vector<float>& costs) const {
+    const auto& offsets = forward ? forward_offsets_ : reverse_offsets_;
+    const auto& arcs = forward ? forward_arcs_ : reverse_arcs_;
+    costs.assign(node_count(), kInfinity);
+    queue_t queue;
+    costs[source] = 0.f;
+    queue.emplace(0.f, source);
+    while (!queue.empty()) {
+      auto cost = queue.top().first;
+      auto node = queue.top().second;
+      queue.pop();
+      if (cost > costs[node]) {
+        continue;
+      }
+      for (auto i = offsets[node]; i < offsets[node + 1]; ++i) {
+        auto next = cost + arcs[i].second;
+        if (next < costs[arcs[i].first]) {
+          costs[arcs[i].first] = next;
+          queue.emplace(next, arcs[i].first);
+        }
+      }
+    }
+  }
+
+  // the region of each node, nodes are in the same region if there are arcs between them one way
+  // or the other
+  std::vector<uint32_t> regions() const {
+    std::vector<uint32_t> parent(node_count());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&](uint32_t n) {
+      while (parent[n] != n) {
+        n = parent[n] = parent[parent[n]];
+      }
+      return n;
+    };
+    for (uint32_t node = 0; node < node_count(); ++node) {
+      for (auto i = forward_offsets_[node]; i < forward_offsets_[node + 1]; ++i) {
+        auto a = find(node), b = find(forward_arcs_[i].first);
+        if (a != b) {
+          parent[std::max(a, b)] = std::min(a, b);
+        }
+      }
+    }
+    for (uint32_t node = 0; node < node_count(); ++node) {
+      parent[node] = find(node);
+    }
+    return parent;
+  }
+
+protected:
+  static void layout(uint32_t node_count,
+                     const std::vector<arc_t>& arcs,
+                     bool reverse,
+                     std::vector<uint32_t>& offsets,
+                     std::vector<std::pair<uint32_t, float>>& flat) {
+    offsets.assign(node_count + 1, 0);
+    for (const auto& arc : arcs) {
+      ++offsets[(reverse ? arc.to : arc.from) + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    flat.resize(arcs.size());
+    auto next = offsets;
+    for (const auto& arc : arcs) {
+      flat[next[reverse ? arc.to : arc.from]++] = {reverse ? arc.from : arc.to, arc.cost};
+    }
+  }
+
+  std::vector<uint32_t> forward_offsets_;
+  std::vector<std::pair<uint32_t, float>> forward_arcs_;
+  std::vector<uint32_t> reverse_offsets_;
+  std::vector<std::pair<uint32_t, float>> reverse_arcs_;
+};
+
+// splits the landmarks between the regions by their share of the nodes of the highest level,
+// largest remainder first, so a region too small for its share to round up to one gets none
+std::unordered_map<uint32_t, uint32_t>
+allocate(const std::unordered_map<uint32_t, std::vector<uint32_t>>& regions,
+         uint32_t landmark_count) {
+  size_t total = 0;
+  for (const auto& region : regions) {
+    total += region.second.size();
+  }
+  std::unordered_map<uint32_t, uint32_t> allocated;
+  std::vector<std::pair<double, uint32_t>> remainders;
+  uint32_t left = landmark_count;
+  for (const auto& region : regions) {
+    const double share = static_cast<double>(landmark_count) * region.second.size() / total;
+    const uint32_t whole = std::min<size_t>(std::floor(share), region.second.size());
+    allocated[region.first] = whole;
+    left -= whole;
+    remainders.emplace_back(share - whole, region.first);
+  }
+  std::sort(remainders.begin(), remainders.end(), std::greater<std::pair<double, uint32_t>>());
+  for (const auto& remainder : remainders) {
+    if (left == 0) {
+      break;
+    }
+    auto& count = allocated[remainder.second];
+    if (count < regions.at(remainder.second).size()) {
+      ++count;
+      --left;
+    }
+  }
+  return allocated;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+constexpr uint32_t LandmarkBuilder::kDefaultLandmarkCount;
+
+void LandmarkBuilder::Build(const boost::property_tree::ptree& pt) {
+  const auto file = pt.get<std::string>("mjolnir.landmarks", "");
+  const auto landmark_count =
+      pt.get<uint32_t>("mjolnir.landmarks_count", LandmarkBuilder::kDefaultLandmarkCount);
+  if (file.empty() || landmark_count == 0) {
+    LOG_INFO("Skipping landmarks");
+    return;
+  }
+
+  // the default options of the costing are the profile we build for
+  const auto costing_str = pt.get<std::string>("mjolnir.landmarks_costing", "auto");
+  Costing costing;
+  if (!Costing_Enum_Parse(costing_str, &costing)) {
+    throw std::runtime_error("Unknown landmarks costing " + costing_str);
+  }
+  rapidjson::Document doc;
+  doc.SetObject();
+  CostingOptions options;
+  ParseCostingOptions(doc, "/costing_options/" + costing_str, &options, costing);
+  auto cost = CostFactory().Create(options);
+  // the costs have to hold for the second pass of A* too
+  cost->set_allow_destination_only(true);
+
+  // the landmarks are time invariant so they shouldnt see any live traffic, and they have to see
+  // the tiles we just built rather than some old extract of them
+  auto reader_config = pt.get_child("mjolnir");
+  reader_config.erase("traffic_extract");
+  reader_config.erase("tile_extract");
+  GraphReader reader(reader_config);
+
+  // every node on every level gets an index, in order of tile, but only those on the highest
+  // level get costs
+  const auto top_level = TileHierarchy::levels().front().level;
+  std::vector<GraphId> tile_ids;
+  for (const auto& level : TileHierarchy::levels()) {
+    for (const auto& tile_id : reader.GetTileSet(level.level)) {
+      tile_ids.push_back(tile_id);
+    }
+  }
+  std::sort(tile_ids.begin(), tile_ids.end());
+  std::unordered_map<uint64_t, uint32_t> first_node;
+  std::vector<Landmarks::tile_t> tiles;
+  std::vector<uint32_t> top_nodes;
+  uint32_t node_count = 0;
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    if (!tile) {
+      continue;
+    }
+    const uint32_t count = tile->header()->nodecount();
+    if (static_cast<uint64_t>(node_count) + count >= Landmarks::kInvalidNode) {
+      throw std::runtime_error("Too many nodes for landmarks");
+    }
+    first_node.emplace(tile_id, node_count);
+    if (tile_id.level() == top_level) {
+      tiles.push_back({tile_id, static_cast<uint32_t>(top_nodes.size()), count});
+      for (uint32_t i = 0; i < count; ++i) {
+        top_nodes.push_back(node_count + i);
+      }
+    }
+    node_count += count;
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  if (top_nodes.empty()) {
+    LOG_WARN("Skipping landmarks, there are no nodes on the highest level");
+    return;
+  }
+
+  // an arc along each edge the costing allows, costing only the edge at the lower of its day and
+  // night costs, that is at the faster of the two speeds, so that the costs never overestimate
+  // those of a request without a time, and between the same node on each level for free
+  std::vector<arc_t> arcs;
+  for (const auto& tile_id : tile_ids) {
+    auto found = first_node.find(tile_id);
+    if (found == first_node.end()) {
+      continue;
+    }
+    auto tile = reader.GetGraphTile(tile_id);
+    for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+      const auto from = found->second + i;
+      const auto* node = tile->node(i);
+      for (const auto& edge : tile->GetDirectedEdges(node)) {
+        auto end = first_node.find(edge.endnode().Tile_Base());
+        if (end == first_node.end() || edge.is_shortcut() || edge.IsTransitLine() ||
+            !cost->Allowed(&edge, tile)) {
+          continue;
+        }
+        const auto day = cost->EdgeCost(&edge, tile, kConstrainedFlowSecondOfDay).cost;
+        const auto night = cost->EdgeCost(&edge, tile, 0).cost;
+        arcs.push_back({from, end->second + edge.endnode().id(), std::min(day, night)});
+      }
+      for (const auto& transition : tile->GetNodeTransitions(node)) {
+        auto end = first_node.find(transition.endnode().Tile_Base());
+        if (end != first_node.end()) {
+          arcs.push_back({from, end->second + transition.endnode().id(), 0.f});
+        }
+      }
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  node_graph_t graph(node_count, arcs);
+  arcs = std::vector<arc_t>();
+  LOG_INFO("Selecting " + std::to_string(landmark_count) + " landmarks among " +
+           std::to_string(top_nodes.size()) + " of " + std::to_string(node_count) +
+           " nodes for " + costing_str);
+
+  // split the landmarks between the regions of the graph, a node in one region can never reach
+  // a node in another so the landmarks of one are of no use to another
+  const auto node_regions = graph.regions();
+  std::unordered_map<uint32_t, std::vector<uint32_t>> regions;
+  for (uint32_t i = 0; i < top_nodes.size(); ++i) {
+    regions[node_regions[top_nodes[i]]].push_back(i);
+  }
+  const auto allocated = allocate(regions, landmark_count);
+
+  // in each region the first landmark is the node farthest from some node and every next one is
+  // the node farthest from the closest of those already selected
+  std::vector<float> costs(top_nodes.size() * 2 * landmark_count, kInfinity);
+  std::vector<float> forward, reverse;
+  uint32_t landmark = 0;
+  for (const auto& region : regions) {
+    const auto count = allocated.at(region.first);
+    if (count == 0) {
+      continue;
+    }
+    const auto& members = region.second;
+    std::vector<float> closest(members.size(), kInfinity);
+    graph.dijkstra(top_nodes[members.front()], true, forward);
+    for (uint32_t i = 0; i < members.size(); ++i) {
+      closest[i] = forward[top_nodes[members[i]]];
+    }
+
+    for (uint32_t selected = 0; selected < count; ++selected, ++landmark) {
+      uint32_t farthest = 0;
+      float farthest_cost = -1.f;
+      for (uint32_t i = 0; i < members.size(); ++i) {
+        if (!std::isinf(closest[i]) && closest[i] > farthest_cost) {
+          farthest = i;
+          farthest_cost = closest[i];
+        }
+      }
+      const auto node = top_nodes[members[farthest]];
+      graph.dijkstra(node, true, forward);
+      graph.dijkstra(node, false, reverse);
+
+      // keep the costs to and from it for every node of the highest level
+      for (uint32_t i = 0; i < top_nodes.size(); ++i) {
+        auto* row = costs.data() + static_cast<size_t>(i) * 2 * landmark_count;
+        row[landmark] = forward[top_nodes[i]];
+        row[landmark_count + landmark] = reverse[top_nodes[i]];
+      }
+      for (uint32_t i = 0; i < members.size(); ++i) {
+        closest[i] = std::min(closest[i], forward[top_nodes[members[i]]]);
+      }
+      LOG_DEBUG("Landmark " + std::to_string(landmark) + " at node " +
+                std::to_string(members[farthest]) + " of region " + std::to_string(region.first));
+    }
+  }
+  LOG_INFO("Selected " + std::to_string(landmark) + " landmarks in " +
+           std::to_string(regions.size()) + " regions");
+
+  Landmarks::Save(file, reader, static_cast<uint32_t>(costing), options.SerializeAsString(),
+                  landmark_count, tiles, costs);
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -1,5 +1,6 @@
 #include "mjolnir/util.h"
 
+#include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 #include "midgard/aabb2.h"
@@ -7,12 +8,15 @@
 #include "midgard/point2.h"
 #include "midgard/polyline2.h"
 #include "mjolnir/bssbuilder.h"
+#include "mjolnir/contractionhierarchybuilder.h"
 #include "mjolnir/elevationbuilder.h"
 #include "mjolnir/graphbuilder.h"
 #include "mjolnir/graphenhancer.h"
 #include "mjolnir/graphfilter.h"
+#include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/graphvalidator.h"
 #include "mjolnir/hierarchybuilder.h"
+#include "mjolnir/landmarkbuilder.h"
 #include "mjolnir/osmpbfparser.h"
 #include "mjolnir/pbfgraphparser.h"
 #include "mjolnir/restrictionbuilder.h"
@@ -378,6 +382,42 @@ bool build_tile_set(const boost::property_tree::ptree& config,
   // Validate the graph and add information that cannot be added until full graph is formed.
   if (start_stage <= BuildStage::kValidate && BuildStage::kValidate <= end_stage) {
     GraphValidator::Validate(config);
+
+    // Append the compact routing edges to every tile. Nothing above has to carry them along this
+    // way, and the tile builders keep them in sync with any later change to the directed edges
+    if (config.get<bool>("mjolnir.routing_edges", false)) {
+      LOG_INFO("Adding routing edges to the tiles within " + tile_dir);
+      auto reader_config = config.get_child("mjolnir");
+      reader_config.erase("tile_extract");
+      baldr::GraphReader reader(reader_config);
+      for (const auto& tile_id : reader.GetTileSet()) {
+        GraphTileBuilder::AddRoutingEdges(tile_dir, reader.GetGraphTile(tile_id));
+        if (reader.OverCommitted()) {
+          reader.Trim();
+        }
+      }
+    }
+
+    // Recover the shortcuts once here so that the readers can map them rather than recovering them
+    // all over again in every process. This needs the opposing edges so it has to follow validation
+    auto shortcut_recovery_file = config.get_optional<std::string>("mjolnir.shortcut_recovery_file");
+    if (shortcut_recovery_file && build_hierarchy && config.get<bool>("mjolnir.shortcuts", true)) {
+      LOG_INFO("Writing recovered shortcuts to " + *shortcut_recovery_file);
+      auto reader_config = config.get_child("mjolnir");
+      reader_config.erase("shortcut_caching");
+      baldr::GraphReader reader(reader_config);
+      reader.SaveShortcutRecovery(*shortcut_recovery_file);
+    }
+  }
+
+  // Contract the graph for the fixed costing profile of the contraction hierarchy, if configured
+  if (start_stage <= BuildStage::kContract && BuildStage::kContract <= end_stage) {
+    ContractionHierarchyBuilder::Build(config);
+  }
+
+  // Select the landmarks of the ALT heuristic and their costs, if configured
+  if (start_stage <= BuildStage::kLandmarks && BuildStage::kLandmarks <= end_stage) {
+    LandmarkBuilder::Build(config);
   }
 
   // Cleanup bin files
@@ -112,6 +112,8 @@ bool Options_Action_Enum_Parse(const std::string& action, Options::Action* a) {
       {"height", Options::height},
       {"transit_available", Options::transit_available},
       {"expansion", Options::expansion},
+      {"one_to_many", Options::one_to_many},
+      {"batch_isochrone", Options::batch_isochrone},
   };
   auto i = actions.find(action);
   if (i == actions.cend())
@@ -133,6 +135,8 @@ const std::string& Options_Action_Enum_Name(const Options::Action action) {
       {Options::height, "height"},
       {Options::transit_available, "transit_available"},
       {Options::expansion, "expansion"},
+      {Options::one_to_many, "one_to_many"},
+      {Options::batch_isochrone, "batch_isochrone"},
   };
   auto i = actions.find(action);
   return i == actions.cend() ? empty : i->second;
@@ -331,5 +331,18 @@ void ParseCostingOptions(const rapidjson::Document& doc,
   costing_options->set_costing(costing);
 }
 
+std::string SerializeDefaultCostingOptions(Costing costing, const char* json) {
+  rapidjson::Document doc;
+  const auto& costing_str = Costing_Enum_Name(costing);
+  if (json) {
+    doc.Parse(std::string("{\"costing_options\":{\"") + costing_str + "\":" + json + "}}");
+  } else {
+    doc.SetObject();
+  }
+  CostingOptions options;
+  ParseCostingOptions(doc, "/costing_options/" + costing_str, &options, costing);
+  return options.SerializeAsString();
+}
+
 } // namespace sif
 } // namespace valhalla
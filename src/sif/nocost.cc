@@ -112,6 +112,10 @@ public:
     return true;
   }
 
+  virtual bool IsAccessible(const baldr::RoutingEdges&, const uint32_t) const override {
+    return true;
+  }
+
   bool IsClosed(const baldr::DirectedEdge*, const graph_tile_ptr&) const override {
     return false;
   }
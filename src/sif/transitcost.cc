@@ -147,6 +147,18 @@ public:
    */
   virtual bool Allowed(const baldr::NodeInfo* node) const override;
 
+  // the overload for a single directed edge is still that of DynamicCost
+  using DynamicCost::IsAccessible;
+
+  /**
+   * Transit access is decided by the use of the edge in Allowed rather than by
+   * the access mask so we cant reject anything up front.
+   * @return  Returns true.
+   */
+  virtual bool IsAccessible(const baldr::RoutingEdges&, const uint32_t) const override {
+    return true;
+  }
+
   /**
    * Get the cost to traverse the specified directed edge using a transit
    * departure (schedule based edge traversal). Cost includes
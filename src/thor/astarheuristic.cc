@@ -0,0 +1,184 @@
+#include "thor/astarheuristic.h"
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+constexpr float kInfinity = std::numeric_limits<float>::infinity();
+
+// How many nodes with landmark costs to bound a location through, and how many nodes to settle
+// looking for them before giving up
+constexpr uint32_t kMaxProxies = 4;
+constexpr uint32_t kMaxProxySettled = 2000;
+
+using queue_t =
+    std::priority_queue<std::pair<float, uint64_t>, std::vector<std::pair<float, uint64_t>>,
+                        std::greater<std::pair<float, uint64_t>>>;
+
+// The closest nodes to a node that the landmarks have costs for, along with the cost of a path
+// from the node to each of them (forward) or from each of them to the node (reverse). The paths
+// only ever have to be possible, not shortest, for the bounds to hold, so neither the turn costs
+// nor the restrictions of the costing matter here.
+std::vector<std::pair<uint32_t, float>> proxies(const Landmarks& landmarks,
+                                                GraphReader& reader,
+                                                const DynamicCost& costing,
+                                                const GraphId& start,
+                                                bool forward) {
+  std::vector<std::pair<uint32_t, float>> found;
+  std::unordered_map<uint64_t, float> costs;
+  queue_t queue;
+  costs.emplace(start, 0.f);
+  queue.emplace(0.f, start);
+  uint32_t settled = 0;
+  while (!queue.empty() && found.size() < kMaxProxies && settled < kMaxProxySettled) {
+    const auto cost = queue.top().first;
+    const GraphId node(queue.top().second);
+    queue.pop();
+    if (cost > costs[node]) {
+      continue;
+    }
+    ++settled;
+    const auto index = landmarks.node(node);
+    if (index != Landmarks::kInvalidNode) {
+      found.emplace_back(index, cost);
+      // no other node bounds it tighter than its own costs
+      if (cost == 0.f) {
+        break;
+      }
+    }
+
+    graph_tile_ptr tile = reader.GetGraphTile(node);
+    if (!tile) {
+      continue;
+    }
+    const auto* nodeinfo = tile->node(node);
+    auto relax = [&](const GraphId& next, float next_cost) {
+      auto inserted = costs.emplace(next, next_cost);
+      if (inserted.second || next_cost < inserted.first->second) {
+        inserted.first->second = next_cost;
+        queue.emplace(next_cost, next);
+      }
+    };
+    GraphId edge_id(node.tileid(), node.level(), nodeinfo->edge_index());
+    for (const auto& edge : tile->GetDirectedEdges(nodeinfo)) {
+      if (edge.is_shortcut() || edge.IsTransitLine()) {
+        ++edge_id;
+        continue;
+      }
+      if (forward) {
+        if (costing.Allowed(&edge, tile)) {
+          relax(edge.endnode(), cost + costing.EdgeCost(&edge, tile).cost);
+        }
+      } else {
+        // the opposing edge leads from the end node to this one
+        graph_tile_ptr opp_tile = tile;
+        const auto* opp_edge = reader.GetOpposingEdge(edge_id, opp_tile);
+        if (opp_edge && costing.Allowed(opp_edge, opp_tile)) {
+          relax(edge.endnode(), cost + costing.EdgeCost(opp_edge, opp_tile).cost);
+        }
+      }
+      ++edge_id;
+    }
+    for (const auto& transition : tile->GetNodeTransitions(nodeinfo)) {
+      relax(transition.endnode(), cost);
+    }
+  }
+  return found;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+bool AStarHeuristic::InitLandmarks(const Landmarks* landmarks,
+                                   const valhalla::Location& location,
+                                   bool to_location,
+                                   GraphReader& reader,
+                                   const DynamicCost& costing) {
+  ClearLandmarks();
+  if (!landmarks || !*landmarks || location.path_edges().empty()) {
+    return false;
+  }
+
+  // Bound the costs between each landmark and the node the location is reached through for each
+  // candidate edge. The cost to the location is bounded through the begin node of its edges, since
+  // the location lies beyond them, and the cost from the location through the end node of its
+  // edges. For a proxy p of that node n (a nearby node with landmark costs) and a landmark L:
+  //   forward  d(L,n) >= d(L,p) - d(n,p)   d(n,L) <= d(n,p) + d(p,L)
+  //   reverse  d(n,L) >= d(p,L) - d(p,n)   d(L,n) <= d(L,p) + d(p,n)
+  // the lower bounds go in first and the upper bounds in second, tightest over all proxies
+  const auto landmark_count = landmarks->landmark_count();
+  bounds_.reserve(location.path_edges_size() * landmark_count);
+  for (const auto& path_edge : location.path_edges()) {
+    const GraphId edge_id(path_edge.graph_id());
+    const auto node = to_location ? reader.edge_startnode(edge_id) : reader.edge_endnode(edge_id);
+    const auto found =
+        node.Is_Valid() ? proxies(*landmarks, reader, costing, node, to_location)
+                        : std::vector<std::pair<uint32_t, float>>();
+    if (found.empty()) {
+      ClearLandmarks();
+      return false;
+    }
+
+    const auto offset = bounds_.size();
+    bounds_.resize(offset + landmark_count, {-kInfinity, kInfinity});
+    for (const auto& proxy : found) {
+      const float* lower = to_location ? landmarks->from(proxy.first) : landmarks->to(proxy.first);
+      const float* upper = to_location ? landmarks->to(proxy.first) : landmarks->from(proxy.first);
+      for (uint32_t i = 0; i < landmark_count; ++i) {
+        auto& bound = bounds_[offset + i];
+        if (!std::isinf(lower[i])) {
+          bound.first = std::max(bound.first, lower[i] - proxy.second);
+        }
+        if (!std::isinf(upper[i])) {
+          bound.second = std::min(bound.second, upper[i] + proxy.second);
+        }
+      }
+    }
+  }
+
+  landmarks_ = landmarks;
+  to_location_ = to_location;
+  return true;
+}
+
+float AStarHeuristic::GetLandmarks(const GraphId& node) const {
+  const auto index = landmarks_->node(node);
+  if (index == Landmarks::kInvalidNode) {
+    return 0.f;
+  }
+
+  // The cost to the location is at least d(L,n) - d(L,v) and d(v,L) - d(n,L) for every landmark,
+  // the cost from it at least d(n,L) - d(v,L) and d(L,v) - d(L,n). Nodes that cannot reach or be
+  // reached from a landmark give no bound through it
+  const auto landmark_count = landmarks_->landmark_count();
+  const float* lower = to_location_ ? landmarks_->from(index) : landmarks_->to(index);
+  const float* upper = to_location_ ? landmarks_->to(index) : landmarks_->from(index);
+  float estimate = kInfinity;
+  for (size_t offset = 0; offset < bounds_.size(); offset += landmark_count) {
+    float bound = 0.f;
+    for (uint32_t i = 0; i < landmark_count; ++i) {
+      const auto& location = bounds_[offset + i];
+      if (!std::isinf(lower[i])) {
+        bound = std::max(bound, location.first - lower[i]);
+      }
+      if (!std::isinf(upper[i])) {
+        bound = std::max(bound, upper[i] - location.second);
+      }
+    }
+    // the location is reached through whichever of its edges is cheapest
+    estimate = std::min(estimate, bound);
+  }
+  return estimate;
+}
+
+} // namespace thor
+} // namespace valhalla
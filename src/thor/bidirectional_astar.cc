@@ -4,10 +4,14 @@
 #include "baldr/graphid.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "proto_conversions.h"
 #include "sif/edgelabel.h"
 #include "thor/alternates.h"
 #include <algorithm>
+#include <atomic>
 #include <map>
+#include <mutex>
+#include <thread>
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -28,9 +32,16 @@ constexpr float kThresholdDelta = 420.0f;
 namespace valhalla {
 namespace thor {
 
+constexpr float BidirectionalAStar::kDefaultParallelMinDistance;
+
 // Default constructor
 BidirectionalAStar::BidirectionalAStar() : PathAlgorithm() {
   threshold_ = 0;
+  parallel_min_distance_ = kDefaultParallelMinDistance;
+  forward_time_info_ = TimeInfo::invalid();
+  reverse_time_info_ = TimeInfo::invalid();
+  invariant_ = false;
+  resumable_ = false;
   mode_ = TravelMode::kDrive;
   access_mode_ = kAutoAccess;
   travel_type_ = 0;
@@ -45,17 +56,59 @@ BidirectionalAStar::~BidirectionalAStar() {
 
 // Clear the temporary information generated during path construction.
 void BidirectionalAStar::Clear() {
-  edgelabels_forward_.clear();
-  edgelabels_reverse_.clear();
-  adjacencylist_forward_.reset();
-  adjacencylist_reverse_.reset();
+  // Give the storage back to the arena for the next search
+  arena_->Release(edgelabels_forward_);
+  arena_->Release(edgelabels_reverse_);
+  arena_->ReleaseQueue(adjacencylist_forward_);
+  arena_->ReleaseQueue(adjacencylist_reverse_);
   edgestatus_forward_.clear();
   edgestatus_reverse_.clear();
+  settled_forward_.clear();
+  settled_reverse_.clear();
+  pruned_forward_.clear();
+  pruned_reverse_.clear();
+  resumable_ = false;
+  arena_->Trim();
+  if (reverse_reader_ && reverse_reader_->OverCommitted()) {
+    reverse_reader_->Trim();
+  }
 
   // Set the ferry flag to false
   has_ferry_ = false;
 }
 
+// Map the landmarks, as long as they were built for the current defaults of their costing
+bool BidirectionalAStar::LoadLandmarks(const std::string& file, GraphReader& reader) {
+  landmarks_explicit_profile_.clear();
+  if (!landmarks_.Load(file, reader)) {
+    return false;
+  }
+
+  const auto costing = static_cast<Costing>(landmarks_.costing());
+  if (landmarks_.profile() != SerializeDefaultCostingOptions(costing)) {
+    LOG_WARN("Ignoring landmarks " + file + " built with other " + Costing_Enum_Name(costing) +
+             " costing defaults");
+    return false;
+  }
+  landmarks_explicit_profile_ = SerializeDefaultCostingOptions(costing, "{}");
+  LOG_INFO("Mapped " + std::to_string(landmarks_.landmark_count()) + " " +
+           Costing_Enum_Name(costing) + " landmarks from " + file);
+  return true;
+}
+
+// The landmarks only bound the costs of the options they were built for. Alternates are left to
+// the plain heuristic, the search needs to stray from the best path to find them
+bool BidirectionalAStar::LandmarksMatch(const Options& options) const {
+  if (!landmarks_ || landmarks_explicit_profile_.empty() ||
+      options.costing() != static_cast<Costing>(landmarks_.costing()) ||
+      options.costing() >= options.costing_options_size() ||
+      (options.has_alternates() && options.alternates() > 0)) {
+    return false;
+  }
+  const auto requested = options.costing_options(options.costing()).SerializeAsString();
+  return requested == landmarks_.profile() || requested == landmarks_explicit_profile_;
+}
+
 // Initialize the A* heuristic and adjacency lists for both the forward
 // and reverse search.
 void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
@@ -64,8 +117,12 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
   astarheuristic_forward_.Init(destll, factor);
   astarheuristic_reverse_.Init(origll, factor);
 
-  // Reserve size for edge labels - do this here rather than in constructor so
-  // to limit how much extra memory is used for persistent objects
+  // Take the edge labels from the arena, reserving size for them if it had none - do this here
+  // rather than in constructor so to limit how much extra memory is used for persistent objects
+  arena_->Acquire(edgelabels_forward_);
+  arena_->Acquire(edgelabels_reverse_);
+  edgelabels_forward_.clear();
+  edgelabels_reverse_.clear();
   edgelabels_forward_.reserve(kInitialEdgeLabelCountBD);
   edgelabels_reverse_.reserve(kInitialEdgeLabelCountBD);
 
@@ -74,11 +131,13 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
   uint32_t bucketsize = costing_->UnitSize();
   float range = kBucketCount * bucketsize;
   float mincostf = astarheuristic_forward_.Get(origll);
-  adjacencylist_forward_.reset(
-      new DoubleBucketQueue<BDEdgeLabel>(mincostf, range, bucketsize, edgelabels_forward_));
+  arena_->ReleaseQueue(adjacencylist_forward_);
+  adjacencylist_forward_ = arena_->MakeQueue(mincostf, range, bucketsize, edgelabels_forward_);
   float mincostr = astarheuristic_reverse_.Get(destll);
-  adjacencylist_reverse_.reset(
-      new DoubleBucketQueue<BDEdgeLabel>(mincostr, range, bucketsize, edgelabels_reverse_));
+  arena_->ReleaseQueue(adjacencylist_reverse_);
+  adjacencylist_reverse_ = arena_->MakeQueue(mincostr, range, bucketsize, edgelabels_reverse_);
+  edgestatus_forward_.set_arena(arena_);
+  edgestatus_reverse_.set_arena(arena_);
   edgestatus_forward_.clear();
   edgestatus_reverse_.clear();
 
@@ -89,6 +148,9 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
 
   // Initialize best connections as having none
   best_connections_ = {};
+  pruned_forward_.clear();
+  pruned_reverse_.clear();
+  resumable_ = false;
 
   // Set the cost threshold to the maximum float value. Once the initial connection is found
   // the threshold is set.
@@ -143,10 +205,10 @@ bool BidirectionalAStar::ExpandForward(GraphReader& graphreader,
     // If so, it means we are attempting a u-turn. In that case, lets wait with evaluating
     // this edge until last. If any other edges were emplaced, it means we should not
     // even try to evaluate a u-turn since u-turns should only happen for deadends
-    uturn_meta = pred.opp_local_idx() == meta.edge->localedgeidx() ? meta : uturn_meta;
+    uturn_meta = pred.opp_local_idx() == meta.localedgeidx() ? meta : uturn_meta;
 
     // Expand but only if this isnt the uturn, we'll try that later if nothing else works out
-    disable_uturn = (pred.opp_local_idx() != meta.edge->localedgeidx() &&
+    disable_uturn = (pred.opp_local_idx() != meta.localedgeidx() &&
                      ExpandForwardInner(graphreader, pred, nodeinfo, pred_idx, meta, shortcuts, tile,
                                         offset_time)) ||
                     disable_uturn;
@@ -158,9 +220,12 @@ bool BidirectionalAStar::ExpandForward(GraphReader& graphreader,
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       // if this is a downward transition (ups are always allowed) AND we are no longer allowed OR
       // we cant get the tile at that level (local extracts could have this problem) THEN bail
-      graph_tile_ptr trans_tile = nullptr;
-      if ((!trans->up() && hierarchy_limits_forward_[trans->endnode().level()].StopExpanding()) ||
-          !(trans_tile = graphreader.GetGraphTile(trans->endnode()))) {
+      if (!trans->up() && hierarchy_limits_forward_[trans->endnode().level()].StopExpanding()) {
+        pruned_forward_.push_back(pred_idx);
+        continue;
+      }
+      graph_tile_ptr trans_tile = graphreader.GetGraphTile(trans->endnode());
+      if (!trans_tile) {
         continue;
       }
       // setup for expansion at this level
@@ -221,13 +286,13 @@ inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
   // edges while still expanding on the next level since we can still transition down to
   // that level. If using a shortcut, set the shortcuts mask. Skip if this is a regular
   // edge superseded by a shortcut.
-  if (meta.edge->is_shortcut()) {
+  if (meta.is_shortcut()) {
     if (hierarchy_limits_forward_[meta.edge_id.level() + 1].StopExpanding()) {
-      shortcuts |= meta.edge->shortcut();
+      shortcuts |= meta.shortcut();
     } else {
       return false;
     }
-  } else if (shortcuts & meta.edge->superseded()) {
+  } else if (shortcuts & meta.superseded()) {
     return false;
   }
 
@@ -244,10 +309,15 @@ inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
   const uint64_t localtime = time_info.valid ? time_info.local_time : 0;
   int restriction_idx = -1;
 
-  if (!costing_->Allowed(meta.edge, pred, tile, meta.edge_id, localtime, time_info.timezone_index,
+  if (!meta.accessible(*costing_) ||
+      !costing_->Allowed(meta.edge, pred, tile, meta.edge_id, localtime, time_info.timezone_index,
                          restriction_idx) ||
       costing_->Restricted(meta.edge, pred, edgelabels_forward_, tile, meta.edge_id, true,
                            &edgestatus_forward_, localtime, time_info.timezone_index)) {
+    // a second pass allowing destination only edges has to come back here
+    if (meta.edge->destonly() && !pred.destonly()) {
+      pruned_forward_.push_back(pred_idx);
+    }
     return false;
   }
 
@@ -282,7 +352,8 @@ inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
   // end node of the directed edge.
   float dist = 0.0f;
   float sortcost =
-      newcost.cost + astarheuristic_forward_.Get(t2->get_node_ll(meta.edge->endnode()), dist);
+      newcost.cost + astarheuristic_forward_.Get(t2->get_node_ll(meta.edge->endnode()),
+                                                 meta.edge->endnode(), dist);
 
   // Add edge label, add to the adjacency list and set edge status
   uint32_t idx = edgelabels_forward_.size();
@@ -352,10 +423,10 @@ bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
     // If so, it means we are attempting a u-turn. In that case, lets wait with evaluating
     // this edge until last. If any other edges were emplaced, it means we should not
     // even try to evaluate a u-turn since u-turns should only happen for deadends
-    uturn_meta = pred.opp_local_idx() == meta.edge->localedgeidx() ? meta : uturn_meta;
+    uturn_meta = pred.opp_local_idx() == meta.localedgeidx() ? meta : uturn_meta;
 
     // Expand but only if this isnt the uturn, we'll try that later if nothing else works out
-    disable_uturn = (pred.opp_local_idx() != meta.edge->localedgeidx() &&
+    disable_uturn = (pred.opp_local_idx() != meta.localedgeidx() &&
                      ExpandReverseInner(graphreader, pred, opp_pred_edge, nodeinfo, pred_idx, meta,
                                         shortcuts, tile, offset_time)) ||
                     disable_uturn;
@@ -367,9 +438,12 @@ bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       // if this is a downward transition (ups are always allowed) AND we are no longer allowed OR
       // we cant get the tile at that level (local extracts could have this problem) THEN bail
-      graph_tile_ptr trans_tile = nullptr;
-      if ((!trans->up() && hierarchy_limits_reverse_[trans->endnode().level()].StopExpanding()) ||
-          !(trans_tile = graphreader.GetGraphTile(trans->endnode()))) {
+      if (!trans->up() && hierarchy_limits_reverse_[trans->endnode().level()].StopExpanding()) {
+        pruned_reverse_.push_back(pred_idx);
+        continue;
+      }
+      graph_tile_ptr trans_tile = graphreader.GetGraphTile(trans->endnode());
+      if (!trans_tile) {
         continue;
       }
       // setup for expansion at this level
@@ -430,13 +504,13 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
   // edges while still expanding on the next level since we can still transition down to
   // that level. If using a shortcut, set the shortcuts mask. Skip if this is a regular
   // edge superseded by a shortcut.
-  if (meta.edge->is_shortcut()) {
+  if (meta.is_shortcut()) {
     if (hierarchy_limits_reverse_[meta.edge_id.level() + 1].StopExpanding()) {
-      shortcuts |= meta.edge->shortcut();
+      shortcuts |= meta.shortcut();
     } else {
       return false;
     }
-  } else if (shortcuts & meta.edge->superseded()) {
+  } else if (shortcuts & meta.superseded()) {
     return false;
   }
 
@@ -446,7 +520,7 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
     return true; // This is an edge we _could_ have expanded, so return true
   }
   // TODO Why is this check necessary? opp_edge.forwardaccess() is checked in Allowed(...)
-  if (!(meta.edge->reverseaccess() & access_mode_)) {
+  if (!(meta.reverseaccess() & access_mode_)) {
     return false;
   }
 
@@ -469,6 +543,10 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
                                 time_info.timezone_index, restriction_idx) ||
       costing_->Restricted(meta.edge, pred, edgelabels_reverse_, tile, meta.edge_id, false,
                            &edgestatus_reverse_, localtime, time_info.timezone_index)) {
+    // a second pass allowing destination only edges has to come back here
+    if (opp_edge->destonly() && !pred.destonly()) {
+      pruned_reverse_.push_back(pred_idx);
+    }
     return false;
   }
 
@@ -497,7 +575,8 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
   // end node of the directed edge.
   float dist = 0.0f;
   float sortcost =
-      newcost.cost + astarheuristic_reverse_.Get(t2->get_node_ll(meta.edge->endnode()), dist);
+      newcost.cost + astarheuristic_reverse_.Get(t2->get_node_ll(meta.edge->endnode()),
+                                                 meta.edge->endnode(), dist);
 
   // Add edge label, add to the adjacency list and set edge status
   uint32_t idx = edgelabels_reverse_.size();
@@ -539,11 +618,25 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   PointLL destination_new(destination.path_edges(0).ll().lng(), destination.path_edges(0).ll().lat());
   Init(origin_new, destination_new);
 
+  // Start loading the tiles between the locations in the background, if the reader supports it
+  graphreader.PrefetchAlong(origin_new, destination_new);
+
   // Get time information for forward and backward searches
   bool invariant = options.has_date_time_type() && options.date_time_type() == Options::invariant;
   auto forward_time_info = TimeInfo::make(origin, graphreader, &tz_cache_);
   auto reverse_time_info = TimeInfo::make(destination, graphreader, &tz_cache_);
 
+  // Bound the heuristics with the landmarks too if the request is for the options they were built
+  // for and has no time (their costs are those of a route without one). Either both searches use
+  // them or neither does, so that they stay even
+  if (!LandmarksMatch(options) || forward_time_info.valid || reverse_time_info.valid ||
+      !astarheuristic_forward_.InitLandmarks(&landmarks_, destination, true, graphreader,
+                                             *costing_) ||
+      !astarheuristic_reverse_.InitLandmarks(&landmarks_, origin, false, graphreader, *costing_)) {
+    astarheuristic_forward_.ClearLandmarks();
+    astarheuristic_reverse_.ClearLandmarks();
+  }
+
   // When a timedependent route is too long in distance it gets sent to this algorithm. It used to be
   // the case that this algorithm called EdgeCost without a time component. This would result in
   // timedependent routes falling back to time independent routing. Now that this algorithm is time
@@ -563,7 +656,31 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   // points to may be harder to find
   SetOrigin(graphreader, origin, forward_time_info);
   SetDestination(graphreader, destination, reverse_time_info);
+  forward_time_info_ = forward_time_info;
+  reverse_time_info_ = reverse_time_info;
+  invariant_ = invariant;
+
+  // Long routes can have the two searches run at the same time. Not with a time at both ends
+  // since they would share the timezone cache, nor with alternates which are found from the
+  // connections the searches happen to meet at
+  if (reverse_reader_ && origin_new.Distance(destination_new) >= parallel_min_distance_ &&
+      !(forward_time_info.valid && reverse_time_info.valid) &&
+      !(options.has_alternates() && options.alternates() > 0)) {
+    return GetBestPathParallel(graphreader, options, origin, destination, forward_time_info,
+                               reverse_time_info, invariant);
+  }
+  return Search(graphreader, options, origin, destination, forward_time_info, reverse_time_info,
+                invariant);
+}
 
+// Alternate between the forward and reverse searches until they connect
+std::vector<std::vector<PathInfo>> BidirectionalAStar::Search(GraphReader& graphreader,
+                                                              const Options& options,
+                                                              const valhalla::Location& origin,
+                                                              const valhalla::Location& destination,
+                                                              const TimeInfo& forward_time_info,
+                                                              const TimeInfo& reverse_time_info,
+                                                              const bool invariant) {
   // Find shortest path. Switch between a forward direction and a reverse
   // direction search based on the current costs. Alternating like this
   // prevents one tree from expanding much more quickly (if in a sparser
@@ -574,6 +691,9 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   BDEdgeLabel fwd_pred, rev_pred;
   bool expand_forward = true;
   bool expand_reverse = true;
+  // Tiles the search frontiers were last in, the neighbors get prefetched when they move on
+  const bool prefetch = graphreader.PrefetchEnabled();
+  GraphId forward_tile, reverse_tile;
   while (true) {
     // Allow this process to be aborted
     if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
@@ -602,7 +722,11 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
       } else {
         // Search is exhausted. If a connection has been found, return it
         if (best_connections_.empty()) {
-          // No route found.
+          // No route found. The reverse edge we have yet to expand goes back for Resume
+          if (!expand_reverse) {
+            adjacencylist_reverse_->add(reverse_pred_idx);
+          }
+          resumable_ = true;
           LOG_ERROR("Bi-directional route failure - forward search exhausted: n = " +
                     std::to_string(edgelabels_forward_.size()) + "," +
                     std::to_string(edgelabels_reverse_.size()));
@@ -632,7 +756,9 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
       } else {
         // Search is exhausted. If a connection has been found, return it
         if (best_connections_.empty()) {
-          // No route found.
+          // No route found. The forward edge we have yet to expand goes back for Resume
+          adjacencylist_forward_->add(forward_pred_idx);
+          resumable_ = true;
           LOG_ERROR("Bi-directional route failure - reverse search exhausted: n = " +
                     std::to_string(edgelabels_reverse_.size()) + "," +
                     std::to_string(edgelabels_forward_.size()));
@@ -658,11 +784,20 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
 
       // Prune path if predecessor is not a through edge or if the maximum
       // number of upward transitions has been exceeded on this hierarchy level.
-      if ((fwd_pred.not_thru() && fwd_pred.not_thru_pruning()) ||
-          hierarchy_limits_forward_[fwd_pred.endnode().level()].StopExpanding()) {
+      if (fwd_pred.not_thru() && fwd_pred.not_thru_pruning()) {
+        continue;
+      }
+      if (hierarchy_limits_forward_[fwd_pred.endnode().level()].StopExpanding()) {
+        pruned_forward_.push_back(forward_pred_idx);
         continue;
       }
 
+      // Let the reader fetch the tiles around the frontier while we expand
+      if (prefetch && fwd_pred.endnode().Tile_Base() != forward_tile) {
+        forward_tile = fwd_pred.endnode().Tile_Base();
+        graphreader.PrefetchNeighbors(forward_tile);
+      }
+
       // Expand from the end node in forward direction.
       ExpandForward(graphreader, fwd_pred.endnode(), fwd_pred, forward_pred_idx, forward_time_info,
                     invariant);
@@ -680,8 +815,11 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
       }
 
       // Prune path if predecessor is not a through edge
-      if ((rev_pred.not_thru() && rev_pred.not_thru_pruning()) ||
-          hierarchy_limits_reverse_[rev_pred.endnode().level()].StopExpanding()) {
+      if (rev_pred.not_thru() && rev_pred.not_thru_pruning()) {
+        continue;
+      }
+      if (hierarchy_limits_reverse_[rev_pred.endnode().level()].StopExpanding()) {
+        pruned_reverse_.push_back(reverse_pred_idx);
         continue;
       }
 
@@ -690,6 +828,12 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
       const DirectedEdge* opp_pred_edge =
           graphreader.GetGraphTile(rev_pred.opp_edgeid())->directededge(rev_pred.opp_edgeid());
 
+      // Let the reader fetch the tiles around the frontier while we expand
+      if (prefetch && rev_pred.endnode().Tile_Base() != reverse_tile) {
+        reverse_tile = rev_pred.endnode().Tile_Base();
+        graphreader.PrefetchNeighbors(reverse_tile);
+      }
+
       // Expand from the end node in reverse direction.
       ExpandReverse(graphreader, rev_pred.endnode(), rev_pred, reverse_pred_idx, opp_pred_edge,
                     reverse_time_info, invariant);
@@ -698,6 +842,263 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   return {}; // If we are here the route failed
 }
 
+// Carry on with a failed search once the costing is relaxed
+std::vector<std::vector<PathInfo>> BidirectionalAStar::Resume(valhalla::Location& origin,
+                                                              valhalla::Location& destination,
+                                                              GraphReader& graphreader,
+                                                              const Options& options) {
+  if (!resumable_) {
+    throw std::runtime_error("BidirectionalAStar can only resume a search that found no path");
+  }
+  resumable_ = false;
+
+  // The relaxed limits apply from here on to the transitions the searches have made so far
+  const auto& relaxed = costing_->GetHierarchyLimits();
+  for (auto* limits : {&hierarchy_limits_forward_, &hierarchy_limits_reverse_}) {
+    for (size_t level = 0; level < limits->size() && level < relaxed.size(); ++level) {
+      (*limits)[level].max_up_transitions = relaxed[level].max_up_transitions;
+      (*limits)[level].expansion_within_dist = relaxed[level].expansion_within_dist;
+    }
+  }
+
+  // The filtered edges are new candidates for the locations. The landmark bounds were only worked
+  // out for the edges the locations had, so the heuristics go without them from here on
+  if (origin.filtered_edges_size() > 0 || destination.filtered_edges_size() > 0) {
+    astarheuristic_forward_.ClearLandmarks();
+    astarheuristic_reverse_.ClearLandmarks();
+  }
+  // Only the ones the searches have not reached yet get labels of their own
+  if (origin.filtered_edges_size() > 0) {
+    auto added = origin;
+    added.clear_path_edges();
+    for (const auto& edge : origin.filtered_edges()) {
+      if (edgestatus_forward_.Get(GraphId(edge.graph_id())).set() == EdgeSet::kUnreachedOrReset) {
+        *added.add_path_edges() = edge;
+      }
+    }
+    SetOrigin(graphreader, added, forward_time_info_);
+  }
+  if (destination.filtered_edges_size() > 0) {
+    auto added = destination;
+    added.clear_path_edges();
+    for (const auto& edge : destination.filtered_edges()) {
+      const auto opp_edge_id = graphreader.GetOpposingEdgeId(GraphId(edge.graph_id()));
+      if (opp_edge_id.Is_Valid() &&
+          edgestatus_reverse_.Get(opp_edge_id).set() == EdgeSet::kUnreachedOrReset) {
+        *added.add_path_edges() = edge;
+      }
+    }
+    SetDestination(graphreader, added, reverse_time_info_);
+  }
+
+  // Expand the labels that were cut short again, which adds the edges the rules left out. Those
+  // that are still over the limits are noted again. Edges the first pass settled keep their labels
+  // though, even if it only got to them through a detour that an edge added now would cut short,
+  // so the path found can cost more than the one a second pass from scratch would find
+  std::vector<uint32_t> pruned;
+  pruned.swap(pruned_forward_);
+  std::sort(pruned.begin(), pruned.end());
+  pruned.erase(std::unique(pruned.begin(), pruned.end()), pruned.end());
+  for (const auto pred_idx : pruned) {
+    BDEdgeLabel pred = edgelabels_forward_[pred_idx];
+    if (hierarchy_limits_forward_[pred.endnode().level()].StopExpanding()) {
+      pruned_forward_.push_back(pred_idx);
+      continue;
+    }
+    ExpandForward(graphreader, pred.endnode(), pred, pred_idx, forward_time_info_, invariant_);
+  }
+  pruned.clear();
+  pruned.swap(pruned_reverse_);
+  std::sort(pruned.begin(), pruned.end());
+  pruned.erase(std::unique(pruned.begin(), pruned.end()), pruned.end());
+  for (const auto pred_idx : pruned) {
+    BDEdgeLabel pred = edgelabels_reverse_[pred_idx];
+    if (hierarchy_limits_reverse_[pred.endnode().level()].StopExpanding()) {
+      pruned_reverse_.push_back(pred_idx);
+      continue;
+    }
+    const DirectedEdge* opp_pred_edge =
+        graphreader.GetGraphTile(pred.opp_edgeid())->directededge(pred.opp_edgeid());
+    ExpandReverse(graphreader, pred.endnode(), pred, pred_idx, opp_pred_edge, reverse_time_info_,
+                  invariant_);
+  }
+
+  return Search(graphreader, options, origin, destination, forward_time_info_, reverse_time_info_,
+                invariant_);
+}
+
+// Run the forward search on this thread and the reverse one on another
+std::vector<std::vector<PathInfo>>
+BidirectionalAStar::GetBestPathParallel(GraphReader& graphreader,
+                                        const Options& options,
+                                        const valhalla::Location& origin,
+                                        const valhalla::Location& destination,
+                                        const TimeInfo& forward_time_info,
+                                        const TimeInfo& reverse_time_info,
+                                        const bool invariant) {
+  // Each search only writes its own labels, adjacency list and edge status. The arena and the
+  // expansion callback are shared so the reverse search keeps clear of the one and both go
+  // through a lock for the other
+  edgestatus_reverse_.set_arena(nullptr);
+  const auto expansion_callback = expansion_callback_;
+  std::mutex callback_lock;
+  if (expansion_callback) {
+    expansion_callback_ = [&](GraphReader& reader, const char* algorithm, const GraphId edgeid,
+                              const char* status, const bool full_shape) {
+      std::lock_guard<std::mutex> lock(callback_lock);
+      expansion_callback(reader, algorithm, edgeid, status, full_shape);
+    };
+  }
+  settled_forward_.clear();
+  settled_reverse_.clear();
+
+  // The threshold is set by the first connection, the searches write how far they have got so
+  // it can be set from the furthest of them. Connections are only noted while they run
+  std::atomic<float> threshold(std::numeric_limits<float>::max());
+  std::atomic<float> forward_sortcost(0.f), reverse_sortcost(0.f);
+  std::atomic<bool> stop(false);
+  std::mutex connection_lock;
+  std::vector<std::pair<bool, uint32_t>> connections;
+
+  auto search = [&](const bool forward, GraphReader& reader) {
+    auto& adjacencylist = forward ? adjacencylist_forward_ : adjacencylist_reverse_;
+    auto& edgelabels = forward ? edgelabels_forward_ : edgelabels_reverse_;
+    auto& edgestatus = forward ? edgestatus_forward_ : edgestatus_reverse_;
+    auto& hierarchy_limits = forward ? hierarchy_limits_forward_ : hierarchy_limits_reverse_;
+    auto& pruned = forward ? pruned_forward_ : pruned_reverse_;
+    auto& settled = forward ? settled_forward_ : settled_reverse_;
+    const auto& other_settled = forward ? settled_reverse_ : settled_forward_;
+    auto& sortcost = forward ? forward_sortcost : reverse_sortcost;
+    const auto& other_sortcost = forward ? reverse_sortcost : forward_sortcost;
+    const float diff = forward ? cost_diff_ : 0.f;
+    const bool prefetch = reader.PrefetchEnabled();
+    GraphId frontier_tile;
+    graph_tile_ptr tile, opp_tile;
+    int n = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      // Allow this process to be aborted, from the calling thread only
+      if (forward && interrupt && (++n % kInterruptIterationsInterval) == 0) {
+        (*interrupt)();
+      }
+
+      // A search that runs out of edges before any connection means there is no route, one that
+      // runs out after leaves the other one to finish
+      const uint32_t pred_idx = adjacencylist->pop();
+      if (pred_idx == kInvalidLabel) {
+        if (threshold.load() == std::numeric_limits<float>::max()) {
+          stop = true;
+        }
+        break;
+      }
+      BDEdgeLabel pred = edgelabels[pred_idx];
+
+      // This search is done once it gets past the threshold
+      sortcost.store(pred.sortcost() + diff, std::memory_order_relaxed);
+      if (pred.sortcost() + diff > threshold.load()) {
+        break;
+      }
+
+      // Say we got to the edge before looking for its opposing edge in the other search, so that
+      // when both get to either side of it at once at least one of them sees the other
+      settled.Add(pred.edgeid(), reader.GetGraphTile(pred.edgeid(), tile));
+      if (other_settled.Contains(pred.opp_edgeid())) {
+        {
+          std::lock_guard<std::mutex> lock(connection_lock);
+          connections.emplace_back(forward, pred_idx);
+        }
+        // Connections on complex restrictions might not be allowed, the search goes on past them
+        // until they are checked after. Any other one sets the threshold if it is the first, from
+        // the further of the two searches since the other got to the edge before us
+        if (!pred.on_complex_rest()) {
+          float none = std::numeric_limits<float>::max();
+          const float furthest =
+              std::max(pred.sortcost() + diff, other_sortcost.load(std::memory_order_relaxed));
+          threshold.compare_exchange_strong(none, furthest + kThresholdDelta);
+          continue;
+        }
+      }
+
+      // Settle this edge
+      edgestatus.Update(pred.edgeid(), EdgeSet::kPermanent);
+      if (expansion_callback_) {
+        // sending the opposing edge for the reverse tree
+        expansion_callback_(reader, "bidirectional_astar",
+                            forward ? pred.edgeid() : pred.opp_edgeid(), "s", false);
+      }
+
+      // Prune path if predecessor is not a through edge or if the maximum
+      // number of upward transitions has been exceeded on this hierarchy level.
+      if (pred.not_thru() && pred.not_thru_pruning()) {
+        continue;
+      }
+      if (hierarchy_limits[pred.endnode().level()].StopExpanding()) {
+        pruned.push_back(pred_idx);
+        continue;
+      }
+
+      // Let the reader fetch the tiles around the frontier while we expand
+      if (prefetch && pred.endnode().Tile_Base() != frontier_tile) {
+        frontier_tile = pred.endnode().Tile_Base();
+        reader.PrefetchNeighbors(frontier_tile);
+      }
+
+      if (forward) {
+        ExpandForward(reader, pred.endnode(), pred, pred_idx, forward_time_info, invariant);
+      } else {
+        const DirectedEdge* opp_pred_edge =
+            reader.GetGraphTile(pred.opp_edgeid(), opp_tile)->directededge(pred.opp_edgeid());
+        ExpandReverse(reader, pred.endnode(), pred, pred_idx, opp_pred_edge, reverse_time_info,
+                      invariant);
+      }
+    }
+  };
+
+  // Either search failing stops the other one, the error is thrown once both are done
+  std::exception_ptr forward_error, reverse_error;
+  std::thread reverse([&]() {
+    try {
+      search(false, *reverse_reader_);
+    } catch (...) {
+      reverse_error = std::current_exception();
+      stop = true;
+    }
+  });
+  try {
+    search(true, graphreader);
+  } catch (...) {
+    forward_error = std::current_exception();
+    stop = true;
+  }
+  reverse.join();
+  expansion_callback_ = expansion_callback;
+  edgestatus_reverse_.set_arena(arena_);
+  if (forward_error) {
+    std::rethrow_exception(forward_error);
+  }
+  if (reverse_error) {
+    std::rethrow_exception(reverse_error);
+  }
+
+  // Cost the connections now that the labels no longer change, dropping the ones that complex
+  // restrictions do not allow
+  for (const auto& connection : connections) {
+    if (connection.first) {
+      SetForwardConnection(graphreader, edgelabels_forward_[connection.second]);
+    } else {
+      SetReverseConnection(graphreader, edgelabels_reverse_[connection.second]);
+    }
+  }
+  if (best_connections_.empty()) {
+    // No route found.
+    resumable_ = true;
+    LOG_ERROR("Bi-directional route failure - parallel searches exhausted: n = " +
+              std::to_string(edgelabels_forward_.size()) + "," +
+              std::to_string(edgelabels_reverse_.size()));
+    return {};
+  }
+  return FormPath(graphreader, options, origin, destination);
+}
+
 // The edge on the forward search connects to a reached edge on the reverse
 // search tree. Check if this is the best connection so far and set the
 // search threshold.
@@ -857,8 +1258,10 @@ void BidirectionalAStar::SetOrigin(GraphReader& graphreader,
     // We assume the slowest speed you could travel to cover that distance to start/end the route
     // TODO: assumes 1m/s which is a maximum penalty this could vary per costing model
     cost.cost += edge.distance();
-    float dist = astarheuristic_forward_.GetDistance(nodeinfo->latlng(endtile->header()->base_ll()));
-    float sortcost = cost.cost + astarheuristic_forward_.Get(dist);
+    float dist = 0.0f;
+    float sortcost =
+        cost.cost + astarheuristic_forward_.Get(nodeinfo->latlng(endtile->header()->base_ll()),
+                                                directededge->endnode(), dist);
 
     // Add EdgeLabel to the adjacency list. Set the predecessor edge index
     // to invalid to indicate the origin of the path.
@@ -935,8 +1338,10 @@ void BidirectionalAStar::SetDestination(GraphReader& graphreader,
     // We assume the slowest speed you could travel to cover that distance to start/end the route
     // TODO: assumes 1m/s which is a maximum penalty this could vary per costing model
     cost.cost += edge.distance();
-    float dist = astarheuristic_reverse_.GetDistance(tile->get_node_ll(opp_dir_edge->endnode()));
-    float sortcost = cost.cost + astarheuristic_reverse_.Get(dist);
+    float dist = 0.0f;
+    float sortcost =
+        cost.cost + astarheuristic_reverse_.Get(tile->get_node_ll(opp_dir_edge->endnode()),
+                                                opp_dir_edge->endnode(), dist);
 
     // Add EdgeLabel to the adjacency list. Set the predecessor edge index
     // to invalid to indicate the origin of the path. Make sure the opposing
@@ -0,0 +1,232 @@
+#include "thor/bucketmatrix.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+constexpr uint32_t kInvalidVertex = ContractionHierarchy::kInvalidVertex;
+
+bool equals(const valhalla::LatLng& a, const valhalla::LatLng& b) {
+  return a.has_lat() == b.has_lat() && a.has_lng() == b.has_lng() &&
+         (!a.has_lat() || a.lat() == b.lat()) && (!a.has_lng() || a.lng() == b.lng());
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+BucketMatrix::BucketMatrix(const ContractionHierarchy& hierarchy)
+    : hierarchy_(hierarchy), mode_(TravelMode::kDrive), cost_threshold_(0) {
+}
+
+BucketMatrix::~BucketMatrix() {
+}
+
+float BucketMatrix::GetCostThreshold(const float max_matrix_distance) const {
+  float cost_threshold;
+  switch (mode_) {
+    case TravelMode::kBicycle:
+      cost_threshold = max_matrix_distance / kCostThresholdBicycleDivisor;
+      break;
+    case TravelMode::kPedestrian:
+    case TravelMode::kPublicTransit:
+      cost_threshold = max_matrix_distance / kCostThresholdPedestrianDivisor;
+      break;
+    case TravelMode::kDrive:
+    default:
+      cost_threshold = max_matrix_distance / kCostThresholdAutoDivisor;
+  }
+  return cost_threshold * 2.0f;
+}
+
+void BucketMatrix::Clear() {
+  labels_.clear();
+  queue_ = queue_t();
+  labeled_.clear();
+  settled_.clear();
+  buckets_.clear();
+  bucket_index_.clear();
+  best_.clear();
+}
+
+std::vector<TimeDistance> BucketMatrix::SourceToTarget(
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+    GraphReader& graphreader,
+    const sif::mode_costing_t& mode_costing,
+    const TravelMode mode,
+    const float max_matrix_distance) {
+  // Set the mode and costing
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+  cost_threshold_ = GetCostThreshold(max_matrix_distance);
+
+  Clear();
+  const uint32_t source_count = source_location_list.size();
+  const uint32_t target_count = target_location_list.size();
+  best_.assign(source_count * target_count, {std::numeric_limits<float>::infinity(), 0.f, 0.f});
+
+  // Leave each target in the bucket of every vertex up the hierarchy from it
+  for (uint32_t i = 0; i < target_count; i++) {
+    for (const auto& label : Search(false, graphreader, target_location_list.Get(i))) {
+      buckets_.push_back({label.vertex, i, label.cost, label.secs, label.length, label.percent});
+    }
+  }
+  std::sort(buckets_.begin(), buckets_.end(), [](const bucket_t& a, const bucket_t& b) {
+    return a.vertex < b.vertex || (a.vertex == b.vertex && a.target < b.target);
+  });
+  for (uint32_t i = 0; i < buckets_.size(); i++) {
+    bucket_index_.emplace(buckets_[i].vertex, i);
+  }
+
+  // Then connect each source to the targets in the buckets of every vertex up the hierarchy from
+  // it. A target behind the source on the same edge is left for later
+  std::vector<std::pair<uint32_t, uint32_t>> behind;
+  for (uint32_t i = 0; i < source_count; i++) {
+    auto* best = &best_[i * target_count];
+    for (const auto& label : Search(true, graphreader, source_location_list.Get(i))) {
+      auto found = bucket_index_.find(label.vertex);
+      if (found == bucket_index_.end()) {
+        continue;
+      }
+      for (auto bucket = buckets_.cbegin() + found->second;
+           bucket != buckets_.cend() && bucket->vertex == label.vertex; ++bucket) {
+        if (bucket->end < label.percent) {
+          behind.emplace_back(i, bucket->target);
+          continue;
+        }
+        auto cost = label.cost + bucket->cost;
+        if (cost < best[bucket->target].cost) {
+          best[bucket->target] = {cost, label.secs + bucket->secs, label.length + bucket->length};
+        }
+      }
+    }
+  }
+
+  // Form the time distance matrix. Any locations that are the same get 0 time and distance
+  std::vector<TimeDistance> td;
+  td.reserve(best_.size());
+  for (uint32_t i = 0; i < source_count; i++) {
+    for (uint32_t j = 0; j < target_count; j++) {
+      const auto& connection = best_[i * target_count + j];
+      if (equals(source_location_list.Get(i).ll(), target_location_list.Get(j).ll())) {
+        td.emplace_back(0, 0);
+      } else if (connection.cost == std::numeric_limits<float>::infinity()) {
+        td.emplace_back(kMaxCost, kMaxCost);
+      } else {
+        td.emplace_back(std::round(std::max(connection.secs, 0.f)),
+                        std::round(std::max(connection.length, 0.f)));
+      }
+    }
+  }
+
+  // The best path to a target behind the source on the same edge goes around the block, which
+  // the hierarchy cant represent (a vertex is only ever labeled once), so let CostMatrix do those
+  std::sort(behind.begin(), behind.end());
+  behind.erase(std::unique(behind.begin(), behind.end()), behind.end());
+  google::protobuf::RepeatedPtrField<valhalla::Location> source, target;
+  source.Add();
+  target.Add();
+  for (const auto& pair : behind) {
+    if (equals(source_location_list.Get(pair.first).ll(),
+               target_location_list.Get(pair.second).ll())) {
+      continue;
+    }
+    *source.Mutable(0) = source_location_list.Get(pair.first);
+    *target.Mutable(0) = target_location_list.Get(pair.second);
+    CostMatrix matrix;
+    td[pair.first * target_count + pair.second] =
+        matrix.SourceToTarget(source, target, graphreader, mode_costing, mode, max_matrix_distance)
+            .front();
+  }
+  LOG_DEBUG("BucketMatrix " + std::to_string(source_count) + "x" + std::to_string(target_count) +
+            " with " + std::to_string(buckets_.size()) + " bucket entries and " +
+            std::to_string(behind.size()) + " pairs on the same edge");
+  return td;
+}
+
+const std::vector<BucketMatrix::label_t>& BucketMatrix::Search(bool forward,
+                                                               GraphReader& graphreader,
+                                                               const valhalla::Location& location) {
+  labels_.clear();
+  queue_ = queue_t();
+  labeled_.clear();
+  settled_.clear();
+
+  // Only skip the edges the location is at the wrong end of if we have other options
+  bool has_other_edges = false;
+  for (const auto& edge : location.path_edges()) {
+    has_other_edges = has_other_edges || !(forward ? edge.end_node() : edge.begin_node());
+  }
+
+  for (const auto& edge : location.path_edges()) {
+    GraphId edgeid(edge.graph_id());
+    if ((has_other_edges && (forward ? edge.end_node() : edge.begin_node())) ||
+        (forward ? costing_->AvoidAsOriginEdge(edgeid, edge.percent_along())
+                 : costing_->AvoidAsDestinationEdge(edgeid, edge.percent_along()))) {
+      continue;
+    }
+    auto vertex = hierarchy_.vertex(edgeid);
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if (vertex == kInvalidVertex || !tile) {
+      continue;
+    }
+
+    // A source costs the rest of the edge plus the penalty for the distance from the input
+    // location. Arcs cost the whole edge they lead to so a target takes back the part after it
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    const float remainder = 1.0f - edge.percent_along();
+    Cost cost = costing_->EdgeCost(directededge, tile) * remainder;
+    float length = directededge->length() * remainder;
+    if (forward) {
+      Add({vertex, static_cast<float>(cost.cost + edge.distance()), cost.secs, length,
+           static_cast<float>(edge.percent_along())});
+    } else {
+      Add({vertex, static_cast<float>(edge.distance() - cost.cost), -cost.secs, -length,
+           static_cast<float>(edge.percent_along())});
+    }
+  }
+
+  // Settle everything up the hierarchy within the cost threshold
+  while (!queue_.empty()) {
+    auto cost = queue_.top().first;
+    auto idx = queue_.top().second;
+    queue_.pop();
+    const auto label = labels_[idx];
+    if (cost > label.cost) {
+      continue;
+    }
+    settled_.push_back(label);
+    if (label.secs > cost_threshold_) {
+      continue;
+    }
+    auto arcs = forward ? hierarchy_.up(label.vertex) : hierarchy_.down(label.vertex);
+    for (const auto& arc : arcs) {
+      Add({arc.vertex, label.cost + arc.cost, label.secs + arc.secs, label.length + arc.length,
+           forward ? 0.f : 1.f});
+    }
+  }
+  return settled_;
+}
+
+void BucketMatrix::Add(const label_t& label) {
+  auto inserted = labeled_.emplace(label.vertex, labels_.size());
+  if (inserted.second) {
+    labels_.push_back(label);
+  } else if (label.cost < labels_[inserted.first->second].cost) {
+    labels_[inserted.first->second] = label;
+  } else {
+    return;
+  }
+  queue_.emplace(label.cost, inserted.first->second);
+}
+
+} // namespace thor
+} // namespace valhalla
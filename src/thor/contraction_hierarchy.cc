@@ -0,0 +1,402 @@
+#include "thor/contraction_hierarchy.h"
+#include "midgard/logging.h"
+#include "proto_conversions.h"
+#include "sif/edgelabel.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+constexpr uint32_t kInvalidVertex = ContractionHierarchy::kInvalidVertex;
+constexpr uint32_t kForward = 0;
+constexpr uint32_t kReverse = 1;
+
+// the percent along the edge of whichever of the locations edges it is
+float percent_along(const valhalla::Location& location, const GraphId& edge_id) {
+  for (const auto& edge : location.path_edges()) {
+    if (edge.graph_id() == edge_id) {
+      return edge.percent_along();
+    }
+  }
+  throw std::logic_error("Could not find candidate edge used for the path");
+}
+
+// the score of whichever of the locations edges it is
+float distance(const valhalla::Location& location, const GraphId& edge_id) {
+  for (const auto& edge : location.path_edges()) {
+    if (edge.graph_id() == edge_id) {
+      return edge.distance();
+    }
+  }
+  return 0.f;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+ContractionHierarchyQuery::ContractionHierarchyQuery()
+    : PathAlgorithm(), mode_(TravelMode::kDrive) {
+}
+
+ContractionHierarchyQuery::~ContractionHierarchyQuery() {
+}
+
+bool ContractionHierarchyQuery::Load(const std::string& file, GraphReader& reader) {
+  explicit_profile_.clear();
+  if (!hierarchy_.Load(file, reader)) {
+    return false;
+  }
+
+  // the defaults of the costing may have changed since it was built
+  const auto costing = static_cast<Costing>(hierarchy_.costing());
+  if (hierarchy_.profile() != SerializeDefaultCostingOptions(costing)) {
+    LOG_WARN("Ignoring contraction hierarchy " + file + " built with other " +
+             Costing_Enum_Name(costing) + " costing defaults");
+    return false;
+  }
+  explicit_profile_ = SerializeDefaultCostingOptions(costing, "{}");
+  LOG_INFO("Mapped " + Costing_Enum_Name(costing) + " contraction hierarchy of " +
+           std::to_string(hierarchy_.vertex_count()) + " edges from " + file);
+  return true;
+}
+
+bool ContractionHierarchyQuery::Matches(const Options& options) const {
+  if (!hierarchy_ || explicit_profile_.empty() ||
+      options.costing() != static_cast<Costing>(hierarchy_.costing()) ||
+      options.costing() >= options.costing_options_size() ||
+      (options.has_alternates() && options.alternates() > 0)) {
+    return false;
+  }
+  const auto requested = options.costing_options(options.costing()).SerializeAsString();
+  return requested == hierarchy_.profile() || requested == explicit_profile_;
+}
+
+void ContractionHierarchyQuery::Clear() {
+  for (auto direction : {kForward, kReverse}) {
+    labels_[direction].clear();
+    queue_[direction] = queue_t();
+    labeled_[direction].clear();
+  }
+  has_ferry_ = false;
+}
+
+std::vector<std::vector<PathInfo>>
+ContractionHierarchyQuery::GetBestPath(valhalla::Location& origin,
+                                       valhalla::Location& dest,
+                                       GraphReader& graphreader,
+                                       const mode_costing_t& mode_costing,
+                                       const TravelMode mode,
+                                       const Options& /*options*/) {
+  Clear();
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode)];
+  if (!hierarchy_) {
+    return {};
+  }
+
+  // search up the hierarchy from both ends until neither can beat the best connection
+  SetOrigin(graphreader, origin);
+  SetDestination(graphreader, dest);
+  auto meet = Connect(graphreader, true);
+  if (meet == kInvalidVertex) {
+    return {};
+  }
+  auto path = FormPath(graphreader, meet, origin, dest);
+  if (path.empty()) {
+    return {};
+  }
+  return {std::move(path)};
+}
+
+std::vector<std::vector<PathInfo>>
+ContractionHierarchyQuery::GetBestPaths(valhalla::Location& origin,
+                                        google::protobuf::RepeatedPtrField<valhalla::Location>&
+                                            destinations,
+                                        GraphReader& graphreader,
+                                        const mode_costing_t& mode_costing,
+                                        const TravelMode mode) {
+  Clear();
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode)];
+  std::vector<std::vector<PathInfo>> paths(destinations.size());
+  if (!hierarchy_) {
+    return paths;
+  }
+
+  // everything up the hierarchy from the origin, once
+  SetOrigin(graphreader, origin);
+  while (!queue_[kForward].empty()) {
+    Settle(kForward, graphreader);
+  }
+
+  // and for each destination the search up from it until it cant beat the best connection
+  bool has_ferry = false;
+  for (int i = 0; i < destinations.size(); ++i) {
+    labels_[kReverse].clear();
+    queue_[kReverse] = queue_t();
+    labeled_[kReverse].clear();
+    SetDestination(graphreader, destinations.Get(i));
+    auto meet = Connect(graphreader, false);
+    if (meet != kInvalidVertex) {
+      paths[i] = FormPath(graphreader, meet, origin, destinations.Get(i));
+      has_ferry = has_ferry || has_ferry_;
+    }
+  }
+  has_ferry_ = has_ferry;
+  return paths;
+}
+
+void ContractionHierarchyQuery::SetOrigin(GraphReader& graphreader,
+                                          const valhalla::Location& origin) {
+  // Only skip inbound edges if we have other options
+  bool has_other_edges = false;
+  for (const auto& edge : origin.path_edges()) {
+    has_other_edges = has_other_edges || !edge.end_node();
+  }
+
+  for (const auto& edge : origin.path_edges()) {
+    GraphId edgeid(edge.graph_id());
+    if ((has_other_edges && edge.end_node()) ||
+        costing_->AvoidAsOriginEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+    auto vertex = hierarchy_.vertex(edgeid);
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if (vertex == kInvalidVertex || !tile) {
+      continue;
+    }
+
+    // the rest of the edge plus the penalty for the distance from the input location
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    Cost cost = costing_->EdgeCost(directededge, tile) * (1.0f - edge.percent_along());
+    Add(kForward, vertex, kInvalidLabel, kInvalidVertex, cost.cost + edge.distance());
+  }
+}
+
+void ContractionHierarchyQuery::SetDestination(GraphReader& graphreader,
+                                               const valhalla::Location& dest) {
+  // Only skip outbound edges if we have other options
+  bool has_other_edges = false;
+  for (const auto& edge : dest.path_edges()) {
+    has_other_edges = has_other_edges || !edge.begin_node();
+  }
+
+  std::vector<std::pair<uint32_t, float>> seeds;
+  for (const auto& edge : dest.path_edges()) {
+    GraphId edgeid(edge.graph_id());
+    if ((has_other_edges && edge.begin_node()) ||
+        costing_->AvoidAsDestinationEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+    auto vertex = hierarchy_.vertex(edgeid);
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if (vertex == kInvalidVertex || !tile) {
+      continue;
+    }
+
+    // arcs cost the whole edge they lead to so take back the part after the destination
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    Cost cost = costing_->EdgeCost(directededge, tile) * (1.0f - edge.percent_along());
+    seeds.emplace_back(vertex, edge.distance() - cost.cost);
+  }
+
+  // which can make the seeds negative, but a direction can only stop once it cant beat the best
+  // connection if the labels of the other are not. So they are all shifted by the same amount,
+  // which shifts every connection by it as well and doesnt change which one is the best
+  float shift = 0.f;
+  for (const auto& seed : seeds) {
+    shift = std::max(shift, -seed.second);
+  }
+  for (const auto& seed : seeds) {
+    Add(kReverse, seed.first, kInvalidLabel, kInvalidVertex, seed.second + shift);
+  }
+}
+
+void ContractionHierarchyQuery::Add(int direction,
+                                    uint32_t vertex,
+                                    uint32_t predecessor,
+                                    uint32_t middle,
+                                    float cost) {
+  auto& labels = labels_[direction];
+  auto inserted = labeled_[direction].emplace(vertex, labels.size());
+  if (inserted.second) {
+    labels.push_back({vertex, predecessor, middle, cost});
+  } else if (cost < labels[inserted.first->second].cost) {
+    labels[inserted.first->second] = {vertex, predecessor, middle, cost};
+  } else {
+    return;
+  }
+  queue_[direction].emplace(cost, inserted.first->second);
+}
+
+uint32_t ContractionHierarchyQuery::Settle(int direction, GraphReader& graphreader) {
+  // skip it if it was relabeled with a lower cost since it was queued
+  auto cost = queue_[direction].top().first;
+  auto idx = queue_[direction].top().second;
+  queue_[direction].pop();
+  const auto label = labels_[direction][idx];
+  if (cost > label.cost) {
+    return kInvalidLabel;
+  }
+
+  // Check for cancel
+  if (interrupt && labels_[direction].size() % kInterruptIterationsInterval == 0) {
+    (*interrupt)();
+  }
+  if (expansion_callback_) {
+    expansion_callback_(graphreader, name(), hierarchy_.edge(label.vertex), "s", false);
+  }
+
+  // only ever up the hierarchy
+  auto arcs = direction == kForward ? hierarchy_.up(label.vertex) : hierarchy_.down(label.vertex);
+  for (const auto& arc : arcs) {
+    Add(direction, arc.vertex, idx, arc.middle, label.cost + arc.cost);
+  }
+  return idx;
+}
+
+uint32_t ContractionHierarchyQuery::Connect(GraphReader& graphreader, bool forward_too) {
+  float best = std::numeric_limits<float>::infinity();
+  uint32_t meet = kInvalidVertex;
+  while (true) {
+    // neither direction can beat the best connection once it gets more expensive than it
+    bool forward = forward_too && !queue_[kForward].empty() && queue_[kForward].top().first < best;
+    bool reverse = !queue_[kReverse].empty() && queue_[kReverse].top().first < best;
+    if (!forward && !reverse) {
+      break;
+    }
+    int direction = forward && (!reverse || queue_[kForward].top().first <=
+                                                queue_[kReverse].top().first)
+                        ? kForward
+                        : kReverse;
+    auto idx = Settle(direction, graphreader);
+    if (idx == kInvalidLabel) {
+      continue;
+    }
+
+    // see if the other direction got here already
+    const auto& label = labels_[direction][idx];
+    auto other = labeled_[1 - direction].find(label.vertex);
+    if (other != labeled_[1 - direction].end()) {
+      auto cost = label.cost + labels_[1 - direction][other->second].cost;
+      if (cost < best) {
+        best = cost;
+        meet = label.vertex;
+      }
+    }
+  }
+  return meet;
+}
+
+void ContractionHierarchyQuery::Unpack(uint32_t from,
+                                       uint32_t to,
+                                       uint32_t middle,
+                                       std::vector<uint32_t>& vertices) const {
+  if (middle == kInvalidVertex) {
+    vertices.push_back(to);
+    return;
+  }
+  const auto* first = hierarchy_.find_arc(from, middle);
+  const auto* second = hierarchy_.find_arc(middle, to);
+  if (!first || !second) {
+    throw std::logic_error("Contraction hierarchy is missing the arcs of a shortcut");
+  }
+  Unpack(from, middle, first->middle, vertices);
+  Unpack(middle, to, second->middle, vertices);
+}
+
+std::vector<PathInfo> ContractionHierarchyQuery::FormPath(GraphReader& graphreader,
+                                                          uint32_t meet,
+                                                          const valhalla::Location& origin,
+                                                          const valhalla::Location& dest) {
+  // the forward search from the origin up to where it met the reverse search
+  std::vector<uint32_t> chain;
+  for (auto idx = labeled_[kForward][meet]; idx != kInvalidLabel;
+       idx = labels_[kForward][idx].predecessor) {
+    chain.push_back(idx);
+  }
+  std::vector<uint32_t> vertices{labels_[kForward][chain.back()].vertex};
+  for (auto idx = chain.rbegin() + 1; idx < chain.rend(); ++idx) {
+    const auto& label = labels_[kForward][*idx];
+    Unpack(vertices.back(), label.vertex, label.middle, vertices);
+  }
+
+  // and the reverse search from there back down to the destination
+  for (auto idx = labeled_[kReverse][meet]; labels_[kReverse][idx].predecessor != kInvalidLabel;
+       idx = labels_[kReverse][idx].predecessor) {
+    const auto& label = labels_[kReverse][idx];
+    Unpack(label.vertex, labels_[kReverse][label.predecessor].vertex, label.middle, vertices);
+  }
+
+  // cost the edges the same way A* would. the labels of the path are kept so that we can look
+  // for complex restrictions, which the hierarchy knows nothing about
+  std::vector<PathInfo> path;
+  path.reserve(vertices.size());
+  std::vector<EdgeLabel> labels;
+  labels.reserve(vertices.size());
+  Cost elapsed;
+  has_ferry_ = false;
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    GraphId edgeid = hierarchy_.edge(vertices[i]);
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    const DirectedEdge* edge = tile->directededge(edgeid);
+
+    // the turn onto this edge from the node it leaves, on its own level
+    Cost transition_cost;
+    if (i > 0) {
+      const auto& pred = labels.back();
+      GraphId node_id = pred.endnode();
+      if (node_id.level() != edgeid.level()) {
+        auto node_tile = graphreader.GetGraphTile(node_id);
+        for (const auto& transition : node_tile->GetNodeTransitions(node_id)) {
+          if (transition.endnode().level() == edgeid.level()) {
+            node_id = transition.endnode();
+            break;
+          }
+        }
+      }
+      if (edge->end_restriction() &&
+          costing_->Restricted(edge, pred, labels, tile, edgeid, true)) {
+        LOG_DEBUG("Contraction hierarchy path goes through a complex restriction");
+        return {};
+      }
+      transition_cost =
+          costing_->TransitionCost(edge, graphreader.GetGraphTile(node_id)->node(node_id), pred);
+    }
+
+    // the ends of the path only cost the part of the edge between the locations
+    float begin = i == 0 ? percent_along(origin, edgeid) : 0.f;
+    float end = i == vertices.size() - 1 ? percent_along(dest, edgeid) : 1.f;
+    if (end < begin) {
+      // the destination is behind the origin on the same edge, let A* go around the block
+      return {};
+    }
+    Cost cost = costing_->EdgeCost(edge, tile) * (end - begin);
+    if (i == 0) {
+      cost.cost += distance(origin, edgeid);
+    }
+    if (i == vertices.size() - 1) {
+      cost.cost += distance(dest, edgeid);
+    }
+    elapsed += transition_cost + cost;
+
+    path.emplace_back(mode_, elapsed, edgeid, 0, -1, transition_cost);
+    labels.emplace_back(i == 0 ? kInvalidLabel : i - 1, edgeid, edge, elapsed, elapsed.cost, 0.f,
+                        mode_, 0, transition_cost);
+    has_ferry_ = has_ferry_ || edge->use() == Use::kFerry;
+  }
+  return path;
+}
+
+} // namespace thor
+} // namespace valhalla
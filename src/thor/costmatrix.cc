@@ -1,5 +1,11 @@
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "midgard/logging.h"
@@ -33,10 +39,128 @@ namespace thor {
 
 class CostMatrix::TargetMap : public robin_hood::unordered_map<uint64_t, std::vector<uint32_t>> {};
 
+// The threads besides the calling one that the locations are stepped on. A step of a location is
+// a single edge, so a thread spins for a little while for the next step before it goes to sleep
+// until there is one. The graph reader and its tiles cannot be shared between threads, so each of
+// them reads the tiles with a reader of its own
+class CostMatrix::Threads {
+public:
+  using step_t = std::function<void(GraphReader& reader, uint32_t index)>;
+
+  Threads(const boost::property_tree::ptree& config, uint32_t thread_count)
+      : generation_(0), busy_(0), stop_(false), next_(0), count_(0), step_(nullptr) {
+    for (uint32_t thread = 1; thread < thread_count; ++thread) {
+      readers_.emplace_back(new GraphReader(config));
+    }
+    for (auto& reader : readers_) {
+      threads_.emplace_back([this, &reader]() { work(*reader); });
+    }
+  }
+
+  ~Threads() {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      stop_ = true;
+      generation_.fetch_add(1, std::memory_order_release);
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // steps all of the locations, those the calling thread takes with its reader, and returns once
+  // they are all done
+  void run(uint32_t count, GraphReader& reader, const step_t& step) {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      step_ = &step;
+      count_ = count;
+      next_.store(0, std::memory_order_relaxed);
+      busy_ = threads_.size();
+      generation_.fetch_add(1, std::memory_order_release);
+    }
+    wake_.notify_all();
+    steps(reader);
+    std::unique_lock<std::mutex> lock(lock_);
+    done_.wait(lock, [this]() { return busy_ == 0; });
+    if (error_) {
+      auto error = error_;
+      error_ = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+
+private:
+  void work(GraphReader& reader) {
+    uint64_t generation = 0;
+    while (true) {
+      // the steps of a matrix follow each other closely, between matrices the thread sleeps
+      for (uint32_t spins = 0;
+           spins < 1024 && generation_.load(std::memory_order_acquire) == generation; ++spins) {
+        std::this_thread::yield();
+      }
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        wake_.wait(lock, [this, generation]() {
+          return generation_.load(std::memory_order_relaxed) != generation;
+        });
+        generation = generation_.load(std::memory_order_relaxed);
+        if (stop_) {
+          return;
+        }
+      }
+      steps(reader);
+      {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (--busy_ > 0) {
+          continue;
+        }
+      }
+      done_.notify_one();
+    }
+  }
+
+  void steps(GraphReader& reader) {
+    for (uint32_t index; (index = next_.fetch_add(1, std::memory_order_relaxed)) < count_;) {
+      try {
+        (*step_)(reader, index);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (!error_) {
+          error_ = std::current_exception();
+        }
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<GraphReader>> readers_;
+  std::vector<std::thread> threads_;
+  std::mutex lock_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  std::atomic<uint64_t> generation_;
+  size_t busy_;
+  bool stop_;
+  std::atomic<uint32_t> next_;
+  uint32_t count_;
+  const step_t* step_;
+  std::exception_ptr error_;
+};
+
+std::shared_ptr<CostMatrix::Threads>
+CostMatrix::MakeThreads(const boost::property_tree::ptree& config, uint32_t thread_count) {
+  if (thread_count < 2) {
+    return nullptr;
+  }
+  return std::make_shared<Threads>(config, thread_count);
+}
+
 // Constructor with cost threshold.
-CostMatrix::CostMatrix()
-    : mode_(TravelMode::kDrive), access_mode_(kAutoAccess), source_count_(0), remaining_sources_(0),
-      target_count_(0), remaining_targets_(0), current_cost_threshold_(0), targets_{new TargetMap} {
+CostMatrix::CostMatrix(std::shared_ptr<Threads> threads)
+    : threads_(std::move(threads)), mode_(TravelMode::kDrive),
+      access_mode_(kAutoAccess), source_count_(0), remaining_sources_(0), target_count_(0),
+      remaining_targets_(0), current_cost_threshold_(0), targets_{new TargetMap} {
 }
 
 CostMatrix::~CostMatrix() {
@@ -104,6 +228,8 @@ void CostMatrix::Clear() {
   target_hierarchy_limits_.clear();
   source_status_.clear();
   target_status_.clear();
+  target_reached_.clear();
+  source_connected_.clear();
 }
 
 // Form a time distance matrix from the set of source locations
@@ -132,38 +258,46 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
   // location set.
   Initialize(source_location_list, target_location_list);
 
+  // The locations are stepped on as many threads as we have, each with its own reader
+  Threads* threads = std::max(source_count_, target_count_) > 1 ? threads_.get() : nullptr;
+  auto run = [&](uint32_t count, const Threads::step_t& step) {
+    if (threads) {
+      threads->run(count, graphreader, step);
+    } else {
+      for (uint32_t i = 0; i < count; i++) {
+        step(graphreader, i);
+      }
+    }
+  };
+
   // Perform backward search from all target locations. Perform forward
   // search from all source locations. Connections between the 2 search
   // spaces is checked during the forward search.
   int n = 0;
+  std::vector<uint8_t> target_exhausted(target_count_);
+  std::vector<uint8_t> source_exhausted(source_count_);
+  const Threads::step_t backward_step = [&](GraphReader& reader, uint32_t i) {
+    target_exhausted[i] = false;
+    if (target_status_[i].threshold > 0) {
+      target_status_[i].threshold--;
+      target_exhausted[i] = BackwardSearch(i, reader);
+    }
+  };
+  const Threads::step_t forward_step = [&](GraphReader& reader, uint32_t i) {
+    source_exhausted[i] = false;
+    if (source_status_[i].threshold > 0) {
+      source_status_[i].threshold--;
+      source_exhausted[i] = ForwardSearch(i, n, reader);
+    }
+  };
   while (true) {
     // Iterate all target locations in a backwards search
-    for (uint32_t i = 0; i < target_count_; i++) {
-      if (target_status_[i].threshold > 0) {
-        target_status_[i].threshold--;
-        BackwardSearch(i, graphreader);
-        if (target_status_[i].threshold == 0) {
-          target_status_[i].threshold = -1;
-          if (remaining_targets_ > 0) {
-            remaining_targets_--;
-          }
-        }
-      }
-    }
+    run(target_count_, backward_step);
+    FinishBackwardStep(target_exhausted);
 
     // Iterate all source locations in a forward search
-    for (uint32_t i = 0; i < source_count_; i++) {
-      if (source_status_[i].threshold > 0) {
-        source_status_[i].threshold--;
-        ForwardSearch(i, n, graphreader);
-        if (source_status_[i].threshold == 0) {
-          source_status_[i].threshold = -1;
-          if (remaining_sources_ > 0) {
-            remaining_sources_--;
-          }
-        }
-      }
-    }
+    run(source_count_, forward_step);
+    FinishForwardStep(source_exhausted);
 
     // Break out when remaining sources and targets to expand are both 0
     if (remaining_sources_ == 0 && remaining_targets_ == 0) {
@@ -223,6 +357,10 @@ void CostMatrix::Initialize(
     }
   }
 
+  // Nothing shared yet
+  target_reached_.resize(target_count_);
+  source_connected_.resize(source_count_);
+
   // Set the remaining number of sources and targets
   remaining_sources_ = 0;
   for (const auto& s : source_status_) {
@@ -239,26 +377,21 @@ void CostMatrix::Initialize(
 }
 
 // Iterate the forward search from the source/origin location.
-void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphReader& graphreader) {
-  // Get the next edge from the adjacency list for this source location
+bool CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphReader& graphreader) {
+  // Get the next edge from the adjacency list for this source location. If the
+  // forward search is exhausted the status gets updated once the step is over
   auto& adj = source_adjacency_[index];
   auto& edgelabels = source_edgelabel_[index];
   uint32_t pred_idx = adj->pop();
   if (pred_idx == kInvalidLabel) {
-    // Forward search is exhausted - mark this and update so we don't
-    // extend searches more than we need to
-    for (uint32_t target = 0; target < target_count_; target++) {
-      UpdateStatus(index, target);
-    }
-    source_status_[index].threshold = 0;
-    return;
+    return true;
   }
 
   // Get edge label and check cost threshold
   BDEdgeLabel pred = edgelabels[pred_idx];
   if (pred.cost().secs > current_cost_threshold_) {
     source_status_[index].threshold = 0;
-    return;
+    return false;
   }
 
   // Settle this edge
@@ -270,7 +403,7 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
 
   // Prune path if predecessor is not a through edge
   if (pred.not_thru() && pred.not_thru_pruning()) {
-    return;
+    return false;
   }
 
   // Get the end node of the prior directed edge. Do not expand on this
@@ -279,7 +412,7 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
   GraphId node = pred.endnode();
   auto& hierarchy_limits = source_hierarchy_limits_[index];
   if (hierarchy_limits[node.level()].StopExpanding()) {
-    return;
+    return false;
   }
 
   // lambda to expand search forward from the end node
@@ -385,6 +518,7 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
       expand(tile, node, nodeinfo, pred, pred_idx, false);
     }
   }
+  return false;
 }
 
 // Check if the edge on the forward search connects to a reached edge
@@ -423,8 +557,9 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
     const auto& edgestate = target_edgestatus_[target];
 
     // If this edge has been reached then a shortest path has been found
-    // to the end node of this directed edge.
-    EdgeStatusInfo oppedgestatus = edgestate.Get(oppedge);
+    // to the end node of this directed edge. Other sources may be looking
+    // at the same target at the same time so we only peek
+    EdgeStatusInfo oppedgestatus = edgestate.Peek(oppedge);
     if (oppedgestatus.set() != EdgeSet::kUnreachedOrReset) {
       const auto& edgelabels = target_edgelabel_[target];
       uint32_t predidx = edgelabels[oppedgestatus.index()].predecessor();
@@ -444,8 +579,9 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
         best_connection_[idx].found = true;
 
         // Update status and update threshold if this is the last location
-        // to find for this source or target
-        UpdateStatus(source, target);
+        // to find for this source or target (once the step is over)
+        UpdateSourceStatus(source, target);
+        source_connected_[source].emplace_back(target, source_edgelabel_[source].size());
       } else {
         float oppcost = (predidx == kInvalidLabel) ? 0 : edgelabels[predidx].cost().cost;
         float c = pred.cost().cost + oppcost + opp_el.transition_cost().cost;
@@ -466,8 +602,9 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
           }
 
           // Update status and update threshold if this is the last location
-          // to find for this source or target
-          UpdateStatus(source, target);
+          // to find for this source or target (once the step is over)
+          UpdateSourceStatus(source, target);
+          source_connected_[source].emplace_back(target, source_edgelabel_[source].size());
         }
       }
     }
@@ -476,6 +613,12 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
 // Update status when a connection is found.
 void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
+  UpdateSourceStatus(source, target);
+  UpdateTargetStatus(source, target, source_edgelabel_[source].size());
+}
+
+// Update the source status when a connection is found.
+void CostMatrix::UpdateSourceStatus(const uint32_t source, const uint32_t target) {
   // Remove the target from the source status
   auto& s = source_status_[source].remaining_locations;
   auto it = s.find(target);
@@ -488,42 +631,96 @@ void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
           GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
     }
   }
+}
 
+// Update the target status when a connection is found.
+void CostMatrix::UpdateTargetStatus(const uint32_t source,
+                                    const uint32_t target,
+                                    const size_t source_labels) {
   // Remove the source from the target status
   auto& t = target_status_[target].remaining_locations;
-  it = t.find(source);
+  auto it = t.find(source);
   if (it != t.end()) {
     t.erase(it);
     if (t.empty() && target_status_[target].threshold > 0) {
       // At least 1 connection has been found to each source for this target.
       // Set a threshold to continue search for a limited number of times.
       target_status_[target].threshold =
-          GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
+          GetThreshold(mode_, source_labels + target_edgelabel_[target].size());
+    }
+  }
+}
+
+// Apply what the targets shared during a step of the backward searches. Doing it in order of
+// target, after all of them stepped, gives the same result as stepping them one after another
+void CostMatrix::FinishBackwardStep(const std::vector<uint8_t>& exhausted) {
+  for (uint32_t i = 0; i < target_count_; i++) {
+    // Add to the list of targets that have reached these edges
+    for (const auto& edgeid : target_reached_[i]) {
+      (*targets_)[edgeid].push_back(i);
+    }
+    target_reached_[i].clear();
+
+    // Backward search is exhausted - mark this and update so we don't
+    // extend searches more than we need to
+    if (exhausted[i]) {
+      for (uint32_t source = 0; source < source_count_; source++) {
+        UpdateStatus(source, i);
+      }
+      target_status_[i].threshold = 0;
+    }
+
+    if (target_status_[i].threshold == 0) {
+      target_status_[i].threshold = -1;
+      if (remaining_targets_ > 0) {
+        remaining_targets_--;
+      }
+    }
+  }
+}
+
+// Apply what the sources shared during a step of the forward searches, in order of source
+void CostMatrix::FinishForwardStep(const std::vector<uint8_t>& exhausted) {
+  for (uint32_t i = 0; i < source_count_; i++) {
+    for (const auto& connected : source_connected_[i]) {
+      UpdateTargetStatus(i, connected.first, connected.second);
+    }
+    source_connected_[i].clear();
+
+    // Forward search is exhausted - mark this and update so we don't
+    // extend searches more than we need to
+    if (exhausted[i]) {
+      for (uint32_t target = 0; target < target_count_; target++) {
+        UpdateStatus(i, target);
+      }
+      source_status_[i].threshold = 0;
+    }
+
+    if (source_status_[i].threshold == 0) {
+      source_status_[i].threshold = -1;
+      if (remaining_sources_ > 0) {
+        remaining_sources_--;
+      }
     }
   }
 }
 
 // Expand the backwards search trees.
-void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader) {
-  // Get the next edge from the adjacency list for this target location
+bool CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader) {
+  // Get the next edge from the adjacency list for this target location. If the
+  // backward search is exhausted the status gets updated once the step is over
   auto& adj = target_adjacency_[index];
   auto& edgelabels = target_edgelabel_[index];
   uint32_t pred_idx = adj->pop();
   if (pred_idx == kInvalidLabel) {
-    // Backward search is exhausted - mark this and update so we don't
-    // extend searches more than we need to
-    for (uint32_t source = 0; source < source_count_; source++) {
-      UpdateStatus(source, index);
-    }
-    target_status_[index].threshold = 0;
-    return;
+    return true;
   }
 
   // Copy predecessor, check cost threshold
   BDEdgeLabel pred = edgelabels[pred_idx];
   if (pred.cost().secs > current_cost_threshold_) {
     target_status_[index].threshold = 0;
-    return;
+    return false;
   }
 
   // Settle this edge
@@ -532,7 +729,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
 
   // Prune path if predecessor is not a through edge
   if (pred.not_thru() && pred.not_thru_pruning()) {
-    return;
+    return false;
   }
 
   // Get the end node of the prior directed edge. Do not expand on this
@@ -541,7 +738,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
   GraphId node = pred.endnode();
   auto& hierarchy_limits = target_hierarchy_limits_[index];
   if (hierarchy_limits[node.level()].StopExpanding()) {
-    return;
+    return false;
   }
 
   // Expand from node in reverse direction.
@@ -622,8 +819,8 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
                               restriction_idx);
       adj->add(idx);
 
-      // Add to the list of targets that have reached this edge
-      (*targets_)[edgeid].push_back(index);
+      // Add to the list of targets that have reached this edge (once the step is over)
+      target_reached_[index].push_back(edgeid);
     }
 
     // Handle transitions - expand from the end node of the transition
@@ -665,6 +862,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
       expand(tile, node, nodeinfo, index, pred, pred_idx, opp_pred_edge, false);
     }
   }
+  return false;
 }
 
 // Sets the source/origin locations. Search expands forward from these
@@ -41,17 +41,20 @@ namespace thor {
 
 // Default constructor
 Dijkstras::Dijkstras()
-    : access_mode_(kAutoAccess), mode_(TravelMode::kDrive), adjacencylist_(nullptr) {
+    : access_mode_(kAutoAccess), mode_(TravelMode::kDrive), adjacencylist_(nullptr),
+      arena_(std::make_shared<SearchArena>()) {
 }
 
 // Clear the temporary information generated during path construction.
 void Dijkstras::Clear() {
-  // Clear the edge labels, edge status flags, and adjacency list
-  // TODO - clear only the edge label set that was used?
-  bdedgelabels_.clear();
-  mmedgelabels_.clear();
-  adjacencylist_.reset();
+  // Give the edge labels, edge status flags, and adjacency lists back to
+  // the arena for the next expansion
+  arena_->Release(bdedgelabels_);
+  arena_->Release(mmedgelabels_);
+  arena_->ReleaseQueue(adjacencylist_);
+  arena_->ReleaseQueue(mmadjacencylist_);
   edgestatus_.clear();
+  arena_->Trim();
 }
 
 // Initialize - create adjacency list, edgestatus support, and reserve
@@ -59,27 +62,29 @@ void Dijkstras::Clear() {
 template <typename label_container_t>
 void Dijkstras::Initialize(
     label_container_t& labels,
-    std::shared_ptr<baldr::DoubleBucketQueue<typename label_container_t::value_type>>& queue,
+    std::shared_ptr<baldr::LabelQueue<typename label_container_t::value_type>>& queue,
     const uint32_t bucket_size) {
-  // Set aside some space for edge labels
+  // Set aside some space for edge labels, taking what the arena has
   uint32_t edge_label_reservation;
   uint32_t bucket_count;
   GetExpansionHints(bucket_count, edge_label_reservation);
+  arena_->Acquire(labels);
+  labels.clear();
   labels.reserve(edge_label_reservation);
 
   // Set up lambda to get sort costs
   float range = bucket_count * bucket_size;
-  queue.reset(new baldr::DoubleBucketQueue<typename label_container_t::value_type>(0.0f, range,
-                                                                                   bucket_size,
-                                                                                   labels));
+  arena_->ReleaseQueue(queue);
+  queue = arena_->MakeQueue(0.0f, range, bucket_size, labels);
+  edgestatus_.set_arena(arena_);
 }
 template void Dijkstras::Initialize<decltype(Dijkstras::bdedgelabels_)>(
     decltype(Dijkstras::bdedgelabels_)&,
-    std::shared_ptr<baldr::DoubleBucketQueue<sif::BDEdgeLabel>>&,
+    std::shared_ptr<baldr::LabelQueue<sif::BDEdgeLabel>>&,
     const uint32_t);
 template void Dijkstras::Initialize<decltype(Dijkstras::mmedgelabels_)>(
     decltype(Dijkstras::mmedgelabels_)&,
-    std::shared_ptr<baldr::DoubleBucketQueue<sif::MMEdgeLabel>>&,
+    std::shared_ptr<baldr::LabelQueue<sif::MMEdgeLabel>>&,
     const uint32_t);
 
 // Initializes the time of the expansion if there is one
@@ -222,6 +227,8 @@ void Dijkstras::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>&
   auto time_infos = SetTime(origin_locations, graphreader);
 
   // Compute the isotile
+  const bool prefetch = graphreader.PrefetchEnabled();
+  GraphId frontier_tile;
   auto cb_decision = ExpansionRecommendation::continue_expansion;
   while (cb_decision != ExpansionRecommendation::stop_expansion) {
     // Get next element from adjacency list. Check that it is valid. An
@@ -238,6 +245,12 @@ void Dijkstras::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>&
     // Check if we should stop
     cb_decision = ShouldExpand(graphreader, pred, InfoRoutingType::forward);
     if (cb_decision != ExpansionRecommendation::prune_expansion) {
+      // Let the reader fetch the tiles around the frontier while we expand
+      if (prefetch && pred.endnode().Tile_Base() != frontier_tile) {
+        frontier_tile = pred.endnode().Tile_Base();
+        graphreader.PrefetchNeighbors(frontier_tile);
+      }
+
       // Expand from the end node in forward direction.
       ExpandForward(graphreader, pred.endnode(), pred, predindex, false, time_infos.front());
     }
@@ -374,6 +387,8 @@ void Dijkstras::ComputeReverse(google::protobuf::RepeatedPtrField<valhalla::Loca
   auto time_infos = SetTime(dest_locations, graphreader);
 
   // Compute the isotile
+  const bool prefetch = graphreader.PrefetchEnabled();
+  GraphId frontier_tile;
   auto cb_decision = ExpansionRecommendation::continue_expansion;
   while (cb_decision != ExpansionRecommendation::stop_expansion) {
     // Get next element from adjacency list. Check that it is valid. An
@@ -395,6 +410,12 @@ void Dijkstras::ComputeReverse(google::protobuf::RepeatedPtrField<valhalla::Loca
     // Check if we should stop
     cb_decision = ShouldExpand(graphreader, pred, InfoRoutingType::forward);
     if (cb_decision != ExpansionRecommendation::prune_expansion) {
+      // Let the reader fetch the tiles around the frontier while we expand
+      if (prefetch && pred.endnode().Tile_Base() != frontier_tile) {
+        frontier_tile = pred.endnode().Tile_Base();
+        graphreader.PrefetchNeighbors(frontier_tile);
+      }
+
       // Expand from the end node in forward direction.
       ExpandReverse(graphreader, pred.endnode(), pred, predindex, opp_pred_edge, false,
                     time_infos.front());
@@ -136,8 +136,12 @@ void Isochrone::ConstructIsoTile(const bool multimodal,
   AABB2<PointLL> bounds(loc_bounds.minx() - dlon, loc_bounds.miny() - dlat, loc_bounds.maxx() + dlon,
                         loc_bounds.maxy() + dlat);
 
-  // Create isotile (gridded data)
-  isotile_.reset(new GriddedData<2>(bounds, grid_size, {max_minutes, max_km}));
+  // Create isotile (gridded data), the last one is laid out anew if nobody holds on to it anymore
+  if (isotile_ && isotile_.use_count() == 1) {
+    isotile_->Reset(bounds, grid_size, {max_minutes, max_km});
+  } else {
+    isotile_.reset(new GriddedData<2>(bounds, grid_size, {max_minutes, max_km}));
+  }
 
   // Find the center of the grid that the location lies within. Shift the
   // tilebounds so the location lies in the center of a tile.
@@ -1,3 +1,7 @@
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 #include "midgard/util.h"
 #include "thor/worker.h"
 #include "tyr/serializers.h"
@@ -5,18 +9,10 @@
 using namespace valhalla::baldr;
 using namespace valhalla::midgard;
 
-namespace valhalla {
-namespace thor {
-
-std::string thor_worker_t::isochrones(Api& request) {
-  // time this whole method and save that statistic
-  auto _ = measure_scope_time(request, "thor_worker_t::isochrones");
-
-  parse_locations(request);
-  auto costing = parse_costing(request);
-  auto& options = *request.mutable_options();
+namespace {
 
-  // name of the metric (time/distance, value, color)
+// name of the metric (time/distance, value, color)
+std::vector<GriddedData<2>::contour_interval_t> parse_contours(const valhalla::Options& options) {
   std::vector<GriddedData<2>::contour_interval_t> contours;
   for (const auto& contour : options.contours()) {
     if (contour.has_time()) {
@@ -26,6 +22,22 @@ std::string thor_worker_t::isochrones(Api& request) {
       contours.emplace_back(1, contour.distance(), "distance", contour.color());
     }
   }
+  return contours;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+std::string thor_worker_t::isochrones(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request, "thor_worker_t::isochrones");
+
+  parse_locations(request);
+  auto costing = parse_costing(request);
+  auto& options = *request.mutable_options();
+  auto contours = parse_contours(options);
 
   // If no generalization is requested an optimal factor is computed (based on the isotile grid size).
   if (!options.has_generalize()) {
@@ -40,13 +52,94 @@ std::string thor_worker_t::isochrones(Api& request) {
   // we have parallel vectors of contour properties and the actual geojson features
   // this method sorts the contour specifications by metric (time or distance) and then by value
   // with the largest values coming first. eg (60min, 30min, 10min, 40km, 10km)
-  auto isolines =
-      grid->GenerateContours(contours, options.polygons(), options.denoise(), options.generalize());
+  auto isolines = grid->GenerateContours(contours, options.polygons(), options.denoise(),
+                                         options.generalize(), contour_threads);
 
   // make the final json
   return tyr::serializeIsochrones(request, contours, isolines, options.polygons(),
                                   options.show_locations());
 }
 
+std::string thor_worker_t::batch_isochrones(Api& request, const isochrone_callback_t& on_isochrone) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request, "thor_worker_t::batch_isochrones");
+
+  parse_locations(request);
+  auto costing = parse_costing(request);
+  auto& options = *request.mutable_options();
+  const auto contours = parse_contours(options);
+  const bool multimodal = costing == "multimodal" || costing == "transit";
+  if (!options.has_generalize()) {
+    options.set_generalize(kOptimalGeneralization);
+  }
+
+  // Every isochrone is computed from a request of its own with only its location in it
+  Api batch;
+  batch.mutable_options()->CopyFrom(options);
+  batch.mutable_options()->clear_locations();
+
+  // The worker and its isochrone threads take the next location that is left until none are. Each
+  // of them expands with the same isochrone, and so the same labels and isotile, every time
+  const size_t count = options.locations_size();
+  std::vector<std::string> isochrones(count);
+  std::atomic<size_t> next(0);
+  std::mutex done_lock;
+  std::exception_ptr error;
+  auto compute = [&](Isochrone& isochrone, GraphReader& reader,
+                     const sif::mode_costing_t& mode_costing, const sif::TravelMode mode) {
+    try {
+      for (size_t i = next++; i < count; i = next++) {
+        Api api(batch);
+        api.mutable_options()->add_locations()->CopyFrom(options.locations(i));
+        auto grid = multimodal ? isochrone.ComputeMultiModal(api, reader, mode_costing, mode)
+                               : isochrone.Compute(api, reader, mode_costing, mode);
+        auto intervals = contours;
+        auto isolines = grid->GenerateContours(intervals, options.polygons(), options.denoise(),
+                                               options.generalize());
+        grid.reset();
+        isochrone.Clear();
+        auto json = tyr::serializeIsochrones(api, intervals, isolines, options.polygons(),
+                                             options.show_locations());
+
+        // hand it out as soon as it is done
+        std::lock_guard<std::mutex> lock(done_lock);
+        if (on_isochrone) {
+          on_isochrone(i, json);
+        }
+        isochrones[i] = std::move(json);
+      }
+    } catch (...) {
+      // the others stop after the isochrone they are on
+      std::lock_guard<std::mutex> lock(done_lock);
+      if (!error) {
+        error = std::current_exception();
+      }
+      next = count;
+    }
+  };
+
+  const auto thread_count = std::min(isochrone_threads.size() + 1, count);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i + 1 < thread_count; ++i) {
+    auto& thread = *isochrone_threads[i];
+    // a request that is given up on stops their tile loads as well as those of the worker
+    thread.reader->SetInterrupt(interrupt);
+    sif::TravelMode thread_mode;
+    thread.mode_costing = factory.CreateModeCosting(options, thread_mode);
+    threads.emplace_back(compute, std::ref(thread.isochrone), std::ref(*thread.reader),
+                         std::cref(thread.mode_costing), thread_mode);
+  }
+  compute(isochrone_gen, *reader, mode_costing, mode);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  // make the final json
+  return tyr::serializeBatchIsochrones(request, isochrones);
+}
+
 } // namespace thor
 } // namespace valhalla
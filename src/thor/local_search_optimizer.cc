@@ -0,0 +1,323 @@
+#include "thor/local_search_optimizer.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+namespace {
+
+// Moves have to gain at least this much so rounding can not keep the search going
+constexpr double kMinGain = 1e-4;
+
+// The longest run of locations Or-opt moves elsewhere in the tour
+constexpr uint32_t kMaxOrOptLength = 3;
+
+// The tour along with where each location is in it and the cost of the tour up to each position,
+// both ways, so that reversing part of the tour is costed in constant time
+struct tour_state_t {
+  std::vector<uint32_t>& tour;
+  std::vector<uint32_t> position;
+  std::vector<double> forward;  // cost from the start to each position
+  std::vector<double> backward; // cost from each position back to the start
+
+  tour_state_t(std::vector<uint32_t>& tour)
+      : tour(tour), position(tour.size()), forward(tour.size()), backward(tour.size()) {
+  }
+
+  template <typename problem_t> void update(const problem_t& problem) {
+    forward[0] = backward[0] = 0.0;
+    position[tour[0]] = 0;
+    for (uint32_t i = 1; i < tour.size(); ++i) {
+      position[tour[i]] = i;
+      forward[i] = forward[i - 1] + problem.cost(tour[i - 1], tour[i]);
+      backward[i] = backward[i - 1] + problem.cost(tour[i], tour[i - 1]);
+    }
+  }
+};
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+LocalSearchOptimizer::LocalSearchOptimizer(const uint32_t thread_count,
+                                           const uint32_t starts,
+                                           const uint32_t max_time,
+                                           const uint32_t neighbors)
+    : thread_count_(std::max(thread_count, 1u)), starts_(std::max(starts, 1u)),
+      max_time_(max_time), neighbors_(std::max(neighbors, 1u)) {
+}
+
+// Optimize the tour through a set of locations given the cost matrix
+// among all locations. The first location (origin) and last location
+// (destination) remain fixed in the tour.
+std::vector<uint32_t> LocalSearchOptimizer::Solve(const uint32_t count,
+                                                  const std::vector<float>& costs) const {
+  // Handle trivial cases.
+  std::vector<uint32_t> identity(count);
+  std::iota(identity.begin(), identity.end(), 0);
+  if (count <= 3) {
+    return identity;
+  }
+
+  // Sort the other locations of each location by how close they are either way and keep the
+  // nearest of them
+  problem_t problem{count, costs};
+  problem.neighbor_count = std::min(neighbors_, count - 1);
+  problem.neighbors.reserve(count * problem.neighbor_count);
+  problem.limited = max_time_ > 0;
+  problem.deadline = clock_t::now() + std::chrono::milliseconds(max_time_);
+  std::vector<uint32_t> others;
+  for (uint32_t i = 0; i < count; ++i) {
+    others.clear();
+    for (uint32_t j = 0; j < count; ++j) {
+      if (j != i) {
+        others.push_back(j);
+      }
+    }
+    auto nearness = [&problem, i](const uint32_t j) {
+      return std::min(problem.cost(i, j), problem.cost(j, i));
+    };
+    std::partial_sort(others.begin(), others.begin() + problem.neighbor_count, others.end(),
+                      [&nearness](const uint32_t a, const uint32_t b) {
+                        return nearness(a) < nearness(b);
+                      });
+    problem.neighbors.insert(problem.neighbors.end(), others.begin(),
+                             others.begin() + problem.neighbor_count);
+  }
+
+  // The threads take the next start that is left until none are or the time is up, every start
+  // but the first is randomized by a generator seeded with its index
+  std::vector<std::vector<uint32_t>> tours(starts_);
+  std::vector<double> tour_costs(starts_, std::numeric_limits<double>::max());
+  std::atomic<uint32_t> next(0);
+  std::mutex error_lock;
+  std::exception_ptr error;
+  auto run = [&]() {
+    try {
+      for (uint32_t start = next++; start < starts_; start = next++) {
+        if (start > 0 && problem.expired()) {
+          break;
+        }
+        std::mt19937 random(start);
+        tours[start] = Construct(problem, start == 0 ? nullptr : &random);
+        tour_costs[start] = Improve(problem, tours[start]);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_lock);
+      if (!error) {
+        error = std::current_exception();
+      }
+      next = starts_;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (uint32_t i = 1; i < std::min(thread_count_, starts_); ++i) {
+    threads.emplace_back(run);
+  }
+  run();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  // The cheapest tour wins, the earliest start among equally cheap ones
+  auto best = std::min_element(tour_costs.begin(), tour_costs.end()) - tour_costs.begin();
+  LOG_DEBUG("Best tour cost = " + std::to_string(tour_costs[best]) + " from start " +
+            std::to_string(best));
+  return tours[best];
+}
+
+// Builds a tour by nearest or random insertion
+std::vector<uint32_t> LocalSearchOptimizer::Construct(const problem_t& problem,
+                                                      std::mt19937* random) {
+  const uint32_t count = problem.count;
+  std::vector<uint32_t> tour{0, count - 1};
+  tour.reserve(count);
+
+  // The locations that are left to insert and how close each of them is to the tour so far
+  std::vector<uint32_t> left(count - 2);
+  std::iota(left.begin(), left.end(), 1);
+  if (random) {
+    std::shuffle(left.begin(), left.end(), *random);
+  }
+  std::vector<float> nearness(count, std::numeric_limits<float>::max());
+  auto update_nearness = [&problem, &nearness](const uint32_t in_tour) {
+    for (uint32_t i = 0; i < problem.count; ++i) {
+      nearness[i] =
+          std::min(nearness[i], std::min(problem.cost(i, in_tour), problem.cost(in_tour, i)));
+    }
+  };
+  update_nearness(0);
+  update_nearness(count - 1);
+
+  while (!left.empty()) {
+    // Take the nearest location, or the next one in the random order
+    auto next = left.end() - 1;
+    if (!random) {
+      next = std::min_element(left.begin(), left.end(),
+                              [&nearness](const uint32_t a, const uint32_t b) {
+                                return nearness[a] < nearness[b];
+                              });
+    }
+    const uint32_t location = *next;
+    *next = left.back();
+    left.pop_back();
+
+    // Insert it between the two locations it adds the least cost between
+    uint32_t best = 0;
+    double best_cost = std::numeric_limits<double>::max();
+    for (uint32_t i = 0; i + 1 < tour.size(); ++i) {
+      double cost = static_cast<double>(problem.cost(tour[i], location)) +
+                    problem.cost(location, tour[i + 1]) - problem.cost(tour[i], tour[i + 1]);
+      if (cost < best_cost) {
+        best_cost = cost;
+        best = i;
+      }
+    }
+    tour.insert(tour.begin() + best + 1, location);
+    if (!random) {
+      update_nearness(location);
+    }
+  }
+  return tour;
+}
+
+// Improves the tour with 2-opt and Or-opt moves
+double LocalSearchOptimizer::Improve(const problem_t& problem, std::vector<uint32_t>& tour) {
+  const uint32_t count = problem.count;
+  tour_state_t state(tour);
+  state.update(problem);
+
+  // Reversing the locations from l to r, which never include the first or the last, changes the
+  // two connections around them and the direction of all of the connections between them
+  auto reverse_gain = [&problem, &state, &tour](const uint32_t l, const uint32_t r) {
+    return problem.cost(tour[l - 1], tour[l]) + problem.cost(tour[r], tour[r + 1]) -
+           problem.cost(tour[l - 1], tour[r]) - problem.cost(tour[l], tour[r + 1]) +
+           (state.forward[r] - state.forward[l]) - (state.backward[r] - state.backward[l]);
+  };
+
+  // 2-opt, each move connects a location to one of its neighbors
+  auto two_opt = [&]() {
+    bool improved = false;
+    for (uint32_t p = 0; p < count && !problem.expired(); ++p) {
+      const auto* neighbors = &problem.neighbors[tour[p] * problem.neighbor_count];
+      for (uint32_t n = 0; n < problem.neighbor_count; ++n) {
+        const uint32_t q = state.position[neighbors[n]];
+        uint32_t l = 0, r = 0;
+        if (q > p + 1 && q < count - 1) {
+          // the neighbor comes right after the location
+          l = p + 1;
+          r = q;
+        } else if (q + 1 < p && p < count - 1) {
+          // the location comes right after the neighbor
+          l = q + 1;
+          r = p;
+        } else {
+          continue;
+        }
+        if (reverse_gain(l, r) > kMinGain) {
+          std::reverse(tour.begin() + l, tour.begin() + r + 1);
+          state.update(problem);
+          improved = true;
+        }
+      }
+    }
+    return improved;
+  };
+
+  // Or-opt, moves a run of up to three locations, either way around, next to a neighbor of one
+  // of its ends
+  auto or_opt = [&]() {
+    bool improved = false;
+    for (uint32_t length = 1; length <= kMaxOrOptLength; ++length) {
+      for (uint32_t i = 1; i + length < count && !problem.expired(); ++i) {
+        const uint32_t j = i + length - 1;
+        const double inner_forward = state.forward[j] - state.forward[i];
+        const double inner_backward = state.backward[j] - state.backward[i];
+        const double removed = problem.cost(tour[i - 1], tour[i]) + inner_forward +
+                               problem.cost(tour[j], tour[j + 1]) -
+                               problem.cost(tour[i - 1], tour[j + 1]);
+
+        // Find the best place to put it
+        double best_gain = kMinGain;
+        uint32_t best_at = 0;
+        bool best_reversed = false;
+        for (const uint32_t end : {tour[i], tour[j]}) {
+          const auto* neighbors = &problem.neighbors[end * problem.neighbor_count];
+          for (uint32_t n = 0; n < problem.neighbor_count; ++n) {
+            const uint32_t q = state.position[neighbors[n]];
+            for (const uint32_t at : {q - 1, q}) {
+              // between at and at + 1, which can not be in the run or next to it on both sides
+              if (q == 0 && at == q - 1) {
+                continue;
+              }
+              if (at + 1 >= count || (at + 1 >= i && at <= j)) {
+                continue;
+              }
+              const uint32_t x = tour[at], y = tour[at + 1];
+              const double forward = problem.cost(x, tour[i]) + inner_forward +
+                                     problem.cost(tour[j], y) - problem.cost(x, y);
+              const double backward = problem.cost(x, tour[j]) + inner_backward +
+                                      problem.cost(tour[i], y) - problem.cost(x, y);
+              if (removed - forward > best_gain) {
+                best_gain = removed - forward;
+                best_at = at;
+                best_reversed = false;
+              }
+              if (removed - backward > best_gain) {
+                best_gain = removed - backward;
+                best_at = at;
+                best_reversed = true;
+              }
+            }
+          }
+        }
+        if (best_gain == kMinGain) {
+          continue;
+        }
+
+        // Move it
+        std::vector<uint32_t> run(tour.begin() + i, tour.begin() + j + 1);
+        if (best_reversed) {
+          std::reverse(run.begin(), run.end());
+        }
+        tour.erase(tour.begin() + i, tour.begin() + j + 1);
+        const uint32_t at = best_at < i ? best_at : best_at - length;
+        tour.insert(tour.begin() + at + 1, run.begin(), run.end());
+        state.update(problem);
+        improved = true;
+      }
+    }
+    return improved;
+  };
+
+  // Keep going until neither kind of move helps anymore
+  bool improved = true;
+  while (improved && !problem.expired()) {
+    improved = two_opt();
+    improved = or_opt() || improved;
+  }
+  return state.forward[count - 1];
+}
+
+// Get the cost for the specified tour (order of locations).
+double LocalSearchOptimizer::TourCost(const std::vector<float>& costs,
+                                      const std::vector<uint32_t>& tour) {
+  double c = 0;
+  const size_t count = tour.size();
+  for (size_t i = 0; i + 1 < count; i++) {
+    c += costs[(tour[i] * count) + tour[i + 1]];
+  }
+  return c;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -1,6 +1,7 @@
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancematrix.h"
 #include "thor/worker.h"
@@ -41,7 +42,7 @@ std::string thor_worker_t::matrix(Api& request) {
   // do the real work
   std::vector<TimeDistance> time_distances;
   auto costmatrix = [&]() {
-    thor::CostMatrix matrix;
+    thor::CostMatrix matrix(costmatrix_threads);
     return matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
                                  max_matrix_distance.find(costing)->second);
   };
@@ -50,6 +51,29 @@ std::string thor_worker_t::matrix(Api& request) {
     return matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
                                  max_matrix_distance.find(costing)->second);
   };
+
+  // A matrix departing at a time is expanded forward from every source at that time, on the speeds
+  // the edges have when they are reached. Only the first source got the time when parsing
+  const bool time_dependent =
+      time_dependent_matrix && options.has_date_time() &&
+      (options.date_time_type() == Options::current ||
+       options.date_time_type() == Options::depart_at) &&
+      (source_to_target_algorithm == SELECT_OPTIMAL ||
+       source_to_target_algorithm == TIME_DISTANCE_MATRIX);
+  if (time_dependent) {
+    auto sources = options.sources();
+    for (auto& source : sources) {
+      if (!source.has_date_time()) {
+        source.set_date_time(options.date_time());
+      }
+    }
+    thor::TimeDistanceMatrix matrix;
+    time_distances =
+        matrix.TimeDependentSourceToTarget(sources, options.targets(), *reader, mode_costing, mode,
+                                           max_matrix_distance.find(costing)->second);
+    return tyr::serializeMatrix(request, time_distances, distance_scale);
+  }
+
   switch (source_to_target_algorithm) {
     case SELECT_OPTIMAL:
       // TODO - Do further performance testing to pick the best algorithm for the job
@@ -78,6 +102,17 @@ std::string thor_worker_t::matrix(Api& request) {
     case TIME_DISTANCE_MATRIX:
       time_distances = timedistancematrix();
       break;
+    case BUCKET_MATRIX:
+      // The buckets are only right for the profile the contraction hierarchy was built for
+      if (ch_query.Matches(options)) {
+        thor::BucketMatrix matrix(ch_query.hierarchy());
+        time_distances =
+            matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing,
+                                  mode, max_matrix_distance.find(costing)->second);
+      } else {
+        time_distances = costmatrix();
+      }
+      break;
   }
   return tyr::serializeMatrix(request, time_distances, distance_scale);
 }
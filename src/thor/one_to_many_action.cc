@@ -0,0 +1,59 @@
+#include "midgard/logging.h"
+#include "thor/timedistancematrix.h"
+#include "thor/worker.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace valhalla {
+namespace thor {
+
+void thor_worker_t::one_to_many(Api& request) {
+  // time this whole method and save that statistic
+  auto _ = measure_scope_time(request, "thor_worker_t::one_to_many");
+
+  parse_locations(request);
+  parse_filter_attributes(request);
+  auto costing = parse_costing(request);
+  auto& options = *request.mutable_options();
+
+  // One expansion from the origin finds the paths to all of the destinations, or as many of them
+  // as it gets to within the budget
+  TimeDistanceMatrix matrix;
+  auto paths =
+      matrix.OneToManyPaths(options.sources(0), options.targets(), *reader, mode_costing, mode,
+                            max_matrix_distance.find(costing)->second, options.budget());
+
+  // Each destination that was found gets a route of its own, in the order they were given in
+  const std::vector<std::string> algorithms{"time_distance_matrix"};
+  auto& routes = *request.mutable_trip()->mutable_routes();
+  routes.Reserve(options.targets_size());
+  for (int i = 0; i < options.targets_size(); ++i) {
+    const auto& path = paths[i];
+    if (path.empty()) {
+      LOG_DEBUG("No path to destination " + std::to_string(i) + " within the budget");
+      continue;
+    }
+    auto origin = options.sources(0);
+    auto destination = options.targets(i);
+    auto& leg = *routes.Add()->mutable_legs()->Add();
+    TripLegBuilder::Build(options, controller, *reader, mode_costing, path.begin(), path.end(),
+                          origin, destination, {}, leg, algorithms, interrupt);
+  }
+
+  // Nothing at all is a failure, the destinations that were found show which ones they are through
+  // the original index of their location
+  if (routes.empty()) {
+    throw valhalla_exception_t{442};
+  }
+
+  // The routes share the origin so the locations are the origin followed by the destinations
+  options.mutable_locations()->Clear();
+  options.mutable_locations()->Add()->CopyFrom(options.sources(0));
+  options.mutable_locations()->MergeFrom(options.targets());
+}
+
+} // namespace thor
+} // namespace valhalla
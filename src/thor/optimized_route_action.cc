@@ -27,7 +27,7 @@ void thor_worker_t::optimized_route(Api& request) {
   auto& options = *request.mutable_options();
 
   // Use CostMatrix to find costs from each location to every other location
-  CostMatrix costmatrix;
+  CostMatrix costmatrix(costmatrix_threads);
   std::vector<thor::TimeDistance> td =
       costmatrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
                                 max_matrix_distance.find(costing)->second);
@@ -52,9 +52,9 @@ void thor_worker_t::optimized_route(Api& request) {
     time_costs.emplace_back(static_cast<float>(td[i].time));
   }
 
-  Optimizer optimizer;
   // returns the optimal order of the path_locations
-  auto optimal_order = optimizer.Solve(correlated.size(), time_costs);
+  auto optimal_order = optimize_by_annealing ? Optimizer().Solve(correlated.size(), time_costs)
+                                             : optimizer.Solve(correlated.size(), time_costs);
   // put the optimal order into the locations array
   options.mutable_locations()->Clear();
   for (size_t i = 0; i < optimal_order.size(); i++) {
@@ -1,5 +1,8 @@
 #include "thor/worker.h"
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <thread>
 
 #include "baldr/json.h"
 #include "baldr/rapidjson_utils.h"
@@ -187,6 +190,7 @@ std::string thor_worker_t::expansion(Api& request) {
            &timedep_reverse,
            &bidir_astar,
            &bss_astar,
+           &ch_query,
        }) {
     alg->set_track_expansion(track_expansion);
   }
@@ -205,6 +209,7 @@ std::string thor_worker_t::expansion(Api& request) {
            &timedep_reverse,
            &bidir_astar,
            &bss_astar,
+           &ch_query,
        }) {
     alg->set_track_expansion(nullptr);
   }
@@ -222,11 +227,32 @@ void thor_worker_t::route(Api& request) {
   auto costing = parse_costing(request);
   auto& options = *request.mutable_options();
 
+  // a route found before for the same correlated locations and options doesnt need a search
+  std::string cache_key;
+  bool cached = false;
+  if (route_cache) {
+    route_cache->CheckTraffic(*reader);
+    cache_key = RouteCache::MakeKey(request);
+    cached = route_cache->Get(cache_key, request);
+    auto* stat = request.mutable_info()->mutable_statistics()->Add();
+    stat->set_name("thor_worker_t::route_cache_hit");
+    stat->set_value(cached ? 1 : 0);
+  }
+
   // get all the legs
-  if (options.has_date_time_type() && options.date_time_type() == Options::arrive_by) {
-    path_arrive_by(request, costing);
-  } else {
-    path_depart_at(request, costing);
+  if (!cached) {
+    // speeds published while searching may have gone into part of the route, it isnt kept if the
+    // cache has seen them by then and is dropped with the rest of the routes once it does
+    const uint64_t traffic_epoch = route_cache ? route_cache->traffic_epoch() : 0;
+    if (options.has_date_time_type() && options.date_time_type() == Options::arrive_by) {
+      path_arrive_by(request, costing);
+    } else {
+      path_depart_at(request, costing);
+    }
+    if (route_cache) {
+      route_cache->CheckTraffic(*reader);
+      route_cache->Put(cache_key, request, traffic_epoch);
+    }
   }
   // log admin areas
   if (!options.do_not_track()) {
@@ -238,28 +264,30 @@ void thor_worker_t::route(Api& request) {
   }
 }
 
-thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routetype,
+thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const path_context_t& context,
+                                                       const std::string& routetype,
                                                        const valhalla::Location& origin,
                                                        const valhalla::Location& destination,
                                                        const Options& options) {
   // make sure they are all cancelable
   for (auto* alg : std::vector<PathAlgorithm*>{
-           &multi_modal_astar,
-           &timedep_forward,
-           &timedep_reverse,
-           &bidir_astar,
-           &bss_astar,
+           &context.timedep_forward,
+           &context.timedep_reverse,
+           &context.bidir_astar,
+           &context.ch_query,
        }) {
-    alg->set_interrupt(interrupt);
+    alg->set_interrupt(context.interrupt);
   }
 
   // Have to use multimodal for transit based routing
   if (routetype == "multimodal" || routetype == "transit") {
+    multi_modal_astar.set_interrupt(interrupt);
     return &multi_modal_astar;
   }
 
   // Have to use bike share station algorithm
   if (routetype == "bikeshare") {
+    bss_astar.set_interrupt(interrupt);
     return &bss_astar;
   }
 
@@ -269,7 +297,7 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
     PointLL ll1(origin.ll().lng(), origin.ll().lat());
     PointLL ll2(destination.ll().lng(), destination.ll().lat());
     if (ll1.Distance(ll2) < max_timedep_distance) {
-      return &timedep_forward;
+      return &context.timedep_forward;
     }
   }
 
@@ -279,7 +307,7 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
     PointLL ll1(origin.ll().lng(), origin.ll().lat());
     PointLL ll2(destination.ll().lng(), destination.ll().lat());
     if (ll1.Distance(ll2) < max_timedep_distance) {
-      return &timedep_reverse;
+      return &context.timedep_reverse;
     }
   }
 
@@ -290,29 +318,56 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
   for (auto& edge1 : origin.path_edges()) {
     for (auto& edge2 : destination.path_edges()) {
       if (edge1.graph_id() == edge2.graph_id() ||
-          reader->AreEdgesConnected(GraphId(edge1.graph_id()), GraphId(edge2.graph_id()))) {
-        return &timedep_forward;
+          context.reader.AreEdgesConnected(GraphId(edge1.graph_id()),
+                                           GraphId(edge2.graph_id()))) {
+        return &context.timedep_forward;
       }
     }
   }
 
+  // Use the contraction hierarchy if the request is for the profile it was contracted for
+  if (context.ch_query.Matches(options)) {
+    return &context.ch_query;
+  }
+
   // No other special cases we land on bidirectional a*
-  return &bidir_astar;
+  return &context.bidir_astar;
 }
 
-std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm* path_algorithm,
+std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(const path_context_t& context,
+                                                                 PathAlgorithm* path_algorithm,
                                                                  valhalla::Location& origin,
                                                                  valhalla::Location& destination,
                                                                  const std::string& costing,
                                                                  const Options& options) {
+  // the reader, costing and algorithms of whichever thread finds this leg
+  auto& reader = context.reader;
+  auto& mode_costing = context.mode_costing;
+  auto& bidir_astar = context.bidir_astar;
+  auto& ch_query = context.ch_query;
+
   // Find the path. If bidirectional A* disable use of destination only edges on the
-  // first pass. If there is a failure, we allow them on the second pass.
+  // first pass. If there is a failure, we allow them on the second pass. Every leg starts from
+  // the costing as it was made, the same costing finds the legs one after the other
   valhalla::sif::cost_ptr_t cost = mode_costing[static_cast<uint32_t>(mode)];
+  cost->set_pass(0);
+  cost->set_allow_destination_only(true);
+
+  // The contraction hierarchy either has the path or we fall back to bidirectional A*
+  if (path_algorithm == &ch_query) {
+    auto paths = ch_query.GetBestPath(origin, destination, reader, mode_costing, mode, options);
+    if (!paths.empty()) {
+      return paths;
+    }
+    LOG_DEBUG("Contraction hierarchy found no path, falling back to bidirectional A*");
+    ch_query.Clear();
+    path_algorithm = &bidir_astar;
+  }
+
   if (path_algorithm == &bidir_astar) {
     cost->set_allow_destination_only(false);
   }
-  cost->set_pass(0);
-  auto paths = path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+  auto paths = path_algorithm->GetBestPath(origin, destination, reader, mode_costing, mode, options);
 
   // Check if we should run a second pass pedestrian route with different A*
   // (to look for better routes where a ferry is taken)
@@ -334,7 +389,8 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
     origin.mutable_path_edges()->MergeFrom(origin.filtered_edges());
     destination.mutable_path_edges()->MergeFrom(destination.filtered_edges());
 
-    path_algorithm->Clear();
+    const float astar_factor = cost->AStarCostFactor();
+    const auto hierarchy_limits = cost->GetHierarchyLimits();
     cost->set_pass(1);
     // since bidir does about half the expansion we can do half the relaxation here
     float relax_factor = path_algorithm == &bidir_astar ? 8.f : 16.f;
@@ -342,9 +398,20 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
     cost->RelaxHierarchyLimits(relax_factor, expansion_within_factor);
     cost->set_allow_destination_only(true);
 
+    // Bidirectional A* carries on from where it found no path, as long as the second pass keeps
+    // the heuristic its labels are sorted by. Anything else starts over. Carrying on keeps what
+    // the first pass settled, detours included, so it is faster but not always optimal
+    const bool resume = path_algorithm == &bidir_astar && paths.empty() &&
+                        bidir_astar.CanResume() && cost->AStarCostFactor() == astar_factor;
+    if (!resume) {
+      path_algorithm->Clear();
+    }
+
     // Get the best path. Return if not empty (else return the original path)
-    auto relaxed_paths =
-        path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+    auto relaxed_paths = resume ? bidir_astar.Resume(origin, destination, reader, options)
+                                : path_algorithm->GetBestPath(origin, destination, reader,
+                                                              mode_costing, mode, options);
+    cost->GetHierarchyLimits() = hierarchy_limits;
     if (!relaxed_paths.empty()) {
       return relaxed_paths;
     }
@@ -357,6 +424,104 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
   return paths;
 }
 
+std::vector<std::vector<thor::PathInfo>> thor_worker_t::leg_result_t::take_paths() {
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return std::move(paths);
+}
+
+std::unordered_map<size_t, thor_worker_t::leg_result_t>
+thor_worker_t::find_independent_legs(Api& api, const std::string& costing, bool arrive_by) {
+  std::unordered_map<size_t, leg_result_t> results;
+  const auto& options = api.options();
+  auto& correlated = *api.mutable_options()->mutable_locations();
+  if (leg_threads.empty() || correlated.size() < 3 || costing == "multimodal" ||
+      costing == "transit" || costing == "bikeshare") {
+    return results;
+  }
+
+  // Unless the times do not matter each leg leaves when the one before it arrives (or arrives when
+  // the one after it leaves) so they have to be found one after the other
+  if (options.date_time_type() != Options::invariant &&
+      std::any_of(correlated.begin(), correlated.end(),
+                  [](const valhalla::Location& location) { return location.has_date_time(); })) {
+    return results;
+  }
+
+  // A leg leaving a through location has to continue on the edge the leg before it ended on (or
+  // arriving at one, on the edge the leg after it starts on). The other legs are independent
+  std::vector<size_t> legs;
+  for (int leg = 0; leg < correlated.size() - 1; ++leg) {
+    const auto type = correlated.Get(arrive_by ? leg + 1 : leg).type();
+    if (type != valhalla::Location::kThrough && type != valhalla::Location::kBreakThrough) {
+      legs.push_back(leg);
+    }
+  }
+  if (legs.size() < 2) {
+    return results;
+  }
+
+  // The legs are found with copies of their locations since they can change them and every thread
+  // has costing of its own as the passes of a search change it
+  std::vector<std::pair<valhalla::Location, valhalla::Location>> locations;
+  locations.reserve(legs.size());
+  for (auto leg : legs) {
+    locations.emplace_back(correlated.Get(leg), correlated.Get(leg + 1));
+  }
+  std::vector<leg_result_t> found(legs.size());
+  const auto thread_count = std::min(leg_threads.size() + 1, legs.size());
+  for (size_t i = 0; i + 1 < thread_count; ++i) {
+    auto leg_mode = mode;
+    leg_threads[i]->mode_costing = factory.CreateModeCosting(options, leg_mode);
+  }
+
+  // The worker and its leg threads take the next leg that is left until none are
+  std::atomic<size_t> next(0);
+  auto find = [&](path_context_t context) {
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < legs.size();) {
+      auto& result = found[i];
+      try {
+        auto* path_algorithm = get_path_algorithm(context, costing, locations[i].first,
+                                                  locations[i].second, options);
+        path_algorithm->Clear();
+        result.algorithm = path_algorithm->name();
+        result.paths = get_path(context, path_algorithm, locations[i].first, locations[i].second,
+                                costing, options);
+      } catch (...) {
+        // the others stop after the leg they are on since the route fails anyway
+        result.error = std::current_exception();
+        next = legs.size();
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i + 1 < thread_count; ++i) {
+    threads.emplace_back(find, leg_threads[i]->context());
+  }
+  find(context());
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // A second pass adds the filtered edges to the candidates of the locations of its leg, which the
+  // legs found after it would have seen as well
+  for (size_t i = 0; i < legs.size(); ++i) {
+    // a leg left alone after another failed is found the usual way, should the route get to it
+    if (found[i].algorithm.empty() && !found[i].error) {
+      continue;
+    }
+    for (auto* location : {&locations[i].first, &locations[i].second}) {
+      auto& original = *correlated.Mutable(legs[i] + (location == &locations[i].first ? 0 : 1));
+      if (location->path_edges_size() > original.path_edges_size()) {
+        *original.mutable_path_edges() = location->path_edges();
+      }
+    }
+    results.emplace(legs[i], std::move(found[i]));
+  }
+  return results;
+}
+
 void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
   // Things we'll need
   TripRoute* route = nullptr;
@@ -367,15 +532,24 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
   std::vector<std::string> algorithms;
   api.mutable_trip()->mutable_routes()->Reserve(api.options().alternates() + 1);
 
+  // The legs that do not depend on the ones after them can be found up front on more threads
+  auto independent_legs = find_independent_legs(api, costing, true);
+
   // For each pair of locations
   for (auto origin = ++correlated.rbegin(); origin != correlated.rend(); ++origin) {
     // Get the algorithm type for this location pair
     auto destination = std::prev(origin);
-    thor::PathAlgorithm* path_algorithm =
-        get_path_algorithm(costing, *origin, *destination, api.options());
-    path_algorithm->Clear();
-    algorithms.push_back(path_algorithm->name());
-    LOG_INFO(std::string("algorithm::") + path_algorithm->name());
+    auto independent_leg =
+        independent_legs.find(std::distance(correlated.begin(), origin.base()) - 1);
+    thor::PathAlgorithm* path_algorithm = nullptr;
+    if (independent_leg == independent_legs.end()) {
+      path_algorithm = get_path_algorithm(context(), costing, *origin, *destination, api.options());
+      path_algorithm->Clear();
+      algorithms.push_back(path_algorithm->name());
+    } else {
+      algorithms.push_back(independent_leg->second.algorithm);
+    }
+    LOG_INFO("algorithm::" + algorithms.back());
 
     // TODO: delete this and send all cases to the function above
     // If we are continuing through a location we need to make sure we
@@ -390,7 +564,10 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
     }
 
     // Get best path and keep it
-    auto temp_paths = get_path(path_algorithm, *origin, *destination, costing, api.options());
+    auto temp_paths = independent_leg == independent_legs.end()
+                          ? get_path(context(), path_algorithm, *origin, *destination, costing,
+                                     api.options())
+                          : independent_leg->second.take_paths();
     for (auto& temp_path : temp_paths) {
       // back propagate time information
       if (destination->has_date_time() &&
@@ -474,15 +651,23 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
   std::vector<std::string> algorithms;
   api.mutable_trip()->mutable_routes()->Reserve(api.options().alternates() + 1);
 
+  // The legs that do not depend on the ones before them can be found up front on more threads
+  auto independent_legs = find_independent_legs(api, costing, false);
+
   // For each pair of locations
   for (auto destination = ++correlated.begin(); destination != correlated.end(); ++destination) {
     // Get the algorithm type for this location pair
     auto origin = std::prev(destination);
-    thor::PathAlgorithm* path_algorithm =
-        get_path_algorithm(costing, *origin, *destination, api.options());
-    path_algorithm->Clear();
-    algorithms.push_back(path_algorithm->name());
-    LOG_INFO(std::string("algorithm::") + path_algorithm->name());
+    auto independent_leg = independent_legs.find(std::distance(correlated.begin(), origin));
+    thor::PathAlgorithm* path_algorithm = nullptr;
+    if (independent_leg == independent_legs.end()) {
+      path_algorithm = get_path_algorithm(context(), costing, *origin, *destination, api.options());
+      path_algorithm->Clear();
+      algorithms.push_back(path_algorithm->name());
+    } else {
+      algorithms.push_back(independent_leg->second.algorithm);
+    }
+    LOG_INFO("algorithm::" + algorithms.back());
 
     // TODO: delete this and send all cases to the function above
     // If we are continuing through a location we need to make sure we
@@ -497,7 +682,10 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
     }
 
     // Get best path and keep it
-    auto temp_paths = get_path(path_algorithm, *origin, *destination, costing, api.options());
+    auto temp_paths = independent_leg == independent_legs.end()
+                          ? get_path(context(), path_algorithm, *origin, *destination, costing,
+                                     api.options())
+                          : independent_leg->second.take_paths();
     for (auto& temp_path : temp_paths) {
       // forward propagate time information
       if (origin->has_date_time() && api.options().date_time_type() != valhalla::Options::invariant) {
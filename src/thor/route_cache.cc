@@ -0,0 +1,239 @@
+#include "thor/route_cache.h"
+#include "midgard/logging.h"
+
+#include <cmath>
+
+namespace {
+
+template <typename T> void append(std::string& key, const T& value) {
+  key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Puts what thor worked out for a location of the cached route into a copy of the location of the
+// request, whose inputs are what the response should echo back
+void restore(const valhalla::Location& input, valhalla::Location& cached) {
+  valhalla::Location location(input);
+  location.mutable_path_edges()->Swap(cached.mutable_path_edges());
+  location.mutable_filtered_edges()->Swap(cached.mutable_filtered_edges());
+  if (cached.has_date_time()) {
+    location.set_date_time(cached.date_time());
+  } else {
+    location.clear_date_time();
+  }
+  location.Swap(&cached);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+constexpr size_t RouteCache::kDefaultMaxEntries;
+constexpr size_t RouteCache::kDefaultMaxBytes;
+constexpr uint32_t RouteCache::kDefaultTtl;
+constexpr uint32_t RouteCache::kDefaultTrafficCheckInterval;
+constexpr double RouteCache::kPercentAlongSteps;
+
+RouteCache::RouteCache(size_t max_entries,
+                       size_t max_bytes,
+                       uint32_t ttl,
+                       uint32_t traffic_check_interval)
+    : max_entries_(max_entries), max_bytes_(max_bytes), ttl_(ttl),
+      traffic_check_interval_(traffic_check_interval), bytes_(0), traffic_epoch_(0),
+      traffic_checked_(false) {
+}
+
+std::shared_ptr<RouteCache> RouteCache::get_instance(const boost::property_tree::ptree& config) {
+  if (!config.get<bool>("thor.route_cache.enabled", false)) {
+    return nullptr;
+  }
+
+  // the workers reading the same tiles and traffic share the cache that was made for them first
+  const auto tiles = config.get<std::string>("mjolnir.tile_extract", "") + '\n' +
+                     config.get<std::string>("mjolnir.tile_dir", "") + '\n' +
+                     config.get<std::string>("mjolnir.traffic_extract", "");
+  static std::mutex caches_lock;
+  static std::unordered_map<std::string, std::weak_ptr<RouteCache>> caches;
+  std::lock_guard<std::mutex> lock(caches_lock);
+  auto cache = caches[tiles].lock();
+  if (!cache) {
+    cache = std::make_shared<RouteCache>(
+        config.get<size_t>("thor.route_cache.max_entries", kDefaultMaxEntries),
+        config.get<size_t>("thor.route_cache.max_size_mb", kDefaultMaxBytes / (1024 * 1024)) *
+            1024 * 1024,
+        config.get<uint32_t>("thor.route_cache.ttl", kDefaultTtl),
+        config.get<uint32_t>("thor.route_cache.traffic_check_interval",
+                             kDefaultTrafficCheckInterval));
+    caches[tiles] = cache;
+  }
+  return cache;
+}
+
+std::string RouteCache::MakeKey(const Api& request) {
+  // the options that go into the search, leaving out the locations and what only changes how the
+  // response is written
+  Options options(request.options());
+  options.clear_locations();
+  options.clear_id();
+  options.clear_jsonp();
+  options.clear_format();
+  options.clear_units();
+  options.clear_language();
+  options.clear_directions_type();
+  const auto serialized = options.SerializeAsString();
+  std::string key;
+  append(key, static_cast<uint64_t>(serialized.size()));
+  key += serialized;
+
+  // and the edges the locations were correlated to
+  for (const auto& location : request.options().locations()) {
+    append(key, static_cast<int32_t>(location.type()));
+    append(key, static_cast<uint64_t>(location.date_time().size()));
+    key += location.date_time();
+    for (const auto* edges : {&location.path_edges(), &location.filtered_edges()}) {
+      append(key, static_cast<int32_t>(edges->size()));
+      for (const auto& edge : *edges) {
+        append(key, edge.graph_id());
+        append(key, std::llround(edge.percent_along() * kPercentAlongSteps));
+        append(key, std::llround(edge.distance()));
+        append(key, static_cast<int32_t>(edge.side_of_street()));
+        append(key, static_cast<uint8_t>(edge.begin_node() | edge.end_node() << 1));
+      }
+    }
+  }
+  return key;
+}
+
+bool RouteCache::Get(const std::string& key, Api& request) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto entry = entries_.find(key);
+  if (entry == entries_.end()) {
+    ++stats_.misses;
+    return false;
+  }
+  if (ttl_.count() > 0 && now() - entry->second.inserted > ttl_) {
+    Erase(entry);
+    ++stats_.expirations;
+    ++stats_.misses;
+    return false;
+  }
+  lru_.splice(lru_.begin(), lru_, entry->second.lru);
+  ++stats_.hits;
+
+  // the locations of the legs are those of the request on the edges the route took
+  auto& locations = *request.mutable_options()->mutable_locations();
+  *request.mutable_trip() = entry->second.trip;
+  for (auto& route : *request.mutable_trip()->mutable_routes()) {
+    for (auto& leg : *route.mutable_legs()) {
+      for (auto& location : *leg.mutable_location()) {
+        if (location.has_original_index() &&
+            location.original_index() < static_cast<uint32_t>(locations.size())) {
+          restore(locations.Get(location.original_index()), location);
+        }
+      }
+    }
+  }
+
+  // and so are the locations of the request
+  for (int i = 0; i < locations.size() && i < entry->second.locations.size(); ++i) {
+    valhalla::Location location(entry->second.locations.Get(i));
+    restore(locations.Get(i), location);
+    locations.Mutable(i)->Swap(&location);
+  }
+  return true;
+}
+
+void RouteCache::Put(const std::string& key, const Api& request, uint64_t traffic_epoch) {
+  size_t bytes = key.size() + request.trip().ByteSizeLong();
+  for (const auto& location : request.options().locations()) {
+    bytes += location.ByteSizeLong();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (traffic_epoch != traffic_epoch_) {
+    return;
+  }
+  auto existing = entries_.find(key);
+  if (existing != entries_.end()) {
+    Erase(existing);
+  }
+  if (max_entries_ == 0 || bytes > max_bytes_) {
+    return;
+  }
+
+  // make room by dropping the least recently used routes
+  while (!lru_.empty() && (entries_.size() >= max_entries_ || bytes_ + bytes > max_bytes_)) {
+    Erase(entries_.find(lru_.back()));
+    ++stats_.evictions;
+  }
+
+  lru_.push_front(key);
+  auto& entry = entries_[key];
+  entry.trip = request.trip();
+  entry.locations = request.options().locations();
+  entry.inserted = now();
+  entry.bytes = bytes;
+  entry.lru = lru_.begin();
+  bytes_ += bytes;
+}
+
+void RouteCache::CheckTraffic(const baldr::GraphReader& reader) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto time = now();
+    if (traffic_checked_ && time - last_traffic_check_ < traffic_check_interval_) {
+      return;
+    }
+    last_traffic_check_ = time;
+    traffic_checked_ = true;
+  }
+  // summing up the epochs of the traffic tiles doesnt need the lock
+  SetTrafficEpoch(reader.GetTrafficEpoch());
+}
+
+void RouteCache::SetTrafficEpoch(uint64_t epoch) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (epoch == traffic_epoch_) {
+    return;
+  }
+  if (!entries_.empty()) {
+    LOG_DEBUG("Live traffic changed, dropping " + std::to_string(entries_.size()) +
+              " cached routes");
+    stats_.invalidations += entries_.size();
+    entries_.clear();
+    lru_.clear();
+    bytes_ = 0;
+  }
+  traffic_epoch_ = epoch;
+}
+
+uint64_t RouteCache::traffic_epoch() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return traffic_epoch_;
+}
+
+void RouteCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  lru_.clear();
+  bytes_ = 0;
+}
+
+RouteCache::stats_t RouteCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+size_t RouteCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void RouteCache::Erase(std::unordered_map<std::string, entry_t>::iterator entry) {
+  bytes_ -= entry->second.bytes;
+  lru_.erase(entry->second.lru);
+  entries_.erase(entry);
+}
+
+} // namespace thor
+} // namespace valhalla
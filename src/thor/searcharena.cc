@@ -0,0 +1,60 @@
+#include "thor/searcharena.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+
+namespace valhalla {
+namespace thor {
+
+constexpr uint32_t SearchArena::kDefaultWindow;
+constexpr size_t SearchArena::kDefaultMaxRetainedBytes;
+
+SearchArena::SearchArena(uint32_t window, size_t max_retained_bytes, baldr::QueueType queue_type)
+    : window_(std::max(window, 1u)), max_retained_bytes_(max_retained_bytes), released_(false),
+      queue_type_(queue_type) {
+}
+
+void SearchArena::Trim() {
+  // its only a round if some search gave back its storage since the last one
+  if (!released_) {
+    return;
+  }
+  released_ = false;
+
+  // keep no more of each kind of storage than the most any round in the window used
+  size_t trimmed = 0;
+  for (auto& kv : pools_) {
+    auto& pool = *kv.second;
+    pool.recent.push_back(pool.used);
+    pool.used = 0;
+    if (pool.recent.size() > window_) {
+      pool.recent.pop_front();
+    }
+    const auto high_water = *std::max_element(pool.recent.begin(), pool.recent.end());
+    if (pool.retained > high_water) {
+      trimmed += pool.trim(high_water);
+    }
+  }
+  stats_.retained_bytes -= trimmed;
+
+  // and no more of all of it than the limit
+  for (auto& kv : pools_) {
+    if (stats_.retained_bytes <= max_retained_bytes_) {
+      break;
+    }
+    auto& pool = *kv.second;
+    const auto over = stats_.retained_bytes - max_retained_bytes_;
+    const auto given_back = pool.trim(pool.retained > over ? pool.retained - over : 0);
+    stats_.retained_bytes -= given_back;
+    trimmed += given_back;
+  }
+
+  if (trimmed > 0) {
+    stats_.trimmed_bytes += trimmed;
+    LOG_DEBUG("Search arena gave back " + std::to_string(trimmed) + " bytes and keeps " +
+              std::to_string(stats_.retained_bytes));
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -33,12 +33,13 @@ TimeDepForward::~TimeDepForward() {
 
 // Clear the temporary information generated during path construction.
 void TimeDepForward::Clear() {
-  // Clear the edge labels and destination list. Reset the adjacency list
-  // and clear edge status.
-  edgelabels_.clear();
+  // Give the edge labels, adjacency list and edge status back to the arena
+  // for the next search and clear the destination list.
+  arena_->Release(edgelabels_);
   destinations_percent_along_.clear();
-  adjacencylist_.reset();
+  arena_->ReleaseQueue(adjacencylist_);
   edgestatus_.clear();
+  arena_->Trim();
 
   // Set the ferry flag to false
   has_ferry_ = false;
@@ -88,10 +89,10 @@ bool TimeDepForward::ExpandForward(GraphReader& graphreader,
     // If so, it means we are attempting a u-turn. In that case, lets wait with evaluating
     // this edge until last. If any other edges were emplaced, it means we should not
     // even try to evaluate a u-turn since u-turns should only happen for deadends
-    uturn_meta = pred.opp_local_idx() == meta.edge->localedgeidx() ? meta : uturn_meta;
+    uturn_meta = pred.opp_local_idx() == meta.localedgeidx() ? meta : uturn_meta;
 
     // Expand but only if this isnt the uturn, we'll try that later if nothing else works out
-    disable_uturn = (pred.opp_local_idx() != meta.edge->localedgeidx() &&
+    disable_uturn = (pred.opp_local_idx() != meta.localedgeidx() &&
                      ExpandForwardInner(graphreader, pred, nodeinfo, pred_idx, meta, tile,
                                         offset_time, destination, best_path)) ||
                     disable_uturn;
@@ -164,7 +165,7 @@ inline bool TimeDepForward::ExpandForwardInner(GraphReader& graphreader,
   // Skip shortcut edges for time dependent routes, if no access is allowed to this edge
   // (based on costing method)
   int restriction_idx = -1;
-  if (meta.edge->is_shortcut() ||
+  if (meta.is_shortcut() || !meta.accessible(*costing_) ||
       !costing_->Allowed(meta.edge, pred, tile, meta.edge_id, time_info.local_time,
                          nodeinfo->timezone(), restriction_idx) ||
       costing_->Restricted(meta.edge, pred, edgelabels_, tile, meta.edge_id, true, &edgestatus_,
@@ -367,16 +368,21 @@ void TimeDepForward::Init(const midgard::PointLL& origll, const midgard::PointLL
   // Get the initial cost based on A* heuristic from origin
   float mincost = astarheuristic_.Get(origll);
 
-  // Reserve size for edge labels - do this here rather than in constructor so
-  // to limit how much extra memory is used for persistent objects.
+  // Take the edge labels from the arena, reserving size for them if it had
+  // none - do this here rather than in constructor so to limit how much extra
+  // memory is used for persistent objects.
   // TODO - reserve based on estimate based on distance and route type.
+  arena_->Acquire(edgelabels_);
+  edgelabels_.clear();
   edgelabels_.reserve(kInitialEdgeLabelCount);
 
   // Construct adjacency list, clear edge status.
   // Set bucket size and cost range based on DynamicCost.
   uint32_t bucketsize = costing_->UnitSize();
   float range = kBucketCount * bucketsize;
-  adjacencylist_.reset(new DoubleBucketQueue<EdgeLabel>(mincost, range, bucketsize, edgelabels_));
+  arena_->ReleaseQueue(adjacencylist_);
+  adjacencylist_ = arena_->MakeQueue(mincost, range, bucketsize, edgelabels_);
+  edgestatus_.set_arena(arena_);
   edgestatus_.clear();
 
   // Get hierarchy limits from the costing. Get a copy since we increment
@@ -32,9 +32,9 @@ TimeDepReverse::~TimeDepReverse() {
 }
 
 void TimeDepReverse::Clear() {
+  arena_->Release(edgelabels_rev_);
+  arena_->ReleaseQueue(adjacencylist_rev_);
   TimeDepForward::Clear();
-  edgelabels_rev_.clear();
-  adjacencylist_rev_.reset();
 }
 
 // Initialize prior to finding best path
@@ -46,17 +46,21 @@ void TimeDepReverse::Init(const midgard::PointLL& origll, const midgard::PointLL
   // Get the initial cost based on A* heuristic from destination
   float mincost = astarheuristic_.Get(destll);
 
-  // Reserve size for edge labels - do this here rather than in constructor so
-  // to limit how much extra memory is used for persistent objects.
+  // Take the edge labels from the arena, reserving size for them if it had
+  // none - do this here rather than in constructor so to limit how much extra
+  // memory is used for persistent objects.
   // TODO - reserve based on estimate based on distance and route type.
+  arena_->Acquire(edgelabels_rev_);
+  edgelabels_rev_.clear();
   edgelabels_rev_.reserve(kInitialEdgeLabelCount);
 
   // Construct adjacency list, clear edge status.
   // Set bucket size and cost range based on DynamicCost.
   uint32_t bucketsize = costing_->UnitSize();
   float range = kBucketCount * bucketsize;
-  adjacencylist_rev_.reset(
-      new DoubleBucketQueue<BDEdgeLabel>(mincost, range, bucketsize, edgelabels_rev_));
+  arena_->ReleaseQueue(adjacencylist_rev_);
+  adjacencylist_rev_ = arena_->MakeQueue(mincost, range, bucketsize, edgelabels_rev_);
+  edgestatus_.set_arena(arena_);
   edgestatus_.clear();
 
   // Get hierarchy limits from the costing. Get a copy since we increment
@@ -107,10 +111,10 @@ bool TimeDepReverse::ExpandReverse(GraphReader& graphreader,
     // If so, it means we are attempting a u-turn. In that case, lets wait with evaluating
     // this edge until last. If any other edges were emplaced, it means we should not
     // even try to evaluate a u-turn since u-turns should only happen for deadends
-    uturn_meta = pred.opp_local_idx() == meta.edge->localedgeidx() ? meta : uturn_meta;
+    uturn_meta = pred.opp_local_idx() == meta.localedgeidx() ? meta : uturn_meta;
 
     // Expand but only if this isnt the uturn, we'll try that later if nothing else works out
-    disable_uturn = (pred.opp_local_idx() != meta.edge->localedgeidx() &&
+    disable_uturn = (pred.opp_local_idx() != meta.localedgeidx() &&
                      ExpandReverseInner(graphreader, pred, opp_pred_edge, nodeinfo, pred_idx, meta,
                                         tile, offset_time, destination, best_path)) ||
                     disable_uturn;
@@ -179,7 +183,7 @@ inline bool TimeDepReverse::ExpandReverseInner(GraphReader& graphreader,
 
   // Skip shortcut edges for time dependent routes. Also skip this edge if permanently labeled (best
   // path already found to this directed edge) or if no access for this mode.
-  if (meta.edge->is_shortcut() || !(meta.edge->reverseaccess() & access_mode_)) {
+  if (meta.is_shortcut() || !(meta.reverseaccess() & access_mode_)) {
     return false;
   }
   // Skip this edge if permanently labeled (best path already found to this
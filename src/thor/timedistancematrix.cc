@@ -22,6 +22,15 @@ static bool IsTrivial(const uint64_t& edgeid,
   }
   return false;
 }
+
+// The cost of the edge at the time, or at no particular time if the time is invalid
+inline Cost EdgeCostAt(const DynamicCost& costing,
+                       const DirectedEdge* edge,
+                       const graph_tile_ptr& tile,
+                       const TimeInfo& time_info) {
+  return time_info.valid ? costing.EdgeCost(edge, tile, time_info.second_of_week)
+                         : costing.EdgeCost(edge, tile);
+}
 } // namespace
 namespace valhalla {
 namespace thor {
@@ -68,7 +77,8 @@ void TimeDistanceMatrix::ExpandForward(GraphReader& graphreader,
                                        const GraphId& node,
                                        const EdgeLabel& pred,
                                        const uint32_t pred_idx,
-                                       const bool from_transition) {
+                                       const bool from_transition,
+                                       const TimeInfo& time_info) {
   // Get the tile and the node info. Skip if tile is null (can happen
   // with regional data sets) or if no access at the node.
   graph_tile_ptr tile = graphreader.GetGraphTile(node);
@@ -80,6 +90,11 @@ void TimeDistanceMatrix::ExpandForward(GraphReader& graphreader,
     return;
   }
 
+  // The time at the node, the edges leaving it are costed at that time
+  const auto offset_time =
+      time_info.valid ? time_info.forward(pred.cost().secs, static_cast<int>(nodeinfo->timezone()))
+                      : time_info;
+
   // Expand from end node.
   GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
   EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
@@ -95,14 +110,17 @@ void TimeDistanceMatrix::ExpandForward(GraphReader& graphreader,
     // method), or if a complex restriction prevents this path.
     int restriction_idx = -1;
     if (es->set() == EdgeSet::kPermanent ||
-        !costing_->Allowed(directededge, pred, tile, edgeid, 0, 0, restriction_idx) ||
-        costing_->Restricted(directededge, pred, edgelabels_, tile, edgeid, true)) {
+        !costing_->Allowed(directededge, pred, tile, edgeid, offset_time.local_time,
+                           offset_time.timezone_index, restriction_idx) ||
+        costing_->Restricted(directededge, pred, edgelabels_, tile, edgeid, true, nullptr,
+                             offset_time.local_time, offset_time.timezone_index)) {
       continue;
     }
 
     // Get cost and update distance
     auto transition_cost = costing_->TransitionCost(directededge, nodeinfo, pred);
-    Cost newcost = pred.cost() + costing_->EdgeCost(directededge, tile) + transition_cost;
+    Cost newcost =
+        pred.cost() + EdgeCostAt(*costing_, directededge, tile, offset_time) + transition_cost;
     uint32_t distance = pred.path_distance() + directededge->length();
 
     // Check if edge is temporarily labeled and this path has less cost. If
@@ -130,7 +148,7 @@ void TimeDistanceMatrix::ExpandForward(GraphReader& graphreader,
   if (!from_transition && nodeinfo->transition_count() > 0) {
     const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
-      ExpandForward(graphreader, trans->endnode(), pred, pred_idx, true);
+      ExpandForward(graphreader, trans->endnode(), pred, pred_idx, true, time_info);
     }
   }
 }
@@ -144,6 +162,40 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
                               const sif::mode_costing_t& mode_costing,
                               const TravelMode mode,
                               const float max_matrix_distance) {
+  ExpandOneToMany(origin, locations, graphreader, mode_costing, mode, max_matrix_distance, 0.0f,
+                  TimeInfo::invalid());
+  return FormTimeDistanceMatrix();
+}
+
+// Find the paths from one origin location to many destination locations.
+std::vector<std::vector<PathInfo>> TimeDistanceMatrix::OneToManyPaths(
+    const valhalla::Location& origin,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+    GraphReader& graphreader,
+    const sif::mode_costing_t& mode_costing,
+    const TravelMode mode,
+    const float max_matrix_distance,
+    const float max_cost) {
+  ExpandOneToMany(origin, locations, graphreader, mode_costing, mode, max_matrix_distance,
+                  max_cost, TimeInfo::invalid());
+  std::vector<std::vector<PathInfo>> paths;
+  paths.reserve(destinations_.size());
+  for (const auto& dest : destinations_) {
+    paths.emplace_back(FormPath(dest));
+  }
+  return paths;
+}
+
+// Expand from one origin location until all destinations are settled.
+void TimeDistanceMatrix::ExpandOneToMany(
+    const valhalla::Location& origin,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+    GraphReader& graphreader,
+    const sif::mode_costing_t& mode_costing,
+    const TravelMode mode,
+    const float max_matrix_distance,
+    const float max_cost,
+    const TimeInfo& time_info) {
   // Set the mode and costing
   mode_ = mode;
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
@@ -161,7 +213,7 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
 
   // Initialize the origin and destination locations
   settled_count_ = 0;
-  SetOriginOneToMany(graphreader, origin);
+  SetOriginOneToMany(graphreader, origin, time_info);
   SetDestinations(graphreader, locations);
 
   // Find shortest path
@@ -172,7 +224,7 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
     uint32_t predindex = adjacencylist_->pop();
     if (predindex == kInvalidLabel) {
       // Can not expand any further...
-      return FormTimeDistanceMatrix();
+      return;
     }
 
     // Remove label from adjacency list, mark it as permanently labeled.
@@ -192,20 +244,30 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
       // have been settled.
       tile = graphreader.GetGraphTile(pred.edgeid());
       const DirectedEdge* edge = tile->directededge(pred.edgeid());
-      if (UpdateDestinations(origin, locations, destedge->second, edge, tile, pred, predindex)) {
-        return FormTimeDistanceMatrix();
+
+      // The part of the edge up to the destinations is costed at the time the edge was entered
+      auto edge_time = time_info;
+      if (time_info.valid && pred.predecessor() != kInvalidLabel) {
+        const EdgeLabel& entered = edgelabels_[pred.predecessor()];
+        graph_tile_ptr node_tile;
+        edge_time = time_info.forward(entered.cost().secs,
+                                      graphreader.GetTimezone(entered.endnode(), node_tile));
+      }
+      if (UpdateDestinations(origin, locations, destedge->second, edge, tile, pred, predindex,
+                             edge_time)) {
+        return;
       }
     }
 
-    // Terminate when we are beyond the cost threshold
-    if (pred.cost().cost > current_cost_threshold_) {
-      return FormTimeDistanceMatrix();
+    // Terminate when we are beyond the cost threshold or out of budget
+    if (pred.cost().cost > current_cost_threshold_ ||
+        (max_cost > 0.0f && pred.cost().cost > max_cost)) {
+      return;
     }
 
     // Expand forward from the end node of the predecessor edge.
-    ExpandForward(graphreader, pred.endnode(), pred, predindex, false);
+    ExpandForward(graphreader, pred.endnode(), pred, predindex, false, time_info);
   }
-  return {}; // Should never get here
 }
 
 // Expand from the node along the reverse search path.
@@ -352,7 +414,8 @@ TimeDistanceMatrix::ManyToOne(const valhalla::Location& dest,
       // have been settled.
       tile = graphreader.GetGraphTile(pred.edgeid());
       const DirectedEdge* edge = tile->directededge(pred.edgeid());
-      if (UpdateDestinations(dest, locations, destedge->second, edge, tile, pred, predindex)) {
+      if (UpdateDestinations(dest, locations, destedge->second, edge, tile, pred, predindex,
+                             TimeInfo::invalid())) {
         return FormTimeDistanceMatrix();
       }
     }
@@ -406,9 +469,34 @@ std::vector<TimeDistance> TimeDistanceMatrix::SourceToTarget(
   return many_to_many;
 }
 
+std::vector<TimeDistance> TimeDistanceMatrix::TimeDependentSourceToTarget(
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+    baldr::GraphReader& graphreader,
+    const sif::mode_costing_t& mode_costing,
+    const sif::TravelMode mode,
+    const float max_matrix_distance) {
+  // Run a one to many expansion from every source at its time, only the forward expansions know
+  // the time the edges are reached at
+  std::vector<TimeDistance> many_to_many;
+  many_to_many.reserve(source_location_list.size() * target_location_list.size());
+  for (const auto& source : source_location_list) {
+    // A date_time of current is replaced by the time it is now
+    valhalla::Location origin(source);
+    auto time_info = TimeInfo::make(origin, graphreader, &tz_cache_);
+    ExpandOneToMany(origin, target_location_list, graphreader, mode_costing, mode,
+                    max_matrix_distance, 0.0f, time_info);
+    std::vector<TimeDistance> td = FormTimeDistanceMatrix();
+    many_to_many.insert(many_to_many.end(), td.begin(), td.end());
+    Clear();
+  }
+  return many_to_many;
+}
+
 // Add edges at the origin to the adjacency list
 void TimeDistanceMatrix::SetOriginOneToMany(GraphReader& graphreader,
-                                            const valhalla::Location& origin) {
+                                            const valhalla::Location& origin,
+                                            const TimeInfo& time_info) {
   // Only skip inbound edges if we have other options
   bool has_other_edges = false;
   std::for_each(origin.path_edges().begin(), origin.path_edges().end(),
@@ -442,7 +530,7 @@ void TimeDistanceMatrix::SetOriginOneToMany(GraphReader& graphreader,
 
     // Get cost. Use this as sortcost since A* is not used for time+distance
     // matrix computations. . Get distance along the remainder of this edge.
-    Cost cost = costing_->EdgeCost(directededge, tile) * (1.0f - edge.percent_along());
+    Cost cost = EdgeCostAt(*costing_, directededge, tile, time_info) * (1.0f - edge.percent_along());
     uint32_t d = static_cast<uint32_t>(directededge->length() * (1.0f - edge.percent_along()));
 
     // We need to penalize this location based on its score (distance in meters from input)
@@ -518,8 +606,10 @@ void TimeDistanceMatrix::SetDestinations(
   // For each destination
   uint32_t idx = 0;
   for (const auto& loc : locations) {
-    // Set up the destination - consider each possible location edge.
-    bool added = false;
+    // Set up the destination - consider each possible location edge. Every location gets one so
+    // the destinations line up with the locations
+    destinations_.emplace_back();
+    Destination& d = destinations_.back();
     for (const auto& edge : loc.path_edges()) {
       // Disallow any user avoided edges if the avoid location is behind the destination along the
       // edge
@@ -528,14 +618,7 @@ void TimeDistanceMatrix::SetDestinations(
         continue;
       }
 
-      // Add a destination if this is the first allowed edge for the location
-      if (!added) {
-        destinations_.emplace_back();
-        added = true;
-      }
-
       // Keep the id and the partial distance for the remainder of the edge.
-      Destination& d = destinations_.back();
       d.dest_edges[edge.graph_id()] = (1.0f - edge.percent_along());
 
       // Form a threshold cost (the total cost to traverse the edge)
@@ -556,6 +639,12 @@ void TimeDistanceMatrix::SetDestinations(
       // destination index
       dest_edges_[edge.graph_id()].push_back(idx);
     }
+
+    // There is nothing to wait for at a location without any allowed edges
+    if (d.dest_edges.empty()) {
+      d.settled = true;
+      settled_count_++;
+    }
     idx++;
   }
 }
@@ -615,7 +704,8 @@ bool TimeDistanceMatrix::UpdateDestinations(
     const DirectedEdge* edge,
     const graph_tile_ptr& tile,
     const EdgeLabel& pred,
-    const uint32_t /*predindex*/) {
+    const uint32_t predindex,
+    const TimeInfo& time_info) {
   // For each destination along this edge
   for (auto dest_idx : destinations) {
     Destination& dest = destinations_[dest_idx];
@@ -649,10 +739,11 @@ bool TimeDistanceMatrix::UpdateDestinations(
     // Get the cost. The predecessor cost is cost to the end of the edge.
     // Subtract the partial remaining cost and distance along the edge.
     float remainder = dest_edge->second;
-    Cost newcost = pred.cost() - (costing_->EdgeCost(edge, tile) * remainder);
+    Cost newcost = pred.cost() - (EdgeCostAt(*costing_, edge, tile, time_info) * remainder);
     if (newcost.cost < dest.best_cost.cost) {
       dest.best_cost = newcost;
       dest.distance = pred.path_distance() - (edge->length() * remainder);
+      dest.best_label = predindex;
     }
 
     // Erase this edge from further consideration. Mark this destination as
@@ -708,5 +799,19 @@ std::vector<TimeDistance> TimeDistanceMatrix::FormTimeDistanceMatrix() {
   return td;
 }
 
+// Form the path to a destination by walking back from its best label.
+std::vector<PathInfo> TimeDistanceMatrix::FormPath(const Destination& dest) const {
+  std::vector<PathInfo> path;
+  for (auto index = dest.best_label; index != kInvalidLabel;
+       index = edgelabels_[index].predecessor()) {
+    // The path ends partway along the last edge, at the cost the destination was found with
+    const EdgeLabel& label = edgelabels_[index];
+    path.emplace_back(label.mode(), index == dest.best_label ? dest.best_cost : label.cost(),
+                      label.edgeid(), 0, label.restriction_idx(), label.transition_cost());
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
 } // namespace thor
 } // namespace valhalla
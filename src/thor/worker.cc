@@ -49,6 +49,16 @@ const std::unordered_map<std::string, float> kMaxDistances = {
 constexpr float kDistanceScale = 10.f;
 constexpr double kMilePerMeter = 0.000621371;
 
+// The storage the path algorithms of a thread share between requests
+std::shared_ptr<SearchArena> make_search_arena(const boost::property_tree::ptree& config) {
+  return std::make_shared<SearchArena>(
+      config.get<uint32_t>("thor.search_arena.window", SearchArena::kDefaultWindow),
+      config.get<size_t>("thor.search_arena.max_retained_mb",
+                         SearchArena::kDefaultMaxRetainedBytes / (1024 * 1024)) *
+          1024 * 1024,
+      baldr::to_queue_type(config.get<std::string>("thor.priority_queue", "double_bucket")));
+}
+
 } // namespace
 
 namespace valhalla {
@@ -81,12 +91,99 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
     source_to_target_algorithm = TIME_DISTANCE_MATRIX;
   } else if (conf_algorithm == "costmatrix") {
     source_to_target_algorithm = COST_MATRIX;
+  } else if (conf_algorithm == "bucketmatrix") {
+    source_to_target_algorithm = BUCKET_MATRIX;
   } else {
     source_to_target_algorithm = SELECT_OPTIMAL;
   }
 
   max_timedep_distance =
       config.get<float>("service_limits.max_timedep_distance", kDefaultMaxTimeDependentDistance);
+  costmatrix_threads = CostMatrix::MakeThreads(config.get_child("mjolnir"),
+                                                config.get<uint32_t>("thor.costmatrix_threads", 1));
+  time_dependent_matrix = config.get<bool>("thor.time_dependent_matrix", false);
+  contour_threads = config.get<uint32_t>("thor.contour_threads", 1);
+
+  // optimized_route orders its locations with local search unless simulated annealing is asked for
+  optimize_by_annealing = config.get<std::string>("thor.optimizer.algorithm", "") == "annealing";
+  optimizer = LocalSearchOptimizer(config.get<uint32_t>("thor.optimizer.threads", 1),
+                                   config.get<uint32_t>("thor.optimizer.starts", 8),
+                                   config.get<uint32_t>("thor.optimizer.max_time", 0));
+
+  // The path algorithms share the storage of their searches and keep it between requests, the
+  // arena also picks the priority queue they sort their labels with
+  search_arena = make_search_arena(config);
+  bidir_astar.set_search_arena(search_arena);
+  timedep_forward.set_search_arena(search_arena);
+  timedep_reverse.set_search_arena(search_arena);
+  isochrone_gen.set_search_arena(search_arena);
+
+  // Routes found before can be handed out again, the workers reading the same tiles share them
+  route_cache = RouteCache::get_instance(config);
+
+  // Map the contraction hierarchy if one was built for these tiles
+  auto contraction_hierarchy = config.get<std::string>("mjolnir.contraction_hierarchy", "");
+  if (!contraction_hierarchy.empty()) {
+    ch_query.Load(contraction_hierarchy, *reader);
+  }
+
+  // Long routes can have the two searches of bidirectional A* run on two threads, the reverse one
+  // reading the tiles with a reader of its own
+  if (config.get<bool>("thor.bidirectional_astar.parallel", false)) {
+    bidir_astar.set_parallel(std::make_shared<baldr::GraphReader>(config.get_child("mjolnir")),
+                             config.get<float>("thor.bidirectional_astar.parallel_min_distance",
+                                               BidirectionalAStar::kDefaultParallelMinDistance));
+  }
+
+  // Map the landmarks of the A* heuristic if they were built for these tiles
+  auto landmarks = config.get<std::string>("mjolnir.landmarks", "");
+  if (!landmarks.empty()) {
+    bidir_astar.LoadLandmarks(landmarks, *reader);
+  }
+
+  // The legs of a route with more locations that do not depend on each other can be found on
+  // more threads, the worker being one of them
+  const auto route_leg_threads = config.get<uint32_t>("thor.route_leg_threads", 1);
+  for (uint32_t i = 1; i < route_leg_threads; ++i) {
+    leg_threads.emplace_back(new leg_thread_t(config));
+  }
+
+  // The isochrones of a batch are computed on more threads, the worker being one of them
+  const auto isochrone_thread_count = config.get<uint32_t>("thor.isochrone_threads", 1);
+  for (uint32_t i = 1; i < isochrone_thread_count; ++i) {
+    isochrone_threads.emplace_back(new isochrone_thread_t(config));
+  }
+}
+
+thor_worker_t::leg_thread_t::leg_thread_t(const boost::property_tree::ptree& config)
+    : reader(std::make_shared<baldr::GraphReader>(config.get_child("mjolnir"))),
+      search_arena(make_search_arena(config)) {
+  bidir_astar.set_search_arena(search_arena);
+  timedep_forward.set_search_arena(search_arena);
+  timedep_reverse.set_search_arena(search_arena);
+
+  auto contraction_hierarchy = config.get<std::string>("mjolnir.contraction_hierarchy", "");
+  if (!contraction_hierarchy.empty()) {
+    ch_query.Load(contraction_hierarchy, *reader);
+  }
+  auto landmarks = config.get<std::string>("mjolnir.landmarks", "");
+  if (!landmarks.empty()) {
+    bidir_astar.LoadLandmarks(landmarks, *reader);
+  }
+}
+
+thor_worker_t::isochrone_thread_t::isochrone_thread_t(const boost::property_tree::ptree& config)
+    : reader(std::make_shared<baldr::GraphReader>(config.get_child("mjolnir"))),
+      search_arena(make_search_arena(config)) {
+  isochrone.set_search_arena(search_arena);
+}
+
+thor_worker_t::path_context_t thor_worker_t::leg_thread_t::context() {
+  return {*reader, mode_costing, bidir_astar, timedep_forward, timedep_reverse, ch_query, nullptr};
+}
+
+thor_worker_t::path_context_t thor_worker_t::context() {
+  return {*reader, mode_costing, bidir_astar, timedep_forward, timedep_reverse, ch_query, interrupt};
 }
 
 thor_worker_t::~thor_worker_t() {
@@ -139,10 +236,20 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
         denominator = std::max(options.sources_size(), options.targets_size());
         break;
       }
+      case Options::one_to_many: {
+        one_to_many(request);
+        result.messages.emplace_back(serialize_to_pbf(request));
+        denominator = options.locations_size();
+        break;
+      }
       case Options::isochrone:
         result = to_response(isochrones(request), info, request);
         denominator = options.sources_size() * options.targets_size();
         break;
+      case Options::batch_isochrone:
+        result = to_response(batch_isochrones(request), info, request);
+        denominator = options.locations_size();
+        break;
       case Options::route: {
         route(request);
         result.messages.emplace_back(serialize_to_pbf(request));
@@ -323,14 +430,37 @@ void thor_worker_t::cleanup() {
   bidir_astar.Clear();
   timedep_forward.Clear();
   timedep_reverse.Clear();
+  ch_query.Clear();
   multi_modal_astar.Clear();
   bss_astar.Clear();
   trace.clear();
   isochrone_gen.Clear();
+  LOG_DEBUG("Search arena keeps " + std::to_string(search_arena->stats().retained_bytes) +
+            " bytes, " + std::to_string(search_arena->stats().reused) + " reused and " +
+            std::to_string(search_arena->stats().allocated) + " allocated so far");
+  if (route_cache) {
+    LOG_DEBUG("Route cache holds " + std::to_string(route_cache->size()) + " routes, " +
+              std::to_string(route_cache->stats().hits) + " hits and " +
+              std::to_string(route_cache->stats().misses) + " misses so far");
+  }
   matcher_factory.ClearFullCache();
   if (reader->OverCommitted()) {
     reader->Trim();
   }
+  for (auto& leg_thread : leg_threads) {
+    leg_thread->bidir_astar.Clear();
+    leg_thread->timedep_forward.Clear();
+    leg_thread->timedep_reverse.Clear();
+    leg_thread->ch_query.Clear();
+    if (leg_thread->reader->OverCommitted()) {
+      leg_thread->reader->Trim();
+    }
+  }
+  for (auto& isochrone_thread : isochrone_threads) {
+    if (isochrone_thread->reader->OverCommitted()) {
+      isochrone_thread->reader->Trim();
+    }
+  }
 }
 
 void thor_worker_t::set_interrupt(const std::function<void()>* interrupt_function) {
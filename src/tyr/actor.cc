@@ -146,6 +146,33 @@ std::string actor_t::optimized_route(const std::string& request_str,
   return bytes;
 }
 
+std::string actor_t::one_to_many(const std::string& request_str,
+                                 const std::function<void()>* interrupt,
+                                 Api* api) {
+  // set the interrupts
+  pimpl->set_interrupts(interrupt);
+  // parse the request
+  Api request;
+  ParseApi(request_str, Options::one_to_many, request);
+  // check the request and locate the locations in the graph
+  pimpl->loki_worker.matrix(request);
+  // find the routes from the first location to all of the others with a single expansion
+  pimpl->thor_worker.one_to_many(request);
+  // get some directions back from them
+  pimpl->odin_worker.narrate(request);
+  // serialize them out to json string
+  auto bytes = tyr::serializeDirections(request);
+  // if they want you do to do the cleanup automatically
+  if (auto_cleanup) {
+    cleanup();
+  }
+  // give the caller a copy
+  if (api) {
+    api->Swap(&request);
+  }
+  return bytes;
+}
+
 std::string
 actor_t::isochrone(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
   // set the interrupts
@@ -168,6 +195,31 @@ actor_t::isochrone(const std::string& request_str, const std::function<void()>*
   return json;
 }
 
+std::string actor_t::batch_isochrone(
+    const std::string& request_str,
+    const std::function<void()>* interrupt,
+    Api* api,
+    const std::function<void(size_t, const std::string&)>& on_isochrone) {
+  // set the interrupts
+  pimpl->set_interrupts(interrupt);
+  // parse the request
+  Api request;
+  ParseApi(request_str, Options::batch_isochrone, request);
+  // check the request and locate the locations in the graph
+  pimpl->loki_worker.batch_isochrones(request);
+  // compute an isochrone for each of the locations
+  auto json = pimpl->thor_worker.batch_isochrones(request, on_isochrone);
+  // if they want you do to do the cleanup automatically
+  if (auto_cleanup) {
+    cleanup();
+  }
+  // give the caller a copy
+  if (api) {
+    api->Swap(&request);
+  }
+  return json;
+}
+
 std::string actor_t::trace_route(const std::string& request_str,
                                  const std::function<void()>* interrupt,
                                  Api* api) {
@@ -136,5 +136,23 @@ std::string serializeIsochrones(const Api& request,
   ss << *feature_collection;
   return ss.str();
 }
+
+std::string serializeBatchIsochrones(const Api& request, std::vector<std::string>& isochrones) {
+  // the isochrones were serialized as they were done so they go in as they are
+  auto collections = array({});
+  collections->reserve(isochrones.size());
+  for (auto& isochrone : isochrones) {
+    collections->emplace_back(RawJSON{std::move(isochrone)});
+  }
+  auto batch = map({{"isochrones", collections}});
+
+  if (request.options().has_id()) {
+    batch->emplace("id", request.options().id());
+  }
+
+  std::stringstream ss;
+  ss << *batch;
+  return ss.str();
+}
 } // namespace tyr
 } // namespace valhalla
@@ -1622,6 +1622,7 @@ std::string serialize(valhalla::Api& api) {
       json->emplace("waypoints", osrm::waypoints(api.trip()));
       break;
     case valhalla::Options::optimized_route:
+    case valhalla::Options::one_to_many:
       json->emplace("waypoints", waypoints(*options.mutable_locations()));
       break;
     default:
@@ -542,21 +542,34 @@ std::string serialize(const Api& api) {
   writer.start_object();
 
   // the main route
-  writer.start_object("trip");
+  auto trip = [&api, &writer](int route_index) {
+    // the locations in the trip
+    locations(api, route_index, writer);
 
-  // the locations in the trip
-  locations(api, 0, writer);
+    // the actual meat of the route
+    legs(api, route_index, writer);
 
-  // the actual meat of the route
-  legs(api, 0, writer);
+    // openlr references of the edges in the route
+    valhalla::tyr::openlr(api, route_index, writer);
 
-  // openlr references of the edges in the route
-  valhalla::tyr::openlr(api, 0, writer);
+    // summary time/distance and other stats
+    summary(api, route_index, writer);
+  };
 
-  // summary time/distance and other stats
-  summary(api, 0, writer);
-
-  writer.end_object(); // trip
+  // one to many has a trip for each destination it found a route to
+  if (api.options().action() == Options::one_to_many) {
+    writer.start_array("trips");
+    for (int i = 0; i < api.trip().routes_size(); ++i) {
+      writer.start_object();
+      trip(i);
+      writer.end_object();
+    }
+    writer.end_array(); // trips
+  } else {
+    writer.start_object("trip");
+    trip(0);
+    writer.end_object(); // trip
+  }
 
   if (api.options().has_id()) {
     writer("id", api.options().id());
@@ -96,9 +96,15 @@ int main(int argc, char** argv) {
         case valhalla::Options::optimized_route:
           std::cout << actor.optimized_route(request_str, nullptr, &request) << std::endl;
           break;
+        case valhalla::Options::one_to_many:
+          std::cout << actor.one_to_many(request_str, nullptr, &request) << std::endl;
+          break;
         case valhalla::Options::isochrone:
           std::cout << actor.isochrone(request_str, nullptr, &request) << std::endl;
           break;
+        case valhalla::Options::batch_isochrone:
+          std::cout << actor.batch_isochrone(request_str, nullptr, &request) << std::endl;
+          break;
         case valhalla::Options::trace_route:
           std::cout << actor.trace_route(request_str, nullptr, &request) << std::endl;
           break;
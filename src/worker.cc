@@ -690,7 +690,7 @@ void from_json(rapidjson::Document& doc, Options& options) {
         options.date_time_type() == Options::invariant) {
       if (options.costing() == multimodal || options.costing() == transit)
         throw valhalla_exception_t{141};
-      if (options.action() == Options::isochrone)
+      if (options.action() == Options::isochrone || options.action() == Options::batch_isochrone)
         throw valhalla_exception_t{142};
     }
   }
@@ -952,6 +952,12 @@ void from_json(rapidjson::Document& doc, Options& options) {
     options.set_best_paths(*best_paths);
   }
 
+  // if specified, get the budget of the one to many expansion in there
+  auto budget = rapidjson::get_optional<float>(doc, "/budget");
+  if (budget) {
+    options.set_budget(std::max(*budget, 0.f));
+  }
+
   // if specified, get the trace gps_accuracy value in there
   auto gps_accuracy = rapidjson::get_optional<float>(doc, "/trace_options/gps_accuracy");
   if (gps_accuracy) {
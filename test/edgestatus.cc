@@ -5,6 +5,8 @@
 
 #include "test.h"
 
+#include <thread>
+
 using namespace std;
 using namespace valhalla::baldr;
 using namespace valhalla::thor;
@@ -66,6 +68,179 @@ TEST(EdgeStatus, TestStatus) {
   TryGet(edgestatus, GraphId(555, 3, 1), EdgeSet::kUnreachedOrReset);
 }
 
+TEST(EdgeStatus, TestClearReuse) {
+  EdgeStatus edgestatus;
+
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile = tt;
+
+  // more tiles than the table starts out with, and shifted each round so the arrays pooled by
+  // one round end up being used for other tiles by the next
+  for (uint32_t round = 0; round < 3; ++round) {
+    for (uint32_t t = 0; t < 200; ++t) {
+      GraphId edgeid(t + round, 2, t);
+      edgestatus.Set(edgeid, EdgeSet::kTemporary, t, tile);
+      if (t % 2)
+        edgestatus.Update(edgeid, EdgeSet::kPermanent);
+    }
+
+    for (uint32_t t = 0; t < 200; ++t) {
+      GraphId edgeid(t + round, 2, t);
+      auto status = edgestatus.Get(edgeid);
+      EXPECT_EQ(status.set(), t % 2 ? EdgeSet::kPermanent : EdgeSet::kTemporary);
+      EXPECT_EQ(status.index(), t);
+      // the edges next to it are untouched
+      TryGet(edgestatus, GraphId(t + round, 2, t + 1), EdgeSet::kUnreachedOrReset);
+      EXPECT_EQ(edgestatus.GetPtr(edgeid, tile)[1].index(), 0u);
+    }
+
+    // nothing survives clearing even though the arrays do
+    edgestatus.clear();
+    for (uint32_t t = 0; t < 200; ++t) {
+      auto status = edgestatus.Get(GraphId(t + round, 2, t));
+      EXPECT_EQ(status.set(), EdgeSet::kUnreachedOrReset);
+      EXPECT_EQ(status.index(), 0u);
+    }
+    EXPECT_THROW(edgestatus.Update(GraphId(round, 2, 0), EdgeSet::kPermanent), std::runtime_error);
+  }
+}
+
+TEST(EdgeStatus, TestClearDirectWrites) {
+  EdgeStatus edgestatus;
+
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile = tt;
+
+  // the path algorithms write statuses through the pointer and then update them
+  for (uint32_t round = 0; round < 3; ++round) {
+    GraphId edgeid(round, 2, 5);
+    *edgestatus.GetPtr(edgeid, tile) = {EdgeSet::kTemporary, 7};
+    edgestatus.Update(edgeid, EdgeSet::kPermanent);
+    edgestatus.clear();
+
+    // the array comes back for another tile without any of it
+    auto status = edgestatus.GetPtr(GraphId(round + 1, 2, 5), tile);
+    EXPECT_EQ(status->set(), EdgeSet::kUnreachedOrReset);
+    EXPECT_EQ(status->index(), 0u);
+    edgestatus.clear();
+  }
+}
+
+TEST(EdgeStatus, TestClearIntoArena) {
+  auto arena = std::make_shared<SearchArena>();
+  EdgeStatus edgestatus;
+  edgestatus.set_arena(arena);
+
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile = tt;
+
+  // the arrays go back to the arena and come back out of it reset
+  for (uint32_t round = 0; round < 3; ++round) {
+    for (uint32_t t = 0; t < 10; ++t) {
+      edgestatus.Set(GraphId(t + round, 2, t), EdgeSet::kPermanent, t, tile);
+    }
+    edgestatus.clear();
+    EXPECT_EQ(arena->stats().retained_bytes, 10 * 1000 * sizeof(EdgeStatusInfo));
+    for (uint32_t t = 0; t < 10; ++t) {
+      TryGet(edgestatus, GraphId(t + round, 2, t), EdgeSet::kUnreachedOrReset);
+    }
+  }
+  EXPECT_EQ(arena->stats().allocated, 10u);
+  EXPECT_EQ(arena->stats().reused, 20u);
+}
+
+TEST(EdgeStatus, TestClearDirectWritesIntoArena) {
+  auto arena = std::make_shared<SearchArena>();
+  EdgeStatus edgestatus;
+  edgestatus.set_arena(arena);
+
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile = tt;
+
+  // the arena only ever hands out reset arrays, whatever was written through the pointer
+  for (uint32_t round = 0; round < 3; ++round) {
+    *edgestatus.GetPtr(GraphId(round, 2, 5), tile) = {EdgeSet::kTemporary, 7};
+    edgestatus.clear();
+
+    EdgeStatus other;
+    other.set_arena(arena);
+    auto status = other.GetPtr(GraphId(round + 1, 2, 5), tile);
+    EXPECT_EQ(status->set(), EdgeSet::kUnreachedOrReset);
+    EXPECT_EQ(status->index(), 0u);
+    other.clear();
+  }
+  EXPECT_EQ(arena->stats().allocated, 1u);
+  EXPECT_EQ(arena->stats().reused, 5u);
+}
+
+TEST(SharedEdgeSet, TestAddContains) {
+  SharedEdgeSet settled;
+
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile = tt;
+
+  // enough tiles for the table to grow a few times
+  for (uint32_t round = 0; round < 2; ++round) {
+    for (uint32_t t = 0; t < 300; ++t) {
+      settled.Add(GraphId(t, 2, t), tile);
+      settled.Add(GraphId(t, 2, 999), tile);
+    }
+    for (uint32_t t = 0; t < 300; ++t) {
+      EXPECT_TRUE(settled.Contains(GraphId(t, 2, t)));
+      EXPECT_TRUE(settled.Contains(GraphId(t, 2, 999)));
+      EXPECT_FALSE(settled.Contains(GraphId(t, 2, t + 1)));
+      EXPECT_FALSE(settled.Contains(GraphId(t, 1, t)));
+    }
+    settled.clear();
+    EXPECT_FALSE(settled.Contains(GraphId(0, 2, 0)));
+  }
+}
+
+TEST(SharedEdgeSet, TestConcurrentConnection) {
+  SharedEdgeSet forward, reverse;
+
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile = tt;
+
+  // both add the same edges in the same order and then look for them in the other set, which
+  // one finds them is up to the threads but at least one of them always has to
+  constexpr uint32_t kEdges = 100000;
+  std::vector<uint8_t> forward_found(kEdges), reverse_found(kEdges);
+  auto search = [&tile](SharedEdgeSet& own, const SharedEdgeSet& other,
+                        std::vector<uint8_t>& found) {
+    for (uint32_t i = 0; i < kEdges; ++i) {
+      GraphId edgeid(i % 500, 2, i / 500);
+      own.Add(edgeid, tile);
+      found[i] = other.Contains(edgeid);
+    }
+  };
+  std::thread thread(search, std::ref(reverse), std::cref(forward), std::ref(reverse_found));
+  search(forward, reverse, forward_found);
+  thread.join();
+
+  for (uint32_t i = 0; i < kEdges; ++i) {
+    EXPECT_TRUE(forward_found[i] || reverse_found[i]) << i;
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -1,9 +1,16 @@
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <thread>
 
 #include "baldr/connectivity_map.h"
 #include "baldr/graphreader.h"
+#include "baldr/tile_prefetcher.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
+#include "microtar.h"
 
 #include <fcntl.h>
 
@@ -876,6 +883,373 @@ TEST(CacheLruSoft, TrimOnExactlyFullCache) {
   CheckGraphTile(cache.Get(tile2_id), tile2_id, tile2_size);
 }
 
+// a tile backed by as much memory as its header claims, so the cache can compress it
+graph_tile_ptr make_real_tile(const GraphId& id, size_t size) {
+  std::vector<char> memory(size);
+  for (size_t i = sizeof(GraphTileHeader); i < size; ++i) {
+    memory[i] = static_cast<char>(i % 7);
+  }
+  GraphTileHeader header;
+  header.set_graphid(id);
+  header.set_end_offset(size);
+  memcpy(memory.data(), &header, sizeof(header));
+  return GraphTile::Create(id, std::move(memory));
+}
+
+TEST(CacheLruCompressed, HitAfterEviction) {
+  TileCacheLRU cache(1000, TileCacheLRU::MemoryLimitControl::HARD, 10000);
+
+  GraphId tile1_id(1000, 1, 0);
+  auto tile1 = make_real_tile(tile1_id, 600);
+  cache.Put(tile1_id, tile1, 600);
+  GraphId tile2_id(300, 2, 0);
+  cache.Put(tile2_id, make_real_tile(tile2_id, 600), 600);
+
+  // the first tile was evicted but is still around in compressed form
+  EXPECT_FALSE(cache.Contains(tile1_id));
+  EXPECT_TRUE(cache.ContainsCompressed(tile1_id));
+  EXPECT_EQ(cache.GetCompressedTierStats().compressions, 1);
+  EXPECT_GT(cache.CompressedSize(), 0);
+  EXPECT_LT(cache.CompressedSize(), 600);
+
+  // getting it back inflates it and pushes the other one out
+  auto restored = cache.Get(tile1_id);
+  CheckGraphTile(restored, tile1_id, 600);
+  EXPECT_NE(restored, tile1);
+  EXPECT_EQ(memcmp(restored->header(), tile1->header(), 600), 0);
+  EXPECT_EQ(cache.GetCompressedTierStats().hits, 1);
+  EXPECT_EQ(cache.GetCompressedTierStats().compressions, 2);
+  EXPECT_TRUE(cache.Contains(tile1_id));
+  EXPECT_FALSE(cache.ContainsCompressed(tile1_id));
+  EXPECT_FALSE(cache.Contains(tile2_id));
+  EXPECT_TRUE(cache.ContainsCompressed(tile2_id));
+  EXPECT_FALSE(cache.OverCommitted());
+
+  // the compressed copy is gone once its in the main tier again
+  EXPECT_EQ(cache.Get(tile1_id), restored);
+  EXPECT_EQ(cache.GetCompressedTierStats().hits, 1);
+
+  GraphId tile3_id(5, 0, 0);
+  EXPECT_EQ(cache.Get(tile3_id), nullptr);
+  EXPECT_EQ(cache.GetCompressedTierStats().misses, 1);
+
+  cache.Clear();
+  EXPECT_FALSE(cache.Contains(tile1_id));
+  EXPECT_FALSE(cache.ContainsCompressed(tile2_id));
+  EXPECT_EQ(cache.CompressedSize(), 0);
+}
+
+TEST(CacheLruCompressed, TierEviction) {
+  // only room for a single compressed tile
+  TileCacheLRU cache(1000, TileCacheLRU::MemoryLimitControl::HARD, 1);
+  GraphId tile1_id(1, 2, 0);
+  cache.Put(tile1_id, make_real_tile(tile1_id, 600), 600);
+  GraphId tile2_id(2, 2, 0);
+  cache.Put(tile2_id, make_real_tile(tile2_id, 600), 600);
+  EXPECT_FALSE(cache.Contains(tile1_id));
+  EXPECT_FALSE(cache.ContainsCompressed(tile1_id));
+  EXPECT_EQ(cache.GetCompressedTierStats().compressions, 0);
+
+  // measure a compressed tile and make room for two of them
+  TileCacheLRU probe(1000, TileCacheLRU::MemoryLimitControl::HARD, 10000);
+  probe.Put(tile1_id, make_real_tile(tile1_id, 600), 600);
+  probe.Put(tile2_id, make_real_tile(tile2_id, 600), 600);
+  const size_t compressed_size = probe.CompressedSize();
+  ASSERT_GT(compressed_size, 0);
+
+  TileCacheLRU bigger(1000, TileCacheLRU::MemoryLimitControl::SOFT,
+                      compressed_size * 2 + compressed_size / 2);
+  std::vector<GraphId> ids;
+  for (uint32_t i = 0; i < 8; ++i) {
+    ids.emplace_back(i, 2, 0);
+    bigger.Put(ids.back(), make_real_tile(ids.back(), 600), 600);
+    bigger.Trim();
+  }
+  EXPECT_EQ(bigger.GetCompressedTierStats().compressions, 7);
+  EXPECT_EQ(bigger.GetCompressedTierStats().evictions, 5);
+  // the most recently evicted ones survive
+  EXPECT_TRUE(bigger.ContainsCompressed(ids[6]));
+  EXPECT_TRUE(bigger.ContainsCompressed(ids[5]));
+  EXPECT_FALSE(bigger.ContainsCompressed(ids[4]));
+  EXPECT_FALSE(bigger.ContainsCompressed(ids[0]));
+}
+
+std::vector<std::unique_ptr<TileCache>> make_lru_shards(size_t count, size_t shard_size) {
+  std::vector<std::unique_ptr<TileCache>> shards;
+  for (size_t i = 0; i < count; ++i) {
+    shards.emplace_back(new TileCacheLRU(shard_size, TileCacheLRU::MemoryLimitControl::HARD));
+  }
+  return shards;
+}
+
+TEST(ShardedCache, NoShards) {
+  EXPECT_THROW(ShardedTileCache cache({}), std::runtime_error);
+}
+
+TEST(ShardedCache, PutGetClear) {
+  ShardedTileCache cache(make_lru_shards(4, 1000));
+  EXPECT_EQ(cache.ShardCount(), 4);
+
+  std::vector<GraphId> ids;
+  for (uint32_t i = 0; i < 16; ++i) {
+    ids.emplace_back(i * 7, i % 3, 0);
+    cache.Put(ids.back(), new TestGraphTile(ids.back(), 10 + i), 10 + i);
+  }
+
+  for (uint32_t i = 0; i < ids.size(); ++i) {
+    EXPECT_TRUE(cache.Contains(ids[i]));
+    CheckGraphTile(cache.Get(ids[i]), ids[i], 10 + i);
+    // the same tile id on another level is another tile, which was never put
+    const GraphId other_level(ids[i].tileid(), (ids[i].level() + 1) % 3, 0);
+    EXPECT_FALSE(cache.Contains(other_level));
+    EXPECT_EQ(cache.Get(other_level), nullptr);
+  }
+  EXPECT_FALSE(cache.OverCommitted());
+
+  cache.Clear();
+  for (const auto& id : ids) {
+    EXPECT_FALSE(cache.Contains(id));
+    EXPECT_EQ(cache.Get(id), nullptr);
+  }
+}
+
+TEST(ShardedCache, SharedBetweenCopies) {
+  ShardedTileCache cache(make_lru_shards(2, 1000));
+  ShardedTileCache copy(cache);
+
+  GraphId id(100, 2, 0);
+  cache.Put(id, new TestGraphTile(id, 100), 100);
+  CheckGraphTile(copy.Get(id), id, 100);
+
+  copy.Clear();
+  EXPECT_FALSE(cache.Contains(id));
+}
+
+TEST(ShardedCache, PerShardEviction) {
+  // a single shard behaves exactly like the cache it wraps
+  ShardedTileCache cache(make_lru_shards(1, 500));
+
+  GraphId tile1_id(1000, 1, 0);
+  cache.Put(tile1_id, new TestGraphTile(tile1_id, 300), 300);
+  GraphId tile2_id(300, 2, 0);
+  cache.Put(tile2_id, new TestGraphTile(tile2_id, 300), 300);
+
+  EXPECT_FALSE(cache.OverCommitted());
+  EXPECT_FALSE(cache.Contains(tile1_id));
+  CheckGraphTile(cache.Get(tile2_id), tile2_id, 300);
+}
+
+TEST(ShardedCache, Factory) {
+  boost::property_tree::ptree pt;
+  pt.put("global_synchronized_cache", true);
+  pt.put("global_cache_shards", 8);
+  pt.put("use_lru_mem_cache", true);
+  std::unique_ptr<TileCache> cache1(TileCacheFactory::createTileCache(pt));
+  std::unique_ptr<TileCache> cache2(TileCacheFactory::createTileCache(pt));
+
+  // both readers see the same global shards
+  GraphId id(100, 2, 0);
+  cache1->Put(id, new TestGraphTile(id, 100), 100);
+  CheckGraphTile(cache2->Get(id), id, 100);
+  cache2->Clear();
+  EXPECT_FALSE(cache1->Contains(id));
+}
+
+TEST(TilePrefetcher, TakeLoaded) {
+  std::atomic<size_t> loads(0);
+  tile_prefetcher_t prefetcher(2, 8, [&loads](const GraphId& id) -> graph_tile_ptr {
+    ++loads;
+    return new TestGraphTile(id, 100);
+  });
+
+  GraphId id(100, 2, 0);
+  prefetcher.request(id);
+  prefetcher.request(id);
+  // wait for a background thread to pick it up, take then waits for the load to finish
+  while (loads == 0) {
+    std::this_thread::yield();
+  }
+  CheckGraphTile(prefetcher.take(id), id, 100);
+  EXPECT_EQ(loads, 1);
+
+  // once taken it is gone
+  EXPECT_EQ(prefetcher.take(id), nullptr);
+}
+
+TEST(TilePrefetcher, TakeLoadedAll) {
+  std::atomic<size_t> loads(0);
+  tile_prefetcher_t prefetcher(1, 8, [&loads](const GraphId& id) -> graph_tile_ptr {
+    ++loads;
+    return id.tileid() % 2 ? new TestGraphTile(id, 100) : nullptr;
+  });
+
+  for (uint32_t i = 0; i < 4; ++i) {
+    prefetcher.request({i, 2, 0});
+  }
+  while (loads < 4) {
+    std::this_thread::yield();
+  }
+  // the last load may still be handing over its tile, take waits for it
+  EXPECT_NE(prefetcher.take({3, 2, 0}), nullptr);
+  auto loaded = prefetcher.take_loaded();
+  ASSERT_EQ(loaded.size(), 1);
+  CheckGraphTile(loaded.begin()->second, {1, 2, 0}, 100);
+  EXPECT_TRUE(prefetcher.take_loaded().empty());
+}
+
+TEST(TilePrefetcher, CancelAndLimit) {
+  // without threads nothing is ever loaded so we can look at the bookkeeping alone
+  tile_prefetcher_t prefetcher(0, 2, [](const GraphId& id) -> graph_tile_ptr {
+    return new TestGraphTile(id, 100);
+  });
+
+  GraphId id1(1, 2, 0), id2(2, 2, 0), id3(3, 2, 0);
+  prefetcher.request(id1);
+  prefetcher.request(id2);
+  // over the limit, dropped
+  prefetcher.request(id3);
+
+  // queued requests are cancelled rather than waited on
+  EXPECT_EQ(prefetcher.take(id1), nullptr);
+  EXPECT_EQ(prefetcher.take(id3), nullptr);
+  prefetcher.request(id3);
+  prefetcher.clear();
+  EXPECT_EQ(prefetcher.take(id2), nullptr);
+  EXPECT_TRUE(prefetcher.take_loaded().empty());
+}
+
+struct extract_reader_t : public GraphReader {
+  using GraphReader::tile_extract_t;
+};
+
+// writes a tar with some made up tiles and something that isnt a tile
+void make_extract(const std::string& tar_file, const std::vector<GraphId>& ids) {
+  mtar_t tar;
+  ASSERT_EQ(mtar_open(&tar, tar_file.c_str(), "w"), MTAR_ESUCCESS);
+  for (size_t i = 0; i < ids.size(); ++i) {
+    std::string data(100 + i * 700, 'a' + i);
+    auto name = GraphTile::FileSuffix(ids[i]);
+    ASSERT_EQ(mtar_write_file_header(&tar, name.c_str(), data.size()), MTAR_ESUCCESS);
+    ASSERT_EQ(mtar_write_data(&tar, data.c_str(), data.size()), MTAR_ESUCCESS);
+  }
+  ASSERT_EQ(mtar_write_file_header(&tar, "README", 5), MTAR_ESUCCESS);
+  ASSERT_EQ(mtar_write_data(&tar, "hello", 5), MTAR_ESUCCESS);
+  mtar_finalize(&tar);
+  mtar_close(&tar);
+}
+
+TEST(ExtractIndex, Sidecar) {
+  const std::string tile_dir = "test/data/extract_index";
+  const std::string tar_file = tile_dir + "/tiles.tar";
+  const std::string index_file = tar_file + ".index";
+  filesystem::remove_all(tile_dir);
+  filesystem::create_directories(tile_dir);
+  const std::vector<GraphId> ids{{0, 0, 0}, {12, 1, 0}, {755, 2, 0}};
+  make_extract(tar_file, ids);
+
+  boost::property_tree::ptree pt;
+  pt.put("tile_extract", tar_file);
+
+  // without asking for it there is no index
+  extract_reader_t::tile_extract_t plain(pt);
+  EXPECT_EQ(plain.tiles.size(), ids.size());
+  EXPECT_FALSE(filesystem::exists(index_file));
+
+  // the first time we scan and write the index, the second time we only use the index
+  pt.put("extract_index", true);
+  extract_reader_t::tile_extract_t scanned(pt);
+  EXPECT_FALSE(scanned.archive->contents.empty());
+  EXPECT_TRUE(filesystem::exists(index_file));
+  extract_reader_t::tile_extract_t indexed(pt);
+  EXPECT_TRUE(indexed.archive->contents.empty());
+
+  auto check = [&](const extract_reader_t::tile_extract_t& extract) {
+    ASSERT_EQ(extract.tiles.size(), ids.size());
+    for (const auto& id : ids) {
+      const auto& expected = plain.tiles.at(id);
+      auto found = extract.tiles.find(id);
+      ASSERT_NE(found, extract.tiles.end());
+      ASSERT_EQ(found->second.second, expected.second);
+      EXPECT_EQ(memcmp(found->second.first, expected.first, expected.second), 0);
+    }
+  };
+  check(scanned);
+  check(indexed);
+
+  // a garbled index is ignored and rewritten
+  {
+    std::fstream index(index_file, std::ios::in | std::ios::out | std::ios::binary);
+    index.seekp(-1, std::ios::end);
+    index.put('\x7f');
+  }
+  extract_reader_t::tile_extract_t garbled(pt);
+  EXPECT_FALSE(garbled.archive->contents.empty());
+  check(garbled);
+  extract_reader_t::tile_extract_t reindexed(pt);
+  EXPECT_TRUE(reindexed.archive->contents.empty());
+  check(reindexed);
+
+  filesystem::remove_all(tile_dir);
+}
+
+TEST(ExtractIndex, TrafficUpdatedInPlace) {
+  const std::string tile_dir = "test/data/extract_index_traffic";
+  const std::string tar_file = tile_dir + "/traffic.tar";
+  filesystem::remove_all(tile_dir);
+  filesystem::create_directories(tile_dir);
+  make_extract(tar_file, {{0, 0, 0}, {12, 1, 0}, {755, 2, 0}});
+
+  boost::property_tree::ptree pt;
+  pt.put("traffic_extract", tar_file);
+  pt.put("extract_index", true);
+  extract_reader_t::tile_extract_t scanned(pt);
+  ASSERT_EQ(scanned.traffic_tiles.size(), 3);
+  EXPECT_FALSE(scanned.traffic_archive->contents.empty());
+
+  // rewriting the speeds changes the modification time but not the layout so the index still holds
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::fstream traffic(tar_file, std::ios::in | std::ios::out | std::ios::binary);
+    traffic.seekp(scanned.traffic_tiles.begin()->second.first - scanned.traffic_archive->mm.get());
+    traffic.put('z');
+  }
+  extract_reader_t::tile_extract_t indexed(pt);
+  EXPECT_TRUE(indexed.traffic_archive->contents.empty());
+  ASSERT_EQ(indexed.traffic_tiles.size(), 3);
+  for (const auto& tile : scanned.traffic_tiles) {
+    auto found = indexed.traffic_tiles.find(tile.first);
+    ASSERT_NE(found, indexed.traffic_tiles.end());
+    EXPECT_EQ(found->second.second, tile.second.second);
+  }
+
+  filesystem::remove_all(tile_dir);
+}
+
+TEST(ExtractWarmup, OnlyOnce) {
+  const std::string tile_dir = "test/data/extract_warmup";
+  const std::string tar_file = tile_dir + "/tiles.tar";
+  filesystem::remove_all(tile_dir);
+  filesystem::create_directories(tile_dir);
+  make_extract(tar_file, {{0, 0, 0}, {12, 1, 0}, {755, 2, 0}, {756, 2, 0}});
+
+  boost::property_tree::ptree pt;
+  pt.put("tile_extract", tar_file);
+  extract_reader_t::tile_extract_t extract(pt);
+  ASSERT_EQ(extract.tiles.size(), 4);
+
+  // a bad config fails and leaves it to the next call to warm up
+  boost::property_tree::ptree warmup;
+  warmup.put("bbox", "1,2,3");
+  EXPECT_THROW(extract.warmup(warmup), std::runtime_error);
+  warmup.put("bbox", "-180,-90,180,90");
+  EXPECT_NO_THROW(extract.warmup(warmup));
+  // done already so the config isnt looked at anymore
+  warmup.put("bbox", "1,2,3");
+  EXPECT_NO_THROW(extract.warmup(warmup));
+
+  filesystem::remove_all(tile_dir);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
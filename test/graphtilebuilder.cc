@@ -301,6 +301,84 @@ TEST(GraphTileBuilder, TestBinEdges) {
   EXPECT_EQ(tweeners.size(), 1) << "This edge leaves a tile for 1 other tile and comes back.";
 }
 
+void assert_routing_edges(const GraphTile& tile) {
+  const auto& routing = tile.routing_edges();
+  ASSERT_TRUE(routing) << "Tile should have routing edges";
+  for (uint32_t i = 0; i < tile.header()->directededgecount(); ++i) {
+    const auto* edge = tile.directededge(i);
+    ASSERT_EQ(routing.endnode(i), edge->endnode());
+    ASSERT_EQ(routing.length(i), edge->length());
+    ASSERT_EQ(routing.forwardaccess(i), edge->forwardaccess());
+    ASSERT_EQ(routing.reverseaccess(i), edge->reverseaccess());
+    ASSERT_EQ(routing.speed(i), edge->speed());
+    ASSERT_EQ(routing.classification(i), edge->classification());
+    ASSERT_EQ(routing.use(i), edge->use());
+    ASSERT_EQ(routing.restrictions(i), edge->restrictions());
+    ASSERT_EQ(routing.opp_index(i), edge->opp_index());
+    ASSERT_EQ(routing.localedgeidx(i), edge->localedgeidx());
+    ASSERT_EQ(routing.shortcut(i), edge->shortcut());
+    ASSERT_EQ(routing.is_shortcut(i), edge->is_shortcut());
+    ASSERT_EQ(routing.superseded(i), edge->superseded());
+  }
+}
+
+TEST(GraphTileBuilder, TestAddRoutingEdges) {
+  GraphId id(744881, 2, 0);
+  auto t = GraphTile::Create(VALHALLA_SOURCE_DIR "test/data/bin_tiles/no_bin", id);
+  ASSERT_TRUE(t && t->header()) << "Couldn't load test tile";
+  ASSERT_FALSE(t->routing_edges()) << "Test tile shouldnt have routing edges yet";
+  const auto count = t->header()->directededgecount();
+  const auto end = t->header()->end_offset();
+
+  // add them and check the rest of the tile is untouched
+  std::string routing_dir = "test/data/routing_edges_tiles";
+  GraphTileBuilder::AddRoutingEdges(routing_dir, t);
+  auto r = GraphTile::Create(routing_dir, id);
+  ASSERT_TRUE(r && r->header());
+  EXPECT_EQ(r->header()->routing_edges_offset(), end);
+  EXPECT_EQ(r->header()->end_offset(), end + RoutingEdges::size(count));
+  EXPECT_EQ(memcmp(reinterpret_cast<const char*>(t->header()) + sizeof(GraphTileHeader),
+                   reinterpret_cast<const char*>(r->header()) + sizeof(GraphTileHeader),
+                   end - sizeof(GraphTileHeader)),
+            0);
+  assert_routing_edges(*r);
+
+  // adding them again replaces them
+  GraphTileBuilder::AddRoutingEdges(routing_dir, r);
+  r = GraphTile::Create(routing_dir, id);
+  EXPECT_EQ(r->header()->end_offset(), end + RoutingEdges::size(count));
+  assert_routing_edges(*r);
+
+  // updating the edges updates them as well
+  {
+    GraphTileBuilder builder(routing_dir, id, false);
+    std::vector<NodeInfo> nodes(builder.GetNodes().begin(), builder.GetNodes().end());
+    std::vector<DirectedEdge> edges(builder.GetDirectedEdges().begin(),
+                                    builder.GetDirectedEdges().end());
+    for (auto& edge : edges) {
+      edge.set_speed(edge.speed() / 2);
+      edge.set_forwardaccess(edge.forwardaccess() & ~kAutoAccess);
+    }
+    builder.Update(nodes, edges);
+  }
+  r = GraphTile::Create(routing_dir, id);
+  EXPECT_EQ(r->header()->end_offset(), end + RoutingEdges::size(count));
+  for (uint32_t i = 0; i < count; ++i) {
+    ASSERT_EQ(r->routing_edges().speed(i), t->directededge(i)->speed() / 2);
+    ASSERT_FALSE(r->routing_edges().forwardaccess(i) & kAutoAccess);
+  }
+  assert_routing_edges(*r);
+
+  // and they stay last when the bins grow
+  std::array<std::vector<GraphId>, kBinCount> bins;
+  for (auto& bin : bins)
+    bin.emplace_back(id.tileid(), 2, 0);
+  GraphTileBuilder::AddBins(routing_dir, r, bins);
+  r = GraphTile::Create(routing_dir, id);
+  EXPECT_EQ(r->header()->routing_edges_offset(), end + bins.size() * sizeof(GraphId));
+  assert_routing_edges(*r);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
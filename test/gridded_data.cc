@@ -1,6 +1,7 @@
 #include "midgard/gridded_data.h"
 #include "midgard/pointll.h"
 #include <limits>
+#include <random>
 //#include <iostream>
 
 #include "test.h"
@@ -78,6 +79,236 @@ TEST(GriddedData, Basic) {
   */
 }
 
+TEST(GriddedData, Threads) {
+  // two metrics growing away from a few places with some noise so there are plenty of rings
+  const auto max = std::numeric_limits<float>::max();
+  GriddedData<2> g({-7, -7, 7, 7}, .1f, {max, max});
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> noise(0, 20000);
+  for (int tile_id = 0; tile_id < g.nrows() * g.ncolumns(); ++tile_id) {
+    auto b = g.Base(tile_id);
+    float d = std::min(PointLL(-2, -2).Distance(b), PointLL(3, 1).Distance(b));
+    g.SetIfLessThan(tile_id, {d + noise(gen), d / 2 + noise(gen)});
+  }
+
+  // the contours are the same whichever thread traced them
+  for (bool rings_only : {true, false}) {
+    std::vector<GriddedData<2>::contour_interval_t> iso_markers{
+        {0, 100000, "dist", ""}, {0, 200000, "dist", ""}, {0, 300000, "dist", ""},
+        {1, 50000, "half", ""},  {1, 150000, "half", ""},
+    };
+    auto contours = g.GenerateContours(iso_markers, rings_only, 0.f);
+    ASSERT_EQ(contours.size(), iso_markers.size());
+    for (uint32_t threads : {2, 3, 8}) {
+      EXPECT_EQ(g.GenerateContours(iso_markers, rings_only, 0.f, 200.f, threads), contours);
+    }
+
+    for (const auto& collection : contours) {
+      ASSERT_FALSE(collection.empty());
+      if (rings_only) {
+        // all of the rings are in one feature and they are closed
+        ASSERT_EQ(collection.size(), 1);
+        EXPECT_GT(collection.front().size(), 1);
+        for (const auto& ring : collection.front()) {
+          EXPECT_EQ(ring.front(), ring.back());
+        }
+      } else {
+        // every line is a feature of its own
+        for (const auto& feature : collection) {
+          EXPECT_EQ(feature.size(), 1);
+        }
+      }
+    }
+  }
+}
+
+TEST(GriddedData, SameContoursAsBefore) {
+  // two places to reach, the bigger one with a tile in the middle of it that takes much longer to
+  // get to so that its contours have holes. rows go from south to north
+  const float grid[8][10] = {
+      {9, 9, 9, 9, 9, 9, 9, 9, 9, 9}, {9, 9, 9, 9, 9, 9, 9, 9, 9, 9},
+      {9, 5, 4, 4, 4, 5, 9, 9, 9, 9}, {9, 4, 1, 1, 1, 4, 9, 3, 3, 9},
+      {9, 4, 1, 9, 1, 4, 9, 3, 1, 9}, {9, 4, 1, 1, 1, 4, 9, 3, 3, 9},
+      {9, 5, 4, 4, 4, 5, 9, 9, 9, 9}, {9, 9, 9, 9, 9, 9, 9, 9, 9, 9},
+  };
+  GriddedData<1> g({0, 0, 10, 8}, 1, {9});
+  for (int row = 0; row < 8; ++row) {
+    for (int column = 0; column < 10; ++column) {
+      g.SetIfLessThan(g.TileId(column, row), {grid[row][column]});
+    }
+  }
+
+  // what the contours were before they were stitched by grid position, neither denoised nor
+  // generalized so that every point of them is pinned down
+  const std::vector<GriddedData<1>::contours_t> expected{
+      // rings_only = true
+      {
+          {
+              {
+                  {{9, 6}, {8.5, 6.25}, {8.25, 6.25}, {7.75, 6.25}, {7.5, 6.25}, {7, 6},
+                   {6.75, 5.5}, {6.75, 5.25}, {6.75, 4.75}, {6.75, 4.5}, {6.75, 4.25}, {6.75, 3.75},
+                   {6.75, 3.5}, {7, 3}, {7.5, 2.75}, {7.75, 2.75}, {8.25, 2.75}, {8.5, 2.75},
+                   {9, 3}, {9.25, 3.5}, {9.3, 3.7}, {9.3, 4.3}, {9.33333333, 4.5}, {9.3, 4.7},
+                   {9.3, 5.3}, {9.25, 5.5}, {9, 6}},
+                  {{3.5, 4.66666667}, {3.61111111, 4.61111111}, {3.66666667, 4.5},
+                   {3.61111111, 4.38888889}, {3.5, 4.33333333}, {3.38888889, 4.38888889},
+                   {3.33333333, 4.5}, {3.38888889, 4.61111111}, {3.5, 4.66666667}},
+              },
+          },
+          {
+              {
+                  {{8.72222222, 5.72222222}, {8.5, 5.83333333}, {8.16666667, 5.83333333},
+                   {7.83333333, 5.83333333}, {7.5, 5.83333333}, {7.27777778, 5.72222222},
+                   {7.16666667, 5.5}, {7.16666667, 5.16666667}, {7.16666667, 4.83333333},
+                   {7.16666667, 4.5}, {7.16666667, 4.16666667}, {7.16666667, 3.83333333},
+                   {7.16666667, 3.5}, {7.27777778, 3.27777778}, {7.5, 3.16666667},
+                   {7.83333333, 3.16666667}, {8.16666667, 3.16666667}, {8.5, 3.16666667},
+                   {8.72222222, 3.27777778}, {8.83333333, 3.5}, {9.1, 3.9}, {9.1, 4.1},
+                   {9.21428571, 4.5}, {9.1, 4.9}, {9.1, 5.1}, {8.83333333, 5.5},
+                   {8.72222222, 5.72222222}},
+                  {{5, 6}, {4.5, 6.33333333}, {4.33333333, 6.33333333}, {3.66666667, 6.33333333},
+                   {3.5, 6.33333333}, {3.33333333, 6.33333333}, {2.66666667, 6.33333333},
+                   {2.5, 6.33333333}, {2, 6}, {1.66666667, 5.5}, {1.66666667, 5.33333333},
+                   {1.66666667, 4.66666667}, {1.66666667, 4.5}, {1.66666667, 4.33333333},
+                   {1.66666667, 3.66666667}, {1.66666667, 3.5}, {2, 3}, {2.5, 2.66666667},
+                   {2.66666667, 2.66666667}, {3.33333333, 2.66666667}, {3.5, 2.66666667},
+                   {3.66666667, 2.66666667}, {4.33333333, 2.66666667}, {4.5, 2.66666667}, {5, 3},
+                   {5.33333333, 3.5}, {5.33333333, 3.66666667}, {5.33333333, 4.33333333},
+                   {5.33333333, 4.5}, {5.33333333, 4.66666667}, {5.33333333, 5.33333333},
+                   {5.33333333, 5.5}, {5, 6}},
+                  {{3.5, 4.78571429}, {3.69047619, 4.69047619}, {3.78571429, 4.5},
+                   {3.69047619, 4.30952381}, {3.5, 4.21428571}, {3.30952381, 4.30952381},
+                   {3.21428571, 4.5}, {3.30952381, 4.69047619}, {3.5, 4.78571429}},
+              },
+          },
+          {
+              {
+                  {{4.7, 5.7}, {4.5, 5.83333333}, {4.16666667, 5.83333333},
+                   {3.83333333, 5.83333333}, {3.5, 5.83333333}, {3.16666667, 5.83333333},
+                   {2.83333333, 5.83333333}, {2.5, 5.83333333}, {2.3, 5.7}, {2.16666667, 5.5},
+                   {2.16666667, 5.16666667}, {2.16666667, 4.83333333}, {2.16666667, 4.5},
+                   {2.16666667, 4.16666667}, {2.16666667, 3.83333333}, {2.16666667, 3.5},
+                   {2.3, 3.3}, {2.5, 3.16666667}, {2.83333333, 3.16666667},
+                   {3.16666667, 3.16666667}, {3.5, 3.16666667}, {3.83333333, 3.16666667},
+                   {4.16666667, 3.16666667}, {4.5, 3.16666667}, {4.7, 3.3}, {4.83333333, 3.5},
+                   {4.83333333, 3.83333333}, {4.83333333, 4.16666667}, {4.83333333, 4.5},
+                   {4.83333333, 4.83333333}, {4.83333333, 5.16666667}, {4.83333333, 5.5}, {4.7, 5.7}},
+                  {{8.5, 5}, {8.83333333, 4.83333333}, {9, 4.5}, {8.83333333, 4.16666667}, {8.5, 4},
+                   {8.16666667, 4.16666667}, {8, 4.5}, {8.16666667, 4.83333333}, {8.5, 5}},
+                  {{3.5, 5}, {3.83333333, 4.83333333}, {4, 4.5}, {3.83333333, 4.16666667}, {3.5, 4},
+                   {3.16666667, 4.16666667}, {3, 4.5}, {3.16666667, 4.83333333}, {3.5, 5}},
+              },
+          },
+      },
+      // rings_only = false
+      {
+          {
+              {
+                  {{9, 6}, {8.5, 6.25}, {8.25, 6.25}, {7.75, 6.25}, {7.5, 6.25}, {7, 6},
+                   {6.75, 5.5}, {6.75, 5.25}, {6.75, 4.75}, {6.75, 4.5}, {6.75, 4.25}, {6.75, 3.75},
+                   {6.75, 3.5}, {7, 3}, {7.5, 2.75}, {7.75, 2.75}, {8.25, 2.75}, {8.5, 2.75},
+                   {9, 3}, {9.25, 3.5}, {9.3, 3.7}, {9.3, 4.3}, {9.33333333, 4.5}, {9.3, 4.7},
+                   {9.3, 5.3}, {9.25, 5.5}, {9, 6}},
+              },
+              {
+                  {{1.5, 2}, {1.9, 1.9}, {2.1, 1.9}, {2.5, 1.83333333}, {2.83333333, 1.83333333},
+                   {3.16666667, 1.83333333}, {3.5, 1.83333333}, {3.83333333, 1.83333333},
+                   {4.16666667, 1.83333333}, {4.5, 1.83333333}, {4.9, 1.9}, {5.1, 1.9}, {5.5, 2},
+                   {5.83333333, 2.16666667}, {6, 2.5}, {6.1, 2.9}, {6.1, 3.1}, {6.16666667, 3.5},
+                   {6.16666667, 3.83333333}, {6.16666667, 4.16666667}, {6.16666667, 4.5},
+                   {6.16666667, 4.83333333}, {6.16666667, 5.16666667}, {6.16666667, 5.5},
+                   {6.1, 5.9}, {6.1, 6.1}, {6, 6.5}, {5.83333333, 6.83333333}, {5.5, 7}, {5.1, 7.1},
+                   {4.9, 7.1}, {4.5, 7.16666667}, {4.16666667, 7.16666667},
+                   {3.83333333, 7.16666667}, {3.5, 7.16666667}, {3.16666667, 7.16666667},
+                   {2.83333333, 7.16666667}, {2.5, 7.16666667}, {2.1, 7.1}, {1.9, 7.1}, {1.5, 7}},
+              },
+              {
+                  {{3.5, 4.66666667}, {3.61111111, 4.61111111}, {3.66666667, 4.5},
+                   {3.61111111, 4.38888889}, {3.5, 4.33333333}, {3.38888889, 4.38888889},
+                   {3.33333333, 4.5}, {3.38888889, 4.61111111}, {3.5, 4.66666667}},
+              },
+          },
+          {
+              {
+                  {{8.72222222, 5.72222222}, {8.5, 5.83333333}, {8.16666667, 5.83333333},
+                   {7.83333333, 5.83333333}, {7.5, 5.83333333}, {7.27777778, 5.72222222},
+                   {7.16666667, 5.5}, {7.16666667, 5.16666667}, {7.16666667, 4.83333333},
+                   {7.16666667, 4.5}, {7.16666667, 4.16666667}, {7.16666667, 3.83333333},
+                   {7.16666667, 3.5}, {7.27777778, 3.27777778}, {7.5, 3.16666667},
+                   {7.83333333, 3.16666667}, {8.16666667, 3.16666667}, {8.5, 3.16666667},
+                   {8.72222222, 3.27777778}, {8.83333333, 3.5}, {9.1, 3.9}, {9.1, 4.1},
+                   {9.21428571, 4.5}, {9.1, 4.9}, {9.1, 5.1}, {8.83333333, 5.5},
+                   {8.72222222, 5.72222222}},
+              },
+              {
+                  {{5, 6}, {4.5, 6.33333333}, {4.33333333, 6.33333333}, {3.66666667, 6.33333333},
+                   {3.5, 6.33333333}, {3.33333333, 6.33333333}, {2.66666667, 6.33333333},
+                   {2.5, 6.33333333}, {2, 6}, {1.66666667, 5.5}, {1.66666667, 5.33333333},
+                   {1.66666667, 4.66666667}, {1.66666667, 4.5}, {1.66666667, 4.33333333},
+                   {1.66666667, 3.66666667}, {1.66666667, 3.5}, {2, 3}, {2.5, 2.66666667},
+                   {2.66666667, 2.66666667}, {3.33333333, 2.66666667}, {3.5, 2.66666667},
+                   {3.66666667, 2.66666667}, {4.33333333, 2.66666667}, {4.5, 2.66666667}, {5, 3},
+                   {5.33333333, 3.5}, {5.33333333, 3.66666667}, {5.33333333, 4.33333333},
+                   {5.33333333, 4.5}, {5.33333333, 4.66666667}, {5.33333333, 5.33333333},
+                   {5.33333333, 5.5}, {5, 6}},
+              },
+              {
+                  {{3.5, 4.78571429}, {3.69047619, 4.69047619}, {3.78571429, 4.5},
+                   {3.69047619, 4.30952381}, {3.5, 4.21428571}, {3.30952381, 4.30952381},
+                   {3.21428571, 4.5}, {3.30952381, 4.69047619}, {3.5, 4.78571429}},
+              },
+          },
+          {
+              {
+                  {{4.7, 5.7}, {4.5, 5.83333333}, {4.16666667, 5.83333333},
+                   {3.83333333, 5.83333333}, {3.5, 5.83333333}, {3.16666667, 5.83333333},
+                   {2.83333333, 5.83333333}, {2.5, 5.83333333}, {2.3, 5.7}, {2.16666667, 5.5},
+                   {2.16666667, 5.16666667}, {2.16666667, 4.83333333}, {2.16666667, 4.5},
+                   {2.16666667, 4.16666667}, {2.16666667, 3.83333333}, {2.16666667, 3.5},
+                   {2.3, 3.3}, {2.5, 3.16666667}, {2.83333333, 3.16666667},
+                   {3.16666667, 3.16666667}, {3.5, 3.16666667}, {3.83333333, 3.16666667},
+                   {4.16666667, 3.16666667}, {4.5, 3.16666667}, {4.7, 3.3}, {4.83333333, 3.5},
+                   {4.83333333, 3.83333333}, {4.83333333, 4.16666667}, {4.83333333, 4.5},
+                   {4.83333333, 4.83333333}, {4.83333333, 5.16666667}, {4.83333333, 5.5}, {4.7, 5.7}},
+              },
+              {
+                  {{8.5, 5}, {8.83333333, 4.83333333}, {9, 4.5}, {8.83333333, 4.16666667}, {8.5, 4},
+                   {8.16666667, 4.16666667}, {8, 4.5}, {8.16666667, 4.83333333}, {8.5, 5}},
+              },
+              {
+                  {{3.5, 5}, {3.83333333, 4.83333333}, {4, 4.5}, {3.83333333, 4.16666667}, {3.5, 4},
+                   {3.16666667, 4.16666667}, {3, 4.5}, {3.16666667, 4.83333333}, {3.5, 5}},
+              },
+          },
+      },
+  };
+
+  for (bool rings_only : {true, false}) {
+    std::vector<GriddedData<1>::contour_interval_t> iso_markers{
+        {0, 2, "time", ""}, {0, 3.5, "time", ""}, {0, 6, "time", ""}};
+    auto contours = g.GenerateContours(iso_markers, rings_only, 0.f, 0.f);
+    const auto& expected_contours = expected[rings_only ? 0 : 1];
+    ASSERT_EQ(contours.size(), expected_contours.size());
+    for (size_t i = 0; i < contours.size(); ++i) {
+      ASSERT_EQ(contours[i].size(), expected_contours[i].size()) << "interval " << i;
+      auto feature = contours[i].begin();
+      for (const auto& expected_feature : expected_contours[i]) {
+        ASSERT_EQ(feature->size(), expected_feature.size()) << "interval " << i;
+        auto ring = feature->begin();
+        for (const auto& expected_ring : expected_feature) {
+          ASSERT_EQ(ring->size(), expected_ring.size()) << "interval " << i;
+          for (size_t p = 0; p < ring->size(); ++p) {
+            EXPECT_NEAR((*ring)[p].first, expected_ring[p].first, 1e-6) << "interval " << i;
+            EXPECT_NEAR((*ring)[p].second, expected_ring[p].second, 1e-6) << "interval " << i;
+          }
+          ++ring;
+        }
+        ++feature;
+      }
+    }
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
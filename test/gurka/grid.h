@@ -0,0 +1,117 @@
+#pragma once
+/******************************************************************************
+ * The grid the tests of the path algorithms route on
+ *
+ * Its ways are on all of the levels of the hierarchy, some of them are oneway
+ * and a turn restriction at B forces a detour, so that an algorithm that gets
+ * the same costs as A* between every pair of its nodes handles all of those.
+ * 1 and 2 are locations along BC and KL, and P and Q are the ends of a way
+ * that is not connected to the rest of the grid.
+ ******************************************************************************/
+#include "gurka.h"
+
+#include <functional>
+#include <string>
+
+namespace valhalla {
+namespace gurka {
+namespace grid {
+
+// the nodes of the grid the algorithms are compared between
+const std::string kNodes = "ABCDEFGHIJKLMNO";
+
+inline nodelayout layout() {
+  constexpr double gridsize = 100;
+
+  const std::string ascii_map = R"(
+    A----B-1--C----D
+    |    |    |    |
+    E----F----G----H
+    |    |    |    |
+    I----J----K--2-L
+    |         |
+    M----N----O    P----Q)";
+
+  return detail::map_to_coordinates(ascii_map, gridsize);
+}
+
+inline gurka::ways roads() {
+  return {
+      {"AB", {{"highway", "primary"}}},
+      {"BC", {{"highway", "primary"}}},
+      {"CD", {{"highway", "primary"}}},
+      {"EFGH", {{"highway", "residential"}}},
+      {"IJ", {{"highway", "tertiary"}}},
+      {"JK", {{"highway", "tertiary"}, {"oneway", "yes"}}},
+      {"KL", {{"highway", "tertiary"}}},
+      {"MNO", {{"highway", "secondary"}}},
+      {"AEIM", {{"highway", "secondary"}}},
+      {"BFJ", {{"highway", "residential"}}},
+      {"CG", {{"highway", "residential"}, {"oneway", "-1"}}},
+      {"GKO", {{"highway", "residential"}}},
+      {"DHL", {{"highway", "primary"}}},
+  };
+}
+
+// the roads and the way that cant be reached from them
+inline gurka::ways with_island() {
+  auto ways = roads();
+  ways.emplace("PQ", std::map<std::string, std::string>{{"highway", "primary"}});
+  return ways;
+}
+
+// no left turn from BC onto BFJ, so going from C to F has to go around through A and E
+inline gurka::relations restrictions() {
+  return {
+      {{
+           {way_member, "BC", "from"},
+           {way_member, "BFJ", "to"},
+           {node_member, "B", "via"},
+       },
+       {
+           {"type", "restriction"},
+           {"restriction", "no_left_turn"},
+       }},
+  };
+}
+
+inline map build(const std::string& workdir,
+                 const gurka::ways& ways = roads(),
+                 const gurka::relations& relations = restrictions()) {
+  return buildtiles(layout(), ways, {}, relations, workdir);
+}
+
+// the cost of a leg or of the first leg of a route
+inline double cost(const valhalla::TripLeg& leg) {
+  return leg.node().rbegin()->cost().elapsed_cost().cost();
+}
+
+inline double cost(const valhalla::Api& result) {
+  return cost(result.trip().routes(0).legs(0));
+}
+
+// the json of the locations of the named nodes, for the requests that dont go through route()
+inline std::string locations(const map& map, const std::string& names) {
+  std::string locations;
+  for (const auto name : names) {
+    const auto& ll = map.nodes.at(std::string(1, name));
+    locations += std::string(locations.empty() ? "" : ",") + R"({"lon":)" +
+                 std::to_string(ll.lng()) + R"(,"lat":)" + std::to_string(ll.lat()) + "}";
+  }
+  return locations;
+}
+
+// calls the check for every ordered pair of different nodes of the grid
+inline void for_each_pair(const std::function<void(const std::string&, const std::string&)>& check) {
+  for (const auto from : kNodes) {
+    for (const auto to : kNodes) {
+      if (from != to) {
+        check(std::string(1, from), std::string(1, to));
+      }
+    }
+  }
+}
+
+} // namespace grid
+} // namespace gurka
+} // namespace valhalla
@@ -0,0 +1,67 @@
+#include "grid.h"
+#include "test.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+class BatchIsochrone : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    map = gurka::grid::build("test/data/gurka_batch_isochrone", gurka::grid::with_island());
+    map.config.put("thor.isochrone_threads", 3);
+  }
+
+  static std::string request(const std::string& names) {
+    return R"({"costing":"auto","contours":[{"time":1},{"time":2}],"polygons":true,)"
+           R"("locations":[)" +
+           gurka::grid::locations(map, names) + "]}";
+  }
+
+  // checks every location gets the isochrone it would get on its own, whichever thread it was
+  // done on
+  static void expect_same(const std::string& names) {
+    auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+    tyr::actor_t actor(map.config, *reader, true);
+    std::vector<size_t> handed_out(names.size(), 0);
+    auto response =
+        actor.batch_isochrone(request(names), nullptr, nullptr,
+                              [&handed_out](size_t i, const std::string&) { ++handed_out.at(i); });
+    EXPECT_EQ(handed_out, std::vector<size_t>(names.size(), 1));
+
+    rapidjson::Document json;
+    json.Parse(response);
+    ASSERT_FALSE(json.HasParseError());
+    ASSERT_EQ(json["isochrones"].Size(), names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+      rapidjson::Document expected;
+      expected.Parse(actor.isochrone(request(names.substr(i, 1))));
+      EXPECT_EQ(json["isochrones"][i], expected) << names[i];
+    }
+  }
+};
+
+gurka::map BatchIsochrone::map = {};
+
+/*************************************************************/
+TEST_F(BatchIsochrone, SameAsIsochrones) {
+  expect_same("ADFKMOL");
+}
+
+TEST_F(BatchIsochrone, MidEdgeAndIsland) {
+  // the expansions from part way along an edge and the one that cant leave the island dont change
+  // what the others get
+  expect_same("1P2A");
+}
+
+TEST_F(BatchIsochrone, TooManyLocations) {
+  auto config = map.config;
+  config.put("service_limits.isochrone.max_batch_locations", 2);
+  auto reader = test::make_clean_graphreader(config.get_child("mjolnir"));
+  tyr::actor_t actor(config, *reader, true);
+  try {
+    actor.batch_isochrone(request("ADF"));
+    FAIL() << "Expected valhalla_exception_t";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 150); }
+}
@@ -0,0 +1,191 @@
+#include "grid.h"
+#include "mjolnir/contractionhierarchybuilder.h"
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <set>
+
+using namespace valhalla;
+
+class ContractionHierarchy : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::map astar_map;
+
+  static void SetUpTestSuite() {
+    map = gurka::grid::build("test/data/gurka_contraction_hierarchy");
+    astar_map = map;
+
+    // contract it and have the workers map it
+    map.config.put("mjolnir.contraction_hierarchy",
+                   "test/data/gurka_contraction_hierarchy/contraction_hierarchy.bin");
+    mjolnir::ContractionHierarchyBuilder::Build(map.config);
+  }
+};
+
+gurka::map ContractionHierarchy::map = {};
+gurka::map ContractionHierarchy::astar_map = {};
+
+/*************************************************************/
+TEST_F(ContractionHierarchy, SameCostAsAStar) {
+  gurka::grid::for_each_pair([](const std::string& from, const std::string& to) {
+    auto result = gurka::route(map, from, to, "auto");
+    auto expected = gurka::route(astar_map, from, to, "auto");
+    EXPECT_NEAR(gurka::grid::cost(result), gurka::grid::cost(expected), 0.01)
+        << from << " to " << to;
+  });
+}
+
+TEST_F(ContractionHierarchy, MidEdgeAcrossLevels) {
+  // the routes between a primary and a tertiary start and end part way along vertices of the
+  // hierarchy and go up and down its levels
+  for (const auto& waypoints : {std::make_pair("1", "2"), std::make_pair("2", "1")}) {
+    auto result = gurka::route(map, waypoints.first, waypoints.second, "auto");
+    auto expected = gurka::route(astar_map, waypoints.first, waypoints.second, "auto");
+    const auto& leg = result.trip().routes(0).legs(0);
+    EXPECT_EQ(leg.algorithms(0), "contraction_hierarchy");
+    EXPECT_NEAR(gurka::grid::cost(result), gurka::grid::cost(expected), 0.01)
+        << waypoints.first << " to " << waypoints.second;
+
+    std::set<uint32_t> levels;
+    for (const auto& node : leg.node()) {
+      if (node.has_edge()) {
+        levels.insert(baldr::GraphId(node.edge().id()).level());
+      }
+    }
+    EXPECT_GT(levels.size(), 1u) << waypoints.first << " to " << waypoints.second;
+  }
+}
+
+TEST_F(ContractionHierarchy, UsesHierarchy) {
+  auto result = gurka::route(map, "A", "L", "auto");
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "contraction_hierarchy");
+  gurka::assert::raw::expect_path(result, {"AB", "BC", "CD", "DHL", "DHL"});
+}
+
+TEST_F(ContractionHierarchy, ForceDetour) {
+  auto result = gurka::route(map, "C", "F", "auto");
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "contraction_hierarchy");
+  gurka::assert::raw::expect_path(result, {"BC", "AB", "AEIM", "EFGH"});
+}
+
+TEST_F(ContractionHierarchy, OtherOptionsUseAStar) {
+  auto result =
+      gurka::route(map, "A", "L", "auto", {{"/costing_options/auto/use_highways", "0.1"}});
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+
+  result = gurka::route(map, "A", "L", "pedestrian");
+  EXPECT_NE(result.trip().routes(0).legs(0).algorithms(0), "contraction_hierarchy");
+}
+
+TEST_F(ContractionHierarchy, ExplicitDefaultsUseHierarchy) {
+  auto request = R"({"costing":"auto","costing_options":{"auto":{}},"locations":[)" +
+                 gurka::grid::locations(map, "AL") + "]}";
+  auto result = gurka::route(map, request);
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "contraction_hierarchy");
+}
+
+TEST_F(ContractionHierarchy, BucketMatrixSameAsCostMatrix) {
+  const auto& names = gurka::grid::kNodes;
+  const auto locations = gurka::grid::locations(map, names);
+  const auto request =
+      R"({"costing":"auto","sources":[)" + locations + R"(],"targets":[)" + locations + "]}";
+
+  auto matrix = [&](const std::string& algorithm) {
+    auto config = map.config;
+    config.put("thor.source_to_target_algorithm", algorithm);
+    tyr::actor_t actor(config, true);
+    rapidjson::Document doc;
+    doc.Parse(actor.matrix(request));
+    return doc;
+  };
+  auto result = matrix("bucketmatrix");
+  auto expected = matrix("costmatrix");
+
+  const auto& rows = result["sources_to_targets"].GetArray();
+  const auto& expected_rows = expected["sources_to_targets"].GetArray();
+  ASSERT_EQ(rows.Size(), names.size());
+  for (rapidjson::SizeType i = 0; i < rows.Size(); ++i) {
+    ASSERT_EQ(rows[i].Size(), names.size());
+    for (rapidjson::SizeType j = 0; j < rows[i].Size(); ++j) {
+      const auto& cell = rows[i][j];
+      const auto& expected_cell = expected_rows[i][j];
+      EXPECT_NEAR(cell["time"].GetDouble(), expected_cell["time"].GetDouble(), 1)
+          << names[i] << " to " << names[j];
+      EXPECT_NEAR(cell["distance"].GetDouble(), expected_cell["distance"].GetDouble(), 0.01)
+          << names[i] << " to " << names[j];
+    }
+  }
+}
+
+TEST_F(ContractionHierarchy, CorruptOffsetsAreIgnored) {
+  const std::string file = map.config.get<std::string>("mjolnir.contraction_hierarchy");
+  const std::string corrupt = file + ".corrupt";
+  baldr::GraphReader reader(map.config.get_child("mjolnir"));
+  ASSERT_TRUE(valhalla::baldr::ContractionHierarchy().Load(file, reader));
+
+  // make the offset of the second vertex larger than the last one so the first goes out of bounds
+  {
+    std::ofstream(corrupt, std::ios::binary) << std::ifstream(file, std::ios::binary).rdbuf();
+    std::fstream f(corrupt, std::ios::in | std::ios::out | std::ios::binary);
+    uint32_t sizes[6];
+    f.seekg(16);
+    f.read(reinterpret_cast<char*>(sizes), sizeof(sizes));
+    const uint32_t profile_size = sizes[1], tile_count = sizes[2], up_count = sizes[4];
+    const uint32_t offset = up_count + 1;
+    f.seekp(40 + ((profile_size + 7) & ~7u) + tile_count * 16 + sizeof(uint32_t));
+    f.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+  }
+  EXPECT_FALSE(valhalla::baldr::ContractionHierarchy().Load(corrupt, reader));
+  filesystem::remove(corrupt);
+}
+
+class ContractionHierarchySlowEdge : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::map astar_map;
+
+  static void SetUpTestSuite() {
+    constexpr double gridsize = 100;
+
+    const std::string ascii_map = R"(
+    A----B----C----D
+    |              |
+    E-1------------F
+    |              |
+    G----H----I----J)";
+
+    // 1 is near the start of a long road that takes much longer than going around it
+    const gurka::ways ways = {
+        {"ABCD", {{"highway", "primary"}}},
+        {"AEG", {{"highway", "primary"}}},
+        {"DFJ", {{"highway", "primary"}}},
+        {"GHIJ", {{"highway", "primary"}}},
+        {"EF", {{"highway", "residential"}, {"maxspeed", "5"}}},
+    };
+
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, gridsize);
+    const std::string workdir = "test/data/gurka_contraction_hierarchy_slow_edge";
+    map = gurka::buildtiles(layout, ways, {}, {}, workdir);
+    astar_map = map;
+    map.config.put("mjolnir.contraction_hierarchy", workdir + "/contraction_hierarchy.bin");
+    mjolnir::ContractionHierarchyBuilder::Build(map.config);
+  }
+};
+
+gurka::map ContractionHierarchySlowEdge::map = {};
+gurka::map ContractionHierarchySlowEdge::astar_map = {};
+
+TEST_F(ContractionHierarchySlowEdge, DestinationNearStart) {
+  // the reverse search starts from the end of the slow road with less than nothing left to go,
+  // the forward search must not stop before it gets there
+  for (const auto& from : {"A", "B", "C", "D", "G", "H", "I", "J"}) {
+    auto result = gurka::route(map, from, "1", "auto");
+    auto expected = gurka::route(astar_map, from, "1", "auto");
+    EXPECT_NEAR(gurka::grid::cost(result), gurka::grid::cost(expected), 0.01) << from;
+
+    result = gurka::route(map, "1", from, "auto");
+    expected = gurka::route(astar_map, "1", from, "auto");
+    EXPECT_NEAR(gurka::grid::cost(result), gurka::grid::cost(expected), 0.01) << from;
+  }
+}
@@ -32,3 +32,31 @@ TEST(Standalone, DestinationOnly) {
   auto leg = result.trip().routes(0).legs(0);
   gurka::assert::raw::expect_path(result, {"AB", "BC", "CD", "DE", "EF", "FG", "GH", "HI"});
 }
+
+TEST(Standalone, DestinationOnlyThroughRoute) {
+  // the only way across is destination only, so the first pass finds no route and the second
+  // carries on from where it left off
+  const std::string ascii_map = R"(
+      A----B----C
+                |
+                D----E----F
+  )";
+
+  const gurka::ways ways = {
+      {"AB", {{"highway", "residential"}}},
+      {"BC", {{"highway", "residential"}}},
+      {"CD", {{"highway", "residential"}, {"motor_vehicle", "destination"}}},
+      {"DE", {{"highway", "residential"}}},
+      {"EF", {{"highway", "residential"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_destination_through");
+
+  for (const auto& locations : {std::make_pair("A", "F"), std::make_pair("F", "A")}) {
+    auto result = gurka::route(map, locations.first, locations.second, "auto");
+    ASSERT_EQ(result.trip().routes(0).legs_size(), 1);
+    EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+  }
+  auto result = gurka::route(map, "A", "F", "auto");
+  gurka::assert::raw::expect_path(result, {"AB", "BC", "CD", "DE", "EF"});
+}
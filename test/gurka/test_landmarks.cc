@@ -0,0 +1,107 @@
+#include "baldr/landmarks.h"
+#include "grid.h"
+#include "mjolnir/landmarkbuilder.h"
+#include "test.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+class LandmarkHeuristic : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::map astar_map;
+
+  static void SetUpTestSuite() {
+    // CD is oneway so that the landmarks arent the same both ways
+    auto ways = gurka::grid::roads();
+    ways["CD"] = {{"highway", "primary"}, {"oneway", "yes"}};
+    map = gurka::grid::build("test/data/gurka_landmarks", ways);
+    map.config.put("mjolnir.traffic_extract", "test/data/gurka_landmarks/traffic.tar");
+    test::build_live_traffic_data(map.config);
+    astar_map = map;
+
+    // select the landmarks and have the workers map them
+    map.config.put("mjolnir.landmarks", "test/data/gurka_landmarks/landmarks.bin");
+    map.config.put("mjolnir.landmarks_count", 4);
+    mjolnir::LandmarkBuilder::Build(map.config);
+  }
+};
+
+gurka::map LandmarkHeuristic::map = {};
+gurka::map LandmarkHeuristic::astar_map = {};
+
+/*************************************************************/
+TEST_F(LandmarkHeuristic, Load) {
+  baldr::GraphReader reader(map.config.get_child("mjolnir"));
+  baldr::Landmarks landmarks;
+  ASSERT_TRUE(landmarks.Load(map.config.get<std::string>("mjolnir.landmarks"), reader));
+  EXPECT_EQ(landmarks.costing(), static_cast<uint32_t>(Costing::auto_));
+  EXPECT_EQ(landmarks.landmark_count(), 4);
+
+  // every landmark is a node of the highest level, so some node is 0 from each
+  std::vector<bool> found(landmarks.landmark_count(), false);
+  for (uint32_t node = 0; node < landmarks.node_count(); ++node) {
+    for (uint32_t i = 0; i < landmarks.landmark_count(); ++i) {
+      EXPECT_GE(landmarks.from(node)[i], 0.f);
+      EXPECT_GE(landmarks.to(node)[i], 0.f);
+      if (landmarks.from(node)[i] == 0.f && landmarks.to(node)[i] == 0.f) {
+        found[i] = true;
+      }
+    }
+  }
+  for (uint32_t i = 0; i < landmarks.landmark_count(); ++i) {
+    EXPECT_TRUE(found[i]) << "landmark " << i;
+  }
+
+  baldr::Landmarks missing;
+  EXPECT_FALSE(missing.Load("test/data/gurka_landmarks/missing.bin", reader));
+  EXPECT_FALSE(missing);
+}
+
+TEST_F(LandmarkHeuristic, SameCostAsAStar) {
+  gurka::grid::for_each_pair([](const std::string& from, const std::string& to) {
+    auto result = gurka::route(map, from, to, "auto");
+    auto expected = gurka::route(astar_map, from, to, "auto");
+    EXPECT_NEAR(gurka::grid::cost(result), gurka::grid::cost(expected), 0.01)
+        << from << " to " << to;
+  });
+}
+
+TEST_F(LandmarkHeuristic, ClosuresSameCostAsAStar) {
+  // the landmarks were selected on the open roads, closing some only makes the routes longer than
+  // the landmarks say so they still dont overestimate. C is still reached from G and left to D
+  test::customize_live_traffic_data(map.config, [](baldr::GraphReader& reader,
+                                                   baldr::TrafficTile& tile, int index,
+                                                   baldr::TrafficSpeed* current) {
+    for (const auto& closed : {"BC", "CB", "FG", "GF"}) {
+      auto edge = std::get<0>(gurka::findEdgeByNodes(reader, map.nodes, std::string(1, closed[0]),
+                                                     std::string(1, closed[1])));
+      if (edge.Tile_Base() == baldr::GraphId(tile.header->tile_id) &&
+          edge.id() == static_cast<uint32_t>(index)) {
+        current->breakpoint1 = 255;
+        current->overall_speed = 0;
+        current->speed1 = 0;
+      }
+    }
+  });
+
+  gurka::grid::for_each_pair([](const std::string& from, const std::string& to) {
+    auto result = gurka::route(map, from, to, "auto");
+    auto expected = gurka::route(astar_map, from, to, "auto");
+    EXPECT_NEAR(gurka::grid::cost(result), gurka::grid::cost(expected), 0.01)
+        << from << " to " << to;
+  });
+  auto detour = gurka::route(map, "B", "C", "auto");
+  gurka::assert::raw::expect_path(detour, {"BFJ", "BFJ", "JK", "GKO", "CG"});
+
+  // the other tests see the roads open again
+  test::build_live_traffic_data(map.config);
+}
+
+TEST_F(LandmarkHeuristic, OtherOptionsSameCostAsAStar) {
+  const std::unordered_map<std::string, std::string> options = {
+      {"/costing_options/auto/use_highways", "0.1"}};
+  auto result = gurka::route(map, "A", "L", "auto", options);
+  auto expected = gurka::route(astar_map, "A", "L", "auto", options);
+  EXPECT_NEAR(gurka::grid::cost(result), gurka::grid::cost(expected), 0.01);
+}
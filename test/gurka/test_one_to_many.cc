@@ -0,0 +1,88 @@
+#include "grid.h"
+#include "test.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+class OneToMany : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    map = gurka::grid::build("test/data/gurka_one_to_many", gurka::grid::with_island());
+  }
+
+  static std::string request(const std::string& names, const std::string& extra = "") {
+    return R"({"costing":"auto","locations":[)" + gurka::grid::locations(map, names) + "]" +
+           extra + "}";
+  }
+
+  static valhalla::Api one_to_many(const std::string& request,
+                                   rapidjson::Document* json = nullptr) {
+    auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+    tyr::actor_t actor(map.config, *reader, true);
+    valhalla::Api api;
+    auto response = actor.one_to_many(request, nullptr, &api);
+    if (json) {
+      json->Parse(response);
+    }
+    return api;
+  }
+};
+
+gurka::map OneToMany::map = {};
+
+/*************************************************************/
+TEST_F(OneToMany, SameAsRoutes) {
+  // the origin is a node so every route is as cheap as the route found on its own, the ones to
+  // locations along an edge too
+  const std::string destinations = "ABDEFGHIJKLMNO12";
+  rapidjson::Document json;
+  auto result = one_to_many(request("C" + destinations), &json);
+  ASSERT_EQ(result.trip().routes_size(), destinations.size());
+  ASSERT_EQ(json["trips"].Size(), destinations.size());
+  for (size_t i = 0; i < destinations.size(); ++i) {
+    const auto& leg = result.trip().routes(i).legs(0);
+    EXPECT_EQ(leg.algorithms(0), "time_distance_matrix");
+    EXPECT_EQ(leg.location(1).original_index(), i + 1);
+    auto expected = gurka::route(map, "C", std::string(1, destinations[i]), "auto");
+    EXPECT_NEAR(gurka::grid::cost(leg), gurka::grid::cost(expected), 0.01) << destinations[i];
+  }
+}
+
+TEST_F(OneToMany, ForceDetour) {
+  // the turn restriction at B holds for the paths of the shared expansion too
+  auto result = one_to_many(request("CFB"));
+  ASSERT_EQ(result.trip().routes_size(), 2);
+  std::vector<std::string> names;
+  for (const auto& node : result.trip().routes(0).legs(0).node()) {
+    if (node.has_edge()) {
+      names.push_back(node.edge().name(0).value());
+    }
+  }
+  EXPECT_EQ(names, (std::vector<std::string>{"BC", "AB", "AEIM", "EFGH"}));
+}
+
+TEST_F(OneToMany, Budget) {
+  // only the destinations within the budget get a route
+  auto unlimited = one_to_many(request("ABO"));
+  ASSERT_EQ(unlimited.trip().routes_size(), 2);
+  const auto budget = gurka::grid::cost(unlimited) + 1;
+  auto result = one_to_many(request("ABO", R"(,"budget":)" + std::to_string(budget)));
+  ASSERT_EQ(result.trip().routes_size(), 1);
+  EXPECT_EQ(result.trip().routes(0).legs(0).location(1).original_index(), 1);
+}
+
+TEST_F(OneToMany, UnreachableDestinations) {
+  // the destinations on the island get no route and the others get theirs
+  auto result = one_to_many(request("CAPOQ"));
+  ASSERT_EQ(result.trip().routes_size(), 2);
+  EXPECT_EQ(result.trip().routes(0).legs(0).location(1).original_index(), 1);
+  EXPECT_EQ(result.trip().routes(1).legs(0).location(1).original_index(), 3);
+
+  // and with none to get it fails as a route would
+  try {
+    one_to_many(request("CPQ"));
+    FAIL() << "Expected valhalla_exception_t";
+  } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 442); }
+}
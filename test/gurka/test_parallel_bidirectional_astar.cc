@@ -0,0 +1,57 @@
+#include "grid.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+class ParallelBidirectionalAStar : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::map sequential_map;
+
+  static void SetUpTestSuite() {
+    map = gurka::grid::build("test/data/gurka_parallel_bidirectional");
+    sequential_map = map;
+
+    // every route is long enough to run the searches on two threads
+    map.config.put("thor.bidirectional_astar.parallel", true);
+    map.config.put("thor.bidirectional_astar.parallel_min_distance", 0);
+  }
+};
+
+gurka::map ParallelBidirectionalAStar::map = {};
+gurka::map ParallelBidirectionalAStar::sequential_map = {};
+
+/*************************************************************/
+TEST_F(ParallelBidirectionalAStar, SameCostAsSequential) {
+  for (const std::string costing : {"auto", "pedestrian"}) {
+    gurka::grid::for_each_pair([&costing](const std::string& from, const std::string& to) {
+      auto result = gurka::route(map, from, to, costing);
+      auto expected = gurka::route(sequential_map, from, to, costing);
+      EXPECT_NEAR(gurka::grid::cost(result), gurka::grid::cost(expected), 0.01)
+          << costing << " " << from << " to " << to;
+    });
+  }
+}
+
+TEST_F(ParallelBidirectionalAStar, MidEdge) {
+  // the searches start and end part way along their edges and meet somewhere in between
+  for (const std::string costing : {"auto", "pedestrian"}) {
+    for (const auto& waypoints : {std::make_pair("1", "2"), std::make_pair("2", "1")}) {
+      auto result = gurka::route(map, waypoints.first, waypoints.second, costing);
+      auto expected = gurka::route(sequential_map, waypoints.first, waypoints.second, costing);
+      EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0),
+                expected.trip().routes(0).legs(0).algorithms(0));
+      EXPECT_NEAR(gurka::grid::cost(result), gurka::grid::cost(expected), 0.01)
+          << costing << " " << waypoints.first << " to " << waypoints.second;
+    }
+  }
+  auto result = gurka::route(map, "1", "2", "auto");
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+}
+
+TEST_F(ParallelBidirectionalAStar, ForceDetour) {
+  // the turn restriction at B holds with the searches on two threads too
+  auto result = gurka::route(map, "C", "F", "auto");
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+  gurka::assert::raw::expect_path(result, {"BC", "AB", "AEIM", "EFGH"});
+}
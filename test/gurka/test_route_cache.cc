@@ -0,0 +1,113 @@
+#include "gurka.h"
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include "baldr/trafficupdater.h"
+
+using namespace valhalla;
+
+class RouteCache : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static std::string traffic_extract;
+
+  static void SetUpTestSuite() {
+    constexpr double gridsize = 100;
+
+    const std::string ascii_map = R"(
+    A----B----C
+         |    |
+         D----E)";
+
+    const gurka::ways ways = {{"AB", {{"highway", "primary"}, {"maxspeed", "10"}}},
+                              {"BC", {{"highway", "primary"}, {"maxspeed", "10"}}},
+                              {"BD", {{"highway", "primary"}, {"maxspeed", "10"}}},
+                              {"CE", {{"highway", "primary"}, {"maxspeed", "10"}}},
+                              {"DE", {{"highway", "primary"}, {"maxspeed", "10"}}}};
+
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, gridsize);
+    const std::string tile_dir = "test/data/gurka_route_cache";
+    map = gurka::buildtiles(layout, ways, {}, {}, tile_dir);
+    traffic_extract = tile_dir + "/traffic.tar";
+    map.config.put("mjolnir.traffic_extract", traffic_extract);
+    map.config.put("thor.route_cache.enabled", true);
+    map.config.put("thor.route_cache.traffic_check_interval", 0);
+    test::build_live_traffic_data(map.config);
+  }
+
+  static std::string request(const std::string& names, const std::string& costing = "auto") {
+    std::string locations;
+    for (const auto name : names) {
+      const auto& ll = map.nodes[std::string(1, name)];
+      locations += std::string(locations.empty() ? "" : ",") + R"({"lon":)" +
+                   std::to_string(ll.lng()) + R"(,"lat":)" + std::to_string(ll.lat()) + "}";
+    }
+    return R"({"costing":")" + costing + R"(","date_time":{"type":0},"locations":[)" + locations +
+           "]}";
+  }
+
+  // Routes and says whether the route came from the cache
+  static valhalla::Api route(tyr::actor_t& actor, const std::string& request, bool& cached) {
+    valhalla::Api api;
+    actor.route(request, nullptr, &api);
+    cached = false;
+    for (const auto& stat : api.info().statistics()) {
+      if (stat.name() == "thor_worker_t::route_cache_hit") {
+        cached = stat.value() == 1;
+      }
+    }
+    return api;
+  }
+};
+
+gurka::map RouteCache::map = {};
+std::string RouteCache::traffic_extract = {};
+
+/*************************************************************/
+TEST_F(RouteCache, RepeatedRouteHits) {
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+  tyr::actor_t actor(map.config, *reader, true);
+  bool cached = true;
+  auto first = route(actor, request("AC"), cached);
+  EXPECT_FALSE(cached);
+
+  // the same route again comes from the cache and is the same route
+  auto again = route(actor, request("AC"), cached);
+  EXPECT_TRUE(cached);
+  gurka::assert::raw::expect_path(again, {"AB", "BC"});
+  EXPECT_EQ(again.trip().routes(0).legs(0).shape(), first.trip().routes(0).legs(0).shape());
+  EXPECT_EQ(again.directions().routes(0).legs(0).summary().time(),
+            first.directions().routes(0).legs(0).summary().time());
+
+  // another costing or another destination does not
+  route(actor, request("AC", "pedestrian"), cached);
+  EXPECT_FALSE(cached);
+  route(actor, request("AE"), cached);
+  EXPECT_FALSE(cached);
+}
+
+TEST_F(RouteCache, TrafficInvalidates) {
+  auto reader = test::make_clean_graphreader(map.config.get_child("mjolnir"));
+  tyr::actor_t actor(map.config, *reader, true);
+  bool cached = true;
+  auto before = route(actor, request("AC"), cached);
+  route(actor, request("AC"), cached);
+  EXPECT_TRUE(cached);
+
+  // publishing speeds drops the cached route and the next one is found on the new speeds
+  baldr::TrafficUpdater updater(traffic_extract);
+  const baldr::TrafficSpeed speed(40 >> 1, 40 >> 1, baldr::UNKNOWN_TRAFFIC_SPEED_RAW,
+                                  baldr::UNKNOWN_TRAFFIC_SPEED_RAW, 255, 0, 0, 0, 0, false);
+  for (const auto& edge : {"AB", "BC"}) {
+    auto found = gurka::findEdgeByNodes(*reader, map.nodes, std::string(1, edge[0]),
+                                        std::string(1, edge[1]));
+    EXPECT_TRUE(updater.Stage(std::get<0>(found), speed));
+  }
+  EXPECT_GT(updater.Publish(), 0u);
+
+  auto after = route(actor, request("AC"), cached);
+  EXPECT_FALSE(cached);
+  gurka::assert::raw::expect_path(after, {"AB", "BC"});
+  EXPECT_LT(after.directions().routes(0).legs(0).summary().time(),
+            before.directions().routes(0).legs(0).summary().time());
+}
@@ -0,0 +1,90 @@
+#include "grid.h"
+#include "test.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+class RouteLegThreads : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::map sequential_map;
+
+  static void SetUpTestSuite() {
+    map = gurka::grid::build("test/data/gurka_route_leg_threads", gurka::grid::with_island());
+    sequential_map = map;
+    map.config.put("thor.route_leg_threads", 3);
+  }
+
+  static std::vector<uint64_t> edges(const valhalla::TripLeg& leg) {
+    std::vector<uint64_t> edges;
+    for (const auto& node : leg.node()) {
+      if (node.has_edge()) {
+        edges.push_back(node.edge().id());
+      }
+    }
+    return edges;
+  }
+
+  static void expect_same(const std::vector<std::string>& waypoints,
+                          const std::unordered_map<std::string, std::string>& options = {}) {
+    auto result = gurka::route(map, waypoints, "auto", options);
+    auto expected = gurka::route(sequential_map, waypoints, "auto", options);
+    ASSERT_EQ(result.trip().routes(0).legs_size(), expected.trip().routes(0).legs_size());
+    for (int i = 0; i < result.trip().routes(0).legs_size(); ++i) {
+      const auto& leg = result.trip().routes(0).legs(i);
+      const auto& expected_leg = expected.trip().routes(0).legs(i);
+      EXPECT_EQ(edges(leg), edges(expected_leg)) << "leg " << i;
+      EXPECT_NEAR(leg.node().rbegin()->cost().elapsed_cost().cost(),
+                  expected_leg.node().rbegin()->cost().elapsed_cost().cost(), 0.01)
+          << "leg " << i;
+      ASSERT_EQ(leg.algorithms_size(), expected_leg.algorithms_size()) << "leg " << i;
+      for (int j = 0; j < leg.algorithms_size(); ++j) {
+        EXPECT_EQ(leg.algorithms(j), expected_leg.algorithms(j)) << "leg " << i;
+      }
+    }
+  }
+};
+
+gurka::map RouteLegThreads::map = {};
+gurka::map RouteLegThreads::sequential_map = {};
+
+/*************************************************************/
+TEST_F(RouteLegThreads, BreaksSameAsOneThread) {
+  expect_same({"A", "D", "O", "M", "H", "I"});
+  expect_same({"C", "F", "L", "A", "K"});
+}
+
+TEST_F(RouteLegThreads, ThroughsSameAsOneThread) {
+  // the legs leaving the through locations continue on the edge the leg before them ended on
+  expect_same({"A", "G", "L", "M", "D"}, {{"/locations/1/type", "through"}});
+  expect_same({"A", "G", "L", "M", "D"},
+              {{"/locations/1/type", "through"}, {"/locations/3/type", "break_through"}});
+}
+
+TEST_F(RouteLegThreads, InvariantTimesSameAsOneThread) {
+  expect_same({"A", "D", "O", "M"},
+              {{"/date_time/type", "3"}, {"/date_time/value", "2020-10-30T09:00"}});
+}
+
+TEST_F(RouteLegThreads, LegWithoutPath) {
+  // the legs to and from the island have no path, whichever thread finds that the request fails
+  // as it does on one thread and the threads are there for the next request
+  for (const auto* leg_map : {&map, &sequential_map}) {
+    auto reader = test::make_clean_graphreader(leg_map->config.get_child("mjolnir"));
+    tyr::actor_t actor(leg_map->config, *reader);
+    auto request = [leg_map](const std::string& names) {
+      return R"({"costing":"auto","locations":[)" + gurka::grid::locations(*leg_map, names) + "]}";
+    };
+    for (const auto& names : {"ADPQO", "ADOP", "PADO"}) {
+      try {
+        actor.route(request(names));
+        FAIL() << "Expected valhalla_exception_t for " << names;
+      } catch (const valhalla_exception_t& e) { EXPECT_EQ(e.code, 442) << names; }
+      actor.cleanup();
+    }
+
+    valhalla::Api api;
+    actor.route(request("ADOM"), nullptr, &api);
+    EXPECT_EQ(api.trip().routes(0).legs_size(), 3);
+  }
+}
@@ -0,0 +1,120 @@
+#include "gurka.h"
+#include "test.h"
+#include <gtest/gtest.h>
+
+using namespace valhalla;
+
+class TimeDependentMatrix : public ::testing::Test {
+protected:
+  static gurka::map map;
+
+  static void SetUpTestSuite() {
+    constexpr double gridsize = 100;
+
+    const std::string ascii_map = R"(
+    A----B----C----D
+    |    |    |    |
+    E----F----G----H
+    |    |    |    |
+    I----J----K----L)";
+
+    const gurka::ways ways = {
+        {"AB", {{"highway", "primary"}}},      {"BC", {{"highway", "primary"}}},
+        {"CD", {{"highway", "primary"}}},      {"EFGH", {{"highway", "residential"}}},
+        {"IJ", {{"highway", "tertiary"}}},     {"JK", {{"highway", "tertiary"}}},
+        {"KL", {{"highway", "tertiary"}}},     {"AEI", {{"highway", "secondary"}}},
+        {"BFJ", {{"highway", "residential"}}}, {"CGK", {{"highway", "residential"}}},
+        {"DHL", {{"highway", "primary"}}},
+    };
+
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, gridsize);
+    map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_time_dependent_matrix",
+                            {{"mjolnir.shortcuts", "false"}});
+    map.config.put("thor.time_dependent_matrix", true);
+
+    // slow during the day and fast at night
+    test::customize_historical_traffic(map.config, [](baldr::DirectedEdge& e) {
+      e.set_free_flow_speed(80);
+      e.set_constrained_flow_speed(10);
+      return std::vector<int16_t>{};
+    });
+  }
+
+  // The times of the matrix between all of the nodes, -1 where there is no time
+  static std::vector<int64_t> matrix(const std::string& extra = "",
+                                     const boost::property_tree::ptree* config = nullptr) {
+    std::string locations;
+    for (const auto name : names) {
+      const auto& ll = map.nodes[std::string(1, name)];
+      locations += std::string(locations.empty() ? "" : ",") + R"({"lon":)" +
+                   std::to_string(ll.lng()) + R"(,"lat":)" + std::to_string(ll.lat()) + "}";
+    }
+    tyr::actor_t actor(config ? *config : map.config, true);
+    rapidjson::Document doc;
+    doc.Parse(actor.matrix(R"({"costing":"auto","sources":[)" + locations + R"(],"targets":[)" +
+                           locations + "]" + extra + "}"));
+    std::vector<int64_t> times;
+    for (const auto& row : doc["sources_to_targets"].GetArray()) {
+      for (const auto& cell : row.GetArray()) {
+        times.push_back(cell["time"].IsNull() ? -1 : cell["time"].GetInt64());
+      }
+    }
+    return times;
+  }
+
+  static const std::string names;
+};
+
+gurka::map TimeDependentMatrix::map = {};
+const std::string TimeDependentMatrix::names = "ADFGIL";
+
+/*************************************************************/
+TEST_F(TimeDependentMatrix, DaytimeSameAsInvariant) {
+  // without a time the edges are at their constrained speed, the one they have during the day
+  auto invariant = matrix();
+  auto daytime = matrix(R"(,"date_time":{"type":1,"value":"2021-06-08T12:00"})");
+  ASSERT_EQ(daytime.size(), names.size() * names.size());
+  for (size_t i = 0; i < daytime.size(); ++i) {
+    EXPECT_NEAR(daytime[i], invariant[i], 1) << names[i / names.size()] << " to "
+                                              << names[i % names.size()];
+  }
+}
+
+TEST_F(TimeDependentMatrix, NightFasterThanInvariant) {
+  auto invariant = matrix();
+  auto night = matrix(R"(,"date_time":{"type":1,"value":"2021-06-08T03:00"})");
+  ASSERT_EQ(night.size(), names.size() * names.size());
+  for (size_t i = 0; i < night.size(); ++i) {
+    if (i / names.size() == i % names.size()) {
+      continue;
+    }
+    EXPECT_LT(night[i], invariant[i]) << names[i / names.size()] << " to "
+                                      << names[i % names.size()];
+  }
+}
+
+TEST_F(TimeDependentMatrix, SameAsTimeDependentRoutes) {
+  // every source departs at the time, not only the first one
+  const std::string date_time = "2021-06-08T03:00";
+  auto night = matrix(R"(,"date_time":{"type":1,"value":")" + date_time + R"("})");
+  for (size_t i = 0; i < names.size(); ++i) {
+    for (size_t j = 0; j < names.size(); ++j) {
+      if (i == j) {
+        continue;
+      }
+      auto route = gurka::route(map, std::string(1, names[i]), std::string(1, names[j]), "auto",
+                                {{"/date_time/type", "1"}, {"/date_time/value", date_time}});
+      const auto seconds =
+          route.trip().routes(0).legs(0).node().rbegin()->cost().elapsed_cost().seconds();
+      EXPECT_NEAR(night[i * names.size() + j], seconds, 1) << names[i] << " to " << names[j];
+    }
+  }
+}
+
+TEST_F(TimeDependentMatrix, DisabledIgnoresTime) {
+  auto config = map.config;
+  config.put("thor.time_dependent_matrix", false);
+  auto invariant = matrix("", &config);
+  auto night = matrix(R"(,"date_time":{"type":1,"value":"2021-06-08T03:00"})", &config);
+  EXPECT_EQ(night, invariant);
+}
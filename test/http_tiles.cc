@@ -1,5 +1,6 @@
 #include "test.h"
 
+#include "baldr/curl_multi_tilegetter.h"
 #include "baldr/curl_tilegetter.h"
 #include "baldr/graphtile.h"
 #include "tyr/actor.h"
@@ -300,6 +301,97 @@ TEST(HttpTiles, test_interrupt) {
   }
 }
 
+TEST(HttpTiles, test_coalesced_multiple_threads) {
+  using namespace baldr;
+
+  TestTileDownloadData params;
+  const auto tile_uri = params.tile_url_base + params.test_tile_names[0] + params.request_params;
+
+  // every thread gets its own copy but they all share the transfers
+  curl_multi_tile_getter_t tile_getter(2, "", params.is_gzipped_tile);
+  EXPECT_EQ(tile_getter.gzipped(), params.is_gzipped_tile);
+
+  const size_t thread_count = 8, tile_count = 4;
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count);
+  for (size_t thread_i = 0; thread_i < thread_count; ++thread_i) {
+    threads.emplace_back([&]() {
+      curl_multi_tile_getter_t getter(tile_getter);
+      for (size_t tile_i = 0; tile_i < tile_count; ++tile_i) {
+        auto result = getter.get(tile_uri);
+        ASSERT_EQ(result.status_, tile_getter_t::status_code_t::SUCCESS);
+        auto tile = GraphTile::Create(GraphId(), std::move(result.bytes_));
+        ASSERT_TRUE(tile);
+        EXPECT_EQ(tile->id(), params.test_tile_ids[0]);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // each request either started a download or joined one
+  EXPECT_EQ(tile_getter.transfer_count() + tile_getter.coalesced_count(), thread_count * tile_count);
+  EXPECT_GE(tile_getter.transfer_count(), 1u);
+}
+
+TEST(HttpTiles, test_coalesced_batch) {
+  using namespace baldr;
+
+  TestTileDownloadData params;
+  std::vector<std::string> uris;
+  for (const auto& name : params.test_tile_names) {
+    uris.push_back(params.tile_url_base + name + params.request_params);
+  }
+  // ask for the first one twice in the same batch
+  uris.push_back(uris.front());
+
+  curl_multi_tile_getter_t tile_getter(2, "", params.is_gzipped_tile);
+  auto results = tile_getter.get_batch(uris);
+  ASSERT_EQ(results.size(), uris.size());
+  EXPECT_EQ(tile_getter.transfer_count(), params.test_tile_ids.size());
+  EXPECT_EQ(tile_getter.coalesced_count(), 1u);
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    // only the second ask for the first tile joined a download, so only it leaves saving to others
+    EXPECT_EQ(results[i].coalesced_, i + 1 == results.size());
+    auto expected_tile_id = params.test_tile_ids[i % params.test_tile_ids.size()];
+    if (expected_tile_id == params.get_nonexistent_tile_id()) {
+      EXPECT_EQ(results[i].status_, tile_getter_t::status_code_t::FAILURE);
+      continue;
+    }
+    ASSERT_EQ(results[i].status_, tile_getter_t::status_code_t::SUCCESS);
+    auto tile = GraphTile::Create(GraphId(), std::move(results[i].bytes_));
+    ASSERT_TRUE(tile);
+    EXPECT_EQ(tile->id(), expected_tile_id);
+  }
+}
+
+TEST_F(HttpTilesWithCache, test_batch_write_through) {
+  using namespace baldr;
+
+  TestTileDownloadData params;
+  curl_multi_tile_getter_t tile_getter(2, "", params.is_gzipped_tile);
+  auto tiles = GraphTile::CacheTileURLs(params.full_tile_url_pattern, params.test_tile_ids,
+                                        &tile_getter, "url_tile_cache");
+  ASSERT_EQ(tiles.size(), params.test_tile_ids.size());
+
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    const auto& id = params.test_tile_ids[i];
+    if (id == params.get_nonexistent_tile_id()) {
+      EXPECT_FALSE(tiles[i]) << "Expected no tile";
+      continue;
+    }
+    ASSERT_TRUE(tiles[i]);
+    EXPECT_EQ(tiles[i]->id(), id);
+
+    // it should have been written through to disk and be loadable from there
+    auto from_disk = GraphTile::Create("url_tile_cache", id);
+    ASSERT_TRUE(from_disk);
+    EXPECT_EQ(from_disk->id(), id);
+  }
+}
+
 class HttpTilesEnv : public ::testing::Environment {
 public:
   void SetUp() override {
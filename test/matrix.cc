@@ -276,6 +276,59 @@ TEST(Matrix, test_matrix) {
   }
 }
 
+TEST(Matrix, test_matrix_threads) {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(R"({
+    "sources":[
+      {"lat":52.106337,"lon":5.101728},{"lat":52.111276,"lon":5.089717},
+      {"lat":52.103105,"lon":5.081005},{"lat":52.103948,"lon":5.06813},
+      {"lat":52.084602,"lon":5.119457},{"lat":52.090823,"lon":5.130312},
+      {"lat":52.071398,"lon":5.101932},{"lat":52.122517,"lon":5.052718}
+    ],
+    "targets":[
+      {"lat":52.106126,"lon":5.101497},{"lat":52.100469,"lon":5.087099},
+      {"lat":52.103105,"lon":5.081005},{"lat":52.094273,"lon":5.075254},
+      {"lat":52.079142,"lon":5.142376},{"lat":52.113964,"lon":5.118627},
+      {"lat":52.088613,"lon":5.061402}
+    ],
+    "costing":"auto"
+  })",
+           Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] = CreateSimpleCost(
+      request.options().costing_options(static_cast<int>(request.options().costing())));
+
+  // the threads must not change a thing about the results
+  CostMatrix serial_matrix;
+  auto expected =
+      serial_matrix.SourceToTarget(request.options().sources(), request.options().targets(), reader,
+                                   mode_costing, TravelMode::kDrive, 400000.0);
+  for (uint32_t threads : {2, 3, 8, 64}) {
+    // nor does it matter that the threads expanded a matrix before
+    const auto matrix_threads = CostMatrix::MakeThreads(config.get_child("mjolnir"), threads);
+    for (int run = 0; run < 2; ++run) {
+      CostMatrix cost_matrix(matrix_threads);
+      auto results = cost_matrix.SourceToTarget(request.options().sources(),
+                                                request.options().targets(), reader, mode_costing,
+                                                TravelMode::kDrive, 400000.0);
+      ASSERT_EQ(results.size(), expected.size());
+      for (uint32_t i = 0; i < results.size(); ++i) {
+        EXPECT_EQ(results[i].dist, expected[i].dist)
+            << "result " << i << " differs with " << threads << " threads";
+        EXPECT_EQ(results[i].time, expected[i].time)
+            << "result " << i << " differs with " << threads << " threads";
+      }
+    }
+  }
+}
+
 // TODO: it was commented before. Why?
 TEST(Matrix, DISABLED_test_matrix_osrm) {
   loki_worker_t loki_worker(config);
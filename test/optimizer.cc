@@ -1,6 +1,10 @@
 #include "thor/optimizer.h"
 #include "config.h"
+#include "thor/local_search_optimizer.h"
+#include <algorithm>
 #include <cstdint>
+#include <numeric>
+#include <random>
 #include <vector>
 
 #include "test.h"
@@ -33,6 +37,84 @@ TEST(Optimizer, Basic) {
                               2068, 1133, 1754, 2704, 2193, 1102, 2230, 2937, 854,  2000, 0};
   std::vector<uint32_t> expected_order = {0, 3, 7, 4, 6, 2, 8, 5, 9, 1, 10};
   TryOptimizer(11, costs, expected_order);
+
+  // local search finds the same tour, on any number of threads
+  for (uint32_t threads : {1, 3}) {
+    LocalSearchOptimizer local_search(threads);
+    EXPECT_EQ(local_search.Solve(11, costs), expected_order);
+  }
+}
+
+// Random asymmetric costs between points in a square, the way from one to another some way off
+// the straight line
+std::vector<float> RandomCosts(const uint32_t count, const uint32_t seed) {
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<float> coordinate(0.f, 10000.f), detour(1.f, 1.5f);
+  std::vector<std::pair<float, float>> points(count);
+  for (auto& point : points) {
+    point = {coordinate(random), coordinate(random)};
+  }
+  std::vector<float> costs(count * count, 0.f);
+  for (uint32_t i = 0; i < count; ++i) {
+    for (uint32_t j = 0; j < count; ++j) {
+      if (i != j) {
+        costs[i * count + j] = std::hypot(points[i].first - points[j].first,
+                                          points[i].second - points[j].second) *
+                               detour(random);
+      }
+    }
+  }
+  return costs;
+}
+
+bool IsTour(const uint32_t count, std::vector<uint32_t> tour) {
+  if (tour.size() != count || tour.front() != 0 || tour.back() != count - 1) {
+    return false;
+  }
+  std::sort(tour.begin(), tour.end());
+  std::vector<uint32_t> all(count);
+  std::iota(all.begin(), all.end(), 0);
+  return tour == all;
+}
+
+TEST(LocalSearchOptimizer, Optimal) {
+  // small enough to try every order of the locations in between
+  constexpr uint32_t count = 9;
+  for (uint32_t seed = 0; seed < 10; ++seed) {
+    auto costs = RandomCosts(count, seed);
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    double optimal = LocalSearchOptimizer::TourCost(costs, order);
+    while (std::next_permutation(order.begin() + 1, order.end() - 1)) {
+      optimal = std::min(optimal, LocalSearchOptimizer::TourCost(costs, order));
+    }
+    auto tour = LocalSearchOptimizer().Solve(count, costs);
+    ASSERT_TRUE(IsTour(count, tour));
+    EXPECT_NEAR(LocalSearchOptimizer::TourCost(costs, tour), optimal, 0.01) << "seed " << seed;
+  }
+}
+
+TEST(LocalSearchOptimizer, ManyLocations) {
+  constexpr uint32_t count = 150;
+  auto costs = RandomCosts(count, 7);
+  auto tour = LocalSearchOptimizer().Solve(count, costs);
+  ASSERT_TRUE(IsTour(count, tour));
+
+  // no worse than simulated annealing and the same on any number of threads
+  Optimizer annealing;
+  annealing.Seed(111111);
+  auto annealed = annealing.Solve(count, costs);
+  EXPECT_LE(LocalSearchOptimizer::TourCost(costs, tour),
+            LocalSearchOptimizer::TourCost(costs, annealed));
+  EXPECT_EQ(LocalSearchOptimizer(4).Solve(count, costs), tour);
+}
+
+TEST(LocalSearchOptimizer, TimeBudget) {
+  // whatever the time allows there is a tour
+  constexpr uint32_t count = 300;
+  auto costs = RandomCosts(count, 3);
+  auto tour = LocalSearchOptimizer(2, 64, 1).Solve(count, costs);
+  EXPECT_TRUE(IsTour(count, tour));
 }
 
 } // namespace
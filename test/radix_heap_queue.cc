@@ -0,0 +1,172 @@
+#include "baldr/radix_heap_queue.h"
+#include "baldr/double_bucket_queue.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+struct simple_label {
+  float c;
+  float sortcost() const {
+    return c;
+  }
+};
+
+void TryAddRemove(const std::vector<float>& costs) {
+  std::vector<simple_label> edgelabels;
+  RadixHeapQueue<simple_label> adjlist(edgelabels);
+  for (auto cost : costs) {
+    edgelabels.emplace_back(simple_label{cost});
+    adjlist.add(edgelabels.size() - 1);
+  }
+
+  std::vector<float> expectedorder = costs;
+  std::sort(expectedorder.begin(), expectedorder.end());
+  for (auto expected : expectedorder) {
+    uint32_t labelindex = adjlist.pop();
+    ASSERT_NE(labelindex, kInvalidLabel) << "TryAddRemove: ran out of labels";
+    EXPECT_EQ(edgelabels[labelindex].sortcost(), expected) << "TryAddRemove: expected order failed";
+  }
+  EXPECT_EQ(adjlist.pop(), kInvalidLabel);
+}
+
+TEST(RadixHeapQueue, TestAddRemove) {
+  TryAddRemove({67, 325, 25, 466, 1000, 100005, 758, 167, 258, 16442, 278, 111111000});
+  TryAddRemove({1320209856.f});
+  // fractions and costs that are the same
+  TryAddRemove({0.5f, 0.25f, 3.75f, 3.75f, 0.f, 1e-6f, 1e6f, 0.25f});
+}
+
+TEST(RadixHeapQueue, TestNegativeCosts) {
+  // reverse searches can start with negative costs
+  TryAddRemove({-5.f, 10.f, -0.5f, 0.f, -1000.f, 2.f, -std::numeric_limits<float>::max()});
+}
+
+TEST(RadixHeapQueue, TestClear) {
+  std::vector<simple_label> edgelabels{{67}, {325}, {25}, {466}};
+  RadixHeapQueue<simple_label> adjlist(edgelabels);
+  for (uint32_t i = 0; i < edgelabels.size(); ++i) {
+    adjlist.add(i);
+  }
+  EXPECT_EQ(adjlist.pop(), 2u);
+  adjlist.clear();
+  EXPECT_EQ(adjlist.pop(), kInvalidLabel) << "TryClear: failed to return invalid index after clear";
+
+  // after a clear the costs can start from anywhere again
+  edgelabels.push_back({1});
+  adjlist.add(4);
+  EXPECT_EQ(adjlist.pop(), 4u);
+}
+
+TEST(RadixHeapQueue, TestDecrease) {
+  std::vector<simple_label> edgelabels{{10}, {500}, {20000}, {30}};
+  RadixHeapQueue<simple_label> adjlist(edgelabels);
+  for (uint32_t i = 0; i < edgelabels.size(); ++i) {
+    adjlist.add(i);
+  }
+  EXPECT_EQ(adjlist.pop(), 0u);
+
+  // the queue is told before the label is updated
+  adjlist.decrease(2, 11);
+  edgelabels[2].c = 11;
+  adjlist.decrease(1, 29);
+  edgelabels[1].c = 29;
+  EXPECT_EQ(adjlist.pop(), 2u);
+  EXPECT_EQ(adjlist.pop(), 1u);
+  EXPECT_EQ(adjlist.pop(), 3u);
+  EXPECT_EQ(adjlist.pop(), kInvalidLabel);
+}
+
+TEST(RadixHeapQueue, TestBelowLastPopped) {
+  // a label cheaper than the last one popped comes out next rather than getting lost
+  std::vector<simple_label> edgelabels{{100}, {200}};
+  RadixHeapQueue<simple_label> adjlist(edgelabels);
+  adjlist.add(0);
+  adjlist.add(1);
+  EXPECT_EQ(adjlist.pop(), 0u);
+  edgelabels.push_back({50});
+  adjlist.add(2);
+  EXPECT_EQ(adjlist.pop(), 2u);
+  EXPECT_EQ(adjlist.pop(), 1u);
+  EXPECT_EQ(adjlist.pop(), kInvalidLabel);
+}
+
+TEST(RadixHeapQueue, TestReuseStorage) {
+  std::vector<simple_label> edgelabels{{3}, {1}, {2}};
+  RadixHeapQueue<simple_label> adjlist(edgelabels);
+  for (uint32_t i = 0; i < edgelabels.size(); ++i) {
+    adjlist.add(i);
+  }
+  EXPECT_EQ(adjlist.pop(), 1u);
+
+  // the buckets of either kind of queue come back empty in the other
+  DoubleBucketQueue<simple_label> dbqueue(0, 100, 1, edgelabels, adjlist.release());
+  EXPECT_EQ(dbqueue.pop(), kInvalidLabel);
+  dbqueue.add(0);
+  RadixHeapQueue<simple_label> again(edgelabels, dbqueue.release());
+  EXPECT_EQ(again.pop(), kInvalidLabel);
+}
+
+TEST(RadixHeapQueue, TestSimulation) {
+  std::mt19937 gen(0);
+  for (float max_increment_cost : {1.f, 100.f, 100000.f}) {
+    std::vector<simple_label> costs{{10.f}};
+    RadixHeapQueue<simple_label> rhqueue(costs);
+    std::unordered_set<uint32_t> added{0};
+    rhqueue.add(0);
+
+    // pop the cheapest, then add or decrease some labels no cheaper than it
+    for (size_t loop = 0; loop < 1000; ++loop) {
+      const auto top = rhqueue.pop();
+      if (top == kInvalidLabel) {
+        break;
+      }
+      const auto min_cost = costs[top].sortcost();
+      for (auto k : added) {
+        EXPECT_LE(min_cost, costs[k].sortcost()) << "Simulation: minimal cost expected";
+      }
+      added.erase(top);
+
+      for (size_t i = 0; i < 10; ++i) {
+        const auto newcost = min_cost + test::rand01(gen) * max_increment_cost;
+        if (i % 2 == 0 && !added.empty()) {
+          const auto idx = *std::next(added.begin(), test::rand01(gen) * (added.size() - 1));
+          if (newcost < costs[idx].sortcost()) {
+            rhqueue.decrease(idx, newcost);
+            costs[idx] = {newcost};
+          }
+        } else {
+          costs.push_back({newcost});
+          rhqueue.add(costs.size() - 1);
+          added.insert(costs.size() - 1);
+        }
+      }
+    }
+
+    // what is left comes out in order
+    auto previous_cost = -std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i < added.size(); ++i) {
+      const auto top = rhqueue.pop();
+      ASSERT_NE(top, kInvalidLabel);
+      EXPECT_LE(previous_cost, costs[top].sortcost()) << "Simulation: expected order failed";
+      previous_cost = costs[top].sortcost();
+    }
+    EXPECT_EQ(rhqueue.pop(), kInvalidLabel) << "Simulation: expect queue to be empty";
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
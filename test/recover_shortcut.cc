@@ -1,5 +1,7 @@
 #include "test.h"
 
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -62,8 +64,16 @@ boost::property_tree::ptree get_conf() {
 
 // expose the constructor
 struct testable_recovery : public shortcut_recovery_t {
-  testable_recovery(GraphReader* reader) : shortcut_recovery_t(reader) {
+  testable_recovery(GraphReader* reader, const std::string& file = "")
+      : shortcut_recovery_t(reader, file) {
   }
+  bool is_mapped() const {
+    return keys != nullptr;
+  }
+  size_t size() const {
+    return keys ? count : shortcuts.size();
+  }
+  using shortcut_recovery_t::shortcuts;
 };
 
 void recover(bool cache) {
@@ -168,6 +178,56 @@ TEST(RecoverShortcut, test_recover_shortcut_edges_cache) {
   recover(true);
 }
 
+TEST(RecoverShortcut, test_recover_shortcut_edges_file) {
+  auto conf = get_conf();
+  GraphReader graphreader(conf.get_child("mjolnir"));
+  const std::string file = "recover_shortcut_test.bin";
+  shortcut_recovery_t::save(graphreader, file);
+
+  // the mapped file should have exactly what we would have recovered in memory
+  testable_recovery in_memory{&graphreader};
+  testable_recovery mapped{&graphreader, file};
+  ASSERT_FALSE(in_memory.is_mapped());
+  ASSERT_TRUE(mapped.is_mapped());
+  ASSERT_GT(in_memory.size(), 0u);
+  EXPECT_EQ(mapped.size(), in_memory.size());
+  for (const auto& shortcut : in_memory.shortcuts) {
+    EXPECT_EQ(mapped.get(GraphId(shortcut.first), graphreader), shortcut.second);
+  }
+
+  // a file made from some other tileset should be ignored
+  {
+    std::fstream f(file, std::ios::in | std::ios::out | std::ios::binary);
+    uint64_t dataset_id;
+    f.seekg(8);
+    f.read(reinterpret_cast<char*>(&dataset_id), sizeof(dataset_id));
+    ++dataset_id;
+    f.seekp(8);
+    f.write(reinterpret_cast<const char*>(&dataset_id), sizeof(dataset_id));
+  }
+  testable_recovery stale{&graphreader, file};
+  EXPECT_FALSE(stale.is_mapped());
+  EXPECT_EQ(stale.size(), in_memory.size());
+
+  // so should one whose offsets would point outside of the edges
+  shortcut_recovery_t::save(graphreader, file);
+  {
+    std::fstream f(file, std::ios::in | std::ios::out | std::ios::binary);
+    uint64_t count, edge_count;
+    f.seekg(16);
+    f.read(reinterpret_cast<char*>(&count), sizeof(count));
+    f.read(reinterpret_cast<char*>(&edge_count), sizeof(edge_count));
+    ASSERT_GT(count, 1u);
+    const uint64_t offset = edge_count + 1;
+    f.seekp(32 + (count + 1) * sizeof(uint64_t));
+    f.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+  }
+  testable_recovery corrupt{&graphreader, file};
+  EXPECT_FALSE(corrupt.is_mapped());
+  EXPECT_EQ(corrupt.size(), in_memory.size());
+  std::remove(file.c_str());
+}
+
 int main(int argc, char* argv[]) {
   // valhalla::midgard::logging::Configure({{"type", ""}});
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,217 @@
+#include "thor/route_cache.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla;
+using namespace valhalla::thor;
+
+namespace {
+
+// a cache whose clock only moves when the test says so
+class test_cache : public RouteCache {
+public:
+  using RouteCache::RouteCache;
+
+  void advance(const std::chrono::milliseconds& by) {
+    time_ += by;
+  }
+
+protected:
+  clock_t::time_point now() const override {
+    return time_;
+  }
+
+  clock_t::time_point time_ = clock_t::time_point{} + std::chrono::hours(1);
+};
+
+// a correlated route request between two edges
+Api make_request(const uint64_t from,
+                 const uint64_t to,
+                 const double percent_along = 0.5,
+                 const std::string& costing_options = "") {
+  Api request;
+  auto& options = *request.mutable_options();
+  options.set_action(Options::route);
+  options.set_costing(Costing::auto_);
+  if (!costing_options.empty()) {
+    options.add_costing_options()->set_name(costing_options);
+  }
+  for (const auto edge : {from, to}) {
+    auto* location = options.add_locations();
+    location->set_original_index(options.locations_size() - 1);
+    location->mutable_ll()->set_lng(5.0 + edge);
+    location->mutable_ll()->set_lat(52.0);
+    auto* path_edge = location->add_path_edges();
+    path_edge->set_graph_id(edge);
+    path_edge->set_percent_along(percent_along);
+  }
+  return request;
+}
+
+// what thor would add to the request, a trip whose leg has the locations with the edge it took
+void add_route(Api& request, const std::string& name) {
+  auto* leg = request.mutable_trip()->add_routes()->add_legs();
+  leg->set_shape(name);
+  for (const auto& location : request.options().locations()) {
+    *leg->add_location() = location;
+  }
+}
+
+TEST(RouteCache, Key) {
+  const auto key = RouteCache::MakeKey(make_request(1, 2));
+  EXPECT_EQ(key, RouteCache::MakeKey(make_request(1, 2)));
+
+  // the same edges from somewhere else and what only changes the response dont matter
+  auto other = make_request(1, 2);
+  other.mutable_options()->mutable_locations(0)->mutable_ll()->set_lat(52.001);
+  other.mutable_options()->set_id("again");
+  other.mutable_options()->set_language("de-DE");
+  other.mutable_options()->set_units(Options::miles);
+  EXPECT_EQ(key, RouteCache::MakeKey(other));
+  const double nearby = 0.5 + 0.1 / RouteCache::kPercentAlongSteps;
+  EXPECT_EQ(key, RouteCache::MakeKey(make_request(1, 2, nearby)));
+
+  // but the edges, where along them and the costing do
+  EXPECT_NE(key, RouteCache::MakeKey(make_request(2, 1)));
+  EXPECT_NE(key, RouteCache::MakeKey(make_request(1, 2, 0.6)));
+  EXPECT_NE(key, RouteCache::MakeKey(make_request(1, 2, 0.5, "other")));
+  other = make_request(1, 2);
+  other.mutable_options()->mutable_locations(1)->add_path_edges()->set_graph_id(3);
+  EXPECT_NE(key, RouteCache::MakeKey(other));
+  other = make_request(1, 2);
+  other.mutable_options()->set_date_time_type(Options::arrive_by);
+  EXPECT_NE(key, RouteCache::MakeKey(other));
+}
+
+TEST(RouteCache, GetPut) {
+  test_cache cache;
+  auto request = make_request(1, 2);
+  const auto key = RouteCache::MakeKey(request);
+  EXPECT_FALSE(cache.Get(key, request));
+  add_route(request, "first");
+  cache.Put(key, request, 0);
+  EXPECT_EQ(cache.size(), 1u);
+
+  // a request snapped a tiny bit further along gets the route with its own locations on the
+  // edges of the route
+  auto again = make_request(1, 2, 0.5 + 0.1 / RouteCache::kPercentAlongSteps);
+  again.mutable_options()->mutable_locations(1)->set_name("there");
+  ASSERT_TRUE(cache.Get(key, again));
+  ASSERT_EQ(again.trip().routes_size(), 1);
+  const auto& leg = again.trip().routes(0).legs(0);
+  EXPECT_EQ(leg.shape(), "first");
+  EXPECT_EQ(leg.location(1).name(), "there");
+  ASSERT_EQ(leg.location(1).path_edges_size(), 1);
+  EXPECT_EQ(leg.location(1).path_edges(0).graph_id(), 2u);
+  EXPECT_EQ(leg.location(1).path_edges(0).percent_along(), 0.5);
+  EXPECT_EQ(again.options().locations(1).name(), "there");
+  EXPECT_EQ(again.options().locations(1).path_edges(0).percent_along(), 0.5);
+
+  const auto stats = cache.stats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_DOUBLE_EQ(stats.hit_rate(), 0.5);
+}
+
+TEST(RouteCache, Ttl) {
+  test_cache cache(10, RouteCache::kDefaultMaxBytes, 60);
+  auto request = make_request(1, 2);
+  add_route(request, "first");
+  const auto key = RouteCache::MakeKey(request);
+  cache.Put(key, request, 0);
+
+  cache.advance(std::chrono::seconds(60));
+  EXPECT_TRUE(cache.Get(key, request));
+  cache.advance(std::chrono::seconds(1));
+  EXPECT_FALSE(cache.Get(key, request));
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_EQ(cache.stats().expirations, 1u);
+  EXPECT_EQ(cache.stats().misses, 1u);
+}
+
+TEST(RouteCache, Evictions) {
+  test_cache cache(2);
+  std::vector<Api> requests;
+  std::vector<std::string> keys;
+  for (uint64_t i = 0; i < 3; ++i) {
+    requests.push_back(make_request(i, i + 10));
+    add_route(requests.back(), std::to_string(i));
+    keys.push_back(RouteCache::MakeKey(requests.back()));
+  }
+
+  // the least recently used makes room
+  cache.Put(keys[0], requests[0], 0);
+  cache.Put(keys[1], requests[1], 0);
+  EXPECT_TRUE(cache.Get(keys[0], requests[0]));
+  cache.Put(keys[2], requests[2], 0);
+  EXPECT_EQ(cache.size(), 2u);
+  EXPECT_EQ(cache.stats().evictions, 1u);
+  EXPECT_TRUE(cache.Get(keys[0], requests[0]));
+  EXPECT_FALSE(cache.Get(keys[1], requests[1]));
+  EXPECT_TRUE(cache.Get(keys[2], requests[2]));
+
+  // and so do all of them for one that needs all of the room
+  RouteCache small(10, 1000);
+  small.Put(keys[0], requests[0], 0);
+  small.Put(keys[1], requests[1], 0);
+  auto large = make_request(7, 8);
+  add_route(large, std::string(600, 'x'));
+  small.Put(RouteCache::MakeKey(large), large, 0);
+  EXPECT_EQ(small.size(), 1u);
+  EXPECT_EQ(small.stats().evictions, 2u);
+
+  // one that doesnt fit at all isnt kept
+  add_route(large, std::string(1000, 'x'));
+  small.Put(RouteCache::MakeKey(large), large, 0);
+  EXPECT_EQ(small.size(), 0u);
+}
+
+TEST(RouteCache, TrafficInvalidation) {
+  test_cache cache;
+  auto request = make_request(1, 2);
+  add_route(request, "first");
+  const auto key = RouteCache::MakeKey(request);
+  cache.SetTrafficEpoch(5);
+  cache.Put(key, request, 5);
+
+  // the same epoch keeps the routes, a new one drops them all
+  cache.SetTrafficEpoch(5);
+  EXPECT_TRUE(cache.Get(key, request));
+  cache.SetTrafficEpoch(6);
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_EQ(cache.stats().invalidations, 1u);
+  EXPECT_FALSE(cache.Get(key, request));
+}
+
+TEST(RouteCache, TrafficChangedWhileSearching) {
+  test_cache cache;
+  auto request = make_request(1, 2);
+  const auto key = RouteCache::MakeKey(request);
+  cache.SetTrafficEpoch(5);
+  EXPECT_FALSE(cache.Get(key, request));
+  const auto epoch = cache.traffic_epoch();
+  EXPECT_EQ(epoch, 5u);
+
+  // another worker saw new speeds before the route found on the old ones was put in the cache
+  add_route(request, "first");
+  cache.SetTrafficEpoch(6);
+  cache.Put(key, request, epoch);
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_FALSE(cache.Get(key, request));
+
+  // one found on the new speeds is kept
+  cache.Put(key, request, cache.traffic_epoch());
+  EXPECT_TRUE(cache.Get(key, request));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,149 @@
+#include "thor/searcharena.h"
+#include "baldr/double_bucket_queue.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::thor;
+
+namespace {
+
+struct simple_label {
+  float c;
+  float sortcost() const {
+    return c;
+  }
+};
+
+TEST(SearchArena, AcquireRelease) {
+  SearchArena arena;
+
+  // nothing to reuse the first time
+  std::vector<uint32_t> labels;
+  arena.Acquire(labels);
+  EXPECT_EQ(labels.capacity(), 0u);
+  EXPECT_EQ(arena.stats().allocated, 1u);
+
+  labels.reserve(1000);
+  labels.resize(10, 7);
+  arena.Release(labels);
+  EXPECT_EQ(labels.capacity(), 0u);
+  EXPECT_EQ(arena.stats().retained_bytes, 1000 * sizeof(uint32_t));
+
+  // it comes back out as it went in
+  std::vector<uint32_t> again;
+  arena.Acquire(again);
+  EXPECT_EQ(again.capacity(), 1000u);
+  EXPECT_EQ(again, std::vector<uint32_t>(10, 7));
+  EXPECT_EQ(arena.stats().reused, 1u);
+  EXPECT_EQ(arena.stats().retained_bytes, 0u);
+  EXPECT_EQ(arena.stats().high_water_bytes, 1000 * sizeof(uint32_t));
+
+  // storage with capacity of its own is left alone, and other kinds dont mix
+  arena.Release(again);
+  std::vector<uint32_t> own(5);
+  arena.Acquire(own);
+  EXPECT_EQ(own.capacity(), 5u);
+  std::vector<float> other;
+  arena.Acquire(other);
+  EXPECT_EQ(other.capacity(), 0u);
+  EXPECT_EQ(arena.stats().retained_bytes, 1000 * sizeof(uint32_t));
+}
+
+TEST(SearchArena, HighWaterMark) {
+  SearchArena arena(2);
+
+  // an outlier keeps its capacity while its in the window
+  std::vector<uint32_t> labels(1000);
+  arena.Release(labels);
+  arena.Trim();
+  for (int round = 0; round < 2; ++round) {
+    EXPECT_EQ(arena.stats().retained_bytes, 1000 * sizeof(uint32_t));
+    arena.Acquire(labels);
+    labels.clear();
+    labels.resize(10);
+    arena.Release(labels);
+    arena.Trim();
+  }
+
+  // and is trimmed to what the recent searches used once its out of it
+  EXPECT_LE(arena.stats().retained_bytes, 10 * sizeof(uint32_t));
+  EXPECT_GE(arena.stats().trimmed_bytes, 990 * sizeof(uint32_t));
+  arena.Acquire(labels);
+  EXPECT_GE(labels.capacity(), 10u);
+  EXPECT_LT(labels.capacity(), 1000u);
+
+  // trims with nothing given back dont count
+  arena.Release(labels);
+  for (int round = 0; round < 10; ++round) {
+    arena.Trim();
+  }
+  EXPECT_GT(arena.stats().retained_bytes, 0u);
+}
+
+TEST(SearchArena, MaxRetained) {
+  SearchArena arena(16, 1000);
+  std::vector<uint32_t> first(400), second(400);
+  arena.Release(first);
+  arena.Release(second);
+  EXPECT_EQ(arena.stats().retained_bytes, 800 * sizeof(uint32_t));
+  arena.Trim();
+  EXPECT_LE(arena.stats().retained_bytes, 1000u);
+  EXPECT_EQ(arena.stats().trimmed_bytes + arena.stats().retained_bytes,
+            800 * sizeof(uint32_t));
+}
+
+TEST(SearchArena, ReuseQueue) {
+  SearchArena arena;
+  std::vector<simple_label> labels{{3.f}, {1.f}, {2.f}};
+
+  // leave some labels in the buckets
+  auto queue = arena.MakeQueue(0.f, 100.f, 1, labels);
+  for (uint32_t i = 0; i < labels.size(); ++i) {
+    queue->add(i);
+  }
+  EXPECT_EQ(queue->pop(), 1u);
+  arena.ReleaseQueue(queue);
+  EXPECT_EQ(queue, nullptr);
+  EXPECT_GT(arena.stats().retained_bytes, 0u);
+
+  // the next queue gets the buckets without what was left in them
+  std::vector<simple_label> other{{5.f}};
+  queue = arena.MakeQueue(0.f, 100.f, 1, other);
+  EXPECT_EQ(arena.stats().reused, 1u);
+  EXPECT_EQ(arena.stats().retained_bytes, 0u);
+  queue->add(0);
+  EXPECT_EQ(queue->pop(), 0u);
+  EXPECT_EQ(queue->pop(), kInvalidLabel);
+}
+
+TEST(SearchArena, QueueType) {
+  SearchArena arena;
+  std::vector<simple_label> labels{{3.f}, {1.f}, {2.f}};
+  auto queue = arena.MakeQueue(0.f, 100.f, 1, labels);
+  EXPECT_NE(dynamic_cast<DoubleBucketQueue<simple_label>*>(queue.get()), nullptr);
+  arena.ReleaseQueue(queue);
+
+  // the radix heap reuses the same buckets
+  arena.set_queue_type(QueueType::kRadixHeap);
+  queue = arena.MakeQueue(0.f, 100.f, 1, labels);
+  EXPECT_NE(dynamic_cast<RadixHeapQueue<simple_label>*>(queue.get()), nullptr);
+  EXPECT_EQ(arena.stats().reused, 1u);
+  for (uint32_t i = 0; i < labels.size(); ++i) {
+    queue->add(i);
+  }
+  EXPECT_EQ(queue->pop(), 1u);
+  EXPECT_EQ(queue->pop(), 2u);
+  EXPECT_EQ(queue->pop(), 0u);
+  EXPECT_EQ(queue->pop(), kInvalidLabel);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
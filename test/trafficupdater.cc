@@ -0,0 +1,147 @@
+#include "test.h"
+
+#include "baldr/graphtile.h"
+#include "baldr/traffictile.h"
+#include "baldr/trafficupdater.h"
+#include "midgard/sequence.h"
+
+#include <sstream>
+#include <string>
+
+#include "microtar.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+class UnmanagedGraphMemory : public GraphMemory {
+public:
+  UnmanagedGraphMemory(const char* const buf, const size_t len) {
+    data = const_cast<char*>(buf);
+    size = len;
+  }
+};
+
+const std::string traffic_extract = "test/data/traffic_updater.tar";
+const GraphId double_buffered_id(1, 0, 0);
+const GraphId single_buffered_id(2, 0, 0);
+
+void write_extract() {
+  mtar_t tar;
+  ASSERT_EQ(mtar_open(&tar, traffic_extract.c_str(), "w"), MTAR_ESUCCESS);
+  for (const auto& tile : {std::make_pair(double_buffered_id, true),
+                           std::make_pair(single_buffered_id, false)}) {
+    auto bytes = TrafficUpdater::CreateTile(tile.first, 4, tile.second);
+    auto name = GraphTile::FileSuffix(tile.first);
+    ASSERT_EQ(mtar_write_file_header(&tar, name.c_str(), bytes.size()), MTAR_ESUCCESS);
+    ASSERT_EQ(mtar_write_data(&tar, bytes.data(), bytes.size()), MTAR_ESUCCESS);
+  }
+  mtar_finalize(&tar);
+  mtar_close(&tar);
+}
+
+// what a graph reader sees, mapped separately from the updater
+struct reader_t {
+  reader_t() : archive(traffic_extract) {
+    for (const auto& c : archive.contents) {
+      auto id = GraphTile::GetTileId(c.first);
+      auto tile = std::make_shared<TrafficTile>(
+          std::make_unique<UnmanagedGraphMemory>(c.second.first, c.second.second));
+      tiles.emplace(id, tile);
+    }
+  }
+  const TrafficTile& operator[](const GraphId& id) {
+    return *tiles.at(id);
+  }
+  valhalla::midgard::tar archive;
+  std::unordered_map<GraphId, std::shared_ptr<TrafficTile>> tiles;
+};
+
+TEST(TrafficUpdater, PublishIsAtomicPerTile) {
+  write_extract();
+  reader_t reader;
+  ASSERT_TRUE(reader[double_buffered_id].double_buffered);
+  ASSERT_FALSE(reader[single_buffered_id].double_buffered);
+
+  TrafficUpdater updater(traffic_extract);
+  EXPECT_EQ(updater.tile_count(), 2u);
+
+  // nothing is visible until its published
+  const TrafficSpeed speed(60 >> 1, 60 >> 1, UNKNOWN_TRAFFIC_SPEED_RAW, UNKNOWN_TRAFFIC_SPEED_RAW,
+                           255, 0, 5, 0, 0, false);
+  EXPECT_EQ(updater.Stage({{double_buffered_id + 2, speed}, {GraphId(9, 0, 0), speed}}), 1u);
+  EXPECT_FALSE(updater.Stage(double_buffered_id + 4, speed));
+  EXPECT_EQ(updater.staged_count(), 1u);
+  const auto& before = reader[double_buffered_id].trafficspeed(2);
+  EXPECT_FALSE(before.valid());
+  EXPECT_EQ(reader[double_buffered_id].epoch(), 0u);
+
+  // then it is all there
+  EXPECT_EQ(updater.Publish(1234), 1u);
+  EXPECT_EQ(updater.staged_count(), 0u);
+  EXPECT_EQ(reader[double_buffered_id].epoch(), 1u);
+  EXPECT_EQ(static_cast<uint64_t>(reader[double_buffered_id].header->last_update), 1234u);
+  EXPECT_EQ(reader[double_buffered_id].trafficspeed(2).get_overall_speed(), 60);
+  EXPECT_EQ(static_cast<uint64_t>(reader[double_buffered_id].trafficspeed(2).congestion1), 5u);
+  EXPECT_EQ(reader[single_buffered_id].epoch(), 0u);
+
+  // and whoever was looking at the old speeds is still looking at the old speeds
+  EXPECT_FALSE(before.valid());
+}
+
+TEST(TrafficUpdater, StageFromStream) {
+  write_extract();
+  reader_t reader;
+  TrafficUpdater updater(traffic_extract);
+
+  std::stringstream updates;
+  updates << "# edge,speed,congestion\n"
+          << "0/1/1,40,10\n"
+          << "0/1/3,50\n"
+          << "bogus\n"
+          << "0/1/2,50,\n"
+          << "\n"
+          << "0/2/0,80,70,60,50,100,200,10,20,30\r\n"
+          << "0/2/0,90,70,60,50,100,200,10,20,30\n"
+          << "0/9/0,50\n";
+  EXPECT_EQ(updater.Stage(updates), 4u);
+  EXPECT_EQ(updater.Publish(), 2u);
+
+  const auto& double_buffered = reader[double_buffered_id];
+  EXPECT_EQ(double_buffered.epoch(), 1u);
+  EXPECT_EQ(double_buffered.trafficspeed(1).get_overall_speed(), 40);
+  EXPECT_EQ(double_buffered.trafficspeed(1).get_speed(0), 40);
+  EXPECT_EQ(double_buffered.trafficspeed(1).get_speed(1), UNKNOWN_TRAFFIC_SPEED_KPH);
+  EXPECT_EQ(static_cast<uint64_t>(double_buffered.trafficspeed(1).congestion1), 10u);
+  EXPECT_EQ(double_buffered.trafficspeed(3).get_overall_speed(), 50);
+  EXPECT_EQ(static_cast<uint64_t>(double_buffered.trafficspeed(3).congestion1), 0u);
+  EXPECT_FALSE(double_buffered.trafficspeed(2).valid());
+
+  // the last update of an edge wins
+  const auto& single_buffered = reader[single_buffered_id];
+  EXPECT_EQ(single_buffered.epoch(), 1u);
+  const auto& speed = single_buffered.trafficspeed(0);
+  EXPECT_EQ(speed.get_overall_speed(), 90);
+  EXPECT_EQ(speed.get_speed(0), 70);
+  EXPECT_EQ(speed.get_speed(1), 60);
+  EXPECT_EQ(speed.get_speed(2), 50);
+  EXPECT_EQ(static_cast<uint64_t>(speed.breakpoint1), 100u);
+  EXPECT_EQ(static_cast<uint64_t>(speed.breakpoint2), 200u);
+  EXPECT_EQ(static_cast<uint64_t>(speed.congestion3), 30u);
+
+  // updates carry over the speeds of the previous publish
+  updates.clear();
+  updates << "0/1/3,20\n";
+  EXPECT_EQ(updater.Stage(updates), 1u);
+  EXPECT_EQ(updater.Publish(), 1u);
+  EXPECT_EQ(double_buffered.epoch(), 2u);
+  EXPECT_EQ(double_buffered.trafficspeed(1).get_overall_speed(), 40);
+  EXPECT_EQ(double_buffered.trafficspeed(3).get_overall_speed(), 20);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,175 @@
+#ifndef VALHALLA_BALDR_CONTRACTIONHIERARCHY_H_
+#define VALHALLA_BALDR_CONTRACTIONHIERARCHY_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/midgard/sequence.h>
+#include <valhalla/midgard/util.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * A contraction hierarchy of the routing graph for one fixed costing profile. Its vertices are
+ * the directed edges of the graph, so that turn costs and simple turn restrictions are part of
+ * the arcs between them, and every directed edge of the tileset gets a vertex whether or not the
+ * profile can use it. An arc from one vertex to another is either the transition between the two
+ * edges (plus the cost of the second edge) or a shortcut over a contracted vertex in the middle.
+ *
+ * Each vertex keeps the arcs going up the hierarchy out of it, for the forward search, and the
+ * arcs coming down the hierarchy into it, for the reverse search. The hierarchy is persisted in
+ * a compressed sparse row layout: a header, the serialized costing options of the profile, one
+ * record per tile giving the first vertex of its edges, and then the offsets and arcs up and the
+ * offsets and arcs down. Its mapped so that every process using the same file shares the pages.
+ */
+class ContractionHierarchy {
+public:
+  // Marks an arc which is not a shortcut or a directed edge without a vertex
+  static constexpr uint32_t kInvalidVertex = 0xffffffff;
+
+  struct arc_t {
+    uint32_t vertex; // the other end of the arc
+    uint32_t middle; // the vertex the arc is a shortcut over or kInvalidVertex
+    float cost;      // of the transition and the edge at the end of it
+    float secs;      // elapsed time of the transition and the edge at the end of it
+    uint32_t length; // meters of the edge at the end of it, or of every edge a shortcut is over
+  };
+
+  struct tile_t {
+    uint64_t tile_id;      // the base id of the tile
+    uint32_t first_vertex; // vertex of the first directed edge of the tile
+    uint32_t edge_count;   // number of directed edges in the tile
+  };
+
+  /**
+   * Constructor, nothing is loaded until Load is called.
+   */
+  ContractionHierarchy();
+
+  /**
+   * Maps a contraction hierarchy written by Save if it is sound and was built from the tileset
+   * of the reader.
+   * @param  file    The file written by Save.
+   * @param  reader  The reader of the tileset to check the hierarchy against.
+   * @return Returns true if the hierarchy was loaded.
+   */
+  bool Load(const std::string& file, GraphReader& reader);
+
+  /**
+   * Writes a contraction hierarchy so that it can be loaded. Its written to the side and moved
+   * into place so that no one ever maps half a file. Throws if the file cannot be written.
+   * @param  file          Where to write the hierarchy.
+   * @param  reader        The reader of the tileset the hierarchy was built from.
+   * @param  costing       The costing of the profile.
+   * @param  profile       The serialized costing options of the profile.
+   * @param  tiles         The first vertex of each tile, sorted by vertex.
+   * @param  up_offsets    Per vertex (plus one at the end) offsets into the up arcs.
+   * @param  up_arcs       The arcs going up the hierarchy out of each vertex.
+   * @param  down_offsets  Per vertex (plus one at the end) offsets into the down arcs.
+   * @param  down_arcs     The arcs coming down the hierarchy into each vertex.
+   */
+  static void Save(const std::string& file,
+                   GraphReader& reader,
+                   uint32_t costing,
+                   const std::string& profile,
+                   const std::vector<tile_t>& tiles,
+                   const std::vector<uint32_t>& up_offsets,
+                   const std::vector<arc_t>& up_arcs,
+                   const std::vector<uint32_t>& down_offsets,
+                   const std::vector<arc_t>& down_arcs);
+
+  /**
+   * Is there a hierarchy loaded.
+   */
+  explicit operator bool() const {
+    return up_offsets_ != nullptr;
+  }
+
+  /**
+   * Gets the costing the hierarchy was contracted for.
+   */
+  uint32_t costing() const {
+    return costing_;
+  }
+
+  /**
+   * Gets the serialized costing options the hierarchy was contracted for.
+   */
+  const std::string& profile() const {
+    return profile_;
+  }
+
+  /**
+   * Gets the number of vertices, ie the number of directed edges in the tileset.
+   */
+  uint32_t vertex_count() const {
+    return vertex_count_;
+  }
+
+  /**
+   * Gets the vertex of a directed edge.
+   * @param  edge_id  The directed edge.
+   * @return Returns the vertex or kInvalidVertex if the edge is not in the hierarchy.
+   */
+  uint32_t vertex(const GraphId& edge_id) const {
+    auto found = tile_index_.find(edge_id.Tile_Base());
+    if (found == tile_index_.end() || edge_id.id() >= tiles_[found->second].edge_count) {
+      return kInvalidVertex;
+    }
+    return tiles_[found->second].first_vertex + edge_id.id();
+  }
+
+  /**
+   * Gets the directed edge of a vertex.
+   * @param  vertex  The vertex.
+   * @return Returns the directed edge of the vertex.
+   */
+  GraphId edge(uint32_t vertex) const;
+
+  /**
+   * Gets the arcs going up the hierarchy out of a vertex.
+   */
+  midgard::iterable_t<const arc_t> up(uint32_t vertex) const {
+    return {up_arcs_ + up_offsets_[vertex], up_arcs_ + up_offsets_[vertex + 1]};
+  }
+
+  /**
+   * Gets the arcs coming down the hierarchy into a vertex, the vertex of each arc is where it
+   * comes from.
+   */
+  midgard::iterable_t<const arc_t> down(uint32_t vertex) const {
+    return {down_arcs_ + down_offsets_[vertex], down_arcs_ + down_offsets_[vertex + 1]};
+  }
+
+  /**
+   * Finds the cheapest arc between two vertices, one of which has to be below the other.
+   * @param  from  The vertex the arc leaves.
+   * @param  to    The vertex the arc enters.
+   * @return Returns the cheapest arc or nullptr if there is none. Only its cost and middle vertex
+   *         are of use since its vertex depends on which way up the two vertices are.
+   */
+  const arc_t* find_arc(uint32_t from, uint32_t to) const;
+
+protected:
+  midgard::mem_map<char> mapped_;
+  uint32_t costing_;
+  std::string profile_;
+  uint32_t vertex_count_;
+  const tile_t* tiles_;
+  uint32_t tile_count_;
+  std::unordered_map<uint64_t, uint32_t> tile_index_;
+  const uint32_t* up_offsets_;
+  const arc_t* up_arcs_;
+  const uint32_t* down_offsets_;
+  const arc_t* down_arcs_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_CONTRACTIONHIERARCHY_H_
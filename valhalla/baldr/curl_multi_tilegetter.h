@@ -0,0 +1,76 @@
+#pragma once
+
+#include <valhalla/baldr/tilegetter.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Asynchronous tile getter built on libcurl's multi interface. A single background thread drives
+ * all of the transfers so any number of callers can wait on downloads while at most a fixed
+ * number of them are in progress. Requests for a url which is already being downloaded (or is
+ * queued to be) are coalesced with that download rather than fetching the tile again, and their
+ * responses are marked as coalesced so that only the request which started it saves the tile.
+ *
+ * Copies share the same transfers, so a copy per GraphReader lets all readers of a process
+ * coalesce their requests while each keeps its own interrupt. The copies share the settings the
+ * first one was made with, readers with other settings need a getter of their own.
+ */
+class curl_multi_tile_getter_t : public tile_getter_t {
+public:
+  /**
+   * @param max_concurrent  the maximum number of transfers in progress at once
+   * @param user_agent      user agent to use for HTTP requests
+   * @param gzipped         whether to request for gzip compressed data
+   */
+  curl_multi_tile_getter_t(size_t max_concurrent, const std::string& user_agent, bool gzipped);
+
+  using response_t = tile_getter_t::response_t;
+
+  /**
+   * Fetches the url, joining an existing download of it if there is one.
+   */
+  response_t get(const std::string& url) override;
+
+  /**
+   * Queues all of the urls at once and waits for all of them. Duplicate urls are downloaded once.
+   */
+  std::vector<response_t> get_batch(const std::vector<std::string>& urls) override;
+
+  bool gzipped() const override {
+    return gzipped_;
+  }
+
+  using interrupt_t = tile_getter_t::interrupt_t;
+
+  /**
+   * The interrupt is checked while waiting. Interrupting only stops the wait of this copy, the
+   * download keeps going for anyone else waiting on it.
+   */
+  void set_interrupt(const interrupt_t* interrupt) override {
+    interrupt_ = interrupt;
+  }
+
+  /**
+   * @return the number of downloads that were started
+   */
+  size_t transfer_count() const;
+
+  /**
+   * @return the number of requests that joined a download someone else started
+   */
+  size_t coalesced_count() const;
+
+private:
+  struct pimpl_t;
+  std::shared_ptr<pimpl_t> pimpl_;
+  const bool gzipped_;
+  const interrupt_t* interrupt_ = nullptr;
+};
+
+} // namespace baldr
+} // namespace valhalla
@@ -5,16 +5,14 @@
 #include <cmath>
 #include <cstdint>
 #include <valhalla/baldr/graphconstants.h>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/midgard/util.h>
+#include <utility>
 #include <vector>
 
 namespace valhalla {
 namespace baldr {
 
-// Bucket type and bucket list type.
-using bucket_t = std::vector<uint32_t>;
-using buckets_t = std::vector<bucket_t>;
-
 /**
  * Double Bucket Queue - a form of priority queue. Contains a bucket sort
  * implementation for performance. An "overflow" bucket is maintained to allow
@@ -22,7 +20,7 @@ using buckets_t = std::vector<bucket_t>;
  * into the overflow bucket and are moved into the low-level buckets as
  * needed. Each bucket stores label indexes into external data.
  */
-template <typename label_t> class DoubleBucketQueue final {
+template <typename label_t> class DoubleBucketQueue final : public LabelQueue<label_t> {
 public:
   /**
    * Constructor given a minimum cost, a range of costs held within the
@@ -34,12 +32,14 @@ public:
    * @param bucketsize Bucket size (range of costs within same bucket).
    *                   Must be an integer value.
    * @param labelcost  Functor to get a cost given a label index.
+   * @param storage    Buckets of a previous queue (see release) to reuse the memory of.
    */
   DoubleBucketQueue(const float mincost,
                     const float range,
                     const uint32_t bucketsize,
-                    const std::vector<label_t>& labelcontainer)
-      : labelcontainer_(labelcontainer) {
+                    const std::vector<label_t>& labelcontainer,
+                    buckets_t storage = buckets_t())
+      : buckets_(std::move(storage)), labelcontainer_(labelcontainer) {
     // We need at least a bucketsize of 1 or more
     if (bucketsize < 1) {
       throw std::runtime_error("Bucketsize must be 1 or greater");
@@ -61,8 +61,11 @@ public:
     // Set the maximum cost (above this goes into the overflow bucket)
     maxcost_ = mincost_ + bucketrange_;
 
-    // Allocate the low-level buckets
+    // Allocate the low-level buckets, any reused ones may still hold labels
     size_t bucketcount = (range / bucketsize_) + 1;
+    for (auto& bucket : buckets_) {
+      bucket.clear();
+    }
     buckets_.resize(bucketcount);
 
     // Set the current bucket to the lowest cost low level bucket
@@ -72,7 +75,7 @@ public:
   /**
    * Clear all labels from the low-level buckets and the overflow buckets.
    */
-  void clear() {
+  void clear() override {
     // Empty the overflow bucket and each bucket
     overflowbucket_.clear();
     while (currentbucket_ != buckets_.end()) {
@@ -85,6 +88,18 @@ public:
     currentbucket_ = buckets_.begin();
   }
 
+  /**
+   * Hands over the memory of the low-level buckets so that another queue can reuse it. The queue
+   * cannot be used after this.
+   * @return  Returns the low-level buckets.
+   */
+  buckets_t release() override {
+    buckets_t storage = std::move(buckets_);
+    buckets_.clear();
+    currentbucket_ = buckets_.begin();
+    return storage;
+  }
+
   /**
    * Adds a label index to the bucketed sort. Adds it to the appropriate bucket
    * given the cost. If the cost is greater than maxcost_ the label
@@ -92,7 +107,7 @@ public:
    * cost then the label is placed in the current bucket to prevent underflow.
    * @param   label  Label index to add to the queue.
    */
-  void add(const uint32_t label) {
+  void add(const uint32_t label) override {
     get_bucket(labelcontainer_[label].sortcost()).push_back(label);
   }
 
@@ -103,7 +118,7 @@ public:
    * @param  label        Label index to reorder.
    * @param  newcost      New sort cost.
    */
-  void decrease(const uint32_t label, const float newcost) {
+  void decrease(const uint32_t label, const float newcost) override {
     // Get the buckets of the previous and new costs. Nothing needs to be done
     // if old cost and the new cost are in the same buckets.
     bucket_t& prevbucket = get_bucket(labelcontainer_[label].sortcost());
@@ -120,7 +135,7 @@ public:
    * @return  Returns the label index of the lowest cost label. Returns
    *          kInvalidLabel if the buckets are empty.
    */
-  uint32_t pop() {
+  uint32_t pop() override {
     if (empty()) {
       // No labels found in the low-level buckets.
       if (overflowbucket_.empty()) {
@@ -6,12 +6,14 @@
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 
 #include <valhalla/baldr/curler.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
+#include <valhalla/baldr/tile_prefetcher.h>
 #include <valhalla/baldr/tilegetter.h>
 #include <valhalla/baldr/tilehierarchy.h>
 
@@ -251,12 +253,27 @@ public:
     HARD, // strict memory control on every Put operation
   };
 
+  /**
+   * Counters of the compressed tier, used to size both tiers of the cache
+   */
+  struct CompressedTierStats {
+    size_t hits = 0;          // tiles served from the compressed tier
+    size_t misses = 0;        // tiles found in neither tier
+    size_t compressions = 0;  // evicted tiles moved into the compressed tier
+    size_t evictions = 0;     // tiles dropped from the compressed tier
+    double compress_ms = 0;   // total time spent compressing evicted tiles
+    double decompress_ms = 0; // total time spent decompressing tiles on a hit
+  };
+
   /**
    * Constructor.
-   * @param max_size     maximum size of the cache
-   * @param mem_control  strategy our cache will use to control its memory
+   * @param max_size             maximum size of the cache
+   * @param mem_control          strategy our cache will use to control its memory
+   * @param max_compressed_size  maximum size of the compressed tier, evicted tiles are kept there
+   *                             deflated and inflated again on a hit rather than being re-read
+   *                             from storage. 0 disables the tier
    */
-  TileCacheLRU(size_t max_size, MemoryLimitControl mem_control);
+  TileCacheLRU(size_t max_size, MemoryLimitControl mem_control, size_t max_compressed_size = 0);
 
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
@@ -265,12 +282,20 @@ public:
   void Reserve(size_t tile_size) override;
 
   /**
-   * Checks if tile exists in the cache.
+   * Checks if tile exists in the cache. Only the main tier counts, a tile that is only in the
+   * compressed tier still has to be inflated to be used.
    * @param graphid  the graphid of the tile
    * @return true if tile exists in the cache
    */
   bool Contains(const GraphId& graphid) const override;
 
+  /**
+   * Checks if tile exists in the compressed tier of the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if the tile exists in the compressed tier
+   */
+  bool ContainsCompressed(const GraphId& graphid) const;
+
   /**
    * Puts a copy of a tile of into the cache.
    * @param graphid  the graphid of the tile
@@ -280,7 +305,8 @@ public:
   graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t tile_size) override;
 
   /**
-   * Get a pointer to a graph tile object given a GraphId.
+   * Get a pointer to a graph tile object given a GraphId. A tile found in the compressed tier
+   * is inflated and moved back into the main tier.
    * @param graphid  the graphid of the tile
    * @return GraphTile* a pointer to the graph tile
    */
@@ -303,6 +329,20 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Returns the counters of the compressed tier.
+   */
+  const CompressedTierStats& GetCompressedTierStats() const {
+    return stats_;
+  }
+
+  /**
+   * Returns the number of bytes used by the compressed tier.
+   */
+  size_t CompressedSize() const {
+    return compressed_size_;
+  }
+
 protected:
   struct KeyValue {
     KeyValue(GraphId id_, graph_tile_ptr tile_) : id(id_), tile(std::move(tile_)) {
@@ -312,16 +352,26 @@ protected:
   };
   using KeyValueIter = std::list<KeyValue>::iterator;
 
+  struct CompressedKeyValue {
+    CompressedKeyValue(GraphId id_, std::vector<char>&& data_, size_t tile_size_)
+        : id(id_), data(std::move(data_)), tile_size(tile_size_) {
+    }
+    GraphId id;
+    std::vector<char> data;
+    size_t tile_size;
+  };
+  using CompressedKeyValueIter = std::list<CompressedKeyValue>::iterator;
+
   /**
    * If needed, delete cache items until required_size in bytes is free in cache.
    * The deletion starts from the items that have been unaccessed longer than others.
-   * Can potentially clean the entire cache.
+   * Can potentially clean the entire cache. Evicted items go to the compressed tier if enabled.
    *
    * @param  required_size   size in bytes that should be free in the cache
    *
    * @return  bytes freed by the eviction
    */
-  size_t TrimToFit(const size_t required_size);
+  size_t TrimToFit(const size_t required_size) const;
 
   /**
    * Mark provided cache entry as most recently used.
@@ -330,8 +380,24 @@ protected:
    */
   void MoveToLruHead(const KeyValueIter& entry_iter) const;
 
-  // The GraphId -> Iterator into the linked list which owns the cached objects
-  std::unordered_map<uint64_t, KeyValueIter> cache_;
+  /**
+   * Deflates an evicted tile into the compressed tier, making room for it if needed. Tiles with
+   * live traffic attached are skipped since their traffic memory cannot be restored.
+   *
+   * @param entry  the evicted entry
+   */
+  void Compress(const KeyValue& entry) const;
+
+  /**
+   * Removes an entry from the compressed tier.
+   *
+   * @param entry_iter  list entry inside the compressed LRU list
+   */
+  void EraseCompressed(const CompressedKeyValueIter& entry_iter) const;
+
+  // The GraphId -> Iterator into the linked list which owns the cached objects. Mutable, along with
+  // the size, since a Get may move a tile from the compressed tier back into this one
+  mutable std::unordered_map<uint64_t, KeyValueIter> cache_;
 
   // Linked list of <GraphId, Tile> pairs.
   // The most recently used item is at the beginning and the least one - at the back.
@@ -341,10 +407,22 @@ protected:
   MemoryLimitControl mem_control_;
 
   // The current cache size in bytes
-  size_t cache_size_;
+  mutable size_t cache_size_;
 
   // The max cache size in bytes
   size_t max_cache_size_;
+
+  // The GraphId -> Iterator into the linked list which owns the compressed tiles
+  mutable std::unordered_map<uint64_t, CompressedKeyValueIter> compressed_;
+
+  // Linked list of compressed tiles, most recently evicted or used first
+  mutable std::list<CompressedKeyValue> compressed_lru_list_;
+
+  // The current and max size of the compressed tier in bytes
+  mutable size_t compressed_size_;
+  size_t max_compressed_size_;
+
+  mutable CompressedTierStats stats_;
 };
 
 /**
@@ -409,6 +487,96 @@ private:
   std::mutex& mutex_ref_;
 };
 
+/**
+ * Tile cache split into a number of independently locked shards. Tiles are
+ * assigned to a shard by hashing their GraphId so that threads looking up
+ * different tiles rarely contend on the same mutex. Each shard owns its own
+ * cache and keeps its own size accounting (and LRU order if applicable).
+ * Copies of a ShardedTileCache share the same shards so that many GraphReaders
+ * can use one instance. It is thread-safe.
+ * Note: sharing tiles across threads requires ENABLE_THREAD_SAFE_TILE_REF_COUNT
+ */
+class ShardedTileCache : public TileCache {
+public:
+  /**
+   * Constructor.
+   * @param shards  the caches to use as shards, there must be at least one
+   */
+  ShardedTileCache(std::vector<std::unique_ptr<TileCache>>&& shards);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large. The cache is overcommitted if any of
+   * its shards is overcommitted.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   *  Does its best to reduce the cache size to remove overcommitted state.
+   *  Each shard is trimmed according to its own policy
+   */
+  void Trim() override;
+
+  /**
+   * Returns the number of shards the cache is split into.
+   */
+  size_t ShardCount() const {
+    return shards_->size();
+  }
+
+protected:
+  struct Shard {
+    std::unique_ptr<TileCache> cache;
+    mutable std::mutex mutex;
+  };
+
+  /**
+   * Finds the shard responsible for the tile. The tile id is mixed before taking
+   * the modulus so that neighbouring tiles end up in different shards.
+   * @param graphid  the graphid of the tile
+   * @return the shard holding the tile
+   */
+  Shard& shard(const GraphId& graphid) const {
+    uint64_t key = graphid.Tile_Base().value * 0x9E3779B97F4A7C15ull;
+    return (*shards_)[(key >> 32) % shards_->size()];
+  }
+
+  std::shared_ptr<std::vector<Shard>> shards_;
+};
+
 /**
  * Creates tile caches.
  */
@@ -492,11 +660,44 @@ public:
     return GetGraphTile(pointll, TileHierarchy::levels().back().level);
   }
 
+  /**
+   * Asks the reader to load a tile in the background so that a later call to GetGraphTile does
+   * not have to wait on disk or network I/O. This is a no-op unless prefetching is configured
+   * (see prefetch_threads) or when the tile is already cached. Tiles in a memory mapped extract
+   * are never prefetched.
+   * @param graphid  the graphid of the tile
+   */
+  void Prefetch(const GraphId& graphid);
+
+  /**
+   * Prefetches the tile and the 8 tiles surrounding it on the same hierarchy level.
+   * @param graphid  the graphid of the tile
+   */
+  void PrefetchNeighbors(const GraphId& graphid);
+
+  /**
+   * Prefetches the tiles on all hierarchy levels that lie along the straight line between two
+   * points, for example between the origin and destination of a route.
+   * @param a  one end of the line
+   * @param b  the other end of the line
+   */
+  void PrefetchAlong(const midgard::PointLL& a, const midgard::PointLL& b);
+
+  /**
+   * Returns true if the reader loads tiles in the background when asked to prefetch them.
+   */
+  bool PrefetchEnabled() const {
+    return prefetcher_ != nullptr;
+  }
+
   /**
    * Clears the cache
    */
   virtual void Clear() {
     cache_->Clear();
+    if (prefetcher_) {
+      prefetcher_->clear();
+    }
   }
 
   /**
@@ -682,6 +883,13 @@ public:
    */
   std::vector<GraphId> RecoverShortcut(const GraphId& shortcutid);
 
+  /**
+   * Recovers all of the shortcuts in the tileset and writes them to a file which readers can map
+   * (see shortcut_recovery_file) rather than each of them recovering all of the shortcuts again.
+   * @param  file  where to write the recovered shortcuts
+   */
+  void SaveShortcutRecovery(const std::string& file);
+
   /**
    * Convenience method to get the relative edge density (from the
    * begin node of an edge).
@@ -860,6 +1068,13 @@ public:
    */
   std::unordered_set<GraphId> GetTileSet(const uint8_t level) const;
 
+  /**
+   * Gets a number that changes whenever speeds are published to any of the live traffic tiles,
+   * the sum of their epochs. Readers sharing the same traffic extract see the same number.
+   * @return  returns the traffic epoch, 0 if there are no live traffic tiles
+   */
+  uint64_t GetTrafficEpoch() const;
+
   /**
    * Returns the tile directory.
    * @return  Returns the tile directory.
@@ -905,11 +1120,20 @@ protected:
   // (Tar) extract of tiles - the contents are empty if not being used
   struct tile_extract_t {
     tile_extract_t(const boost::property_tree::ptree& pt);
+    /**
+     * Pre-faults the pages of the extracts holding levels 0 and 1 and, if a bounding box is
+     * configured, the level 2 tiles within it so that the first requests dont pay for the page
+     * faults. Optionally locks those pages in memory. Only does the work once per extract, other
+     * callers wait for it to finish.
+     * @param pt  the warmup configuration
+     */
+    void warmup(const boost::property_tree::ptree& pt) const;
     // TODO: dont remove constness, and actually make graphtile read only?
     std::unordered_map<uint64_t, std::pair<char*, size_t>> tiles;
     std::unordered_map<uint64_t, std::pair<char*, size_t>> traffic_tiles;
     std::shared_ptr<midgard::tar> archive;
     std::shared_ptr<midgard::tar> traffic_archive;
+    mutable std::once_flag warmed_up;
   };
   std::shared_ptr<const tile_extract_t> tile_extract_;
   static std::shared_ptr<const GraphReader::tile_extract_t>
@@ -929,6 +1153,33 @@ protected:
   std::unique_ptr<TileCache> cache_;
 
   bool enable_incidents_;
+
+  /**
+   * Loads a tile from the tile directory or, failing that, from the tile url. Does not use the
+   * cache or the extract and is safe to call from multiple threads.
+   * @param base  the base graphid of the tile
+   * @return the tile or nullptr if it could not be found
+   */
+  graph_tile_ptr LoadGraphTile(const GraphId& base);
+
+  /**
+   * Moves the tiles the prefetcher finished loading into the cache, must be called regularly so
+   * that unused tiles do not pile up in the prefetcher
+   */
+  void AdoptPrefetched();
+
+  /**
+   * Asks the prefetcher for the tile unless it is already cached
+   * @param base  the base graphid of the tile
+   */
+  void RequestPrefetch(const GraphId& base) {
+    if (!cache_->Contains(base)) {
+      prefetcher_->request(base);
+    }
+  }
+
+  // Background loading of tiles, declared last so its threads stop before anything they use dies
+  std::unique_ptr<tile_prefetcher_t> prefetcher_;
 };
 
 // Given the Location relation, return the full metadata
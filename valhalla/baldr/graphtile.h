@@ -16,6 +16,7 @@
 #include <valhalla/baldr/nodeinfo.h>
 #include <valhalla/baldr/nodetransition.h>
 #include <valhalla/baldr/predictedspeeds.h>
+#include <valhalla/baldr/routingedges.h>
 #include <valhalla/baldr/sign.h>
 #include <valhalla/baldr/signinfo.h>
 #include <valhalla/baldr/traffictile.h>
@@ -99,6 +100,20 @@ public:
                                      tile_getter_t* tile_getter,
                                      const std::string& cache_location);
 
+  /**
+   * Constructs many tiles at once given a url for the tiles. All of the tiles are handed to the
+   * tile getter in one batch so that it may download them concurrently
+   * @param  tile_url URL of tile
+   * @param  graphids Tile Ids
+   * @param  tile_getter object that will handle tile downloading
+   * @param  cache_location where to write the tiles through to on disk, if not empty
+   * @return the tiles in the same order as the ids, nullptr where a tile couldnt be had
+   */
+  static std::vector<graph_tile_ptr> CacheTileURLs(const std::string& tile_url,
+                                                   const std::vector<GraphId>& graphids,
+                                                   tile_getter_t* tile_getter,
+                                                   const std::string& cache_location);
+
   /**
    * Construct a tile given a url for the tile using curl
    * @param  tile_data graph tile raw bytes
@@ -320,6 +335,15 @@ public:
     return midgard::iterable_t<const DirectedEdge>{directededges_, header_->directededgecount()};
   }
 
+  /**
+   * Get the routing edges of this tile, a compact copy of the directed edge fields used by
+   * path expansion. Indexed by the same id as the directed edges.
+   * @return  Returns the routing edges, which evaluate to false if the tile has none.
+   */
+  const RoutingEdges& routing_edges() const {
+    return routing_edges_;
+  }
+
   /**
    * Get a pointer to edge info.
    * @return  Returns edge info.
@@ -763,6 +787,9 @@ protected:
   // Predicted speeds
   PredictedSpeeds predictedspeeds_;
 
+  // Compact copy of the directed edge fields used by path expansion (optional)
+  RoutingEdges routing_edges_;
+
   // Map of stop one stops in this tile.
   std::unordered_map<std::string, GraphId> stop_one_stops;
 
@@ -831,6 +858,19 @@ protected:
    *         the uncompressed data, or nullptr
    */
   static graph_tile_ptr DecompressTile(const GraphId& graphid, const std::vector<char>& compressed);
+
+  /**
+   * Turns downloaded tile bytes into a tile, saving them to disk first if there is a place to
+   * @param  graphid         the id of the downloaded tile
+   * @param  bytes           the downloaded bytes
+   * @param  gzipped         whether the bytes are compressed
+   * @param  cache_location  where to write the tile through to on disk, if not empty
+   * @return the tile or nullptr if the bytes couldnt be made into one
+   */
+  static graph_tile_ptr CacheTileBytes(const GraphId& graphid,
+                                       std::vector<char>&& bytes,
+                                       bool gzipped,
+                                       const std::string& cache_location);
 };
 
 } // namespace baldr
@@ -17,7 +17,7 @@ namespace baldr {
 // something to the tile simply subtract one from this number and add it
 // just before the empty_slots_ array below. NOTE that it can ONLY be an
 // offset in bytes and NOT a bitfield or union or anything of that sort
-constexpr size_t kEmptySlots = 11;
+constexpr size_t kEmptySlots = 10;
 
 // Maximum size of the version string (stored as a fixed size
 // character array so the GraphTileHeader size remains fixed).
@@ -585,6 +585,23 @@ public:
     tile_size_ = offset;
   }
 
+  /**
+   * Gets the offset to the routing edges, a compact copy of the directed edge data used by
+   * path expansion. This section is optional and is always the last one in the tile.
+   * @return  Returns the offset (bytes) to the routing edges or 0 if the tile has none.
+   */
+  uint32_t routing_edges_offset() const {
+    return routing_edges_offset_;
+  }
+
+  /**
+   * Sets the offset to the routing edges within the tile.
+   * @param offset Offset to the routing edges within the tile, 0 if there are none.
+   */
+  void set_routing_edges_offset(const uint32_t offset) {
+    routing_edges_offset_ = offset;
+  }
+
 protected:
   // GraphId (tileid and level) of this tile. Data quality metrics.
   uint64_t graphid_ : 46;
@@ -683,6 +700,9 @@ protected:
   // GraphTile data size in bytes
   uint32_t tile_size_;
 
+  // Offset to the beginning of the routing edges (0 if the tile has none)
+  uint32_t routing_edges_offset_;
+
   // Marks the end of this version of the tile with the rest of the slots
   // being available for growth. If you want to use one of the empty slots,
   // simply add a uint32_t some_offset_; just above empty_slots_ and decrease
@@ -0,0 +1,75 @@
+#ifndef VALHALLA_BALDR_LABEL_QUEUE_H_
+#define VALHALLA_BALDR_LABEL_QUEUE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+// Bucket type and bucket list type.
+using bucket_t = std::vector<uint32_t>;
+using buckets_t = std::vector<bucket_t>;
+
+// The kinds of priority queue a path algorithm can sort its labels with
+enum class QueueType : uint8_t { kDoubleBucket = 0, kRadixHeap = 1 };
+
+/**
+ * Gets the queue type from its name in the config ("double_bucket" or "radix_heap").
+ * @param  name  Name of the queue type.
+ * @return Returns the queue type, the double bucket queue if the name is unknown.
+ */
+inline QueueType to_queue_type(const std::string& name) {
+  return name == "radix_heap" ? QueueType::kRadixHeap : QueueType::kDoubleBucket;
+}
+
+/**
+ * The interface of the priority queues the path algorithms sort their labels with. A queue holds
+ * label indexes into an external container of labels and sorts them by the sortcost() of the
+ * labels, so the labels have to stay put while they are in the queue and a label whose cost
+ * goes down has to be told to the queue (see decrease) before the label itself is updated.
+ */
+template <typename label_t> class LabelQueue {
+public:
+  virtual ~LabelQueue() {
+  }
+
+  /**
+   * Adds a label index to the queue.
+   * @param  label  Label index to add to the queue.
+   */
+  virtual void add(const uint32_t label) = 0;
+
+  /**
+   * The specified label index now has a smaller cost. The label still has to have its previous
+   * cost when this is called.
+   * @param  label    Label index to reorder.
+   * @param  newcost  New sort cost.
+   */
+  virtual void decrease(const uint32_t label, const float newcost) = 0;
+
+  /**
+   * Removes the lowest cost label index from the queue.
+   * @return  Returns the label index of the lowest cost label. Returns kInvalidLabel if the
+   *          queue is empty.
+   */
+  virtual uint32_t pop() = 0;
+
+  /**
+   * Clear all labels from the queue.
+   */
+  virtual void clear() = 0;
+
+  /**
+   * Hands over the memory of the queue so that another queue can reuse it. The queue cannot be
+   * used after this.
+   * @return  Returns the buckets of the queue.
+   */
+  virtual buckets_t release() = 0;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_LABEL_QUEUE_H_
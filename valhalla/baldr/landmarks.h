@@ -0,0 +1,150 @@
+#ifndef VALHALLA_BALDR_LANDMARKS_H_
+#define VALHALLA_BALDR_LANDMARKS_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/midgard/sequence.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The costs between a few landmark nodes and every node on the highest level of the hierarchy,
+ * for one fixed costing profile, from which the A* heuristic gets a lower bound on the cost between
+ * two nodes by the triangle inequality (ALT). The costs are those of the nodes and edges alone,
+ * without any turn costs, so they never overestimate what a search with the same profile finds.
+ * Where a node cannot reach a landmark, or be reached from it, the cost is infinite.
+ *
+ * The landmarks are persisted in a flat layout: a header, the serialized costing options of the
+ * profile, one record per tile of the highest level giving the first node of its nodes, and then
+ * per node the cost from each landmark to it followed by the cost from it to each landmark. Its
+ * mapped so that every process using the same file shares the pages.
+ */
+class Landmarks {
+public:
+  // Marks a node which has no costs
+  static constexpr uint32_t kInvalidNode = 0xffffffff;
+
+  struct tile_t {
+    uint64_t tile_id;    // the base id of the tile
+    uint32_t first_node; // index of the first node of the tile
+    uint32_t node_count; // number of nodes in the tile
+  };
+
+  /**
+   * Constructor, nothing is loaded until Load is called.
+   */
+  Landmarks();
+
+  /**
+   * Maps landmarks written by Save if they are sound and were built from the tileset of the reader.
+   * @param  file    The file written by Save.
+   * @param  reader  The reader of the tileset to check the landmarks against.
+   * @return Returns true if the landmarks were loaded.
+   */
+  bool Load(const std::string& file, GraphReader& reader);
+
+  /**
+   * Writes landmarks so that they can be loaded. Its written to the side and moved into place so
+   * that no one ever maps half a file. Throws if the file cannot be written.
+   * @param  file            Where to write the landmarks.
+   * @param  reader          The reader of the tileset the landmarks were built from.
+   * @param  costing         The costing of the profile.
+   * @param  profile         The serialized costing options of the profile.
+   * @param  landmark_count  The number of landmarks.
+   * @param  tiles           The first node of each tile, sorted by node.
+   * @param  costs           Per node the cost from each landmark and then to each landmark.
+   */
+  static void Save(const std::string& file,
+                   GraphReader& reader,
+                   uint32_t costing,
+                   const std::string& profile,
+                   uint32_t landmark_count,
+                   const std::vector<tile_t>& tiles,
+                   const std::vector<float>& costs);
+
+  /**
+   * Are there landmarks loaded.
+   */
+  explicit operator bool() const {
+    return costs_ != nullptr;
+  }
+
+  /**
+   * Gets the costing the landmarks were built for.
+   */
+  uint32_t costing() const {
+    return costing_;
+  }
+
+  /**
+   * Gets the serialized costing options the landmarks were built for.
+   */
+  const std::string& profile() const {
+    return profile_;
+  }
+
+  /**
+   * Gets the number of landmarks.
+   */
+  uint32_t landmark_count() const {
+    return landmark_count_;
+  }
+
+  /**
+   * Gets the number of nodes with costs.
+   */
+  uint32_t node_count() const {
+    return node_count_;
+  }
+
+  /**
+   * Gets the index of a node.
+   * @param  node_id  The node.
+   * @return Returns the index or kInvalidNode if the node has no costs.
+   */
+  uint32_t node(const GraphId& node_id) const {
+    auto found = tile_index_.find(node_id.Tile_Base());
+    if (found == tile_index_.end() || node_id.id() >= tiles_[found->second].node_count) {
+      return kInvalidNode;
+    }
+    return tiles_[found->second].first_node + node_id.id();
+  }
+
+  /**
+   * Gets the costs from each of the landmarks to a node.
+   * @param  node  The index of the node.
+   */
+  const float* from(uint32_t node) const {
+    return costs_ + static_cast<size_t>(node) * 2 * landmark_count_;
+  }
+
+  /**
+   * Gets the costs from a node to each of the landmarks.
+   * @param  node  The index of the node.
+   */
+  const float* to(uint32_t node) const {
+    return from(node) + landmark_count_;
+  }
+
+protected:
+  midgard::mem_map<char> mapped_;
+  uint32_t costing_;
+  std::string profile_;
+  uint32_t landmark_count_;
+  uint32_t node_count_;
+  const tile_t* tiles_;
+  uint32_t tile_count_;
+  std::unordered_map<uint64_t, uint32_t> tile_index_;
+  const float* costs_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_LANDMARKS_H_
@@ -0,0 +1,203 @@
+#ifndef VALHALLA_BALDR_RADIX_HEAP_QUEUE_H_
+#define VALHALLA_BALDR_RADIX_HEAP_QUEUE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphconstants.h>
+#include <valhalla/baldr/label_queue.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Radix Heap - a monotone priority queue. The sort cost of a label is turned into a 32 bit key
+ * that sorts the same way, and a label goes into the bucket of the highest bit its key differs
+ * from the key last popped in, so bucket 0 holds the keys equal to the last one and bucket i the
+ * keys within [2^(i-1), 2^i) of it. Popping only has to look at the first non-empty bucket, and
+ * when that isnt bucket 0 the labels in it are spread over the buckets below it around their
+ * smallest key. Unlike the double bucket queue it doesnt need a cost range or bucket size up
+ * front, so it behaves the same whatever the range of costs or the unit size of the costing, and
+ * it pops labels in exactly the order of their costs rather than a bucket size at a time. It also
+ * keeps where in its bucket each label is, so a decrease doesnt have to search the (possibly very
+ * large) higher buckets for the label.
+ *
+ * The queue is monotone: it expects no label to be added with a lower cost than the last one
+ * popped. Should that happen anyway (an inconsistent heuristic for example) the label is treated
+ * as having the last cost popped, the same as the double bucket queue does with costs below its
+ * current bucket.
+ */
+template <typename label_t> class RadixHeapQueue final : public LabelQueue<label_t> {
+public:
+  // A bucket for each bit of the key plus one for the keys equal to the last one
+  static constexpr uint32_t kBucketCount = 33;
+
+  /**
+   * Constructor.
+   * @param labelcontainer  Container of the labels the label indexes are into.
+   * @param storage         Buckets of a previous queue (see release) to reuse the memory of.
+   */
+  RadixHeapQueue(const std::vector<label_t>& labelcontainer, buckets_t storage = buckets_t())
+      : last_(0), buckets_(std::move(storage)), labelcontainer_(labelcontainer) {
+    // Any reused buckets may still hold labels
+    for (auto& bucket : buckets_) {
+      bucket.clear();
+    }
+    // The one after the last bucket holds where each label is in its bucket
+    buckets_.resize(kBucketCount + 1);
+  }
+
+  /**
+   * Clear all labels from the buckets.
+   */
+  void clear() override {
+    for (auto& bucket : buckets_) {
+      bucket.clear();
+    }
+    last_ = 0;
+  }
+
+  /**
+   * Hands over the memory of the buckets so that another queue can reuse it. The queue cannot be
+   * used after this.
+   * @return  Returns the buckets.
+   */
+  buckets_t release() override {
+    buckets_t storage = std::move(buckets_);
+    buckets_.clear();
+    return storage;
+  }
+
+  /**
+   * Adds a label index to the bucket of its cost.
+   * @param   label  Label index to add to the queue.
+   */
+  void add(const uint32_t label) override {
+    auto& positions = buckets_[kBucketCount];
+    if (label >= positions.size()) {
+      positions.resize(std::max<size_t>(label + 1, positions.size() * 2));
+    }
+    push(get_bucket(key(labelcontainer_[label].sortcost())), label);
+  }
+
+  /**
+   * The specified label index now has a smaller cost. Moves it to the bucket of the new cost if
+   * that is a different one.
+   * @param  label        Label index to reorder.
+   * @param  newcost      New sort cost.
+   */
+  void decrease(const uint32_t label, const float newcost) override {
+    const auto prev = get_bucket(key(labelcontainer_[label].sortcost()));
+    const auto next = get_bucket(key(newcost));
+    if (prev != next) {
+      // Fill its place in the previous bucket with the last label in there
+      auto& prevbucket = buckets_[prev];
+      const auto position = buckets_[kBucketCount][label];
+      buckets_[kBucketCount][prevbucket.back()] = position;
+      prevbucket[position] = prevbucket.back();
+      prevbucket.pop_back();
+      push(next, label);
+    }
+  }
+
+  /**
+   * Removes the lowest cost label index from the buckets.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          kInvalidLabel if the buckets are empty.
+   */
+  uint32_t pop() override {
+    if (buckets_[0].empty()) {
+      // Find the first bucket with anything in it
+      uint32_t i = 1;
+      while (i < kBucketCount && buckets_[i].empty()) {
+        i++;
+      }
+      if (i == kBucketCount) {
+        return kInvalidLabel;
+      }
+
+      // Its smallest key is the last one from now on and everything else in it goes in a lower
+      // bucket, the buckets above it stay as they are
+      auto& bucket = buckets_[i];
+      uint32_t min = std::numeric_limits<uint32_t>::max();
+      for (const auto label : bucket) {
+        min = std::min(min, key(labelcontainer_[label].sortcost()));
+      }
+      last_ = min;
+      for (const auto label : bucket) {
+        push(get_bucket(key(labelcontainer_[label].sortcost())), label);
+      }
+      bucket.clear();
+    }
+
+    // Everything in the first bucket has the lowest cost
+    uint32_t label = buckets_[0].back();
+    buckets_[0].pop_back();
+    return label;
+  }
+
+private:
+  // Key of the last label popped
+  uint32_t last_;
+
+  // The buckets
+  buckets_t buckets_;
+
+  // Access to a container of labels to get cost given the label index.
+  const std::vector<label_t>& labelcontainer_;
+
+  /**
+   * Adds a label to the end of a bucket.
+   * @param  bucket  Index of the bucket.
+   * @param  label   Label index.
+   */
+  void push(const uint32_t bucket, const uint32_t label) {
+    buckets_[kBucketCount][label] = buckets_[bucket].size();
+    buckets_[bucket].push_back(label);
+  }
+
+  /**
+   * Returns a key that sorts the same as the cost. Positive floats sort the same as their bits
+   * so they just go above all the negative ones, the bits of negative floats sort backwards.
+   * @param  cost  Cost.
+   * @return Returns the key of the cost.
+   */
+  static uint32_t key(const float cost) {
+    uint32_t bits;
+    std::memcpy(&bits, &cost, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+  }
+
+  /**
+   * Returns the bucket of a key: the highest bit it differs from the last key in.
+   * @param  key  Key.
+   * @return Returns the index of the bucket the key lies within.
+   */
+  uint32_t get_bucket(const uint32_t key) const {
+    if (key <= last_) {
+      return 0;
+    }
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanReverse(&bit, key ^ last_);
+    return bit + 1;
+#else
+    return 32 - __builtin_clz(key ^ last_);
+#endif
+  }
+};
+
+template <typename label_t> constexpr uint32_t RadixHeapQueue<label_t>::kBucketCount;
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_RADIX_HEAP_QUEUE_H_
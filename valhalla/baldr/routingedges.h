@@ -0,0 +1,150 @@
+#ifndef VALHALLA_BALDR_ROUTINGEDGES_H_
+#define VALHALLA_BALDR_ROUTINGEDGES_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <valhalla/baldr/graphconstants.h>
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Class to access the routing edges within a tile. These are a copy of the handful of directed
+ * edge fields that path expansion looks at for nearly every edge it touches, stored as one array
+ * per field (indexed by directed edge index) rather than as one large record per edge. Expansion
+ * can then reject edges (shortcuts, superseded edges, edges without access) while only touching
+ * a few bytes per edge instead of the whole DirectedEdge.
+ *
+ * The arrays are laid out back to back in order of decreasing alignment:
+ *   uint64_t endnode[n]
+ *   uint32_t length[n]
+ *   uint16_t forwardaccess[n], reverseaccess[n]
+ *   uint8_t  speed[n], classification[n], use[n], restrictions[n],
+ *            opp_index[n], localedgeidx[n], shortcut[n], superseded[n]
+ * where the shortcut byte holds the shortcut mask in its low bits and the is_shortcut flag in
+ * its high bit. Since every edge takes 24 bytes the section stays 8 byte aligned.
+ */
+class RoutingEdges {
+public:
+  // Number of bytes each directed edge takes in the section
+  static constexpr size_t kBytesPerEdge = sizeof(uint64_t) + sizeof(uint32_t) +
+                                          2 * sizeof(uint16_t) + 8 * sizeof(uint8_t);
+
+  // Flag in the shortcut byte marking the edge as a shortcut
+  static constexpr uint8_t kIsShortcut = 0x80;
+
+  /**
+   * Constructor.
+   */
+  RoutingEdges() = default;
+
+  /**
+   * Gets the size of the section for the given number of directed edges.
+   * @param  count  Number of directed edges in the tile.
+   * @return  Returns the number of bytes of the section.
+   */
+  static size_t size(const uint32_t count) {
+    return static_cast<size_t>(count) * kBytesPerEdge;
+  }
+
+  /**
+   * Set the pointers to the arrays of the section within the GraphTile.
+   * @param  data   Pointer to the start of the section in the GraphTile.
+   * @param  count  Number of directed edges in the tile.
+   */
+  void set(const char* data, const uint32_t count) {
+    endnode_ = reinterpret_cast<const uint64_t*>(data);
+    length_ = reinterpret_cast<const uint32_t*>(endnode_ + count);
+    forwardaccess_ = reinterpret_cast<const uint16_t*>(length_ + count);
+    reverseaccess_ = forwardaccess_ + count;
+    speed_ = reinterpret_cast<const uint8_t*>(reverseaccess_ + count);
+    classification_ = speed_ + count;
+    use_ = classification_ + count;
+    restrictions_ = use_ + count;
+    opp_index_ = restrictions_ + count;
+    localedgeidx_ = opp_index_ + count;
+    shortcut_ = localedgeidx_ + count;
+    superseded_ = shortcut_ + count;
+  }
+
+  /**
+   * Does the tile have routing edges.
+   * @return  Returns true if the section is present.
+   */
+  explicit operator bool() const {
+    return endnode_ != nullptr;
+  }
+
+  GraphId endnode(const uint32_t idx) const {
+    return GraphId(endnode_[idx]);
+  }
+
+  uint32_t length(const uint32_t idx) const {
+    return length_[idx];
+  }
+
+  uint32_t forwardaccess(const uint32_t idx) const {
+    return forwardaccess_[idx];
+  }
+
+  uint32_t reverseaccess(const uint32_t idx) const {
+    return reverseaccess_[idx];
+  }
+
+  uint32_t speed(const uint32_t idx) const {
+    return speed_[idx];
+  }
+
+  RoadClass classification(const uint32_t idx) const {
+    return static_cast<RoadClass>(classification_[idx]);
+  }
+
+  Use use(const uint32_t idx) const {
+    return static_cast<Use>(use_[idx]);
+  }
+
+  uint32_t restrictions(const uint32_t idx) const {
+    return restrictions_[idx];
+  }
+
+  uint32_t opp_index(const uint32_t idx) const {
+    return opp_index_[idx];
+  }
+
+  uint32_t localedgeidx(const uint32_t idx) const {
+    return localedgeidx_[idx];
+  }
+
+  uint32_t shortcut(const uint32_t idx) const {
+    return shortcut_[idx] & ~kIsShortcut;
+  }
+
+  bool is_shortcut(const uint32_t idx) const {
+    return shortcut_[idx] & kIsShortcut;
+  }
+
+  uint32_t superseded(const uint32_t idx) const {
+    return superseded_[idx];
+  }
+
+protected:
+  const uint64_t* endnode_{};
+  const uint32_t* length_{};
+  const uint16_t* forwardaccess_{};
+  const uint16_t* reverseaccess_{};
+  const uint8_t* speed_{};
+  const uint8_t* classification_{};
+  const uint8_t* use_{};
+  const uint8_t* restrictions_{};
+  const uint8_t* opp_index_{};
+  const uint8_t* localedgeidx_{};
+  const uint8_t* shortcut_{};
+  const uint8_t* superseded_{};
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_ROUTINGEDGES_H_
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphtileptr.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Loads tiles on a small pool of background threads so that the thread using a GraphReader
+ * can overlap tile I/O (disk or http) with its own work. Requested tiles are loaded in the
+ * order they were requested and are kept until the owner takes them. The tiles are handed
+ * over to the owning thread under a lock and the background threads never hold on to a
+ * reference after that, so the tiles reference counters are never touched concurrently.
+ */
+class tile_prefetcher_t {
+public:
+  /**
+   * A function loading a tile from storage (without using any cache). It is called from the
+   * background threads so it must be thread-safe.
+   */
+  using loader_t = std::function<graph_tile_ptr(const GraphId&)>;
+
+  /**
+   * Constructor
+   *
+   * @param thread_count  the number of background threads to load tiles with
+   * @param max_tiles     the maximum number of tiles that are queued, loading or loaded but not
+   *                      yet taken. requests are dropped when it is reached
+   * @param loader        the function loading a tile from storage
+   */
+  tile_prefetcher_t(size_t thread_count, size_t max_tiles, loader_t loader);
+
+  /**
+   * Stops and joins the background threads. Tiles that were not taken are released.
+   */
+  ~tile_prefetcher_t();
+
+  /**
+   * Asks for the tile to be loaded in the background. Does nothing if the tile was already
+   * requested or if too many tiles are outstanding.
+   *
+   * @param tile_id  the base graphid of the tile
+   */
+  void request(const GraphId& tile_id);
+
+  /**
+   * Takes a prefetched tile. If the tile is currently being loaded this waits for the load to
+   * finish rather than loading it a second time. If the tile was requested but not yet picked up
+   * by a background thread the request is cancelled so the caller can load it directly.
+   *
+   * @param tile_id  the base graphid of the tile
+   * @return the tile or nullptr if it was not prefetched (or could not be loaded)
+   */
+  graph_tile_ptr take(const GraphId& tile_id);
+
+  /**
+   * Takes all the tiles that finished loading so far. The owner should do this regularly, tiles
+   * which are never taken count towards max_tiles and would eventually block further requests.
+   *
+   * @return the loaded tiles keyed by their base graphid
+   */
+  std::unordered_map<GraphId, graph_tile_ptr> take_loaded();
+
+  /**
+   * Drops all queued requests and loaded tiles that were not yet taken.
+   */
+  void clear();
+
+  tile_prefetcher_t(const tile_prefetcher_t&) = delete;
+  tile_prefetcher_t& operator=(const tile_prefetcher_t&) = delete;
+
+protected:
+  // background thread main loop
+  void work();
+
+  const size_t max_tiles_;
+  const loader_t loader_;
+
+  std::mutex mutex_;
+  // wakes up background threads when there is something to load or when stopping
+  std::condition_variable work_cond_;
+  // wakes up the owner waiting for a tile which is being loaded
+  std::condition_variable done_cond_;
+  bool stop_;
+
+  // requests in order, may contain ids which were cancelled in the meantime
+  std::deque<GraphId> queue_;
+  // requests which are not yet picked up by a background thread
+  std::unordered_set<GraphId> queued_;
+  // tiles currently being loaded by a background thread
+  std::unordered_set<GraphId> loading_;
+  // loaded tiles waiting to be taken
+  std::unordered_map<GraphId, graph_tile_ptr> loaded_;
+
+  std::vector<std::thread> threads_;
+};
+
+} // namespace baldr
+} // namespace valhalla
@@ -29,6 +29,8 @@ public:
   struct response_t {
     bytes_t bytes_;
     status_code_t status_ = status_code_t::FAILURE;
+    // whether the bytes came from a download someone else asked for first, they keep the copy
+    bool coalesced_ = false;
   };
 
   /**
@@ -36,6 +38,20 @@ public:
    * */
   virtual response_t get(const std::string& url) = 0;
 
+  /**
+   * Makes synchronous requests to all of the urls and returns their responses in the same order.
+   * The default implementation simply fetches them one after the other, implementations which
+   * can do better (concurrently, without fetching duplicates) should override it.
+   */
+  virtual std::vector<response_t> get_batch(const std::vector<std::string>& urls) {
+    std::vector<response_t> responses;
+    responses.reserve(urls.size());
+    for (const auto& url : urls) {
+      responses.emplace_back(get(url));
+    }
+    return responses;
+  }
+
   /**
    * Whether tiles are with .gz extension.
    */
@@ -8,6 +8,7 @@
 // C99 stdint.h, and POD structs with no constructors
 #ifndef C_ONLY_INTERFACE
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <exception>
 #include <memory>
@@ -184,7 +185,7 @@ struct TrafficTileHeader {
   uint64_t last_update; // seconds since epoch
   uint32_t directed_edge_count;
   uint32_t traffic_tile_version;
-  uint32_t spare2;
+  uint32_t epoch; // bumped every time new speeds are published, picks the buffer if double buffered
   uint32_t spare3;
 };
 
@@ -201,8 +202,14 @@ static_assert(sizeof(TrafficSpeed) == sizeof(uint64_t),
 /**
  * A tile of live traffic data.  The layout is:
  *
- * TrafficTileHeader (24 bytes)
- * n x TrafficSpeed entries (n x 2 bytes)
+ * TrafficTileHeader (32 bytes)
+ * n x TrafficSpeed entries (n x 8 bytes)
+ * n x TrafficSpeed entries (n x 8 bytes, optional)
+ *
+ * When the tile is big enough to hold the second set of entries it is double buffered: writers
+ * fill the buffer readers are not looking at and then publish it by bumping the epoch, whose low
+ * bit says which buffer is current. Readers therefore always see every speed of a tile from the
+ * same update. Tiles with a single buffer are updated in place one entry at a time.
  */
 #ifndef C_ONLY_INTERFACE
 namespace {
@@ -239,7 +246,8 @@ public:
         header(memory_ ? reinterpret_cast<volatile TrafficTileHeader*>(memory_->data) : nullptr),
         speeds(memory_ ? reinterpret_cast<volatile TrafficSpeed*>(memory_->data +
                                                                   sizeof(TrafficTileHeader))
-                       : nullptr) {
+                       : nullptr),
+        double_buffered(memory_ && is_double_buffered(memory_->size, header->directed_edge_count)) {
   }
 
   const volatile TrafficSpeed& trafficspeed(const uint32_t directed_edge_offset) const {
@@ -251,7 +259,7 @@ public:
                                std::to_string(directed_edge_offset) +
                                ", edge count: " + std::to_string(header->directed_edge_count));
 
-    return *(speeds + directed_edge_offset);
+    return *(current_speeds() + directed_edge_offset);
   }
 
   // Returns true if this tile is valid or not
@@ -259,6 +267,67 @@ public:
     return header != nullptr;
   }
 
+  /**
+   * The speeds readers should use right now. For double buffered tiles this is the buffer that
+   * was published last, the entries in it wont change until after the next publish.
+   * @return pointer to the first speed of the current buffer
+   */
+  volatile TrafficSpeed* current_speeds() const {
+    if (!double_buffered) {
+      return speeds;
+    }
+    const uint32_t current = load_epoch(header) & 1;
+    return speeds + current * header->directed_edge_count;
+  }
+
+  /**
+   * @return the number of times speeds have been published to this tile, 0 if there is no tile
+   */
+  uint32_t epoch() const {
+    return header ? load_epoch(header) : 0;
+  }
+
+  /**
+   * Reads the epoch of a tile that a writer may be bumping at the same time. It pairs with
+   * store_epoch so that the speeds published with the epoch are all seen.
+   * @param header  the header of the traffic tile
+   * @return the epoch of the tile
+   */
+  static uint32_t load_epoch(const volatile TrafficTileHeader* header) {
+#ifdef _MSC_VER
+    const uint32_t epoch = header->epoch;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return epoch;
+#else
+    return __atomic_load_n(&header->epoch, __ATOMIC_ACQUIRE);
+#endif
+  }
+
+  /**
+   * Publishes a new epoch of a tile once everything that goes with it has been written.
+   * @param header  the header of the traffic tile
+   * @param epoch   the new epoch
+   */
+  static void store_epoch(volatile TrafficTileHeader* header, const uint32_t epoch) {
+#ifdef _MSC_VER
+    std::atomic_thread_fence(std::memory_order_release);
+    header->epoch = epoch;
+#else
+    __atomic_store_n(&header->epoch, epoch, __ATOMIC_RELEASE);
+#endif
+  }
+
+  /**
+   * Whether a traffic tile of this size has room for two buffers of speeds
+   * @param size        the size in bytes of the traffic tile
+   * @param edge_count  the number of directed edges in the tile
+   * @return true if the tile is double buffered
+   */
+  static bool is_double_buffered(const size_t size, const uint32_t edge_count) {
+    return edge_count > 0 &&
+           size >= sizeof(TrafficTileHeader) + 2 * sizeof(TrafficSpeed) * size_t(edge_count);
+  }
+
 private:
   std::unique_ptr<const GraphMemory> memory_;
 
@@ -269,6 +338,8 @@ public:
   // our control (another process accessing a mmap'd file for example)
   volatile TrafficTileHeader* header;
   volatile TrafficSpeed* speeds;
+  // Whether there is a second buffer of speeds after the first
+  bool double_buffered;
 };
 
 } // namespace baldr
@@ -0,0 +1,134 @@
+#ifndef VALHALLA_BALDR_TRAFFICUPDATER_H_
+#define VALHALLA_BALDR_TRAFFICUPDATER_H_
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/traffictile.h>
+
+namespace valhalla {
+namespace midgard {
+struct tar;
+}
+namespace baldr {
+
+/**
+ * A live traffic update for a single directed edge
+ */
+struct TrafficUpdate {
+  GraphId edge_id;
+  TrafficSpeed speed;
+};
+
+/**
+ * Applies live traffic to a traffic extract in bulk. Updates are staged per tile and become
+ * visible to readers (any process mapping the extract) only when they are published, one tile at
+ * a time. Publishing a double buffered tile writes all of its staged updates into the buffer the
+ * readers are not using and then flips the epoch of the tile, so a reader either sees all of the
+ * updates of a publish for that tile or none of them. Single buffered tiles are written in place
+ * one speed at a time, as before, but still get their epoch bumped.
+ *
+ * A reader holding on to a speed across two publishes of the same tile can see the second one
+ * being written, so publishes of a tile should be further apart than the longest request. Only one
+ * updater should write to an extract at a time.
+ */
+class TrafficUpdater {
+public:
+  /**
+   * Maps the traffic extract for writing
+   * @param traffic_extract  the tar of traffic tiles to update
+   * @param use_index        whether to use (and maintain) the sidecar index of the tar
+   */
+  explicit TrafficUpdater(const std::string& traffic_extract, bool use_index = false);
+
+  /**
+   * Stages an update of an edge. If an edge is staged more than once the last update wins.
+   * @param edge_id  the directed edge to update
+   * @param speed    its new live speeds and congestion
+   * @return false if the extract has no traffic for that edge
+   */
+  bool Stage(const GraphId& edge_id, const TrafficSpeed& speed);
+
+  /**
+   * Stages a batch of updates
+   * @param updates  the updates to stage
+   * @return the number of updates which were staged
+   */
+  size_t Stage(const std::vector<TrafficUpdate>& updates);
+
+  /**
+   * Parses and stages updates, one per line, in either of these comma separated forms:
+   *
+   *   edge_id,speed[,congestion]
+   *   edge_id,overall_speed,speed1,speed2,speed3,breakpoint1,breakpoint2,congestion1,congestion2,congestion3
+   *
+   * where edge_id is level/tileid/id, speeds are in kph, breakpoints are 0-255 and congestion is
+   * 0 (unknown) or 1-63. The short form applies the speed and congestion to the whole edge. Blank
+   * lines and lines starting with # are skipped, malformed ones are logged and skipped.
+   * @param updates  the stream (or file) of updates
+   * @return the number of updates which were staged
+   */
+  size_t Stage(std::istream& updates);
+
+  /**
+   * Publishes all of the staged updates and clears them
+   * @param last_update  the time of the update, in seconds since epoch, to record in the tiles
+   * @return the number of tiles that were published
+   */
+  size_t Publish(uint64_t last_update);
+
+  /**
+   * Publishes all of the staged updates with the current time as the time of the update
+   * @return the number of tiles that were published
+   */
+  size_t Publish();
+
+  /**
+   * @return the number of updates currently staged
+   */
+  size_t staged_count() const {
+    return staged_count_;
+  }
+
+  /**
+   * @return the number of traffic tiles in the extract
+   */
+  size_t tile_count() const {
+    return tiles_.size();
+  }
+
+  /**
+   * Creates an empty traffic tile, for writing into a traffic extract
+   * @param tile_id          the graph tile this traffic belongs to
+   * @param edge_count       the number of directed edges in the graph tile
+   * @param double_buffered  whether to leave room for a second buffer of speeds
+   * @return the bytes of the traffic tile
+   */
+  static std::string CreateTile(const GraphId& tile_id,
+                                uint32_t edge_count,
+                                bool double_buffered = true);
+
+protected:
+  struct tile_t {
+    char* data;
+    size_t size;
+    std::vector<std::pair<uint32_t, TrafficSpeed>> staged;
+  };
+
+  std::shared_ptr<midgard::tar> archive_;
+  std::unordered_map<uint64_t, tile_t> tiles_;
+  // tiles with staged updates, in the order they were first staged
+  std::vector<tile_t*> dirty_;
+  size_t staged_count_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_TRAFFICUPDATER_H_
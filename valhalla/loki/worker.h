@@ -40,6 +40,7 @@ public:
   void route(Api& request);
   void matrix(Api& request);
   void isochrones(Api& request);
+  void batch_isochrones(Api& request);
   void trace(Api& request);
   std::string height(Api& request);
   std::string transit_available(Api& request);
@@ -58,6 +59,7 @@ protected:
   void init_route(Api& request);
   void init_matrix(Api& request);
   void init_isochrones(Api& request);
+  void correlate_isochrones(Api& request);
   void init_trace(Api& request);
   std::vector<midgard::PointLL> init_height(Api& request);
   void init_transit_available(Api& request);
@@ -90,6 +92,7 @@ protected:
   size_t max_contours;
   size_t max_contour_min;
   size_t max_contour_km;
+  size_t max_batch_isochrones;
   size_t max_trace_shape;
   float max_gps_accuracy;
   float max_search_radius;
@@ -3,10 +3,14 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <exception>
 #include <functional>
 #include <limits>
 #include <list>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/polyline2.h>
 #include <valhalla/midgard/tiles.h>
@@ -44,6 +48,19 @@ public:
         data_(this->nrows_ * this->ncolumns_, value) {
   }
 
+  /**
+   * Lays the grid out over new bounds and sets all of it to the value, keeping the memory the data
+   * already has so that a grid can be used for one isochrone after another.
+   * @param   bounds    Bounding box
+   * @param   tilesize  Tile size
+   * @param   value     Value to initialize data with.
+   */
+  void Reset(const AABB2<PointLL>& bounds, const float tilesize, const value_type& value) {
+    Tiles<PointLL>::operator=(Tiles<PointLL>(bounds, tilesize));
+    max_value_ = value;
+    data_.assign(this->nrows_ * this->ncolumns_, value);
+  }
+
   /**
    * Set the value at a specified tile Id if the value is less than the current
    * value set at the grid location. Verifies that the tile is valid.
@@ -61,7 +78,7 @@ public:
     }
   }
 
-  using contour_t = std::list<PointLL>;
+  using contour_t = std::vector<PointLL>;
   using feature_t = std::list<contour_t>;
   using contours_t = std::vector<std::list<feature_t>>;
   // dimension, value (seconds/meters), name (time/distance), color
@@ -83,23 +100,171 @@ public:
    * @param generalize           Generalization factor in meters. A special value
    *                             kOptimalGeneralization will let the method choose
    *                             an optimal generalization factor based on grid size.
+   * @param threads              the number of threads the intervals are contoured on, the
+   *                             contours are the same for any number of them
    *
    * @return contour line geometries with the larger intervals first (for rendering purposes)
    */
   contours_t GenerateContours(std::vector<contour_interval_t>& intervals,
                               const bool rings_only = false,
                               const float denoise = 1.f,
-                              const float generalize = 200.f) const {
+                              const float generalize = 200.f,
+                              const uint32_t threads = 1) const {
     // sort the contours first on the metric index then on the values with the bigger contours first
     std::sort(intervals.begin(), intervals.end(), std::greater<>());
 
+    // If the generalization value equals kOptimalGeneralization then set
+    // the generalization factor to 1/4 of the grid size
+    float gen_factor = generalize;
+    if (generalize == kOptimalGeneralization) {
+      gen_factor = this->tilesize_ * 0.25f * kMetersPerDegreeLat;
+    }
+
+    // every interval is contoured on its own so we hand them out to the threads one at a time
+    contours_t contours(intervals.size());
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_lock;
+    auto work = [&]() {
+      try {
+        for (size_t i = next++; i < intervals.size(); i = next++) {
+          contours[i] = Contour(std::get<0>(intervals[i]), std::get<1>(intervals[i]), rings_only,
+                                denoise, gen_factor);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_lock);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    };
+    std::vector<std::thread> workers;
+    for (size_t thread = 1; thread < std::min<size_t>(threads, intervals.size()); ++thread) {
+      workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+
+    return contours;
+  }
+
+protected:
+  // A contour line while it is being stitched together. The points before the segment it started
+  // with are kept in reverse in one buffer and the ones after it in another, so the line grows at
+  // either end and flips around without moving any of them. The keys are the grid locations of its
+  // ends, see Contour
+  class line_t {
+  public:
+    line_t(const PointLL& a, const uint64_t a_key, const PointLL& b, const uint64_t b_key)
+        : tail_{a, b}, reversed_(false), front_key(a_key), back_key(b_key), merged(false) {
+    }
+
+    size_t size() const {
+      return head_.size() + tail_.size();
+    }
+
+    const PointLL& front() const {
+      return front_side().empty() ? back_side().front() : front_side().back();
+    }
+
+    const PointLL& back() const {
+      return back_side().empty() ? front_side().front() : back_side().back();
+    }
+
+    void push_front(const PointLL& p) {
+      front_side().push_back(p);
+    }
+
+    void push_back(const PointLL& p) {
+      back_side().push_back(p);
+    }
+
+    void reverse() {
+      reversed_ = !reversed_;
+      std::swap(front_key, back_key);
+    }
+
+    // adds the other line to the end of this one, copying whichever of the two is shorter
+    void append(line_t& other) {
+      if (other.size() > size()) {
+        std::swap(head_, other.head_);
+        std::swap(tail_, other.tail_);
+        std::swap(reversed_, other.reversed_);
+        std::for_each(other.back_side().crbegin(), other.back_side().crend(),
+                      [this](const PointLL& p) { push_front(p); });
+        std::for_each(other.front_side().cbegin(), other.front_side().cend(),
+                      [this](const PointLL& p) { push_front(p); });
+      } else {
+        std::for_each(other.front_side().crbegin(), other.front_side().crend(),
+                      [this](const PointLL& p) { push_back(p); });
+        std::for_each(other.back_side().cbegin(), other.back_side().cend(),
+                      [this](const PointLL& p) { push_back(p); });
+      }
+      back_key = other.back_key;
+    }
+
+    contour_t points() const {
+      contour_t points;
+      points.reserve(size());
+      points.insert(points.end(), front_side().crbegin(), front_side().crend());
+      points.insert(points.end(), back_side().cbegin(), back_side().cend());
+      return points;
+    }
+
+  protected:
+    std::vector<PointLL>& front_side() {
+      return reversed_ ? tail_ : head_;
+    }
+    const std::vector<PointLL>& front_side() const {
+      return reversed_ ? tail_ : head_;
+    }
+    std::vector<PointLL>& back_side() {
+      return reversed_ ? head_ : tail_;
+    }
+    const std::vector<PointLL>& back_side() const {
+      return reversed_ ? head_ : tail_;
+    }
+
+    std::vector<PointLL> head_;
+    std::vector<PointLL> tail_;
+    bool reversed_;
+
+  public:
+    uint64_t front_key;
+    uint64_t back_key;
+    bool merged;
+  };
+
+  /**
+   * Contours a single interval, see GenerateContours.
+   *
+   * The segments are stitched together by where their ends lie in the grid rather than by their
+   * coordinates. An end is either a tile corner, a tile center, on one of the tile sides or on one
+   * of the diagonals between the center and the corners, so the tile id times 8 plus which of these
+   * it is identifies it. The tiles are walked a row at a time and an end is only ever shared with
+   * the tiles of the same or the next row, so the ends of the open lines are kept in a table of two
+   * rows worth of slots that the rows take turns in.
+   */
+  std::list<feature_t> Contour(const size_t metric_index,
+                               const float contour_value,
+                               const bool rings_only,
+                               const float denoise,
+                               const float gen_factor) const {
     // Values at tile corners and center (0 element is center)
     int sh[5];
     typename PointLL::first_type s[5]; // Values at the tile corners and center
     PointLL tile_corners[5];           // PointLL at tile corners and center
+    int corner_ids[5];                 // Tile ids of the tile corners
     int m1, m2, m3;                    // Indices into the tile corners
     PointLL pt1, pt2;                  // The intersection points in the tile
+    uint64_t key1, key2;               // Where in the grid the intersection points are
     int tile_inc[4] = {0, 1, this->ncolumns_ + 1, this->ncolumns_};
+    int tileid = 0;
 
     // Find the intersection along a tile edge
     auto intersect = [&tile_corners, &s](int p1, int p2) {
@@ -107,316 +272,308 @@ public:
       return PointLL((s[p2] * tile_corners[p1].first - s[p1] * tile_corners[p2].first) / ds,
                      (s[p2] * tile_corners[p1].second - s[p1] * tile_corners[p2].second) / ds);
     };
+    // The key of a tile corner or the center
+    auto vertex_key = [&corner_ids, &tileid](int p) -> uint64_t {
+      return p ? uint64_t(corner_ids[p]) * 8 : uint64_t(tileid) * 8 + 1;
+    };
+    // The key of a point between two tile corners or between the center and a corner
+    auto edge_key = [&corner_ids, &tileid](int p1, int p2) -> uint64_t {
+      if (p1 == 0 || p2 == 0) {
+        return uint64_t(tileid) * 8 + 3 + p1 + p2;
+      }
+      auto low = std::min(corner_ids[p1], corner_ids[p2]);
+      return uint64_t(low) * 8 + (std::abs(corner_ids[p1] - corner_ids[p2]) == 1 ? 2 : 3);
+    };
 
     // In the tight loop below, we need to decide where a contour intersects the triangles that make
     // up the given tile. this works out to a number of discrete cases which we lookup using the table
-    // below. based on the case we perform the appropriate intersection. to avoid branching we store
-    // the intersection operation for each case in an array and perform the correct one by calling the
-    // function stored in the array
-    int case_table[3][3][3] = {
+    // below. based on the case we perform the appropriate intersection
+    static constexpr int case_table[3][3][3] = {
         {{0, 0, 8}, {0, 2, 5}, {7, 6, 9}},
         {{0, 3, 4}, {1, 3, 1}, {4, 3, 0}},
         {{9, 6, 7}, {5, 2, 0}, {8, 0, 0}},
     };
-    std::array<std::function<void()>, 10> cases{
-        []() {},
-        // Line between vertices 1 and 2
-        [&]() {
-          pt1 = tile_corners[m1];
-          pt2 = tile_corners[m2];
-        },
-        // Line between vertices 2 and 3
-        [&]() {
-          pt1 = tile_corners[m2];
-          pt2 = tile_corners[m3];
-        },
-        // Line between vertices 3 and 1
-        [&]() {
-          pt1 = tile_corners[m3];
-          pt2 = tile_corners[m1];
-        },
-        // Line between vertex 1 and side 2-3
-        [&]() {
-          pt1 = tile_corners[m1];
-          pt2 = intersect(m2, m3);
-        },
-        // Line between vertex 2 and side 3-1
-        [&]() {
-          pt1 = tile_corners[m2];
-          pt2 = intersect(m3, m1);
-        },
-        // Line between vertex 3 and side 1-2
-        [&]() {
-          pt1 = tile_corners[m3];
-          pt2 = intersect(m1, m2);
-        },
-        // Line between sides 1-2 and 2-3
-        [&]() {
-          pt1 = intersect(m1, m2);
-          pt2 = intersect(m2, m3);
-        },
-        // Line between sides 2-3 and 3-1
-        [&]() {
-          pt1 = intersect(m2, m3);
-          pt2 = intersect(m3, m1);
-        },
-        // Line between sides 3-1 and 1-2
-        [&]() {
-          pt1 = intersect(m3, m1);
-          pt2 = intersect(m1, m2);
-        },
-    };
 
-    // which metrics do we need contours for
-    auto _ = std::make_pair(intervals.cbegin(), intervals.cend());
-    std::vector<decltype(_)> metrics{std::move(_)};
-    for (auto interval = intervals.cbegin(); interval != intervals.cend(); ++interval) {
-      if (std::get<0>(*interval) != std::get<0>(*metrics.back().first)) {
-        metrics.back().second = interval;
-        metrics.emplace_back(interval, intervals.cend());
+    // the lines so far, in the order they were started in
+    std::vector<line_t> lines;
+    // and the ends of the ones that are still open, the ones below the current row of tiles can't
+    // be connected to anymore so they can lose their slot
+    constexpr uint32_t kNoLine = std::numeric_limits<uint32_t>::max();
+    std::vector<std::pair<uint64_t, uint32_t>> ends(16 * this->ncolumns_, {0, kNoLine});
+    uint64_t first_key = 0;
+    auto find = [&ends](uint64_t key) {
+      const auto& end = ends[key % ends.size()];
+      return end.first == key ? end.second : kNoLine;
+    };
+    auto emplace = [&ends, &first_key](uint64_t key, uint32_t line) {
+      if (key < first_key) {
+        return;
       }
-    }
+      auto& end = ends[key % ends.size()];
+      if (end.first != key || end.second == kNoLine) {
+        end = {key, line};
+      }
+    };
+    auto erase = [&ends](uint64_t key) {
+      auto& end = ends[key % ends.size()];
+      if (end.first == key) {
+        end.second = kNoLine;
+      }
+    };
 
-    // we need something to hold each iso-line
-    contours_t contours(intervals.size(), std::list<feature_t>{feature_t{}});
-
-    // and something to find them quickly
-    using contour_lookup_t = std::unordered_map<PointLL, typename feature_t::iterator>;
-    std::vector<contour_lookup_t> lookups(intervals.size());
-    // TODO: preallocate the lookups for each interval
-
-    // For each metric we tracked
-    for (const auto& metric : metrics) {
-      size_t metric_index = std::get<0>(*metric.first);
-
-      // For each cell, skipping the outer rim since its out of bounds
-      for (int row = 1; row < this->nrows_ - 1; ++row) {
-        for (int col = 1; col < this->ncolumns_ - 1; ++col) {
-          int tileid = this->TileId(col, row);
-          auto cell1 = data_[tileid][metric_index];
-          auto cell2 = data_[tileid + this->ncolumns_][metric_index];     // TileId(col,   row+1)];
-          auto cell3 = data_[tileid + 1][metric_index];                   // TileId(col+1, row)];
-          auto cell4 = data_[tileid + this->ncolumns_ + 1][metric_index]; // TileId(col+1, row+1)];
-          auto dmin = std::min(std::min(cell1, cell2), std::min(cell3, cell4));
-          auto dmax = std::max(std::max(cell1, cell2), std::max(cell3, cell4));
-
-          // Continue if outside the range of contour values for this metric_index
-          if (dmax < std::get<1>(*std::prev(metric.second)) || dmin > std::get<1>(*metric.first)) {
+    // For each cell, skipping the outer rim since its out of bounds
+    for (int row = 1; row < this->nrows_ - 1; ++row) {
+      first_key = uint64_t(this->TileId(0, row)) * 8;
+      for (int col = 1; col < this->ncolumns_ - 1; ++col) {
+        tileid = this->TileId(col, row);
+        auto cell1 = data_[tileid][metric_index];
+        auto cell2 = data_[tileid + this->ncolumns_][metric_index];     // TileId(col,   row+1)];
+        auto cell3 = data_[tileid + 1][metric_index];                   // TileId(col+1, row)];
+        auto cell4 = data_[tileid + this->ncolumns_ + 1][metric_index]; // TileId(col+1, row+1)];
+        auto dmin = std::min(std::min(cell1, cell2), std::min(cell3, cell4));
+        auto dmax = std::max(std::max(cell1, cell2), std::max(cell3, cell4));
+
+        // Continue if the contour would not intersect this cell
+        if (contour_value < dmin || contour_value > dmax) {
+          continue;
+        }
+
+        for (int m = 4; m > 0; m--) {
+          int newtileid = tileid + tile_inc[m - 1];
+          // Make sure the tile corner value is not set to the max_value
+          // (messes up the intersect method). Set a value slightly above
+          // the contour (e.g. 1 minute higher).
+          // TODO - the value 1 is a bit of a hack.
+          float nd = data_[newtileid][metric_index];
+          s[m] = nd < max_value_[metric_index] ? nd - contour_value : 1.0f;
+          tile_corners[m] = this->Base(newtileid);
+          corner_ids[m] = newtileid;
+          sh[m] = (s[m] > 0.0f) - (s[m] < 0.0f); // pos = 1, neg = -1, 0 = 0
+        }
+        s[0] = 0.25 * (s[1] + s[2] + s[3] + s[4]);
+        tile_corners[0] = this->Center(tileid);
+        sh[0] = (s[0] > 0.0f) - (s[0] < 0.0f); // pos = 1, neg = -1, 0 = 0
+
+        /*
+         Note: at this stage the relative heights of the corners and the
+         centre are in the h array, and the corresponding coordinates are
+         in the xh and yh arrays. The centre of the box is indexed by 0
+         and the 4 corners by 1 to 4 as shown below.
+         Each triangle is then indexed by the parameter m, and the 3
+         vertices of each triangle are indexed by parameters m1,m2,and m3.
+         It is assumed that the centre of the box is always vertex 2
+         though this is important only when all 3 vertices lie exactly on
+         the same contour level, in which case only the side of the box
+         is drawn.
+            vertex 4 +-------------------+ vertex 3
+                     | \               / |
+                     |   \    m-3    /   |
+                     |     \       /     |
+                     |       \   /       |
+                     |  m=2    X   m=2   |       the centre is vertex 0
+                     |       /   \       |
+                     |     /       \     |
+                     |   /    m=1    \   |
+                     | /               \ |
+            vertex 1 +-------------------+ vertex 2
+        */
+
+        // Scan each triangle in the box
+        for (int m = 1; m <= 4; m++) {
+          // figure out which intersection we need to do
+          m1 = m;
+          m2 = 0;
+          m3 = (m != 4) ? m + 1 : 1;
+          switch (case_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1]) {
+            // there is no intersection of this triangle
+            case 0:
+              continue;
+            // Line between vertices 1 and 2
+            case 1:
+              pt1 = tile_corners[m1], key1 = vertex_key(m1);
+              pt2 = tile_corners[m2], key2 = vertex_key(m2);
+              break;
+            // Line between vertices 2 and 3
+            case 2:
+              pt1 = tile_corners[m2], key1 = vertex_key(m2);
+              pt2 = tile_corners[m3], key2 = vertex_key(m3);
+              break;
+            // Line between vertices 3 and 1
+            case 3:
+              pt1 = tile_corners[m3], key1 = vertex_key(m3);
+              pt2 = tile_corners[m1], key2 = vertex_key(m1);
+              break;
+            // Line between vertex 1 and side 2-3
+            case 4:
+              pt1 = tile_corners[m1], key1 = vertex_key(m1);
+              pt2 = intersect(m2, m3), key2 = edge_key(m2, m3);
+              break;
+            // Line between vertex 2 and side 3-1
+            case 5:
+              pt1 = tile_corners[m2], key1 = vertex_key(m2);
+              pt2 = intersect(m3, m1), key2 = edge_key(m3, m1);
+              break;
+            // Line between vertex 3 and side 1-2
+            case 6:
+              pt1 = tile_corners[m3], key1 = vertex_key(m3);
+              pt2 = intersect(m1, m2), key2 = edge_key(m1, m2);
+              break;
+            // Line between sides 1-2 and 2-3
+            case 7:
+              pt1 = intersect(m1, m2), key1 = edge_key(m1, m2);
+              pt2 = intersect(m2, m3), key2 = edge_key(m2, m3);
+              break;
+            // Line between sides 2-3 and 3-1
+            case 8:
+              pt1 = intersect(m2, m3), key1 = edge_key(m2, m3);
+              pt2 = intersect(m3, m1), key2 = edge_key(m3, m1);
+              break;
+            // Line between sides 3-1 and 1-2
+            case 9:
+              pt1 = intersect(m3, m1), key1 = edge_key(m3, m1);
+              pt2 = intersect(m1, m2), key2 = edge_key(m1, m2);
+              break;
+          }
+
+          // this isnt a segment..
+          if (pt1 == pt2) {
             continue;
           }
 
-          // For each requested contour value
-          for (size_t i = 0; i < intervals.size(); ++i) {
-            // some setup to process this contour
-            auto& lookup = lookups[i];
-            auto& contour = contours[i];
-            auto contour_value = std::get<1>(intervals[i]);
-
-            // we skip this contour if its interested in a different metric_index or its value
-            // would not intersect this cell
-            if (std::get<0>(intervals[i]) != metric_index || contour_value < dmin ||
-                contour_value > dmax) {
+          // see if we have anything to connect this segment to
+          auto rec_a = find(key1);
+          auto rec_b = find(key2);
+          if (rec_b != kNoLine) {
+            std::swap(pt1, pt2);
+            std::swap(key1, key2);
+            std::swap(rec_a, rec_b);
+          }
+
+          // we want to merge two records
+          if (rec_b != kNoLine) {
+            // get the segments in question and remove their lookup info
+            auto* segment_a = &lines[rec_a];
+            bool head_a = pt1 == segment_a->front();
+            auto* segment_b = &lines[rec_b];
+            bool head_b = pt2 == segment_b->front();
+            erase(key1);
+            erase(key2);
+
+            // this segment is now a ring
+            if (rec_a == rec_b) {
+              segment_a->push_back(segment_a->front());
               continue;
             }
 
-            for (int m = 4; m > 0; m--) {
-              int newtileid = tileid + tile_inc[m - 1];
-              // Make sure the tile corner value is not set to the max_value
-              // (messes up the intersect method). Set a value slightly above
-              // the contour (e.g. 1 minute higher).
-              // TODO - the value 1 is a bit of a hack.
-              float nd = data_[newtileid][metric_index];
-              s[m] = nd < max_value_[metric_index] ? nd - contour_value : 1.0f;
-              tile_corners[m] = this->Base(newtileid);
-              sh[m] = (s[m] > 0.0f) - (s[m] < 0.0f); // pos = 1, neg = -1, 0 = 0
+            // erase the other lookups
+            erase(head_a ? segment_a->back_key : segment_a->front_key);
+            erase(head_b ? segment_b->back_key : segment_b->front_key);
+
+            // add b to a
+            if (!head_a && head_b) {
+              segment_a->append(*segment_b);
+              segment_b->merged = true;
+            } // add a to b
+            else if (!head_b && head_a) {
+              segment_b->append(*segment_a);
+              segment_a->merged = true;
+              segment_a = segment_b;
+              rec_a = rec_b;
+            } // flip a and add b
+            else if (head_a && head_b) {
+              segment_a->reverse();
+              segment_a->append(*segment_b);
+              segment_b->merged = true;
+            } // flip b and add to a
+            else if (!head_a && !head_b) {
+              segment_b->reverse();
+              segment_a->append(*segment_b);
+              segment_b->merged = true;
             }
-            s[0] = 0.25 * (s[1] + s[2] + s[3] + s[4]);
-            tile_corners[0] = this->Center(tileid);
-            sh[0] = (s[0] > 0.0f) - (s[0] < 0.0f); // pos = 1, neg = -1, 0 = 0
-
-            /*
-             Note: at this stage the relative heights of the corners and the
-             centre are in the h array, and the corresponding coordinates are
-             in the xh and yh arrays. The centre of the box is indexed by 0
-             and the 4 corners by 1 to 4 as shown below.
-             Each triangle is then indexed by the parameter m, and the 3
-             vertices of each triangle are indexed by parameters m1,m2,and m3.
-             It is assumed that the centre of the box is always vertex 2
-             though this is important only when all 3 vertices lie exactly on
-             the same contour level, in which case only the side of the box
-             is drawn.
-                vertex 4 +-------------------+ vertex 3
-                         | \               / |
-                         |   \    m-3    /   |
-                         |     \       /     |
-                         |       \   /       |
-                         |  m=2    X   m=2   |       the centre is vertex 0
-                         |       /   \       |
-                         |     /       \     |
-                         |   /    m=1    \   |
-                         | /               \ |
-                vertex 1 +-------------------+ vertex 2
-            */
-
-            // Scan each triangle in the box
-            for (int m = 1; m <= 4; m++) {
-              // figure out which intersection we need to do
-              m1 = m;
-              m2 = 0;
-              m3 = (m != 4) ? m + 1 : 1;
-              int case_index = case_table[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1];
-
-              // there is no intersection of this triangle
-              if (case_index == 0) {
-                continue;
-              }
-
-              // do the intersection, assigns to pt1 and pt2 inside lambdas defined above
-              cases[case_index]();
-
-              // this isnt a segment..
-              if (pt1 == pt2) {
-                continue;
-              }
-
-              // see if we have anything to connect this segment to
-              typename contour_lookup_t::iterator rec_a = lookup.find(pt1);
-              typename contour_lookup_t::iterator rec_b = lookup.find(pt2);
-              if (rec_b != lookup.end()) {
-                std::swap(pt1, pt2);
-                std::swap(rec_a, rec_b);
-              }
-
-              // we want to merge two records
-              if (rec_b != lookup.end()) {
-                // get the segments in question and remove their lookup info
-                auto segment_a = rec_a->second;
-                bool head_a = rec_a->first == segment_a->front();
-                auto segment_b = rec_b->second;
-                bool head_b = rec_b->first == segment_b->front();
-                lookup.erase(rec_a);
-                lookup.erase(rec_b);
-
-                // this segment is now a ring
-                if (segment_a == segment_b) {
-                  segment_a->push_back(segment_a->front());
-                  continue;
-                }
-
-                // erase the other lookups
-                lookup.erase(
-                    lookup.find(pt1 == segment_a->front() ? segment_a->back() : segment_a->front()));
-                lookup.erase(
-                    lookup.find(pt2 == segment_b->front() ? segment_b->back() : segment_b->front()));
-
-                // add b to a
-                if (!head_a && head_b) {
-                  segment_a->splice(segment_a->end(), *segment_b);
-                  contour.front().erase(segment_b);
-                } // add a to b
-                else if (!head_b && head_a) {
-                  segment_b->splice(segment_b->end(), *segment_a);
-                  contour.front().erase(segment_a);
-                  segment_a = segment_b;
-                } // flip a and add b
-                else if (head_a && head_b) {
-                  segment_a->reverse();
-                  segment_a->splice(segment_a->end(), *segment_b);
-                  contour.front().erase(segment_b);
-                } // flip b and add to a
-                else if (!head_a && !head_b) {
-                  segment_b->reverse();
-                  segment_a->splice(segment_a->end(), *segment_b);
-                  contour.front().erase(segment_b);
-                }
-
-                // update the look up
-                lookup.emplace(segment_a->front(), segment_a);
-                lookup.emplace(segment_a->back(), segment_a);
-              } // ap/prepend to an existing one
-              else if (rec_a != lookup.end()) {
-                // it goes on the front
-                if (rec_a->second->front() == pt1) {
-                  rec_a->second->push_front(pt2);
-                  // it goes on the back
-                } else {
-                  rec_a->second->push_back(pt2);
-                }
-
-                // update the lookup table
-                lookup.emplace(pt2, rec_a->second);
-                lookup.erase(rec_a);
-              } // this is an orphan segment for now
-              else {
-                contour.front().push_front(contour_t{pt1, pt2});
-                lookup.emplace(pt1, contour.front().begin());
-                lookup.emplace(pt2, contour.front().begin());
-              }
+
+            // update the look up
+            emplace(segment_a->front_key, rec_a);
+            emplace(segment_a->back_key, rec_a);
+          } // ap/prepend to an existing one
+          else if (rec_a != kNoLine) {
+            auto& segment = lines[rec_a];
+            // it goes on the front
+            if (segment.front() == pt1) {
+              segment.push_front(pt2);
+              segment.front_key = key2;
+              // it goes on the back
+            } else {
+              segment.push_back(pt2);
+              segment.back_key = key2;
             }
-          } // Each contour
-        }   // Each tile col
-      }     // Each tile row
-    }       // Each dimension of the grid
 
-    // If the generalization value equals kOptimalGeneralization then set
-    // the generalization factor to 1/4 of the grid size
-    float gen_factor = generalize;
-    if (generalize == kOptimalGeneralization) {
-      gen_factor = this->tilesize_ * 0.25f * kMetersPerDegreeLat;
+            // update the lookup table
+            emplace(key2, rec_a);
+            erase(key1);
+          } // this is an orphan segment for now
+          else {
+            lines.emplace_back(pt1, key1, pt2, key2);
+            emplace(key1, lines.size() - 1);
+            emplace(key2, lines.size() - 1);
+          }
+        }
+      } // Each tile col
+    }   // Each tile row
+
+    // the lines that were started last come first and they only wanted rings
+    std::vector<std::pair<typename PointLL::first_type, contour_t>> contour;
+    for (auto line = lines.crbegin(); line != lines.crend(); ++line) {
+      if (!line->merged && (!rings_only || line->front() == line->back())) {
+        contour.emplace_back(0, line->points());
+        contour.back().first = polygon_area(contour.back().second);
+      }
+    }
+    // sort them by area (maybe length would be sufficient?) biggest first
+    std::stable_sort(contour.begin(), contour.end(), [](const auto& a, const auto& b) {
+      return std::abs(a.first) > std::abs(b.first);
+    });
+    // they only want the most significant ones!
+    if (denoise > 0.f && !contour.empty()) {
+      auto largest = contour.front().first;
+      contour.erase(std::remove_if(contour.begin(), contour.end(),
+                                   [largest, denoise](const auto& c) {
+                                     return std::abs(c.first / largest) < denoise;
+                                   }),
+                    contour.end());
     }
 
     // some info about the area the image covers
-    auto c = this->TileBounds().Center();
     auto h = this->tilesize_ / 2;
-    // for each contour
-    for (auto& collection : contours) {
-      auto& contour = collection.front();
-      // they only wanted rings
-      if (rings_only) {
-        contour.remove_if([](const contour_t& line) { return line.front() != line.back(); });
+    std::list<feature_t> collection;
+    if (rings_only) {
+      collection.emplace_back();
+    }
+    // clean up the lines
+    for (auto& area_line : contour) {
+      auto& line = area_line.second;
+      // TODO: generalizing makes self intersections which makes other libraries unhappy
+      if (gen_factor > 0.f) {
+        Polyline2<PointLL>::Generalize(line, gen_factor, {});
       }
-      // sort them by area (maybe length would be sufficient?) biggest first
-      std::unordered_map<const contour_t*, typename PointLL::first_type> cache(contour.size());
-      std::for_each(contour.cbegin(), contour.cend(),
-                    [&cache](const contour_t& c) { cache[&c] = polygon_area(c); });
-      contour.sort([&cache](const contour_t& a, const contour_t& b) {
-        return std::abs(cache[&a]) > std::abs(cache[&b]);
-      });
-      // they only want the most significant ones!
-      if (denoise > 0.f) {
-        contour.remove_if([&cache, &contour, denoise](const contour_t& c) {
-          return std::abs(cache[&c] / cache[&contour.front()]) < denoise;
-        });
+      // if this ends up as an inner we'll undo this later
+      if (area_line.first > 0) {
+        std::reverse(line.begin(), line.end());
       }
-      // clean up the lines
-      for (auto& line : contour) {
-        // TODO: generalizing makes self intersections which makes other libraries unhappy
-        if (gen_factor > 0.f) {
-          Polyline2<PointLL>::Generalize(line, gen_factor, {});
-        }
-        // if this ends up as an inner we'll undo this later
-        if (cache[&line] > 0) {
-          line.reverse();
-        }
-        // sampling the bottom left corner means everything is skewed, so unskew it
-        for (auto& coord : line) {
-          coord.first += h;
-          coord.second += h;
-        }
+      // sampling the bottom left corner means everything is skewed, so unskew it
+      for (auto& coord : line) {
+        coord.first += h;
+        coord.second += h;
       }
       // if they just wanted linestrings we need only one per feature
       if (!rings_only) {
-        for (auto& linestring : contour) {
-          collection.push_back({std::move(linestring)});
-        }
-        collection.pop_front();
+        collection.emplace_back();
       }
+      collection.back().push_back(std::move(line));
     }
 
-    return contours;
+    return collection;
   }
 
-protected:
   value_type max_value_;         // Maximum value stored in the tile
   std::vector<value_type> data_; // Data value within each tile
 };
@@ -580,7 +580,14 @@ struct tar {
     }
   };
 
-  tar(const std::string& tar_file, bool regular_files_only = true)
+  /**
+   * Maps a tar archive and indexes its contents
+   * @param tar_file            the archive
+   * @param regular_files_only  whether to skip directories, links etc when indexing the contents
+   * @param traverse            whether to index the contents at all, when false only the archive
+   *                            is mapped which is useful if the locations are known some other way
+   */
+  tar(const std::string& tar_file, bool regular_files_only = true, bool traverse = true)
       : tar_file(tar_file), corrupt_blocks(0) {
     // get the file size
     struct stat s;
@@ -595,6 +602,9 @@ struct tar {
 
     // map the file
     mm.map(tar_file, s.st_size);
+    if (!traverse) {
+      return;
+    }
 
     // determine opposite of preferred path separator (needed to update OS-specific path separator)
     const char opp_sep = filesystem::path::preferred_separator == '/' ? '\\' : '/';
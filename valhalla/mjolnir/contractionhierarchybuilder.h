@@ -0,0 +1,26 @@
+#ifndef VALHALLA_MJOLNIR_CONTRACTIONHIERARCHYBUILDER_H
+#define VALHALLA_MJOLNIR_CONTRACTIONHIERARCHYBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to contract the graph for one fixed (time invariant) costing profile and write the
+ * contraction hierarchy (see baldr::ContractionHierarchy) alongside the tiles.
+ */
+class ContractionHierarchyBuilder {
+public:
+  /**
+   * Contract the graph tiles with the default options of mjolnir.contraction_hierarchy_costing
+   * and write the hierarchy to mjolnir.contraction_hierarchy.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_CONTRACTIONHIERARCHYBUILDER_H
@@ -402,6 +402,15 @@ public:
                       const graph_tile_ptr& tile,
                       const std::array<std::vector<GraphId>, kBinCount>& more_bins);
 
+  /**
+   * Appends the routing edges, a compact copy of the directed edge fields used by path
+   * expansion, to the tile. Any routing edges the tile already has are replaced. Once a tile
+   * has them, StoreTileData, Update and UpdatePredictedSpeeds keep them up to date.
+   * @param tile_dir   Base tile directory
+   * @param tile       the tile that needs the routing edges
+   */
+  static void AddRoutingEdges(const std::string& tile_dir, const graph_tile_ptr& tile);
+
   /**
    * Get the turn lane builder at the specified index.
    * @param  idx  Index of the turn lane builder.
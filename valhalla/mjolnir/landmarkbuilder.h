@@ -0,0 +1,30 @@
+#ifndef VALHALLA_MJOLNIR_LANDMARKBUILDER_H
+#define VALHALLA_MJOLNIR_LANDMARKBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to select landmarks for the ALT heuristic of A* for one fixed (time invariant)
+ * costing profile and write their costs to and from the nodes of the highest level of the
+ * hierarchy (see baldr::Landmarks) alongside the tiles.
+ */
+class LandmarkBuilder {
+public:
+  // How many landmarks to select unless configured otherwise
+  static constexpr uint32_t kDefaultLandmarkCount = 16;
+
+  /**
+   * Select mjolnir.landmarks_count landmarks in the graph tiles for the default options of
+   * mjolnir.landmarks_costing and write their costs to mjolnir.landmarks.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_LANDMARKBUILDER_H
@@ -38,7 +38,9 @@ enum class BuildStage : int8_t {
   kRestrictions = 12,
   kElevation = 13,
   kValidate = 14,
-  kCleanup = 15
+  kContract = 15,
+  kLandmarks = 16,
+  kCleanup = 17
 };
 
 // Convert string to BuildStage
@@ -59,6 +61,8 @@ inline BuildStage string_to_buildstage(const std::string& s) {
        {"restrictions", BuildStage::kRestrictions},
        {"elevation", BuildStage::kElevation},
        {"validate", BuildStage::kValidate},
+       {"contract", BuildStage::kContract},
+       {"landmarks", BuildStage::kLandmarks},
        {"cleanup", BuildStage::kCleanup}};
 
   auto i = stringToBuildStage.find(s);
@@ -83,6 +87,8 @@ inline std::string to_string(BuildStage stg) {
        {static_cast<int8_t>(BuildStage::kRestrictions), "restrictions"},
        {static_cast<int8_t>(BuildStage::kElevation), "elevation"},
        {static_cast<int8_t>(BuildStage::kValidate), "validate"},
+       {static_cast<int8_t>(BuildStage::kContract), "contract"},
+       {static_cast<int8_t>(BuildStage::kLandmarks), "landmarks"},
        {static_cast<int8_t>(BuildStage::kCleanup), "cleanup"}};
 
   auto i = BuildStageStrings.find(static_cast<int8_t>(stg));
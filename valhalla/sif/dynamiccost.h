@@ -11,6 +11,7 @@
 #include <valhalla/baldr/graphtile.h>
 #include <valhalla/baldr/nodeinfo.h>
 #include <valhalla/baldr/rapidjson_utils.h>
+#include <valhalla/baldr/routingedges.h>
 #include <valhalla/baldr/timedomain.h>
 #include <valhalla/baldr/transitdeparture.h>
 #include <valhalla/midgard/logging.h>
@@ -239,6 +240,21 @@ public:
            (ignore_oneways_ && (edge->reverseaccess() & access_mask_));
   }
 
+  /**
+   * Checks if access is allowed for an edge using only the routing edges of its tile. This is
+   * the same check as IsAccessible on the directed edge, which lets path expansion reject an
+   * edge without touching its DirectedEdge. Costings that override IsAccessible or whose
+   * Allowed does not start with it must override this as well.
+   * @param  edges  Routing edges of the tile the edge is in.
+   * @param  idx    Index of the directed edge within the tile.
+   * @return  Returns true if access is allowed, false if not.
+   */
+  inline virtual bool IsAccessible(const baldr::RoutingEdges& edges, const uint32_t idx) const {
+    return (edges.forwardaccess(idx) & access_mask_) ||
+           (ignore_access_ && (edges.forwardaccess(idx) & baldr::kAllAccess)) ||
+           (ignore_oneways_ && (edges.reverseaccess(idx) & access_mask_));
+  }
+
   inline virtual bool ModeSpecificAllowed(const baldr::AccessRestriction&) const {
     return true;
   };
@@ -977,6 +993,16 @@ void ParseCostingOptions(const rapidjson::Document& doc,
                          CostingOptions* costing_options,
                          Costing costing = static_cast<Costing>(Costing_ARRAYSIZE));
 
+/**
+ * Serializes the default costing options of a costing the way a request would have them. Since
+ * a request that gives the options of its costing as an empty object and one that doesnt give them
+ * at all serialize differently, both have to be checked to tell a request is for the defaults.
+ * @param costing  the costing
+ * @param json     the costing options of the request as a json object, or nullptr if it has none
+ * @return the serialized costing options
+ */
+std::string SerializeDefaultCostingOptions(Costing costing, const char* json = nullptr);
+
 } // namespace sif
 
 } // namespace valhalla
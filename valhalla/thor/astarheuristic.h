@@ -1,23 +1,35 @@
 #ifndef VALHALLA_THOR_ASTARHEURISTIC_H_
 #define VALHALLA_THOR_ASTARHEURISTIC_H_
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/landmarks.h>
 #include <valhalla/midgard/distanceapproximator.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/util.h>
+#include <valhalla/proto/tripcommon.pb.h>
+#include <valhalla/sif/dynamiccost.h>
 
 namespace valhalla {
 namespace thor {
 
 /**
  * Class to calculate A* cost heuristics based on distances of nodes from
- * a destination within the shortest path computation.
+ * a destination within the shortest path computation. Given landmarks (see
+ * baldr::Landmarks) it can also bound the cost of the nodes they have costs
+ * for by the triangle inequality (ALT), which is a much tighter bound than
+ * the distance on all but the shortest routes.
  */
 class AStarHeuristic {
 public:
   /**
    * Constructor.
    */
-  AStarHeuristic() : distapprox_({}), costfactor_(1.0f) {
+  AStarHeuristic() : distapprox_({}), costfactor_(1.0f), landmarks_(nullptr), to_location_(true) {
   }
 
   /**
@@ -35,6 +47,36 @@ public:
     costfactor_ = factor;
   }
 
+  /**
+   * Bounds the cost to (or from) a location with landmarks from now on. The
+   * location is reached through the nodes of its candidate edges, which need
+   * not be on the level the landmarks have costs for, so a small search from
+   * each of them finds the closest nodes that are and bounds the costs of the
+   * location through them. If that fails for any candidate edge the landmarks
+   * are not used.
+   * @param  landmarks    Landmarks built for the costing of the search, they
+   *                      have to outlive their use here.
+   * @param  location     The location the heuristic estimates the cost to.
+   * @param  to_location  True if the cost is to the location (the forward
+   *                      search), false if it is from it (the reverse search).
+   * @param  reader       Graph reader.
+   * @param  costing      The costing of the search.
+   * @return Returns true if the landmarks are used.
+   */
+  bool InitLandmarks(const baldr::Landmarks* landmarks,
+                     const valhalla::Location& location,
+                     bool to_location,
+                     baldr::GraphReader& reader,
+                     const sif::DynamicCost& costing);
+
+  /**
+   * Stops using landmarks.
+   */
+  void ClearLandmarks() {
+    landmarks_ = nullptr;
+    bounds_.clear();
+  }
+
   /**
    * Get the distance to the destination given the lat,lng.
    * @param   ll  Current latitude, longitude.
@@ -77,10 +119,39 @@ public:
     return dist * costfactor_;
   }
 
+  /**
+   * Get the A* heuristic given the lat,lng of a node, using the landmarks as
+   * well if there are any with costs for the node. Also return distance via
+   * an argument.
+   * @param   ll    Lat,lng of the node.
+   * @param   node  The node.
+   * @param   dist  Distance (meters) to the destination.
+   * @return  Returns an estimate of the cost to the destination.
+   *          For A* shortest path this MUST UNDERESTIMATE the true cost.
+   */
+  float Get(const midgard::PointLL& ll, const baldr::GraphId& node, float& dist) const {
+    dist = sqrtf(distapprox_.DistanceSquared(ll));
+    const float estimate = dist * costfactor_;
+    return landmarks_ ? std::max(estimate, GetLandmarks(node)) : estimate;
+  }
+
 private:
   midgard::DistanceApproximator<midgard::PointLL> distapprox_; // Distance approximation
   float costfactor_; // Cost factor - ensures the cost estimate
                      // underestimates the true cost.
+
+  // Landmarks if they are used, the bounds of the location per candidate edge
+  // and landmark (see GetLandmarks) and whether the cost is to the location
+  const baldr::Landmarks* landmarks_;
+  std::vector<std::pair<float, float>> bounds_;
+  bool to_location_;
+
+  /**
+   * Get the landmark bound of the cost between a node and the location.
+   * @param   node  The node.
+   * @return  Returns the bound, 0 if there is none.
+   */
+  float GetLandmarks(const baldr::GraphId& node) const;
 };
 
 } // namespace thor
@@ -4,11 +4,13 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
-#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/label_queue.h>
+#include <valhalla/baldr/landmarks.h>
 #include <valhalla/baldr/time_info.h>
 #include <valhalla/proto/api.pb.h>
 #include <valhalla/sif/edgelabel.h>
@@ -70,6 +72,33 @@ public:
               const sif::TravelMode mode,
               const Options& options = Options::default_instance()) override;
 
+  /**
+   * Carry on with the search of the last GetBestPath after it found no path, once the costing
+   * has been relaxed for a second pass (hierarchy limits, destination only edges), rather than
+   * starting over. Only what the first pass left out for those rules is expanded again, along
+   * with the filtered edges of the locations as new candidates. The costing has to keep the same
+   * A* heuristic, see CanResume. Edges the first pass settled are not opened up again, so when it
+   * got to one of them through a detour the new edges would avoid, the path keeps the detour.
+   * This trades the optimality of the second pass for not searching all over again.
+   * @param  origin       Origin location, with the filtered edges among its path edges
+   * @param  dest         Destination location, with the filtered edges among its path edges
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  options      The request options.
+   * @return  Returns the path edges as GetBestPath does, or nothing if there still is no path.
+   */
+  std::vector<std::vector<PathInfo>> Resume(valhalla::Location& origin,
+                                            valhalla::Location& dest,
+                                            baldr::GraphReader& graphreader,
+                                            const Options& options);
+
+  /**
+   * Whether the last GetBestPath found no path and left its search to be carried on with Resume.
+   * @return Returns true if the search can be resumed.
+   */
+  bool CanResume() const {
+    return resumable_;
+  }
+
   /**
    * Returns the name of the algorithm
    * @return the name of the algorithm
@@ -83,6 +112,41 @@ public:
    */
   void Clear() override;
 
+  /**
+   * Maps landmarks to bound the A* heuristics with (see AStarHeuristic), for requests with the
+   * costing options they were built for. Logs and returns false if they cannot be used.
+   * @param  file    The file written by the mjolnir landmarks stage.
+   * @param  reader  The reader of the tileset to check the landmarks against.
+   * @return Returns true if the landmarks were loaded.
+   */
+  bool LoadLandmarks(const std::string& file, baldr::GraphReader& reader);
+
+  /**
+   * Whether a request is for the costing options the landmarks were built for, so that they can
+   * be used to route it.
+   * @param  options  The request options.
+   * @return Returns true if the landmarks can be used for the request.
+   */
+  bool LandmarksMatch(const Options& options) const;
+
+  // How far apart the locations of a route have to be for the searches to run on two threads
+  // unless configured otherwise
+  static constexpr float kDefaultParallelMinDistance = 200000.0f;
+
+  /**
+   * Run the forward and reverse searches of routes with locations at least some distance apart
+   * on two threads, rather than taking turns on one. Routes with a time at both ends or with
+   * alternates are still found on one thread.
+   * @param  reverse_reader  The graph reader of the reverse search, a reader cannot be shared
+   *                         between threads. Nullptr turns it off.
+   * @param  min_distance    The distance in meters between the locations to start at.
+   */
+  void set_parallel(const std::shared_ptr<baldr::GraphReader>& reverse_reader,
+                    const float min_distance = kDefaultParallelMinDistance) {
+    reverse_reader_ = reverse_reader;
+    parallel_min_distance_ = min_distance;
+  }
+
 protected:
   // Access mode used by the costing method
   uint32_t access_mode_;
@@ -105,13 +169,18 @@ protected:
   AStarHeuristic astarheuristic_forward_;
   AStarHeuristic astarheuristic_reverse_;
 
+  // Landmarks to bound the heuristics with, and how the costing options they were built for
+  // serialize when a request gives them as an empty object
+  baldr::Landmarks landmarks_;
+  std::string landmarks_explicit_profile_;
+
   // Vector of edge labels (requires access by index).
   std::vector<sif::BDEdgeLabel> edgelabels_forward_;
   std::vector<sif::BDEdgeLabel> edgelabels_reverse_;
 
   // Adjacency list - approximate double bucket sort
-  std::shared_ptr<baldr::DoubleBucketQueue<sif::BDEdgeLabel>> adjacencylist_forward_;
-  std::shared_ptr<baldr::DoubleBucketQueue<sif::BDEdgeLabel>> adjacencylist_reverse_;
+  std::shared_ptr<baldr::LabelQueue<sif::BDEdgeLabel>> adjacencylist_forward_;
+  std::shared_ptr<baldr::LabelQueue<sif::BDEdgeLabel>> adjacencylist_reverse_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_forward_;
@@ -121,6 +190,22 @@ protected:
   float threshold_;
   std::vector<CandidateConnection> best_connections_;
 
+  // Labels whose expansion left out edges for the hierarchy limits or the destination only rules,
+  // what the search started out with and whether it failed, for Resume to carry on from
+  std::vector<uint32_t> pruned_forward_;
+  std::vector<uint32_t> pruned_reverse_;
+  baldr::TimeInfo forward_time_info_;
+  baldr::TimeInfo reverse_time_info_;
+  bool invariant_;
+  bool resumable_;
+
+  // Running the searches on two threads, the reader of the reverse one and the edges each has
+  // settled for the other to find its connections in
+  std::shared_ptr<baldr::GraphReader> reverse_reader_;
+  float parallel_min_distance_;
+  SharedEdgeSet settled_forward_;
+  SharedEdgeSet settled_reverse_;
+
   /**
    * Initialize the A* heuristic and adjacency lists for both the forward
    * and reverse search.
@@ -204,6 +289,49 @@ protected:
                       const valhalla::Location& dest,
                       const baldr::TimeInfo& time_info);
 
+  /**
+   * Alternate between the forward and reverse searches, once the origin and destination are set,
+   * until they connect or either one runs out of edges.
+   * @param  graphreader        Graph tile reader.
+   * @param  options            The request options.
+   * @param  origin             The origin location.
+   * @param  destination        The destination location.
+   * @param  forward_time_info  Time at the origin.
+   * @param  reverse_time_info  Time at the destination.
+   * @param  invariant          Whether the time stays the same along the route.
+   * @return Returns the path infos, as GetBestPath does.
+   */
+  std::vector<std::vector<PathInfo>> Search(baldr::GraphReader& graphreader,
+                                            const Options& options,
+                                            const valhalla::Location& origin,
+                                            const valhalla::Location& destination,
+                                            const baldr::TimeInfo& forward_time_info,
+                                            const baldr::TimeInfo& reverse_time_info,
+                                            const bool invariant);
+
+  /**
+   * Run the forward search on this thread and the reverse search on another one, once the
+   * origin and destination are set. Each search stops on its own once it gets past the threshold
+   * set by the first connection either of them finds, so they go at least as far as they would
+   * taking turns. The connections are costed and checked against complex restrictions once
+   * both are done.
+   * @param  graphreader        Graph tile reader of the forward search.
+   * @param  options            The request options.
+   * @param  origin             The origin location.
+   * @param  destination        The destination location.
+   * @param  forward_time_info  Time at the origin.
+   * @param  reverse_time_info  Time at the destination.
+   * @param  invariant          Whether the time stays the same along the route.
+   * @return Returns the path infos, as GetBestPath does.
+   */
+  std::vector<std::vector<PathInfo>> GetBestPathParallel(baldr::GraphReader& graphreader,
+                                                         const Options& options,
+                                                         const valhalla::Location& origin,
+                                                         const valhalla::Location& destination,
+                                                         const baldr::TimeInfo& forward_time_info,
+                                                         const baldr::TimeInfo& reverse_time_info,
+                                                         const bool invariant);
+
   /**
    * The edge on the forward search connects to a reached edge on the reverse
    * search tree. Check if this is the best connection so far and set the
@@ -0,0 +1,134 @@
+#ifndef VALHALLA_THOR_BUCKETMATRIX_H_
+#define VALHALLA_THOR_BUCKETMATRIX_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/contractionhierarchy.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/tripcommon.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/costmatrix.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Many to many time and distance matrix over a contraction hierarchy (see
+ * baldr::ContractionHierarchy). A search up the hierarchy from every target leaves an entry in
+ * the bucket of each vertex it settles, then a search up the hierarchy from every source scans the
+ * buckets of the vertices it settles, and the cheapest source + bucket entry at any vertex is the
+ * best path between the two. Each location is only searched once and the searches settle very few
+ * vertices, so unlike CostMatrix and TimeDistanceMatrix this scales to thousands of sources and
+ * targets. The answer is only right for the costing profile the hierarchy was contracted for, so
+ * check ContractionHierarchyQuery::Matches first.
+ */
+class BucketMatrix {
+public:
+  /**
+   * Constructor.
+   * @param  hierarchy  The contraction hierarchy to search, it has to outlive the matrix.
+   */
+  explicit BucketMatrix(const baldr::ContractionHierarchy& hierarchy);
+  ~BucketMatrix();
+
+  /**
+   * Forms a time distance matrix from the set of source locations
+   * to the set of target locations.
+   * @param  source_location_list  List of source/origin locations.
+   * @param  target_location_list  List of target/destination locations.
+   * @param  graphreader           Graph reader for accessing routing graph.
+   * @param  mode_costing          Costing methods.
+   * @param  mode                  Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @return time/distance from origin index to all other locations
+   */
+  std::vector<TimeDistance>
+  SourceToTarget(const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+                 const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+                 baldr::GraphReader& graphreader,
+                 const sif::mode_costing_t& mode_costing,
+                 const sif::TravelMode mode,
+                 const float max_matrix_distance);
+
+  /**
+   * Clear the temporary information generated during time+distance
+   * matrix construction.
+   */
+  void Clear();
+
+protected:
+  // A vertex settled by the search from one location. The part of the edge of the vertex a path
+  // covers is from where it begins (0 unless its the edge of the source) to where it ends (1
+  // unless its the edge of the target)
+  struct label_t {
+    uint32_t vertex;
+    float cost;
+    float secs;
+    float length;
+    float percent; // where the path begins for a source, ends for a target
+  };
+
+  // The search from a target left this at a vertex
+  struct bucket_t {
+    uint32_t vertex;
+    uint32_t target;
+    float cost;
+    float secs;
+    float length;
+    float end;
+  };
+
+  // The best connection between a source and a target so far
+  struct best_t {
+    float cost;
+    float secs;
+    float length;
+  };
+
+  using queue_t =
+      std::priority_queue<std::pair<float, uint32_t>, std::vector<std::pair<float, uint32_t>>,
+                          std::greater<std::pair<float, uint32_t>>>;
+
+  // Gets the cost threshold (in seconds) for the mode, the same as CostMatrix uses
+  float GetCostThreshold(const float max_matrix_distance) const;
+
+  // Searches up the hierarchy from the edges of a location and returns every vertex it settles
+  const std::vector<label_t>&
+  Search(bool forward, baldr::GraphReader& graphreader, const valhalla::Location& location);
+
+  // Labels a vertex unless it already has a cheaper label
+  void Add(const label_t& label);
+
+  const baldr::ContractionHierarchy& hierarchy_;
+
+  // Current travel mode and costing
+  sif::TravelMode mode_;
+  std::shared_ptr<sif::DynamicCost> costing_;
+
+  // Searches dont go on past this many seconds
+  float cost_threshold_;
+
+  // The labels, queue and labels by vertex of the current search and what it has settled
+  std::vector<label_t> labels_;
+  queue_t queue_;
+  std::unordered_map<uint32_t, uint32_t> labeled_;
+  std::vector<label_t> settled_;
+
+  // The bucket entries of all the targets sorted by vertex, and where those of a vertex begin
+  std::vector<bucket_t> buckets_;
+  std::unordered_map<uint32_t, uint32_t> bucket_index_;
+
+  // The best connection of each source to each target
+  std::vector<best_t> best_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_BUCKETMATRIX_H_
@@ -0,0 +1,166 @@
+#ifndef VALHALLA_THOR_CONTRACTION_HIERARCHY_H_
+#define VALHALLA_THOR_CONTRACTION_HIERARCHY_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/contractionhierarchy.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/pathalgorithm.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Point to point and one to many queries on a contraction hierarchy built by mjolnir (see
+ * baldr::ContractionHierarchy). Both directions only ever search up the hierarchy so they settle
+ * a tiny fraction of the edges A* would, but the answer is only right for the costing profile the
+ * hierarchy was contracted for. Use Matches to tell whether a request can be answered here and
+ * fall back to A* when it cant, or when no path is returned (an edge the hierarchy doesnt know,
+ * a path through a complex restriction the hierarchy cannot represent).
+ */
+class ContractionHierarchyQuery : public PathAlgorithm {
+public:
+  /**
+   * Constructor, there is nothing to query until Load is called.
+   */
+  ContractionHierarchyQuery();
+
+  /**
+   * Destructor
+   */
+  virtual ~ContractionHierarchyQuery();
+
+  /**
+   * Maps the contraction hierarchy. Logs and returns false if it cannot be used.
+   * @param  file    The file written by the mjolnir contraction stage.
+   * @param  reader  The reader of the tileset it was built from.
+   * @return Returns true if the hierarchy can be queried.
+   */
+  bool Load(const std::string& file, baldr::GraphReader& reader);
+
+  /**
+   * Can the request be answered from the hierarchy. Its costing options have to be the default
+   * options of the costing the hierarchy was contracted for.
+   * @param  options  The request options.
+   * @return Returns true if the request matches the profile of the hierarchy.
+   */
+  bool Matches(const Options& options) const;
+
+  /**
+   * Gets the mapped contraction hierarchy.
+   */
+  const baldr::ContractionHierarchy& hierarchy() const {
+    return hierarchy_;
+  }
+
+  /**
+   * Form path between and origin and destination location.
+   * @param  origin        Origin location
+   * @param  dest          Destination location
+   * @param  graphreader   Graph reader for accessing routing graph.
+   * @param  mode_costing  An array of costing methods, one per TravelMode.
+   * @param  mode          Travel mode from the origin.
+   * @return Returns the path edges (and elapsed time/modes at end of each edge) or nothing if
+   *         the hierarchy cannot find the path.
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Form the paths from an origin to each of many destinations. The search up the hierarchy
+   * from the origin is only done once.
+   * @param  origin        Origin location
+   * @param  destinations  Destination locations
+   * @param  graphreader   Graph reader for accessing routing graph.
+   * @param  mode_costing  An array of costing methods, one per TravelMode.
+   * @param  mode          Travel mode from the origin.
+   * @return Returns one path per destination, in the same order, which is empty if the hierarchy
+   *         cannot find it.
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPaths(valhalla::Location& origin,
+               google::protobuf::RepeatedPtrField<valhalla::Location>& destinations,
+               baldr::GraphReader& graphreader,
+               const sif::mode_costing_t& mode_costing,
+               const sif::TravelMode mode);
+
+  /**
+   * Returns the name of the algorithm
+   * @return the name of the algorithm
+   */
+  virtual const char* name() const override {
+    return "contraction_hierarchy";
+  }
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear() override;
+
+protected:
+  struct label_t {
+    uint32_t vertex;
+    uint32_t predecessor; // label index or kInvalidLabel
+    uint32_t middle;      // of the arc from the predecessor
+    float cost;
+  };
+
+  using queue_t =
+      std::priority_queue<std::pair<float, uint32_t>, std::vector<std::pair<float, uint32_t>>,
+                          std::greater<std::pair<float, uint32_t>>>;
+
+  // Adds the edges of the location to the forward or reverse search
+  void SetOrigin(baldr::GraphReader& graphreader, const valhalla::Location& origin);
+  void SetDestination(baldr::GraphReader& graphreader, const valhalla::Location& dest);
+
+  // Labels a vertex unless it already has a cheaper label
+  void Add(int direction, uint32_t vertex, uint32_t predecessor, uint32_t middle, float cost);
+
+  // Settles the next label of a direction and returns its index
+  uint32_t Settle(int direction, baldr::GraphReader& graphreader);
+
+  // Runs the reverse search until it cant beat the best connection, returns the vertex where
+  // the two searches meet or kInvalidVertex
+  uint32_t Connect(baldr::GraphReader& graphreader, bool forward_too);
+
+  // Appends the vertices of an arc, less the one it leaves, unpacking any shortcuts
+  void Unpack(uint32_t from, uint32_t to, uint32_t middle, std::vector<uint32_t>& vertices) const;
+
+  // Turns the searches meeting at a vertex into the edges of the path
+  std::vector<PathInfo> FormPath(baldr::GraphReader& graphreader,
+                                 uint32_t meet,
+                                 const valhalla::Location& origin,
+                                 const valhalla::Location& dest);
+
+  baldr::ContractionHierarchy hierarchy_;
+  // serialized default options of the costing of the hierarchy when parsed from an empty object,
+  // empty if the hierarchy was not built with the current defaults
+  std::string explicit_profile_;
+
+  sif::TravelMode mode_;
+  std::shared_ptr<sif::DynamicCost> costing_;
+
+  // the labels, queue and labels by vertex of the forward and reverse searches
+  std::vector<label_t> labels_[2];
+  queue_t queue_[2];
+  std::unordered_map<uint32_t, uint32_t> labeled_[2];
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_CONTRACTION_HIERARCHY_H_
@@ -8,6 +8,8 @@
 #include <utility>
 #include <vector>
 
+#include <boost/property_tree/ptree.hpp>
+
 #include <valhalla/baldr/double_bucket_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
@@ -87,11 +89,27 @@ struct BestCandidate {
  */
 class CostMatrix {
 public:
+  // The threads besides the calling one that the sources and targets are expanded on
+  class Threads;
+
+  /**
+   * Makes the threads a cost matrix can expand its sources and targets on. Each of them reads the
+   * tiles with a graph reader of its own, they can only be shared by matrices that are not
+   * computed at the same time.
+   * @param  config        The mjolnir configuration to make the graph readers with.
+   * @param  thread_count  Number of threads to expand on, the calling thread included.
+   * @return Returns the threads or nothing if there is only the calling thread.
+   */
+  static std::shared_ptr<Threads> MakeThreads(const boost::property_tree::ptree& config,
+                                              uint32_t thread_count);
+
   /**
    * Default constructor. Most internal values are set when a query is made so
    * the constructor mainly just sets some internals to a default empty value.
+   * @param  threads  Threads to expand the sources and targets on besides the calling one. The
+   *                  results do not depend on them.
    */
-  CostMatrix();
+  explicit CostMatrix(std::shared_ptr<Threads> threads = nullptr);
   ~CostMatrix();
 
   /**
@@ -120,6 +138,9 @@ public:
   void Clear();
 
 protected:
+  // Threads expanding the locations besides the calling one
+  std::shared_ptr<Threads> threads_;
+
   // Access mode used by the costing method
   uint32_t access_mode_;
 
@@ -159,6 +180,13 @@ protected:
   // List of best connections found so far
   std::vector<BestCandidate> best_connection_;
 
+  // The locations are expanded in steps, all targets then all sources, and nothing one location
+  // does within a step affects another until the step is over. These hold what each one did
+  // that is shared: the edges each target reached and the targets each source connected to
+  // (with the number of edge labels of the source at the time).
+  std::vector<std::vector<baldr::GraphId>> target_reached_;
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> source_connected_;
+
   /**
    * Get the cost threshold based on the current mode and the max arc-length distance
    * for that mode.
@@ -177,11 +205,12 @@ protected:
 
   /**
    * Iterate the forward search from the source/origin location.
-   * @param  index        Index of the source location.
-   * @param  n            Iteration counter.
-   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  index  Index of the source location.
+   * @param  n      Iteration counter.
+   * @param  graphreader  Graph reader of the thread for accessing routing graph.
+   * @return Returns true if the forward search is exhausted.
    */
-  void ForwardSearch(const uint32_t index, const uint32_t n, baldr::GraphReader& graphreader);
+  bool ForwardSearch(const uint32_t index, const uint32_t n, baldr::GraphReader& graphreader);
 
   /**
    * Check if the edge on the forward search connects to a reached edge
@@ -199,12 +228,40 @@ protected:
    */
   void UpdateStatus(const uint32_t source, const uint32_t target);
 
+  /**
+   * Update the status of the source when a connection is found.
+   * @param  source  Source index
+   * @param  target  Target index
+   */
+  void UpdateSourceStatus(const uint32_t source, const uint32_t target);
+
+  /**
+   * Update the status of the target when a connection is found.
+   * @param  source         Source index
+   * @param  target         Target index
+   * @param  source_labels  Number of edge labels of the source when it was found.
+   */
+  void UpdateTargetStatus(const uint32_t source, const uint32_t target, const size_t source_labels);
+
   /**
    * Iterate the backward search from the target/destination location.
-   * @param  index        Index of the target location.
-   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  index  Index of the target location.
+   * @param  graphreader  Graph reader of the thread for accessing routing graph.
+   * @return Returns true if the backward search is exhausted.
+   */
+  bool BackwardSearch(const uint32_t index, baldr::GraphReader& graphreader);
+
+  /**
+   * Apply what the locations shared during a step of the backward searches, in order of target.
+   * @param  exhausted  Whether each target search was exhausted in the step.
+   */
+  void FinishBackwardStep(const std::vector<uint8_t>& exhausted);
+
+  /**
+   * Apply what the locations shared during a step of the forward searches, in order of source.
+   * @param  exhausted  Whether each source search was exhausted in the step.
    */
-  void BackwardSearch(const uint32_t index, baldr::GraphReader& graphreader);
+  void FinishForwardStep(const std::vector<uint8_t>& exhausted);
 
   /**
    * Sets the source/origin locations. Search expands forward from these
@@ -8,7 +8,7 @@
 #include <utility>
 #include <vector>
 
-#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/location.h>
@@ -18,6 +18,7 @@
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/searcharena.h>
 
 namespace valhalla {
 namespace thor {
@@ -48,6 +49,15 @@ public:
    */
   virtual void Clear();
 
+  /**
+   * Sets the arena the expansion takes its storage from, so that it can be shared with the other
+   * algorithms of a worker. The expansion has an arena of its own until then.
+   * @param  arena  The arena.
+   */
+  void set_search_arena(const std::shared_ptr<SearchArena>& arena) {
+    arena_ = arena;
+  }
+
   /**
    * Compute the best first graph traversal from a list of origin locations
    * @param  origin_locs  List of origin locations.
@@ -124,12 +134,15 @@ protected:
   std::vector<sif::MMEdgeLabel> mmedgelabels_;
 
   // Adjacency list - approximate double bucket sort
-  std::shared_ptr<baldr::DoubleBucketQueue<sif::BDEdgeLabel>> adjacencylist_;
-  std::shared_ptr<baldr::DoubleBucketQueue<sif::MMEdgeLabel>> mmadjacencylist_;
+  std::shared_ptr<baldr::LabelQueue<sif::BDEdgeLabel>> adjacencylist_;
+  std::shared_ptr<baldr::LabelQueue<sif::MMEdgeLabel>> mmadjacencylist_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
 
+  // Where the storage of the expansions comes from and goes back to
+  std::shared_ptr<SearchArena> arena_;
+
   // when doing timezone differencing a timezone cache speeds up the computation
   baldr::DateTime::tz_sys_info_cache_t tz_cache_;
 
@@ -142,7 +155,7 @@ protected:
   template <typename label_container_t>
   void
   Initialize(label_container_t& labels,
-             std::shared_ptr<baldr::DoubleBucketQueue<typename label_container_t::value_type>>& queue,
+             std::shared_ptr<baldr::LabelQueue<typename label_container_t::value_type>>& queue,
              const uint32_t bucketsize);
 
   /**
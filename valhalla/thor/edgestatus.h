@@ -1,9 +1,17 @@
 #ifndef VALHALLA_THOR_EDGESTATUS_H_
 #define VALHALLA_THOR_EDGESTATUS_H_
 
-#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
+#include <valhalla/thor/searcharena.h>
 
 namespace valhalla {
 namespace thor {
@@ -47,25 +55,60 @@ struct EdgeStatusInfo {
  * edges within arrays for each tile. This allows the path algorithms to get
  * a pointer to the first edge status and iterate that pointer over sequential
  * edges. This reduces the number of map lookups.
+ *
+ * The arrays are found by tile through a small open addressing table, and
+ * since the search tends to stay within one tile for a while the last tile
+ * looked up is checked before the table. Clearing zeroes the arrays and keeps
+ * them in a pool, so repeated searches with the same object dont allocate them
+ * over and over again. The statuses are zeroed whole rather than only the ones
+ * that were set since the path algorithms also write them through GetPtr.
+ * The pool can instead be a SearchArena shared with the other storage of the
+ * searches, see set_arena.
  */
 class EdgeStatus {
 public:
+  EdgeStatus()
+      : slots_(kInitialSlots), size_(0), pooled_edges_(0), last_tile_(kEmptyTile),
+        last_edges_(nullptr) {
+  }
+
+  // the table points into the arrays, moving keeps them where they are but copying would not
+  EdgeStatus(EdgeStatus&&) = default;
+  EdgeStatus& operator=(EdgeStatus&&) = default;
+  EdgeStatus(const EdgeStatus&) = delete;
+  EdgeStatus& operator=(const EdgeStatus&) = delete;
+
   /**
-   * Destructor. Delete any allocated EdgeStatusInfo arrays.
+   * Keep the arrays in an arena rather than in a pool of our own, from the
+   * next clear on.
+   * @param  arena  The arena.
    */
-  ~EdgeStatus() {
-    clear();
+  void set_arena(const std::shared_ptr<SearchArena>& arena) {
+    arena_ = arena;
   }
 
   /**
-   * Clear the EdgeStatusInfo arrays and the edge status map.
+   * Clear the edge status of all tiles. The arrays are kept for the next
+   * search, up to kMaxPooledEdges worth of them unless an arena keeps them.
    */
   void clear() {
-    // Delete any allocated arrays for tiles within the map.
-    for (auto& iter : edgestatus_) {
-      delete[] iter.second;
+    for (auto& edges : in_use_) {
+      // whoever gets the array next, us or another user of the arena, expects it reset
+      std::fill(edges.begin(), edges.end(), EdgeStatusInfo());
+      if (arena_) {
+        arena_->Release(edges);
+      } else if (pooled_edges_ + edges.size() <= kMaxPooledEdges) {
+        pooled_edges_ += edges.size();
+        pool_.emplace_back(std::move(edges));
+      }
+    }
+    in_use_.clear();
+    if (size_ > 0) {
+      std::fill(slots_.begin(), slots_.end(), slot_t{});
+      size_ = 0;
     }
-    edgestatus_.clear();
+    last_tile_ = kEmptyTile;
+    last_edges_ = nullptr;
   }
 
   /**
@@ -75,18 +118,11 @@ public:
    * @param  index    Index of the edge label.
    * @param  tile     Graph tile of the directed edge.
    */
-  void
-  Set(const baldr::GraphId& edgeid, const EdgeSet set, const uint32_t index, graph_tile_ptr tile) {
-    auto p = edgestatus_.find(edgeid.tile_value());
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()] = {set, index};
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value(),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      inserted.first->second[edgeid.id()] = {set, index};
-    }
+  void Set(const baldr::GraphId& edgeid,
+           const EdgeSet set,
+           const uint32_t index,
+           const graph_tile_ptr& tile) {
+    *GetPtr(edgeid, tile) = {set, index};
   }
 
   /**
@@ -96,9 +132,9 @@ public:
    * @param  set      Label set for this directed edge.
    */
   void Update(const baldr::GraphId& edgeid, const EdgeSet set) {
-    const auto p = edgestatus_.find(edgeid.tile_value());
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()].set_ = static_cast<uint32_t>(set);
+    auto* edges = Find(edgeid.tile_value());
+    if (edges) {
+      edges[edgeid.id()].set_ = static_cast<uint32_t>(set);
     } else {
       throw std::runtime_error("EdgeStatus Update on edge not previously set");
     }
@@ -110,8 +146,20 @@ public:
    * @return  Returns edge status info.
    */
   EdgeStatusInfo Get(const baldr::GraphId& edgeid) const {
-    const auto p = edgestatus_.find(edgeid.tile_value());
-    return (p == edgestatus_.end()) ? EdgeStatusInfo() : p->second[edgeid.id()];
+    const auto* edges = Find(edgeid.tile_value());
+    return edges ? edges[edgeid.id()] : EdgeStatusInfo();
+  }
+
+  /**
+   * Get the status info of a directed edge given its GraphId without remembering its tile as the
+   * last one looked up. Unlike Get, any number of threads can call this at once as long as none
+   * of them changes the edge status.
+   * @param   edgeid  GraphId of the directed edge.
+   * @return  Returns edge status info.
+   */
+  EdgeStatusInfo Peek(const baldr::GraphId& edgeid) const {
+    const auto& slot = slots_[Probe(edgeid.tile_value())];
+    return slot.tile == kEmptyTile ? EdgeStatusInfo() : slot.edges[edgeid.id()];
   }
 
   /**
@@ -123,23 +171,260 @@ public:
    * @return  Returns a pointer to edge status info for this edge.
    */
   EdgeStatusInfo* GetPtr(const baldr::GraphId& edgeid, const graph_tile_ptr& tile) {
-    const auto p = edgestatus_.find(edgeid.tile_value());
-    if (p != edgestatus_.end()) {
-      return &p->second[edgeid.id()];
-    } else {
+    auto* edges = Find(edgeid.tile_value());
+    if (!edges) {
       // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
       // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value(),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      return &(inserted.first->second)[edgeid.id()];
+      edges = Insert(edgeid.tile_value(), tile->header()->directededgecount());
     }
+    return &edges[edgeid.id()];
   }
 
 private:
-  // Edge status - keys are the tile Ids (level and tile Id) and the
-  // values are dynamically allocated arrays of EdgeStatusInfo (sized
-  // based on the directed edge count within the tile).
-  std::unordered_map<uint32_t, EdgeStatusInfo*> edgestatus_;
+  // tile values are 25 bits so this can never be a real one
+  static constexpr uint32_t kEmptyTile = std::numeric_limits<uint32_t>::max();
+  // plenty for a typical route, the table doubles whenever it gets half full
+  static constexpr size_t kInitialSlots = 64;
+  // the most edges worth of arrays we hold on to between searches (32MB)
+  static constexpr size_t kMaxPooledEdges = 8 * 1024 * 1024;
+
+  struct slot_t {
+    uint32_t tile = kEmptyTile;
+    EdgeStatusInfo* edges = nullptr;
+  };
+
+  static uint32_t Hash(uint32_t tile_value) {
+    // tile ids are sequential so mix the bits before we use the low ones
+    uint32_t h = tile_value * 0x9E3779B1u;
+    return h ^ (h >> 16);
+  }
+
+  // the slot holding this tile or the empty one where it would go
+  size_t Probe(uint32_t tile_value) const {
+    const size_t mask = slots_.size() - 1;
+    size_t i = Hash(tile_value) & mask;
+    while (slots_[i].tile != kEmptyTile && slots_[i].tile != tile_value) {
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+
+  // the edge status array of this tile, or nullptr if we havent seen the tile
+  EdgeStatusInfo* Find(uint32_t tile_value) const {
+    if (tile_value == last_tile_) {
+      return last_edges_;
+    }
+    const auto& slot = slots_[Probe(tile_value)];
+    if (slot.tile == kEmptyTile) {
+      return nullptr;
+    }
+    last_tile_ = tile_value;
+    last_edges_ = slot.edges;
+    return slot.edges;
+  }
+
+  // get an array from the pool (or a new one) for this tile and put it in the table
+  EdgeStatusInfo* Insert(uint32_t tile_value, uint32_t edge_count) {
+    if ((size_ + 1) * 2 > slots_.size()) {
+      Grow();
+    }
+
+    // pooled arrays are all reset already, we only have to initialize what they are missing
+    std::vector<EdgeStatusInfo> edges;
+    if (arena_) {
+      arena_->Acquire(edges);
+    } else if (!pool_.empty()) {
+      edges = std::move(pool_.back());
+      pool_.pop_back();
+      pooled_edges_ -= edges.size();
+    }
+    if (edges.size() < edge_count) {
+      edges.resize(edge_count);
+    }
+    in_use_.emplace_back(std::move(edges));
+
+    auto* array = in_use_.back().data();
+    slots_[Probe(tile_value)] = {tile_value, array};
+    ++size_;
+    last_tile_ = tile_value;
+    last_edges_ = array;
+    return array;
+  }
+
+  // double the size of the table and put everything back in it
+  void Grow() {
+    std::vector<slot_t> old(slots_.size() * 2);
+    old.swap(slots_);
+    for (const auto& slot : old) {
+      if (slot.tile != kEmptyTile) {
+        slots_[Probe(slot.tile)] = slot;
+      }
+    }
+  }
+
+  // Edge status - open addressing table from tile id (level and tile id) to
+  // the array of EdgeStatusInfo (sized based on the directed edge count
+  // within the tile) of that tile.
+  std::vector<slot_t> slots_;
+  size_t size_;
+
+  // the arrays in the table and the ones left over from previous searches
+  std::vector<std::vector<EdgeStatusInfo>> in_use_;
+  std::vector<std::vector<EdgeStatusInfo>> pool_;
+  size_t pooled_edges_;
+  std::shared_ptr<SearchArena> arena_;
+
+  // the last tile we looked up
+  mutable uint32_t last_tile_;
+  mutable EdgeStatusInfo* last_edges_;
+};
+
+/**
+ * The set of edges one search has settled, for another search running at the
+ * same time to look its connections up in. Only the thread of the search that
+ * owns the set adds to it, any number of threads can check it meanwhile
+ * without taking a lock.
+ *
+ * Like EdgeStatus the edges are kept in an array for each tile found through
+ * an open addressing table, only here they are bits. Arrays and slots are
+ * published after they are filled in and never change hands until clear, and
+ * when the table grows the old one stays around for readers still in it. All
+ * of it is sequentially consistent: when two searches add opposing edges and
+ * then check for each other's, at least one of them finds the other.
+ */
+class SharedEdgeSet {
+public:
+  SharedEdgeSet() : table_(nullptr), size_(0), last_tile_(kEmptyTile), last_bits_(nullptr) {
+  }
+
+  ~SharedEdgeSet() {
+    clear();
+  }
+
+  SharedEdgeSet(const SharedEdgeSet&) = delete;
+  SharedEdgeSet& operator=(const SharedEdgeSet&) = delete;
+
+  /**
+   * Clear the set. No other thread may be using it.
+   */
+  void clear() {
+    tables_.clear();
+    bits_.clear();
+    table_.store(nullptr);
+    size_ = 0;
+    last_tile_ = kEmptyTile;
+    last_bits_ = nullptr;
+  }
+
+  /**
+   * Add a directed edge to the set. Only one thread may do this.
+   * @param  edgeid  GraphId of the directed edge.
+   * @param  tile    Graph tile of the directed edge.
+   */
+  void Add(const baldr::GraphId& edgeid, const graph_tile_ptr& tile) {
+    const uint32_t tile_value = edgeid.tile_value();
+    if (tile_value != last_tile_) {
+      last_bits_ = Find(tile_value);
+      if (!last_bits_) {
+        last_bits_ = Insert(tile_value, tile->header()->directededgecount());
+      }
+      last_tile_ = tile_value;
+    }
+    last_bits_[edgeid.id() / 64].fetch_or(uint64_t(1) << (edgeid.id() % 64));
+  }
+
+  /**
+   * Whether a directed edge is in the set. Any thread may do this at any time.
+   * @param  edgeid  GraphId of the directed edge.
+   * @return Returns true if the edge was added.
+   */
+  bool Contains(const baldr::GraphId& edgeid) const {
+    const auto* bits = Find(edgeid.tile_value());
+    return bits && (bits[edgeid.id() / 64].load() & (uint64_t(1) << (edgeid.id() % 64)));
+  }
+
+private:
+  // slots hold the tile value plus one so that zeroed ones are empty
+  static constexpr uint32_t kEmptyTile = 0;
+  static constexpr size_t kInitialSlots = 64;
+
+  struct slot_t {
+    std::atomic<uint32_t> tile{kEmptyTile};
+    std::atomic<std::atomic<uint64_t>*> bits{nullptr};
+  };
+
+  struct table_t {
+    explicit table_t(size_t size) : slots(new slot_t[size]), size(size) {
+    }
+    std::unique_ptr<slot_t[]> slots;
+    size_t size;
+  };
+
+  static uint32_t Hash(uint32_t tile_value) {
+    uint32_t h = tile_value * 0x9E3779B1u;
+    return h ^ (h >> 16);
+  }
+
+  // the slot holding this tile or the empty one where it would go
+  static slot_t& Probe(const table_t& table, uint32_t key) {
+    const size_t mask = table.size - 1;
+    size_t i = Hash(key) & mask;
+    uint32_t tile;
+    while ((tile = table.slots[i].tile.load()) != kEmptyTile && tile != key) {
+      i = (i + 1) & mask;
+    }
+    return table.slots[i];
+  }
+
+  std::atomic<uint64_t>* Find(uint32_t tile_value) const {
+    const auto* table = table_.load();
+    if (!table) {
+      return nullptr;
+    }
+    const auto& slot = Probe(*table, tile_value + 1);
+    return slot.tile.load() == kEmptyTile ? nullptr : slot.bits.load();
+  }
+
+  // a zeroed array for this tile, put in the table after a copy of it grown if it is half full
+  std::atomic<uint64_t>* Insert(uint32_t tile_value, uint32_t edge_count) {
+    auto* table = table_.load();
+    if (!table || (size_ + 1) * 2 > table->size) {
+      tables_.emplace_back(new table_t(table ? table->size * 2 : kInitialSlots));
+      auto* grown = tables_.back().get();
+      if (table) {
+        for (size_t i = 0; i < table->size; ++i) {
+          const auto key = table->slots[i].tile.load();
+          if (key != kEmptyTile) {
+            Publish(Probe(*grown, key), key, table->slots[i].bits.load());
+          }
+        }
+      }
+      table_.store(grown);
+      table = grown;
+    }
+
+    bits_.emplace_back(new std::atomic<uint64_t>[(edge_count + 63) / 64]());
+    auto* bits = bits_.back().get();
+    Publish(Probe(*table, tile_value + 1), tile_value + 1, bits);
+    ++size_;
+    return bits;
+  }
+
+  // readers see the tile only once its array is there
+  static void Publish(slot_t& slot, uint32_t key, std::atomic<uint64_t>* bits) {
+    slot.bits.store(bits);
+    slot.tile.store(key);
+  }
+
+  // the current table and every one before it since the last clear
+  std::atomic<table_t*> table_;
+  std::vector<std::unique_ptr<table_t>> tables_;
+  size_t size_;
+  std::vector<std::unique_ptr<std::atomic<uint64_t>[]>> bits_;
+
+  // the last tile added to, only the owner uses these
+  uint32_t last_tile_;
+  std::atomic<uint64_t>* last_bits_;
 };
 
 } // namespace thor
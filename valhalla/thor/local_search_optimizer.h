@@ -0,0 +1,106 @@
+#ifndef VALHALLA_THOR_LOCAL_SEARCH_OPTIMIZER_H_
+#define VALHALLA_THOR_LOCAL_SEARCH_OPTIMIZER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Optimizes the order of locations with local search, keeping the first location (origin) and
+ * the last location (destination) fixed like the simulated annealing Optimizer does. Each start
+ * builds a tour with nearest insertion, or inserts the locations in a random order after the
+ * first start, and then improves it with 2-opt and Or-opt moves until none of them help. Only
+ * the moves that connect a location to one of its nearest neighbors are tried so a pass over the
+ * tour is linear in the number of locations rather than quadratic. The costs do not have to be
+ * symmetric.
+ *
+ * The starts are spread over threads and the best tour of them all is returned. Every start is
+ * seeded by its index so the tour does not depend on the number of threads. Without a time limit
+ * the same locations and costs always give the same tour. With one the tour depends on how many
+ * starts got done in time, so a time limit trades reproducible tours for bounded latency.
+ */
+class LocalSearchOptimizer {
+public:
+  // Number of nearest neighbors of each location the moves connect it to
+  static constexpr uint32_t kDefaultNeighbors = 10;
+
+  /**
+   * Constructor.
+   * @param  thread_count  Number of threads to run the starts on.
+   * @param  starts        Number of tours to build and improve, the best of them is returned.
+   * @param  max_time      Milliseconds after which no more starts are begun and the one that is
+   *                       running stops improving its tour, 0 to take as long as it takes. The
+   *                       first start always gets a complete tour. Any limit makes the tour
+   *                       depend on the load of the machine.
+   * @param  neighbors     Number of nearest neighbors of each location the moves connect it to.
+   */
+  explicit LocalSearchOptimizer(const uint32_t thread_count = 1,
+                                const uint32_t starts = 8,
+                                const uint32_t max_time = 0,
+                                const uint32_t neighbors = kDefaultNeighbors);
+
+  /**
+   * Optimize the tour through a set of locations given the cost matrix
+   * among all locations. The first location (origin) and last location
+   * (destination) remain fixed in the tour.
+   * @param  count  Number of locations.
+   * @param  costs  2-D cost matrix, the cost from location i to location j at i * count + j.
+   * @return Returns the tour as an updated order of locations visited to
+   *         complete the tour.
+   */
+  std::vector<uint32_t> Solve(const uint32_t count, const std::vector<float>& costs) const;
+
+  /**
+   * Get the cost for the specified tour (order of locations).
+   * @param  costs  2-D cost array between locations.
+   * @param  tour   Order that locations are traversed.
+   * @return Returns the total cost for the tour.
+   */
+  static double TourCost(const std::vector<float>& costs, const std::vector<uint32_t>& tour);
+
+protected:
+  using clock_t = std::chrono::steady_clock;
+
+  // The costs and nearest neighbors that all of the starts share
+  struct problem_t {
+    uint32_t count;
+    const std::vector<float>& costs;
+    std::vector<uint32_t> neighbors; // count rows of the nearest locations to each location
+    uint32_t neighbor_count;
+    bool limited;
+    clock_t::time_point deadline;
+
+    float cost(const uint32_t from, const uint32_t to) const {
+      return costs[from * count + to];
+    }
+    bool expired() const {
+      return limited && clock_t::now() >= deadline;
+    }
+  };
+
+  /**
+   * Builds a tour by inserting the location nearest to the tour so far at its cheapest position
+   * until all of them are in, or in a random order if a random generator is given.
+   */
+  static std::vector<uint32_t> Construct(const problem_t& problem, std::mt19937* random);
+
+  /**
+   * Improves the tour with 2-opt and Or-opt moves until none of them help or the time is up.
+   * @return Returns the cost of the improved tour.
+   */
+  static double Improve(const problem_t& problem, std::vector<uint32_t>& tour);
+
+  uint32_t thread_count_;
+  uint32_t starts_;
+  uint32_t max_time_;
+  uint32_t neighbors_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_LOCAL_SEARCH_OPTIMIZER_H_
@@ -14,6 +14,7 @@
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/searcharena.h>
 
 namespace valhalla {
 namespace thor {
@@ -30,7 +31,9 @@ public:
   /**
    * Constructor
    */
-  PathAlgorithm() : interrupt(nullptr), has_ferry_(false), expansion_callback_() {
+  PathAlgorithm()
+      : interrupt(nullptr), has_ferry_(false), expansion_callback_(),
+        arena_(std::make_shared<SearchArena>()) {
   }
 
   /**
@@ -78,6 +81,15 @@ public:
     interrupt = interrupt_callback;
   }
 
+  /**
+   * Sets the arena the algorithm takes the storage of its searches from, so that the algorithms
+   * of a worker can share theirs. Each algorithm has an arena of its own until then.
+   * @param  arena  The arena.
+   */
+  void set_search_arena(const std::shared_ptr<SearchArena>& arena) {
+    arena_ = arena;
+  }
+
   /**
    * Does the path include a ferry?
    * @return  Returns true if the path includes a ferry.
@@ -106,6 +118,9 @@ protected:
   // for tracking the expansion of the algorithm visually
   expansion_callback_t expansion_callback_;
 
+  // where the storage of the searches comes from and goes back to
+  std::shared_ptr<SearchArena> arena_;
+
   // when doing timezone differencing a timezone cache speeds up the computation
   baldr::DateTime::tz_sys_info_cache_t tz_cache_;
 
@@ -140,6 +155,9 @@ struct EdgeMetadata {
   const baldr::DirectedEdge* edge;
   baldr::GraphId edge_id;
   EdgeStatusInfo* edge_status;
+  // The routing edges of the tile, if it has them, so that the checks made on every edge
+  // dont have to touch the whole directed edge
+  const baldr::RoutingEdges* routing;
 
   inline static EdgeMetadata make(const baldr::GraphId& node,
                                   const baldr::NodeInfo* nodeinfo,
@@ -148,7 +166,34 @@ struct EdgeMetadata {
     baldr::GraphId edge_id = {node.tileid(), node.level(), nodeinfo->edge_index()};
     EdgeStatusInfo* edge_status = edge_status_.GetPtr(edge_id, tile);
     const baldr::DirectedEdge* directededge = tile->directededge(edge_id);
-    return {directededge, edge_id, edge_status};
+    const auto& routing_edges = tile->routing_edges();
+    return {directededge, edge_id, edge_status, routing_edges ? &routing_edges : nullptr};
+  }
+
+  inline bool is_shortcut() const {
+    return routing ? routing->is_shortcut(edge_id.id()) : edge->is_shortcut();
+  }
+
+  inline uint32_t shortcut() const {
+    return routing ? routing->shortcut(edge_id.id()) : edge->shortcut();
+  }
+
+  inline uint32_t superseded() const {
+    return routing ? routing->superseded(edge_id.id()) : edge->superseded();
+  }
+
+  inline uint32_t localedgeidx() const {
+    return routing ? routing->localedgeidx(edge_id.id()) : edge->localedgeidx();
+  }
+
+  inline uint32_t reverseaccess() const {
+    return routing ? routing->reverseaccess(edge_id.id()) : edge->reverseaccess();
+  }
+
+  // Whether the costing could allow the edge at all. Only checks access when the tile has
+  // routing edges, otherwise the full check in Allowed is cheaper than checking twice
+  inline bool accessible(const sif::DynamicCost& costing) const {
+    return !routing || costing.IsAccessible(*routing, edge_id.id());
   }
 
   inline EdgeMetadata& operator++() {
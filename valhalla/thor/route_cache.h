@@ -0,0 +1,172 @@
+#ifndef VALHALLA_THOR_ROUTE_CACHE_H_
+#define VALHALLA_THOR_ROUTE_CACHE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Keeps the routes thor found so that a request for the same route doesnt need another search.
+ * Routes are keyed by the edges the locations were correlated to, with the percent along them
+ * rounded so that locations snapped within a few centimeters of each other share a route, and by
+ * the rest of the options that go into the search such as the costing. The cache holds what thor
+ * adds to the request: the trip and the edges each location ended up on.
+ *
+ * Entries are dropped once they are older than the time to live, the least recently used go
+ * when the cache is over its number of entries or its size, and all of them go whenever speeds
+ * are published to the live traffic tiles since the routes may be different now. It is thread
+ * safe, the workers reading the same tiles share one through get_instance.
+ */
+class RouteCache {
+public:
+  static constexpr size_t kDefaultMaxEntries = 10000;
+  static constexpr size_t kDefaultMaxBytes = 256 * 1024 * 1024;
+  static constexpr uint32_t kDefaultTtl = 300;                  // seconds
+  static constexpr uint32_t kDefaultTrafficCheckInterval = 1000; // milliseconds
+  // percent along an edge is rounded to this many steps
+  static constexpr double kPercentAlongSteps = 100000.0;
+
+  struct stats_t {
+    size_t hits = 0;          // requests that got their route from the cache
+    size_t misses = 0;        // requests that had to search, including expired entries
+    size_t expirations = 0;   // entries dropped because they were too old
+    size_t evictions = 0;     // entries dropped to make room
+    size_t invalidations = 0; // entries dropped because the live traffic changed
+
+    double hit_rate() const {
+      return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0;
+    }
+  };
+
+  /**
+   * Constructor
+   * @param  max_entries              The most routes the cache holds.
+   * @param  max_bytes                The most bytes the routes of the cache take up.
+   * @param  ttl                      Seconds after which a route is not handed out anymore, 0 to
+   *                                  keep them until they are evicted.
+   * @param  traffic_check_interval   Milliseconds between looks at the live traffic tiles.
+   */
+  explicit RouteCache(size_t max_entries = kDefaultMaxEntries,
+                      size_t max_bytes = kDefaultMaxBytes,
+                      uint32_t ttl = kDefaultTtl,
+                      uint32_t traffic_check_interval = kDefaultTrafficCheckInterval);
+  virtual ~RouteCache() = default;
+
+  /**
+   * Gets the cache configured under thor.route_cache that the workers reading the same tiles
+   * share, or nothing if it isnt enabled.
+   * @param  config  The configuration.
+   * @return Returns the shared cache.
+   */
+  static std::shared_ptr<RouteCache> get_instance(const boost::property_tree::ptree& config);
+
+  /**
+   * Makes the key of the route for a request whose locations have been correlated.
+   * @param  request  The route request.
+   * @return Returns the key.
+   */
+  static std::string MakeKey(const Api& request);
+
+  /**
+   * Hands out the route for the key if there is one, putting the trip and the edges of the
+   * locations into the request. The inputs of the locations stay those of the request.
+   * @param  key      The key of the route.
+   * @param  request  The request to put the route into.
+   * @return Returns true if the route was in the cache.
+   */
+  bool Get(const std::string& key, Api& request);
+
+  /**
+   * Keeps the route thor found for the request, unless the traffic epoch it was found with is not
+   * the one of the cache. The route may have been found on speeds older than the routes of the
+   * cache then, or on speeds the routes of the cache were already dropped for.
+   * @param  key            The key of the route.
+   * @param  request        The request with the route found.
+   * @param  traffic_epoch  The traffic epoch of the cache when the search for the route started.
+   */
+  void Put(const std::string& key, const Api& request, uint64_t traffic_epoch);
+
+  /**
+   * Looks at the live traffic tiles if it has been long enough since the last look and drops all
+   * of the routes if speeds were published to them since.
+   * @param  reader  A reader of the tiles.
+   */
+  void CheckTraffic(const baldr::GraphReader& reader);
+
+  /**
+   * Drops all of the routes if the traffic epoch is not the one the routes were found with.
+   * @param  epoch  The traffic epoch.
+   */
+  void SetTrafficEpoch(uint64_t epoch);
+
+  /**
+   * Gets the traffic epoch the routes of the cache were found with.
+   */
+  uint64_t traffic_epoch() const;
+
+  /**
+   * Drops all of the routes.
+   */
+  void Clear();
+
+  /**
+   * Gets the statistics of the cache.
+   */
+  stats_t stats() const;
+
+  /**
+   * Gets the number of routes in the cache.
+   */
+  size_t size() const;
+
+protected:
+  using clock_t = std::chrono::steady_clock;
+
+  struct entry_t {
+    Trip trip;
+    google::protobuf::RepeatedPtrField<valhalla::Location> locations;
+    clock_t::time_point inserted;
+    size_t bytes;
+    std::list<std::string>::iterator lru;
+  };
+
+  // the time entries are aged by, tests can move it along
+  virtual clock_t::time_point now() const {
+    return clock_t::now();
+  }
+
+  // drops the entry from the cache, the caller holds the lock
+  void Erase(std::unordered_map<std::string, entry_t>::iterator entry);
+
+  size_t max_entries_;
+  size_t max_bytes_;
+  std::chrono::seconds ttl_;
+  std::chrono::milliseconds traffic_check_interval_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, entry_t> entries_;
+  std::list<std::string> lru_; // most recently used first
+  size_t bytes_;
+  uint64_t traffic_epoch_;
+  bool traffic_checked_;
+  clock_t::time_point last_traffic_check_;
+  stats_t stats_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_ROUTE_CACHE_H_
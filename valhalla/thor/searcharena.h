@@ -0,0 +1,245 @@
+#ifndef VALHALLA_THOR_SEARCHARENA_H_
+#define VALHALLA_THOR_SEARCHARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/label_queue.h>
+#include <valhalla/baldr/radix_heap_queue.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * The storage of the searches of one worker: edge label vectors, adjacency list buckets and edge
+ * status arrays. The path algorithms take their storage from the arena when a search starts and
+ * give it back when they are cleared, so a worker grows to the size of its searches once rather
+ * than reallocating all of it on every request. The arena never touches what is in the storage,
+ * it comes back out exactly as it was given back.
+ *
+ * What the arena keeps between searches follows a high water mark: each kind of storage keeps
+ * enough capacity for the most the searches of the last few trims used, so capacity is kept from
+ * one request to the next but is given back once an outlier drops out of the window. On top of
+ * that the arena never keeps more than a fixed number of bytes. Its not thread safe, each worker
+ * (or thread) needs its own.
+ *
+ * The arena also decides which kind of priority queue the algorithms sort their labels with, since
+ * it makes their adjacency lists.
+ */
+class SearchArena {
+public:
+  // how many trims back the high water mark goes
+  static constexpr uint32_t kDefaultWindow = 16;
+  // the most the arena keeps between searches
+  static constexpr size_t kDefaultMaxRetainedBytes = 256 * 1024 * 1024;
+
+  struct stats_t {
+    size_t retained_bytes = 0;   // capacity held for the next searches right now
+    size_t high_water_bytes = 0; // the most that was ever held at once
+    size_t trimmed_bytes = 0;    // capacity given back by the retention policy so far
+    size_t reused = 0;           // storage handed out from what was held
+    size_t allocated = 0;        // storage that had to start from nothing
+  };
+
+  /**
+   * Constructor
+   * @param  window              How many trims back the high water mark goes.
+   * @param  max_retained_bytes  The most the arena keeps between searches.
+   * @param  queue_type          The kind of adjacency list MakeQueue makes.
+   */
+  explicit SearchArena(uint32_t window = kDefaultWindow,
+                       size_t max_retained_bytes = kDefaultMaxRetainedBytes,
+                       baldr::QueueType queue_type = baldr::QueueType::kDoubleBucket);
+
+  /**
+   * Gives the storage the last storage of its kind that was given back, unless it already has
+   * some capacity of its own.
+   * @param  storage  The storage to fill.
+   */
+  template <typename T> void Acquire(std::vector<T>& storage) {
+    if (storage.capacity() > 0) {
+      return;
+    }
+    auto& pool = get_pool<T>();
+    if (pool.storage.empty()) {
+      ++stats_.allocated;
+      return;
+    }
+    ++stats_.reused;
+    storage = std::move(pool.storage.back());
+    pool.storage.pop_back();
+    const auto bytes = capacity_bytes(storage);
+    pool.retained -= bytes;
+    stats_.retained_bytes -= bytes;
+  }
+
+  /**
+   * Takes storage back for the next search, leaving it without any capacity. The size of the
+   * storage is what the search used as far as the high water mark goes.
+   * @param  storage  The storage to take.
+   */
+  template <typename T> void Release(std::vector<T>& storage) {
+    if (storage.capacity() == 0) {
+      return;
+    }
+    auto& pool = get_pool<T>();
+    const auto bytes = capacity_bytes(storage);
+    pool.used += used_bytes(storage);
+    pool.retained += bytes;
+    pool.storage.emplace_back(std::move(storage));
+    storage = std::vector<T>();
+    stats_.retained_bytes += bytes;
+    stats_.high_water_bytes = std::max(stats_.high_water_bytes, stats_.retained_bytes);
+    released_ = true;
+  }
+
+  /**
+   * Makes an adjacency list of the kind the arena is set to whose buckets come from the arena.
+   * @param  mincost     Minimum cost of the low level buckets of a double bucket queue.
+   * @param  range       Cost range of the low level buckets of a double bucket queue.
+   * @param  bucketsize  Range of costs within a bucket of a double bucket queue.
+   * @param  labels      The labels the adjacency list sorts.
+   * @return Returns the adjacency list.
+   */
+  template <typename label_t>
+  std::unique_ptr<baldr::LabelQueue<label_t>> MakeQueue(const float mincost,
+                                                        const float range,
+                                                        const uint32_t bucketsize,
+                                                        const std::vector<label_t>& labels) {
+    baldr::buckets_t buckets;
+    Acquire(buckets);
+    if (queue_type_ == baldr::QueueType::kRadixHeap) {
+      return std::unique_ptr<baldr::LabelQueue<label_t>>(
+          new baldr::RadixHeapQueue<label_t>(labels, std::move(buckets)));
+    }
+    return std::unique_ptr<baldr::LabelQueue<label_t>>(
+        new baldr::DoubleBucketQueue<label_t>(mincost, range, bucketsize, labels,
+                                              std::move(buckets)));
+  }
+
+  /**
+   * Takes back the buckets of an adjacency list made by MakeQueue and resets it.
+   * @param  queue  Pointer to the adjacency list, if there is one.
+   */
+  template <typename queue_ptr_t> void ReleaseQueue(queue_ptr_t& queue) {
+    if (queue) {
+      auto buckets = queue->release();
+      Release(buckets);
+      queue.reset();
+    }
+  }
+
+  /**
+   * Ends a round of searches. Whatever kind of storage holds more than the most the rounds in the
+   * window used gives back the difference, then the arena as a whole gives back whatever is over
+   * its limit. A trim with nothing given back since the last one doesnt count as a round, so it
+   * doesnt matter how many algorithms trim after the same request.
+   */
+  void Trim();
+
+  /**
+   * Gets the statistics of the arena.
+   */
+  const stats_t& stats() const {
+    return stats_;
+  }
+
+  /**
+   * Sets the kind of adjacency list MakeQueue makes from now on.
+   * @param  queue_type  The kind of adjacency list.
+   */
+  void set_queue_type(const baldr::QueueType queue_type) {
+    queue_type_ = queue_type;
+  }
+
+  /**
+   * Gets the kind of adjacency list MakeQueue makes.
+   */
+  baldr::QueueType queue_type() const {
+    return queue_type_;
+  }
+
+protected:
+  struct pool_base_t {
+    virtual ~pool_base_t() {
+    }
+    // gives back storage until it holds no more than this, returns how much it gave back
+    virtual size_t trim(size_t bytes) = 0;
+
+    size_t retained = 0;       // capacity of the storage it holds
+    size_t used = 0;           // what was given back this round
+    std::deque<size_t> recent; // what was given back the last rounds
+  };
+
+  template <typename T> struct pool_t : public pool_base_t {
+    size_t trim(size_t bytes) override {
+      size_t trimmed = 0;
+      while (retained > bytes && !storage.empty()) {
+        auto& last = storage.back();
+        const auto have = capacity_bytes(last);
+        const auto others = retained - have;
+        if (others < bytes) {
+          // keep as much of the last of it as we are allowed
+          std::vector<T> smaller;
+          smaller.reserve((bytes - others) / sizeof(T));
+          last.swap(smaller);
+          retained = others + capacity_bytes(last);
+          trimmed += have - capacity_bytes(last);
+          break;
+        }
+        storage.pop_back();
+        retained = others;
+        trimmed += have;
+      }
+      return trimmed;
+    }
+
+    std::vector<std::vector<T>> storage;
+  };
+
+  template <typename T> static size_t capacity_bytes(const std::vector<T>& storage) {
+    return storage.capacity() * sizeof(T);
+  }
+  template <typename T> static size_t capacity_bytes(const std::vector<std::vector<T>>& storage) {
+    size_t bytes = storage.capacity() * sizeof(std::vector<T>);
+    for (const auto& inner : storage) {
+      bytes += inner.capacity() * sizeof(T);
+    }
+    return bytes;
+  }
+
+  // a drained adjacency list doesnt tell how full it got, so its buckets count as fully used
+  template <typename T> static size_t used_bytes(const std::vector<T>& storage) {
+    return storage.size() * sizeof(T);
+  }
+  template <typename T> static size_t used_bytes(const std::vector<std::vector<T>>& storage) {
+    return capacity_bytes(storage);
+  }
+
+  template <typename T> pool_t<T>& get_pool() {
+    auto& pool = pools_[std::type_index(typeid(T))];
+    if (!pool) {
+      pool.reset(new pool_t<T>());
+    }
+    return static_cast<pool_t<T>&>(*pool);
+  }
+
+  uint32_t window_;
+  size_t max_retained_bytes_;
+  bool released_;
+  baldr::QueueType queue_type_;
+  std::unordered_map<std::type_index, std::unique_ptr<pool_base_t>> pools_;
+  stats_t stats_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_SEARCHARENA_H_
@@ -6,7 +6,7 @@
 #include <utility>
 #include <vector>
 
-#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/time_info.h>
@@ -185,7 +185,7 @@ protected:
 
 private:
   // Adjacency list - approximate double bucket sort
-  std::shared_ptr<baldr::DoubleBucketQueue<sif::EdgeLabel>> adjacencylist_;
+  std::shared_ptr<baldr::LabelQueue<sif::EdgeLabel>> adjacencylist_;
 };
 
 /**
@@ -247,7 +247,7 @@ protected:
   std::vector<sif::BDEdgeLabel> edgelabels_rev_;
 
   // Adjacency list - approximate double bucket sort
-  std::shared_ptr<baldr::DoubleBucketQueue<sif::BDEdgeLabel>> adjacencylist_rev_;
+  std::shared_ptr<baldr::LabelQueue<sif::BDEdgeLabel>> adjacencylist_rev_;
 
   /**
    * Initializes the hierarchy limits, A* heuristic, and adjacency list.
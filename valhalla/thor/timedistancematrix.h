@@ -11,6 +11,7 @@
 #include <valhalla/baldr/double_bucket_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/time_info.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/astarheuristic.h>
@@ -38,13 +39,17 @@ struct Destination {
   uint32_t distance;   // Path distance for the best cost path
   float threshold;     // Threshold above current best cost where no longer
                        // need to search for this destination.
+  uint32_t best_label; // Edge label the best cost path reaches the
+                       // destination through
 
   // Potential edges for this destination (and their partial distance)
   std::unordered_map<uint64_t, float> dest_edges;
 
   // Constructor - set best_cost to an absurdly high value so any new cost
   // will be lower.
-  Destination() : settled(false), best_cost{kMaxCost, kMaxCost}, distance(0), threshold(0.0f) {
+  Destination()
+      : settled(false), best_cost{kMaxCost, kMaxCost}, distance(0), threshold(0.0f),
+        best_label(baldr::kInvalidLabel) {
   }
 };
 
@@ -76,6 +81,28 @@ public:
             const sif::TravelMode mode,
             const float max_matrix_distance);
 
+  /**
+   * One to many shortest paths. Expands once from the origin as OneToMany does and forms the path
+   * to each of the locations from the edge labels of that one expansion.
+   * @param  origin        Location of the origin.
+   * @param  locations     List of locations.
+   * @param  graphreader   Graph reader for accessing routing graph.
+   * @param  mode_costing  Costing methods.
+   * @param  mode          Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @param  max_cost      Cost beyond which the expansion stops even if some locations have not
+   *                       been found yet, 0 to only stop at the threshold of the distance.
+   * @return the path to each of the locations, empty for those that were not found
+   */
+  std::vector<std::vector<PathInfo>>
+  OneToManyPaths(const valhalla::Location& origin,
+                 const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+                 baldr::GraphReader& graphreader,
+                 const sif::mode_costing_t& mode_costing,
+                 const sif::TravelMode mode,
+                 const float max_matrix_distance,
+                 const float max_cost = 0.0f);
+
   /**
    * Many to one time and distance cost matrix. Computes time and distance
    * matrix from many locations to one destination location.
@@ -131,6 +158,28 @@ public:
                  const sif::TravelMode mode,
                  const float max_matrix_distance);
 
+  /**
+   * Forms a time distance matrix from the set of source locations to the set of target
+   * locations, expanding forward from every source at the time it departs at. Each edge is costed
+   * at the time the expansion reaches it, so with predicted and live speeds, as far as the flow
+   * mask of the costing allows, the matrix is the one at that time of day rather than the one of
+   * the time invariant speeds. Sources without a date_time depart at no particular time.
+   * @param  source_location_list  List of source/origin locations.
+   * @param  target_location_list  List of target/destination locations.
+   * @param  graphreader           Graph reader for accessing routing graph.
+   * @param  mode_costing          Costing methods.
+   * @param  mode                  Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @return time/distance from origin index to all other locations
+   */
+  std::vector<TimeDistance> TimeDependentSourceToTarget(
+      const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+      const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+      baldr::GraphReader& graphreader,
+      const sif::mode_costing_t& mode_costing,
+      const sif::TravelMode mode,
+      const float max_matrix_distance);
+
   /**
    * Clear the temporary information generated during time+distance
    * matrix construction.
@@ -168,6 +217,30 @@ protected:
 
   sif::TravelMode mode_;
 
+  // A timezone offset cache for the time dependent expansions
+  baldr::DateTime::tz_sys_info_cache_t tz_cache_;
+
+  /**
+   * Expands forward from the origin until every location is settled or the cost threshold (or the
+   * maximum cost when there is one) is passed.
+   * @param  origin        Location of the origin.
+   * @param  locations     List of locations.
+   * @param  graphreader   Graph reader for accessing routing graph.
+   * @param  mode_costing  Costing methods.
+   * @param  mode          Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @param  max_cost      Cost beyond which the expansion stops, 0 for none.
+   * @param  time_info     Time at the origin, invalid to expand at no particular time.
+   */
+  void ExpandOneToMany(const valhalla::Location& origin,
+                       const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+                       baldr::GraphReader& graphreader,
+                       const sif::mode_costing_t& mode_costing,
+                       const sif::TravelMode mode,
+                       const float max_matrix_distance,
+                       const float max_cost,
+                       const baldr::TimeInfo& time_info);
+
   /**
    * Expand from the node along the forward search path. Immediately expands
    * from the end node of any transition edge (so no transition edges are added
@@ -179,12 +252,14 @@ protected:
    * @param  pred_idx     Predecessor index into the EdgeLabel list.
    * @param  from_transition True if this method is called from a transition
    *                         edge.
+   * @param  time_info    Time at the origin, invalid to expand at no particular time.
    */
   void ExpandForward(baldr::GraphReader& graphreader,
                      const baldr::GraphId& node,
                      const sif::EdgeLabel& pred,
                      const uint32_t pred_idx,
-                     const bool from_transition);
+                     const bool from_transition,
+                     const baldr::TimeInfo& time_info);
 
   /**
    * Expand from the node along the reverse search path. Immediately expands
@@ -215,8 +290,11 @@ protected:
    * Sets the origin for a many to one time+distance matrix computation.
    * @param  graphreader   Graph reader for accessing routing graph.
    * @param  origin        Origin location information.
+   * @param  time_info     Time at the origin, invalid for no particular time.
    */
-  void SetOriginOneToMany(baldr::GraphReader& graphreader, const valhalla::Location& origin);
+  void SetOriginOneToMany(baldr::GraphReader& graphreader,
+                          const valhalla::Location& origin,
+                          const baldr::TimeInfo& time_info);
 
   /**
    * Sets the origin for a many to one time+distance matrix computation.
@@ -251,6 +329,7 @@ protected:
    * @param   edge          Directed edge
    * @param   pred          Predecessor information in shortest path.
    * @param   predindex     Predecessor index in EdgeLabels vector.
+   * @param   time_info     Time the edge was entered at, invalid for no particular time.
    * @return  Returns true if all destinations have been settled.
    */
   bool UpdateDestinations(const valhalla::Location& origin,
@@ -259,13 +338,22 @@ protected:
                           const baldr::DirectedEdge* edge,
                           const graph_tile_ptr& tile,
                           const sif::EdgeLabel& pred,
-                          const uint32_t predindex);
+                          const uint32_t predindex,
+                          const baldr::TimeInfo& time_info);
 
   /**
    * Form a time/distance matrix from the results.
    * @return  Returns a time distance matrix among locations.
    */
   std::vector<TimeDistance> FormTimeDistanceMatrix();
+
+  /**
+   * Form the path to a destination from the edge labels, ending partway along the edge of its
+   * best label.
+   * @param  dest  Destination to form the path to.
+   * @return Returns the path, empty if the destination was not found.
+   */
+  std::vector<PathInfo> FormPath(const Destination& dest) const;
 };
 
 } // namespace thor
@@ -2,7 +2,11 @@
 #define __VALHALLA_THOR_SERVICE_H__
 
 #include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/property_tree/ptree.hpp>
@@ -21,8 +25,13 @@
 #include <valhalla/thor/astar_bss.h>
 #include <valhalla/thor/attributes_controller.h>
 #include <valhalla/thor/bidirectional_astar.h>
+#include <valhalla/thor/contraction_hierarchy.h>
+#include <valhalla/thor/costmatrix.h>
 #include <valhalla/thor/isochrone.h>
+#include <valhalla/thor/local_search_optimizer.h>
 #include <valhalla/thor/multimodal.h>
+#include <valhalla/thor/route_cache.h>
+#include <valhalla/thor/searcharena.h>
 #include <valhalla/thor/timedep.h>
 #include <valhalla/thor/triplegbuilder.h>
 #include <valhalla/tyr/actor.h>
@@ -37,7 +46,12 @@ void run_service(const boost::property_tree::ptree& config);
 
 class thor_worker_t : public service_worker_t {
 public:
-  enum SOURCE_TO_TARGET_ALGORITHM { SELECT_OPTIMAL = 0, COST_MATRIX = 1, TIME_DISTANCE_MATRIX = 2 };
+  enum SOURCE_TO_TARGET_ALGORITHM {
+    SELECT_OPTIMAL = 0,
+    COST_MATRIX = 1,
+    TIME_DISTANCE_MATRIX = 2,
+    BUCKET_MATRIX = 3
+  };
   thor_worker_t(const boost::property_tree::ptree& config,
                 const std::shared_ptr<baldr::GraphReader>& graph_reader = {});
   virtual ~thor_worker_t();
@@ -57,24 +71,97 @@ public:
   void route(Api& request);
   std::string matrix(Api& request);
   void optimized_route(Api& request);
+  void one_to_many(Api& request);
   std::string isochrones(Api& request);
+  // Gets the index of a location of a batch and the geojson of its isochrone as soon as it is done
+  using isochrone_callback_t = std::function<void(size_t, const std::string&)>;
+  std::string batch_isochrones(Api& request, const isochrone_callback_t& on_isochrone = nullptr);
   void trace_route(Api& request);
   std::string trace_attributes(Api& request);
   std::string expansion(Api& request);
 
   void set_interrupt(const std::function<void()>* interrupt) override;
 
+  /**
+   * Gets the statistics of the storage the path algorithms share between requests.
+   */
+  const SearchArena::stats_t& search_arena_stats() const {
+    return search_arena->stats();
+  }
+
+  /**
+   * Gets the statistics of the route cache, all zero if the cache isnt enabled.
+   */
+  RouteCache::stats_t route_cache_stats() const {
+    return route_cache ? route_cache->stats() : RouteCache::stats_t{};
+  }
+
 protected:
-  std::vector<std::vector<thor::PathInfo>> get_path(PathAlgorithm* path_algorithm,
+  // The reader, costing and path algorithms a leg of a route is found with. The worker finds legs
+  // with its own and each of its leg threads with those of the thread
+  struct path_context_t {
+    baldr::GraphReader& reader;
+    sif::mode_costing_t& mode_costing;
+    BidirectionalAStar& bidir_astar;
+    TimeDepForward& timedep_forward;
+    TimeDepReverse& timedep_reverse;
+    ContractionHierarchyQuery& ch_query;
+    const std::function<void()>* interrupt;
+  };
+
+  // A thread that finds the legs of a route which do not depend on each other alongside the
+  // worker. It reads the tiles with a reader of its own, which shares the tile cache of the
+  // worker when mjolnir.global_synchronized_cache is set
+  struct leg_thread_t {
+    leg_thread_t(const boost::property_tree::ptree& config);
+    path_context_t context();
+
+    std::shared_ptr<baldr::GraphReader> reader;
+    sif::mode_costing_t mode_costing;
+    std::shared_ptr<SearchArena> search_arena;
+    BidirectionalAStar bidir_astar;
+    TimeDepForward timedep_forward;
+    TimeDepReverse timedep_reverse;
+    ContractionHierarchyQuery ch_query;
+  };
+
+  // A thread that computes the isochrones of a batch alongside the worker. Its reader, search
+  // storage and isotile are kept from one batch to the next
+  struct isochrone_thread_t {
+    isochrone_thread_t(const boost::property_tree::ptree& config);
+
+    std::shared_ptr<baldr::GraphReader> reader;
+    sif::mode_costing_t mode_costing;
+    std::shared_ptr<SearchArena> search_arena;
+    Isochrone isochrone;
+  };
+
+  // A leg found before the legs are put together
+  struct leg_result_t {
+    // the paths of the leg, or rethrows what finding them threw
+    std::vector<std::vector<thor::PathInfo>> take_paths();
+
+    std::string algorithm;
+    std::vector<std::vector<thor::PathInfo>> paths;
+    std::exception_ptr error;
+  };
+
+  path_context_t context();
+  std::vector<std::vector<thor::PathInfo>> get_path(const path_context_t& context,
+                                                    PathAlgorithm* path_algorithm,
                                                     Location& origin,
                                                     Location& destination,
                                                     const std::string& costing,
                                                     const Options& options);
   void log_admin(const TripLeg&);
-  thor::PathAlgorithm* get_path_algorithm(const std::string& routetype,
+  thor::PathAlgorithm* get_path_algorithm(const path_context_t& context,
+                                          const std::string& routetype,
                                           const Location& origin,
                                           const Location& destination,
                                           const Options& options);
+  std::unordered_map<size_t, leg_result_t> find_independent_legs(Api& api,
+                                                                 const std::string& costing,
+                                                                 bool arrive_by);
   void route_match(Api& request);
   /**
    * Returns the results of the map match where the first float is the normalized
@@ -118,12 +205,22 @@ protected:
   MultiModalPathAlgorithm multi_modal_astar;
   TimeDepForward timedep_forward;
   TimeDepReverse timedep_reverse;
+  ContractionHierarchyQuery ch_query;
 
   Isochrone isochrone_gen;
   std::shared_ptr<meili::MapMatcher> matcher;
   float max_timedep_distance;
   std::unordered_map<std::string, float> max_matrix_distance;
   SOURCE_TO_TARGET_ALGORITHM source_to_target_algorithm;
+  std::shared_ptr<CostMatrix::Threads> costmatrix_threads;
+  bool time_dependent_matrix;
+  uint32_t contour_threads;
+  bool optimize_by_annealing;
+  LocalSearchOptimizer optimizer;
+  std::vector<std::unique_ptr<leg_thread_t>> leg_threads;
+  std::vector<std::unique_ptr<isochrone_thread_t>> isochrone_threads;
+  std::shared_ptr<SearchArena> search_arena;
+  std::shared_ptr<RouteCache> route_cache;
   meili::MapMatcherFactory matcher_factory;
   std::shared_ptr<baldr::GraphReader> reader;
   AttributesController controller;
@@ -30,9 +30,18 @@ public:
   std::string optimized_route(const std::string& request_str,
                               const std::function<void()>* interrupt = nullptr,
                               Api* api = nullptr);
+  std::string one_to_many(const std::string& request_str,
+                          const std::function<void()>* interrupt = nullptr,
+                          Api* api = nullptr);
   std::string isochrone(const std::string& request_str,
                         const std::function<void()>* interrupt = nullptr,
                         Api* api = nullptr);
+  // on_isochrone gets the index of each location and its isochrone as soon as that one is done
+  std::string batch_isochrone(
+      const std::string& request_str,
+      const std::function<void()>* interrupt = nullptr,
+      Api* api = nullptr,
+      const std::function<void(size_t, const std::string&)>& on_isochrone = nullptr);
   std::string trace_route(const std::string& request_str,
                           const std::function<void()>* interrupt = nullptr,
                           Api* api = nullptr);
@@ -46,6 +46,14 @@ std::string serializeIsochrones(const Api& request,
                                 bool polygons = true,
                                 bool show_locations = false);
 
+/**
+ * Turn the isochrones of a batch into a single response
+ *
+ * @param request     the batch isochrone request
+ * @param isochrones  the geojson of the isochrone of each location, in the order of the locations
+ */
+std::string serializeBatchIsochrones(const Api& request, std::vector<std::string>& isochrones);
+
 /**
  * Turn heights and ranges into a height response
  *